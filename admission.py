@@ -0,0 +1,118 @@
+import math
+import time
+import threading
+
+# note: admission control in front of the upstream calls. A bounded number of
+# requests run at once, a bounded number wait for a slot (and only for so
+# long), and every device has a token bucket so one chatty board cannot take
+# the whole server. Whatever is turned away is rejected right away instead of
+# slowing down the requests that were admitted.
+
+class Rejected(Exception):
+    def __init__(self, reason, retry_after):
+        super().__init__(reason)
+        self.reason = reason
+        self.retry_after = retry_after
+
+class DeadlineExceeded(Exception):
+    pass
+
+class TokenBucket:
+    def __init__(self, rate, burst):
+        self.rate = rate
+        self.burst = burst
+        self.tokens = burst
+        self.updated = time.monotonic()
+
+    def _refill(self, now):
+        self.tokens = min(self.burst, self.tokens + (now - self.updated) * self.rate)
+        self.updated = now
+
+    def take(self, now):
+        self._refill(now)
+        if self.tokens >= 1:
+            self.tokens -= 1
+            return True
+        return False
+
+    def wait_time(self):
+        return (1 - self.tokens) / self.rate
+
+    def full(self, now):
+        self._refill(now)
+        return self.tokens >= self.burst
+
+class AdmissionController:
+    # note: keep at most this many idle buckets around, full ones are dropped
+    MAX_BUCKETS = 1024
+
+    def __init__(self, max_active, max_queued, queue_timeout, device_rate, device_burst):
+        self.max_active = max_active
+        self.max_queued = max_queued
+        self.queue_timeout = queue_timeout
+        self.device_rate = device_rate
+        self.device_burst = device_burst
+
+        self._lock = threading.Lock()
+        self._slot_free = threading.Condition(self._lock)
+        self._active = 0
+        self._queued = 0
+        self._buckets = {} # device id -> TokenBucket
+
+    def _take_token(self, device, now):
+        bucket = self._buckets.get(device)
+        if bucket is None:
+            if len(self._buckets) >= self.MAX_BUCKETS:
+                for d in [d for d, b in self._buckets.items() if b.full(now)]:
+                    del self._buckets[d]
+            bucket = self._buckets[device] = TokenBucket(self.device_rate, self.device_burst)
+        if not bucket.take(now):
+            raise Rejected('rate_limited', math.ceil(bucket.wait_time()))
+
+    def acquire(self, device):
+        # note: raises Rejected when the device is over its rate or no slot
+        # frees up in time, otherwise the caller holds a slot until release()
+        with self._lock:
+            now = time.monotonic()
+            self._take_token(device, now)
+
+            if self._active >= self.max_active:
+                if self._queued >= self.max_queued:
+                    raise Rejected('queue_full', math.ceil(self.queue_timeout))
+
+                deadline = now + self.queue_timeout
+                self._queued += 1
+                try:
+                    while self._active >= self.max_active:
+                        remaining = deadline - time.monotonic()
+                        if remaining <= 0:
+                            raise Rejected('queue_timeout', math.ceil(self.queue_timeout))
+                        self._slot_free.wait(remaining)
+                finally:
+                    self._queued -= 1
+            self._active += 1
+
+    def release(self):
+        with self._lock:
+            self._active -= 1
+            self._slot_free.notify()
+
+    def stats(self):
+        with self._lock:
+            return {'active': self._active, 'queued': self._queued}
+
+class Deadline:
+    # note: end-to-end time budget of one request, every stage gets its own
+    # timeout but never more than what is left of the whole budget
+    def __init__(self, seconds, stage_timeouts):
+        self.expires = time.monotonic() + seconds
+        self.stage_timeouts = stage_timeouts
+
+    def remaining(self):
+        return self.expires - time.monotonic()
+
+    def timeout(self, stage):
+        remaining = self.remaining()
+        if remaining <= 0:
+            raise DeadlineExceeded(stage)
+        return min(self.stage_timeouts[stage], remaining)
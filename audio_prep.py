@@ -0,0 +1,133 @@
+import io
+import wave
+
+import numpy as np
+
+# note: preprocessing of an uploaded recording before it goes to speech-to-
+# text, all in memory: mix down to mono, trim leading and trailing silence by
+# frame energy, resample to the 16 kHz that Whisper works at and encode the
+# result as WAV (or FLAC/Opus when soundfile is installed). Resampling alone
+# takes a third off the device's 24 kHz recordings, trimming the silence the
+# push-to-talk button leaves around a command usually takes off more.
+
+TARGET_RATE = 16000
+
+FRAME_SECONDS = 0.02
+# note: keep some audio around the detected speech so soft onsets and word
+# endings are not clipped
+PAD_SECONDS = 0.2
+# note: a frame is speech when its RMS is this many times above the noise
+# floor (the 10th percentile frame) and above an absolute floor of -50 dBFS.
+# The threshold never exceeds half the loudest frame, so a recording without
+# any pause is kept whole.
+NOISE_FLOOR_RATIO = 3.0
+MIN_SPEECH_RMS = 32768 * 10 ** (-50 / 20)
+
+# note: container and soundfile subtype for each upload format
+FORMATS = {
+    'wav':  ('WAV', 'PCM_16'),
+    'flac': ('FLAC', 'PCM_16'),
+    'opus': ('OGG', 'OPUS'),
+}
+
+class UnsupportedAudio(ValueError):
+    pass
+
+class PreparedAudio:
+    def __init__(self, samples, rate, filename, data):
+        self.samples = samples   # numpy int16 array of mono samples
+        self.rate = rate
+        self.filename = filename # name with an extension the ASR recognizes
+        self.data = data         # encoded file contents
+
+    def seconds(self):
+        return len(self.samples) / self.rate
+
+def to_mono16(data, bits, ch):
+    if bits == 16:
+        samples = np.frombuffer(data, dtype='<i2', count=len(data) // 2).astype(np.int16)
+    elif bits == 8:
+        samples = (np.frombuffer(data, dtype=np.uint8).astype(np.int16) - 128) << 8
+    elif bits == 32:
+        samples = (np.frombuffer(data, dtype='<i4', count=len(data) // 4) >> 16).astype(np.int16)
+    else:
+        raise UnsupportedAudio(f'unsupported sample width: {bits} bits')
+
+    if ch > 1:
+        frames = len(samples) // ch
+        mixed = samples[:frames * ch].reshape(frames, ch).sum(axis=1, dtype=np.int32) // ch
+        samples = mixed.astype(np.int16)
+    return samples
+
+def trim_silence(samples, rate):
+    frame = max(1, int(rate * FRAME_SECONDS))
+    if not len(samples):
+        return samples
+    # note: the last frame may be short, its RMS is over the samples it has
+    squares = samples.astype(np.float64) ** 2
+    full = len(samples) // frame
+    rms = squares[:full * frame].reshape(full, frame).mean(axis=1)
+    if len(samples) % frame:
+        rms = np.append(rms, squares[full * frame:].mean())
+    rms = np.sqrt(rms)
+
+    noise_floor = np.sort(rms)[len(rms) // 10]
+    threshold = max(MIN_SPEECH_RMS, min(noise_floor * NOISE_FLOOR_RATIO, rms.max() / 2))
+    voiced = np.flatnonzero(rms >= threshold)
+    if not len(voiced):
+        return samples[:0]
+
+    pad = int(PAD_SECONDS / FRAME_SECONDS)
+    first = max(0, voiced[0] - pad) * frame
+    last = min(len(rms), voiced[-1] + 1 + pad) * frame
+    return samples[first:last]
+
+def resample(samples, rate, target_rate):
+    if rate == target_rate or not len(samples):
+        return samples
+
+    step = rate / target_rate
+    wide = samples.astype(np.int32)
+    if step > 1:
+        # note: [1 2 1] low-pass before decimating, 12 dB down at the new
+        # Nyquist for 24 kHz -> 16 kHz, plenty for speech recognition
+        padded = np.pad(wide, 1, mode='edge')
+        wide = (padded[:-2] + 2 * padded[1:-1] + padded[2:]) >> 2
+
+    n = len(wide)
+    position = np.arange(int(n / step)) * step
+    j = position.astype(np.int64)
+    frac = position - j
+    a = wide[j]
+    b = wide[np.minimum(j + 1, n - 1)]
+    return np.trunc(a + (b - a) * frac).astype(np.int16)
+
+def encode(samples, rate, fmt):
+    if fmt != 'wav':
+        try:
+            import soundfile
+        except ImportError:
+            soundfile = None
+        if soundfile is not None:
+            container, subtype = FORMATS[fmt]
+            buf = io.BytesIO()
+            # note: Opus only supports 48/24/16/12/8 kHz, 16 kHz is one of them
+            soundfile.write(buf, samples, rate, subtype=subtype, format=container)
+            extension = 'ogg' if container == 'OGG' else fmt
+            return f'speech.{extension}', buf.getvalue()
+
+    buf = io.BytesIO()
+    with wave.open(buf, 'wb') as wavfile:
+        wavfile.setparams((1, 2, rate, 0, 'NONE', 'NONE'))
+        wavfile.writeframes(samples.astype('<i2').tobytes())
+    return 'speech.wav', buf.getvalue()
+
+def prepare(data, rates, bits, ch, fmt='wav', trim=True):
+    if rates <= 0 or ch < 1:
+        raise UnsupportedAudio(f'unsupported format: {rates} Hz, {ch} channel(s)')
+    samples = to_mono16(data, bits, ch)
+    if trim:
+        samples = trim_silence(samples, rates)
+    samples = resample(samples, rates, TARGET_RATE)
+    filename, encoded = encode(samples, TARGET_RATE, fmt)
+    return PreparedAudio(samples, TARGET_RATE, filename, encoded)
@@ -0,0 +1,212 @@
+import io
+import os
+import wave
+import shutil
+import threading
+import subprocess
+
+# note: the three upstream stages of a request (speech-to-text, chat and
+# text-to-speech) behind one small interface each, so every stage can be
+# served by OpenAI or by a local engine on the same machine or LAN:
+#
+#   asr.transcribe(audio, timeout)              -> text
+#   chat.complete(messages, max_tokens, timeout) -> text
+#   chat.route(messages, tools, max_tokens, timeout)
+#                                               -> text, [(tool name, JSON arguments)]
+#   tts.synthesize(text, fmt, timeout)           -> audio bytes
+#
+# local engines are loaded once when the backend is created and stay resident
+# for the lifetime of the server. They run on the CPU and are not thread-safe,
+# so each one serializes its own calls, and the timeout is only honored by the
+# network backends (admission control already bounds the local queue).
+
+class OpenAIASR:
+    def __init__(self, client, model):
+        self.client = client
+        self.model = model
+
+    def transcribe(self, audio, timeout=None):
+        # note: audio is an audio_prep.PreparedAudio, uploaded from memory
+        return self.client.audio.transcriptions.create(
+            model=self.model,
+            file=(audio.filename, audio.data),
+            response_format="text",
+            timeout=timeout
+        )
+
+class OpenAIChat:
+    def __init__(self, client, model):
+        self.client = client
+        self.model = model
+
+    def complete(self, messages, max_tokens, timeout=None):
+        return self.client.chat.completions.create(
+            model=self.model,
+            messages=messages,
+            max_tokens=max_tokens,
+            timeout=timeout
+        ).choices[0].message.content
+
+    def route(self, messages, tools, max_tokens, timeout=None):
+        message = self.client.chat.completions.create(
+            model=self.model,
+            messages=messages,
+            tools=tools,
+            tool_choice="auto",
+            max_tokens=max_tokens,
+            timeout=timeout
+        ).choices[0].message
+        calls = [(call.function.name, call.function.arguments) for call in message.tool_calls or []]
+        return message.content or '', calls
+
+class OpenAITTS:
+    def __init__(self, client, model, voice):
+        self.client = client
+        self.model = model
+        self.voice = voice
+
+    def synthesize(self, text, fmt, timeout=None):
+        return self.client.audio.speech.create(
+            model=self.model,
+            voice=self.voice,
+            input=text,
+            response_format=fmt,
+            timeout=timeout
+        ).content
+
+class WhisperCppASR:
+    def __init__(self, model_path, threads):
+        from pywhispercpp.model import Model
+
+        self.model = os.path.basename(model_path)
+        self._whisper = Model(model_path, n_threads=threads, print_progress=False, print_realtime=False)
+        self._lock = threading.Lock()
+
+    def transcribe(self, audio, timeout=None):
+        # note: whisper.cpp takes float32 samples at 16 kHz, mono, which is
+        # what audio_prep already produced
+        import numpy as np
+
+        samples = np.frombuffer(audio.samples, dtype=np.int16).astype(np.float32) / 32768
+        with self._lock:
+            segments = self._whisper.transcribe(samples)
+        return ''.join(segment.text for segment in segments).strip()
+
+class LlamaCppChat:
+    def __init__(self, model_path, threads, context_tokens):
+        from llama_cpp import Llama
+
+        self.model = os.path.basename(model_path)
+        self._llama = Llama(model_path=model_path, n_ctx=context_tokens, n_threads=threads, verbose=False)
+        self._lock = threading.Lock()
+
+    def complete(self, messages, max_tokens, timeout=None):
+        with self._lock:
+            response = self._llama.create_chat_completion(messages=list(messages), max_tokens=max_tokens)
+        return response['choices'][0]['message']['content'].strip()
+
+    def route(self, messages, tools, max_tokens, timeout=None):
+        # note: tool calls need a GGUF whose chat template supports them,
+        # other models simply answer in text
+        with self._lock:
+            response = self._llama.create_chat_completion(messages=list(messages), tools=tools,
+                                                          tool_choice="auto", max_tokens=max_tokens)
+        message = response['choices'][0]['message']
+        calls = [(call['function']['name'], call['function']['arguments']) for call in message.get('tool_calls') or []]
+        return (message.get('content') or '').strip(), calls
+
+def encode_mp3(pcm, rate, channels):
+    # note: the board only decodes MP3, prefer the in-process LAME binding and
+    # fall back to an ffmpeg binary
+    try:
+        import lameenc
+    except ImportError:
+        lameenc = None
+
+    if lameenc is not None:
+        encoder = lameenc.Encoder()
+        encoder.set_bit_rate(64)
+        encoder.set_in_sample_rate(rate)
+        encoder.set_channels(channels)
+        encoder.set_quality(2)
+        return bytes(encoder.encode(pcm) + encoder.flush())
+
+    if shutil.which('ffmpeg'):
+        return subprocess.run(
+            ['ffmpeg', '-loglevel', 'error', '-f', 's16le', '-ar', str(rate), '-ac', str(channels), '-i', 'pipe:0',
+             '-f', 'mp3', '-b:a', '64k', 'pipe:1'],
+            input=pcm, stdout=subprocess.PIPE, check=True
+        ).stdout
+
+    raise RuntimeError('MP3 output needs the lameenc package or ffmpeg')
+
+class PiperTTS:
+    def __init__(self, voice_path):
+        from piper import PiperVoice
+
+        self.model = 'piper'
+        self.voice = os.path.basename(voice_path)
+        self._piper = PiperVoice.load(voice_path)
+        self._lock = threading.Lock()
+
+    def synthesize(self, text, fmt, timeout=None):
+        buf = io.BytesIO()
+        with self._lock, wave.open(buf, 'wb') as wavfile:
+            # note: piper 1.3 renamed synthesize() to synthesize_wav()
+            if hasattr(self._piper, 'synthesize_wav'):
+                self._piper.synthesize_wav(text, wavfile)
+            else:
+                self._piper.synthesize(text, wavfile)
+
+        if fmt == 'wav':
+            return buf.getvalue()
+        if fmt != 'mp3':
+            raise ValueError(f'unsupported output format: {fmt}')
+
+        buf.seek(0)
+        with wave.open(buf, 'rb') as wavfile:
+            return encode_mp3(wavfile.readframes(wavfile.getnframes()), wavfile.getframerate(), wavfile.getnchannels())
+
+class Settings:
+    def __init__(self, **settings):
+        self.__dict__.update(settings)
+
+def create_backends(asr, chat, tts, settings):
+    # note: returns (asr, chat, tts). 'openai' also covers OpenAI-compatible
+    # servers on the LAN (llama.cpp's llama-server, whisper.cpp servers...)
+    # through the per-stage base URL. Clients are only created for stages that
+    # use them, so a fully local server needs no API key.
+    clients = {}
+    def openai_client(stage):
+        base_url = settings.base_urls.get(stage)
+        if base_url not in clients:
+            from openai import OpenAI
+            # note: no retries, a retried call would overrun its stage timeout
+            # and the device can simply ask again. Servers on the LAN usually
+            # take any API key.
+            api_key = os.environ.get('OPENAI_API_KEY') or ('local' if base_url else None)
+            clients[base_url] = OpenAI(base_url=base_url, api_key=api_key, max_retries=0)
+        return clients[base_url]
+
+    if asr == 'openai':
+        asr_backend = OpenAIASR(openai_client('asr'), settings.transcription_model)
+    elif asr == 'whispercpp':
+        asr_backend = WhisperCppASR(settings.whisper_model, settings.threads)
+    else:
+        raise ValueError(f'unknown speech-to-text backend: {asr}')
+
+    if chat == 'openai':
+        chat_backend = OpenAIChat(openai_client('chat'), settings.chat_model)
+    elif chat == 'llamacpp':
+        chat_backend = LlamaCppChat(settings.llama_model, settings.threads, settings.llama_context_tokens)
+    else:
+        raise ValueError(f'unknown chat backend: {chat}')
+
+    if tts == 'openai':
+        tts_backend = OpenAITTS(openai_client('tts'), settings.tts_model, settings.tts_voice)
+    elif tts == 'piper':
+        tts_backend = PiperTTS(settings.piper_voice)
+    else:
+        raise ValueError(f'unknown text-to-speech backend: {tts}')
+
+    return asr_backend, chat_backend, tts_backend
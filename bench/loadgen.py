@@ -0,0 +1,308 @@
+import os, sys
+import io
+import math
+import time
+import wave
+import glob
+import random
+import socket
+import argparse
+import tempfile
+import threading
+import subprocess
+
+from urllib import parse
+from http.client import HTTPConnection
+
+import mock_openai
+
+# note: load generator for smart_server.py. Every simulated device replays a
+# WAV with the same chunked upload as _http_stream_event_handler in
+# main/client.c (x-audio-* headers, one HTTP chunk per audio buffer, then the
+# 0-length terminator) and then GETs speech_response.mp3, like the play
+# pipeline does after [Rec] is released.
+#
+# latency is measured from the end of the upload (button release) until the
+# last byte of the answer arrived. With --spawn the mock backend and a server
+# in a scratch directory are started here, so a run needs no network at all.
+
+REPO_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+UPLOAD_PATH = 'upload'
+RESPONSE_PATH = 'speech_response.mp3'
+
+# note: http_stream hands the writer one ring buffer block at a time
+CHUNK_SIZE = 4096
+
+def make_tone_wav(seconds=2.0, rates=24000, bits=16, ch=1, silence=0.5):
+    # note: a tone with silence before and after, like a button press around
+    # a short command
+    buf = io.BytesIO()
+    with wave.open(buf, 'wb') as wavfile:
+        wavfile.setparams((ch, bits // 8, rates, 0, 'NONE', 'NONE'))
+        frames = bytearray()
+        for n in range(int((seconds + 2 * silence) * rates)):
+            t = n / rates
+            sample = int(8000 * math.sin(2 * math.pi * 440 * t)) if silence <= t < silence + seconds else 0
+            frames += sample.to_bytes(2, 'little', signed=True) * ch
+        wavfile.writeframes(bytes(frames))
+    buf.seek(0)
+    return buf
+
+class Recording:
+    def __init__(self, source, name):
+        with wave.open(source, 'rb') as wavfile:
+            self.rates = wavfile.getframerate()
+            self.bits = wavfile.getsampwidth() * 8
+            self.ch = wavfile.getnchannels()
+            self.pcm = wavfile.readframes(wavfile.getnframes())
+        self.name = name
+        self.seconds = len(self.pcm) / (self.rates * self.ch * self.bits // 8)
+
+def load_recordings(patterns):
+    recordings = []
+    for pattern in patterns:
+        for path in sorted(glob.glob(pattern)):
+            recordings.append(Recording(path, os.path.basename(path)))
+    if not recordings:
+        recordings.append(Recording(make_tone_wav(), 'tone.wav'))
+    return recordings
+
+class Result:
+    def __init__(self):
+        self.ok = False
+        self.rejected = False
+        self.status = None
+        self.error = None
+        self.upload_seconds = 0.0
+        self.latency_seconds = 0.0
+        self.response_bytes = 0
+
+def run_turn(host, port, device, recording, chunk_size, realtime, timeout):
+    result = Result()
+    try:
+        conn = HTTPConnection(host, port, timeout=timeout)
+        conn.putrequest('POST', '/' + UPLOAD_PATH)
+        conn.putheader('Transfer-Encoding', 'chunked')
+        conn.putheader('x-audio-sample-rates', str(recording.rates))
+        conn.putheader('x-audio-bits', str(recording.bits))
+        conn.putheader('x-audio-channel', str(recording.ch))
+        conn.putheader('x-device-id', device)
+        conn.endheaders()
+
+        start = time.perf_counter()
+        bytes_per_second = recording.rates * recording.ch * recording.bits // 8
+        for offset in range(0, len(recording.pcm), chunk_size):
+            chunk = recording.pcm[offset:offset + chunk_size]
+            if realtime:
+                # note: the device can only send audio as fast as it records it
+                wait = start + offset / bytes_per_second - time.perf_counter()
+                if wait > 0:
+                    time.sleep(wait)
+            conn.send(b'%x\r\n' % len(chunk) + chunk + b'\r\n')
+        conn.send(b'0\r\n\r\n')
+        released = time.perf_counter()
+        result.upload_seconds = released - start
+
+        response = conn.getresponse()
+        response.read()
+        conn.close()
+        result.status = response.status
+        if response.status == 503:
+            # note: turned away by admission control, the device still plays
+            # whatever the server pointed its response at (the busy clip)
+            result.rejected = True
+        elif response.status != 200:
+            result.error = f'upload status {response.status}'
+            return result
+
+        conn = HTTPConnection(host, port, timeout=timeout)
+        conn.request('GET', '/' + RESPONSE_PATH, headers={'x-device-id': device})
+        response = conn.getresponse()
+        result.response_bytes = len(response.read())
+        conn.close()
+        result.latency_seconds = time.perf_counter() - released
+        result.status = response.status
+        result.ok = response.status == 200 and not result.rejected
+        if response.status != 200:
+            result.error = f'response status {response.status}'
+    except (OSError, ValueError) as e:
+        result.error = f'{type(e).__name__}: {e}'
+    return result
+
+class ProcessSampler:
+    # note: samples CPU time and resident set size of the server from /proc
+    def __init__(self, pid, interval=0.1):
+        self.pid = pid
+        self.interval = interval
+        self.peak_rss = 0
+        self._stop = threading.Event()
+        self._thread = threading.Thread(target=self._run, daemon=True)
+
+    def _cpu_seconds(self):
+        with open(f'/proc/{self.pid}/stat') as file:
+            fields = file.read().rsplit(')', 1)[1].split()
+        return (int(fields[11]) + int(fields[12])) / os.sysconf('SC_CLK_TCK')
+
+    def _rss_bytes(self):
+        with open(f'/proc/{self.pid}/status') as file:
+            for line in file:
+                if line.startswith('VmRSS:'):
+                    return int(line.split()[1]) * 1024
+        return 0
+
+    def _run(self):
+        while not self._stop.wait(self.interval):
+            try:
+                self.peak_rss = max(self.peak_rss, self._rss_bytes())
+            except OSError:
+                return
+
+    def start(self):
+        self.start_time = time.perf_counter()
+        self.start_cpu = self._cpu_seconds()
+        self.peak_rss = self._rss_bytes()
+        self._thread.start()
+
+    def stop(self):
+        self._stop.set()
+        self._thread.join()
+        wall = time.perf_counter() - self.start_time
+        cpu = self._cpu_seconds() - self.start_cpu
+        return cpu, cpu / wall if wall > 0 else 0.0
+
+def percentile(values, p):
+    if not values:
+        return float('nan')
+    ordered = sorted(values)
+    index = max(0, math.ceil(p / 100 * len(ordered)) - 1)
+    return ordered[index]
+
+def wait_for_port(host, port, timeout=10.0):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        try:
+            with socket.create_connection((host, port), timeout=0.5):
+                return
+        except OSError:
+            time.sleep(0.1)
+    raise RuntimeError(f'nothing is listening on {host}:{port}')
+
+def free_port():
+    with socket.socket() as s:
+        s.bind(('127.0.0.1', 0))
+        return s.getsockname()[1]
+
+def spawn(args):
+    latency = mock_openai.parse_latency_overrides(args.latency)
+    mock_port = free_port()
+    mock = mock_openai.create_server('127.0.0.1', mock_port, latency, seed=args.seed)
+    threading.Thread(target=mock.serve_forever, daemon=True).start()
+
+    workdir = tempfile.mkdtemp(prefix='loadgen_')
+    os.symlink(os.path.join(REPO_DIR, 'chime.mp3'), os.path.join(workdir, 'chime.mp3'))
+
+    env = dict(os.environ)
+    env['OPENAI_BASE_URL'] = f'http://127.0.0.1:{mock_port}/v1'
+    env['OPENAI_API_KEY'] = 'mock'
+    env['OPENWEATHER_BASE_URL'] = f'http://127.0.0.1:{mock_port}'
+    env['OPENWEATHER_API_KEY'] = 'mock'
+
+    port = free_port()
+    server = subprocess.Popen(
+        [sys.executable, os.path.join(REPO_DIR, args.server), '--ip', '127.0.0.1', '--port', str(port)] + args.server_arg,
+        cwd=workdir, env=env, stdout=subprocess.DEVNULL if not args.verbose else None, stderr=subprocess.STDOUT
+    )
+    wait_for_port('127.0.0.1', port)
+    print("Spawned {} (pid {}) in {} against mock backend on port {}".format(args.server, server.pid, workdir, mock_port))
+    return server, f'http://127.0.0.1:{port}'
+
+def main():
+    parser = argparse.ArgumentParser(description='Simulate N voice assistant devices against smart_server.py')
+    parser.add_argument('--url', '-u', default='http://127.0.0.1:8000', type = str, help='server base URL')
+    parser.add_argument('--devices', '-n', default=4, type = int)
+    parser.add_argument('--requests', '-r', default=10, type = int, help='turns per device')
+    parser.add_argument('--wav', '-w', action='append', default=[], help='WAV file or glob to replay (default: a 2 s tone)')
+    parser.add_argument('--chunk-size', default=CHUNK_SIZE, type = int)
+    parser.add_argument('--realtime', action='store_true', help='pace uploads at the recording rate like the device does')
+    parser.add_argument('--think-time', default=0.0, type = float, help='mean seconds between turns of one device')
+    parser.add_argument('--timeout', default=120.0, type = float)
+    parser.add_argument('--server-pid', type = int, help='sample CPU and RSS of this process')
+    parser.add_argument('--spawn', action='store_true', help='start the mock backend and the server locally')
+    parser.add_argument('--server', default='smart_server.py', help='server script to spawn, relative to the repository')
+    parser.add_argument('--server-arg', action='append', default=[], help='extra argument for the spawned server')
+    parser.add_argument('--latency', '-l', action='append', metavar='ENDPOINT=SPEC', help='mock latency override, see mock_openai.py')
+    parser.add_argument('--seed', default=0, type = int)
+    parser.add_argument('--verbose', '-v', action='store_true')
+    args = parser.parse_args()
+
+    server = None
+    if args.spawn:
+        server, args.url = spawn(args)
+        args.server_pid = server.pid
+
+    urlparts = parse.urlparse(args.url)
+    host, port = urlparts.hostname, urlparts.port or 80
+    recordings = load_recordings(args.wav)
+
+    sampler = ProcessSampler(args.server_pid) if args.server_pid else None
+    results = []
+    results_lock = threading.Lock()
+
+    def device_loop(index):
+        rng = random.Random(args.seed * 1000 + index)
+        device = f'loadgen-{index}'
+        for turn in range(args.requests):
+            recording = recordings[(index + turn) % len(recordings)]
+            result = run_turn(host, port, device, recording, args.chunk_size, args.realtime, args.timeout)
+            with results_lock:
+                results.append(result)
+            if args.verbose and result.error:
+                print(f'{device}: {result.error}')
+            if args.think_time > 0:
+                time.sleep(rng.expovariate(1.0 / args.think_time))
+
+    print("Running {} device(s) x {} turn(s) against {}".format(args.devices, args.requests, args.url))
+    if sampler:
+        sampler.start()
+    start = time.perf_counter()
+    threads = [threading.Thread(target=device_loop, args=(i,)) for i in range(args.devices)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    wall = time.perf_counter() - start
+    if sampler:
+        cpu_seconds, cpu_share = sampler.stop()
+
+    ok = [r for r in results if r.ok]
+    rejected = [r for r in results if r.rejected and not r.error]
+    latency = [r.latency_seconds for r in ok]
+    upload = [r.upload_seconds for r in ok]
+    errors = {}
+    for r in results:
+        if r.error:
+            errors[r.error] = errors.get(r.error, 0) + 1
+
+    print()
+    print("turns          {} ok / {} total in {:.2f} s".format(len(ok), len(results), wall))
+    print("rejected       {} answered with the busy clip".format(len(rejected)))
+    print("throughput     {:.2f} turns/s".format(len(ok) / wall if wall > 0 else 0.0))
+    print("latency p50    {:.3f} s".format(percentile(latency, 50)))
+    print("latency p99    {:.3f} s".format(percentile(latency, 99)))
+    print("latency max    {:.3f} s".format(max(latency) if latency else float('nan')))
+    print("upload p50     {:.3f} s".format(percentile(upload, 50)))
+    if sampler:
+        print("server cpu     {:.2f} s ({:.0f}% of one core)".format(cpu_seconds, cpu_share * 100))
+        print("server rss     {:.1f} MiB peak".format(sampler.peak_rss / (1024 * 1024)))
+    for error, count in sorted(errors.items()):
+        print("error          {} x {}".format(count, error))
+
+    if server:
+        server.terminate()
+        server.wait()
+
+    return 0 if len(ok) + len(rejected) == len(results) else 1
+
+if __name__ == "__main__":
+    sys.exit(main())
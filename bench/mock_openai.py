@@ -0,0 +1,376 @@
+import sys
+import ssl
+import socket
+import json
+import time
+import random
+import argparse
+import threading
+import zlib
+import struct
+
+from urllib import parse
+from http.server import ThreadingHTTPServer
+from http.server import BaseHTTPRequestHandler
+
+# note: offline stand-in for the OpenAI endpoints smart_server.py uses
+# (transcriptions, chat completions, speech) and for the OpenWeather current
+# weather API. Each endpoint sleeps for a delay drawn from its own latency
+# distribution, so server changes can be compared without the internet.
+#
+# point the server at it with:
+#   OPENAI_BASE_URL=http://127.0.0.1:8100/v1 OPENAI_API_KEY=mock \
+#   OPENWEATHER_BASE_URL=http://127.0.0.1:8100 python smart_server.py
+#
+# with --tls-cert and --tls-key it serves HTTPS instead and counts the TLS
+# connections it accepted and how many of them resumed an earlier session,
+# which is what bench/tls_reuse.py measures the client's connection reuse with.
+#
+# --fault ENDPOINT=SPEC injects failures into a share of the requests, to see
+# how a client's timeouts, retries and hedging cope with them:
+#   stall:P:S  answer P of the requests S seconds late
+#   reset:P    drop the connection of P of the requests without an answer
+#   error:P    answer P of the requests with 503
+#   truncate:P end P of the chat streams without their [DONE]
+# a further :N injects a fault only N times, 'error:1:1' fails just the next
+# request, the retry of which succeeds; several faults of one endpoint are separated by commas. POST /faults with
+# {"faults": {ENDPOINT: SPEC}, "latency": {ENDPOINT: SPEC}} changes them while
+# the server runs, an empty SPEC removes the faults of the endpoint.
+
+PORT = 8100
+
+DEFAULT_TRANSCRIPTS = [
+    "What is the weather in Detroit?",
+    "Tell me a joke about microcontrollers.",
+    "How far away is the moon?",
+]
+
+DEFAULT_LATENCY = {
+    'transcription': 'lognormal:0.40:0.25',
+    'chat':          'lognormal:0.60:0.35',
+    'speech':        'lognormal:0.50:0.30',
+    'weather':       'lognormal:0.08:0.20',
+}
+
+# note: one fake MPEG-1 layer III frame header, padded out to the body size
+MP3_FRAME_HEADER = b'\xff\xfb\x90\x64'
+
+class Latency:
+    # note: spec is 'fixed:S', 'uniform:LO:HI', 'normal:MEAN:STDDEV' or
+    # 'lognormal:MEDIAN:SIGMA', all in seconds
+    def __init__(self, spec):
+        kind, *params = spec.split(':')
+        self.spec = spec
+        self.kind = kind
+        self.params = [float(p) for p in params]
+        if kind not in ('fixed', 'uniform', 'normal', 'lognormal'):
+            raise ValueError(f'unknown latency distribution: {spec}')
+
+    def sample(self, rng):
+        if self.kind == 'fixed':
+            return self.params[0]
+        if self.kind == 'uniform':
+            return rng.uniform(*self.params)
+        if self.kind == 'normal':
+            return max(0.0, rng.gauss(*self.params))
+        median, sigma = self.params
+        return rng.lognormvariate(0.0, sigma) * median
+
+class Fault:
+    # note: spec is 'stall:P:S', 'reset:P', 'error:P' or 'truncate:P', P a
+    # probability and S seconds, each optionally followed by ':N', the number
+    # of times the fault is injected at most
+    def __init__(self, spec):
+        kind, *params = spec.split(':')
+        self.spec = spec
+        self.kind = kind
+        arity = 2 if kind == 'stall' else 1
+        if kind not in ('stall', 'reset', 'error', 'truncate') or len(params) not in (arity, arity + 1):
+            raise ValueError(f'unknown fault: {spec}')
+        self.probability = float(params[0])
+        self.seconds = float(params[1]) if kind == 'stall' else 0.0
+        self.remaining = int(params[arity]) if len(params) > arity else None
+
+def parse_faults(spec):
+    return [Fault(f) for f in spec.split(',') if f]
+
+class MockState:
+    def __init__(self, latency, transcripts, speech_bytes_per_char, seed, faults=None):
+        self.latency = latency
+        self.faults = faults or {}
+        self.transcripts = transcripts
+        self.speech_bytes_per_char = speech_bytes_per_char
+        self.counts = {name: 0 for name in latency}
+        self.injected = {'stall': 0, 'reset': 0, 'error': 0, 'truncate': 0}
+        self.connections = 0
+        self.tls_resumed = 0
+
+        self._rng = random.Random(seed)
+        self._lock = threading.Lock()
+
+    def connected(self, resumed):
+        with self._lock:
+            self.connections += 1
+            self.tls_resumed += resumed
+
+    def configure(self, faults, latency):
+        with self._lock:
+            for endpoint, spec in faults.items():
+                if endpoint not in self.latency:
+                    raise ValueError(f'unknown endpoint: {endpoint}')
+                self.faults[endpoint] = parse_faults(spec)
+            for endpoint, spec in latency.items():
+                if endpoint not in self.latency:
+                    raise ValueError(f'unknown endpoint: {endpoint}')
+                self.latency[endpoint] = Latency(spec)
+
+    def delay(self, endpoint):
+        # note: returns 'reset', 'error' or 'truncate' when the request is to
+        # fail that way instead of being answered, stalls only add to the delay
+        failure = None
+        with self._lock:
+            self.counts[endpoint] += 1
+            seconds = self.latency[endpoint].sample(self._rng)
+            for fault in self.faults.get(endpoint, []):
+                if fault.remaining == 0 or self._rng.random() >= fault.probability:
+                    continue
+                if fault.remaining is not None:
+                    fault.remaining -= 1
+                self.injected[fault.kind] += 1
+                if fault.kind == 'stall':
+                    seconds += fault.seconds
+                elif failure is None:
+                    failure = fault.kind
+        time.sleep(seconds)
+        return failure
+
+def chat_reply(messages, tools=()):
+    # note: returns (content, tool calls)
+    system = next((m['content'] for m in messages if m.get('role') == 'system'), '')
+    user = next((m['content'] for m in reversed(messages) if m.get('role') == 'user'), '')
+
+    if 'city name' in system:
+        return 'Detroit', []
+    if 'weather' in system.lower() and not tools:
+        return 'It is clear in Detroit with a temperature of fifty degrees Fahrenheit.', []
+    if any(t['function']['name'] == 'get_weather' for t in tools) and 'weather' in user.lower():
+        return None, [{
+            'id': 'call_mock',
+            'type': 'function',
+            'function': {'name': 'get_weather', 'arguments': json.dumps({'city': 'Detroit', 'country_code': 'us'})},
+        }]
+    return f'Here is a short answer to your question: {user[:80]}', []
+
+def chat_events(request, content, truncate=False):
+    # note: the delay of the endpoint is the time to the first token, the
+    # rest of the answer follows word by word
+    chunk = {'id': 'chatcmpl-mock', 'object': 'chat.completion.chunk', 'created': int(time.time()),
+             'model': request.get('model', 'mock')}
+    words = content.split(' ')
+    for index, word in enumerate(words):
+        delta = {'content': word if index == 0 else ' ' + word}
+        if index == 0:
+            delta['role'] = 'assistant'
+        yield json.dumps(dict(chunk, choices=[{'index': 0, 'delta': delta, 'finish_reason': None}]))
+    yield json.dumps(dict(chunk, choices=[{'index': 0, 'delta': {}, 'finish_reason': 'stop'}]))
+    if request.get('stream_options', {}).get('include_usage'):
+        yield json.dumps(dict(chunk, choices=[], usage={'prompt_tokens': 0, 'completion_tokens': len(words),
+                                                         'total_tokens': len(words)}))
+    if not truncate:
+        yield '[DONE]'
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'
+
+    def log_message(self, format, *args):
+        pass
+
+    def setup(self):
+        super().setup()
+        # note: headers and body go out in separate writes, don't let Nagle
+        # hold the body back for the client's delayed ACK
+        self.request.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        # note: the TLS handshake runs here, in the connection's own thread
+        # instead of the accept loop
+        if isinstance(self.request, ssl.SSLSocket):
+            self.request.do_handshake()
+            self.server.state.connected(self.request.session_reused)
+        else:
+            self.server.state.connected(False)
+
+    def _send(self, status, content_type, body):
+        self.send_response(status)
+        self.send_header('Content-Type', content_type)
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def _send_json(self, obj):
+        self._send(200, 'application/json', json.dumps(obj).encode('utf-8'))
+
+    def _send_events(self, events):
+        # note: server-sent events in HTTP chunks, one chunk per event like
+        # the OpenAI API streams them
+        self.send_response(200)
+        self.send_header('Content-Type', 'text/event-stream')
+        self.send_header('Transfer-Encoding', 'chunked')
+        self.end_headers()
+        for event in events:
+            data = f'data: {event}\n\n'.encode('utf-8')
+            self.wfile.write(b'%x\r\n%s\r\n' % (len(data), data))
+            self.wfile.flush()
+        self.wfile.write(b'0\r\n\r\n')
+
+    def _read_body(self):
+        return self.rfile.read(int(self.headers.get('Content-Length', 0)))
+
+    def _fail(self, failure):
+        # note: True when the request was failed instead of being answered, a
+        # truncated request is still answered
+        if failure == 'error':
+            self._send(503, 'application/json', b'{"error": {"code": "server_overloaded"}}')
+        elif failure == 'reset':
+            # note: a linger of 0 sends RST instead of FIN
+            self.request.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER, struct.pack('ii', 1, 0))
+            self.close_connection = True
+        return failure in ('error', 'reset')
+
+    def do_POST(self):
+        state = self.server.state
+        path = parse.urlparse(self.path).path.rstrip('/')
+        body = self._read_body()
+
+        if path.endswith('/audio/transcriptions'):
+            if self._fail(state.delay('transcription')):
+                return
+            text = state.transcripts[zlib.crc32(body) % len(state.transcripts)]
+            if b'name="response_format"\r\n\r\ntext' in body:
+                self._send(200, 'text/plain; charset=utf-8', (text + '\n').encode('utf-8'))
+            else:
+                self._send_json({'text': text})
+
+        elif path.endswith('/chat/completions'):
+            failure = state.delay('chat')
+            if self._fail(failure):
+                return
+            request = json.loads(body)
+            content, tool_calls = chat_reply(request.get('messages', []), request.get('tools', []))
+            if request.get('stream') and not tool_calls:
+                self._send_events(chat_events(request, content, failure == 'truncate'))
+                return
+            message = {'role': 'assistant', 'content': content}
+            if tool_calls:
+                message['tool_calls'] = tool_calls
+            self._send_json({
+                'id': 'chatcmpl-mock',
+                'object': 'chat.completion',
+                'created': int(time.time()),
+                'model': request.get('model', 'mock'),
+                'choices': [{
+                    'index': 0,
+                    'message': message,
+                    'finish_reason': 'tool_calls' if tool_calls else 'stop',
+                }],
+                'usage': {'prompt_tokens': 0, 'completion_tokens': 0, 'total_tokens': 0},
+            })
+
+        elif path.endswith('/audio/speech'):
+            if self._fail(state.delay('speech')):
+                return
+            text = json.loads(body).get('input', '')
+            size = max(len(MP3_FRAME_HEADER), len(text) * state.speech_bytes_per_char)
+            self._send(200, 'audio/mpeg', MP3_FRAME_HEADER + bytes(size - len(MP3_FRAME_HEADER)))
+
+        elif path.endswith('/faults'):
+            try:
+                request = json.loads(body)
+                state.configure(request.get('faults', {}), request.get('latency', {}))
+            except ValueError as e:
+                self._send(400, 'application/json', json.dumps({'error': {'code': 'invalid_request', 'message': str(e)}}).encode('utf-8'))
+                return
+            self._send_json({'ok': True})
+
+        else:
+            self._send(404, 'application/json', b'{"error": {"code": "not_found"}}')
+
+    def do_GET(self):
+        state = self.server.state
+        urlparts = parse.urlparse(self.path)
+
+        if urlparts.path.endswith('/data/2.5/weather'):
+            if self._fail(state.delay('weather')):
+                return
+            city = parse.parse_qs(urlparts.query).get('q', ['Detroit'])[0].split(',')[0]
+            self._send_json({
+                'name': city,
+                'weather': [{'main': 'Clear', 'description': 'clear sky'}],
+                'main': {'temp': 50.0, 'feels_like': 47.5, 'humidity': 60},
+                'wind': {'speed': 5.0},
+            })
+        elif urlparts.path == '/stats':
+            self._send_json(dict(state.counts, connections=state.connections, tls_resumed=state.tls_resumed,
+                                 injected=state.injected))
+        else:
+            self._send(404, 'application/json', b'{"error": {"code": "not_found"}}')
+
+def parse_latency_overrides(overrides):
+    latency = dict(DEFAULT_LATENCY)
+    for override in overrides or []:
+        endpoint, _, spec = override.partition('=')
+        if endpoint not in latency:
+            raise ValueError(f'unknown endpoint: {endpoint}')
+        latency[endpoint] = spec
+    return {endpoint: Latency(spec) for endpoint, spec in latency.items()}
+
+def parse_fault_overrides(overrides):
+    faults = {}
+    for override in overrides or []:
+        endpoint, _, spec = override.partition('=')
+        if endpoint not in DEFAULT_LATENCY:
+            raise ValueError(f'unknown endpoint: {endpoint}')
+        faults[endpoint] = parse_faults(spec)
+    return faults
+
+def create_server(ip, port, latency, transcripts=DEFAULT_TRANSCRIPTS, speech_bytes_per_char=250, seed=0, tls_context=None, faults=None):
+    httpd = ThreadingHTTPServer((ip, port), Handler)
+    httpd.daemon_threads = True
+    if tls_context is not None:
+        httpd.socket = tls_context.wrap_socket(httpd.socket, server_side=True, do_handshake_on_connect=False)
+    httpd.state = MockState(latency, transcripts, speech_bytes_per_char, seed, faults)
+    return httpd
+
+def main():
+    parser = argparse.ArgumentParser(description='Local stand-in for the OpenAI and OpenWeather APIs used by smart_server.py')
+    parser.add_argument('--ip', '-i', default='127.0.0.1', type = str)
+    parser.add_argument('--port', '-p', default=PORT, type = int)
+    parser.add_argument('--latency', '-l', action='append', metavar='ENDPOINT=SPEC',
+                        help='latency distribution for transcription, chat, speech or weather, e.g. chat=uniform:0.2:0.8')
+    parser.add_argument('--fault', '-f', action='append', metavar='ENDPOINT=SPEC',
+                        help='failures injected into an endpoint, e.g. transcription=stall:0.03:5,error:0.01')
+    parser.add_argument('--transcript', '-t', action='append', help='transcript returned for uploads (repeatable)')
+    parser.add_argument('--speech-bytes-per-char', default=250, type = int)
+    parser.add_argument('--seed', default=0, type = int)
+    parser.add_argument('--tls-cert', help='serve HTTPS with this PEM certificate')
+    parser.add_argument('--tls-key', help='PEM private key of --tls-cert')
+    args = parser.parse_args()
+
+    tls_context = None
+    if args.tls_cert:
+        tls_context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        tls_context.load_cert_chain(args.tls_cert, args.tls_key)
+
+    latency = parse_latency_overrides(args.latency)
+    faults = parse_fault_overrides(args.fault)
+    httpd = create_server(args.ip, args.port, latency, args.transcript or DEFAULT_TRANSCRIPTS,
+                          args.speech_bytes_per_char, args.seed, tls_context, faults)
+
+    print("Mock OpenAI serving {} on {} port {}".format('HTTPS' if tls_context else 'HTTP', args.ip, args.port))
+    for endpoint, dist in latency.items():
+        print("  {:<14} {}".format(endpoint, dist.spec))
+    for endpoint, endpoint_faults in faults.items():
+        print("  {:<14} {}".format(endpoint, ','.join(f.spec for f in endpoint_faults)))
+    sys.stdout.flush()
+    httpd.serve_forever()
+
+if __name__ == "__main__":
+    main()
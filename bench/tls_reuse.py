@@ -0,0 +1,181 @@
+import os, sys
+import ssl
+import json
+import time
+import socket
+import argparse
+import tempfile
+import threading
+import subprocess
+
+from urllib import parse
+from http.client import HTTPSConnection
+
+import mock_openai
+from loadgen import make_tone_wav, percentile, free_port
+
+# note: measures what connection reuse saves on the transcription -> chat ->
+# speech sequence of one voice turn, the same three requests the OpenAI
+# component sends from the board. Every turn runs in three modes:
+#
+#   fresh      a new TCP connection and a full TLS handshake per request, like
+#              OpenAI_Request did with esp_http_client_init/cleanup per call
+#   resumed    a new connection per request that resumes the TLS session,
+#              like a reconnect of the persistent client with session tickets
+#   keepalive  one connection kept open for all requests of all turns
+#
+# setup is the time from starting a request until the connection is ready to
+# send, total the time of the whole turn. With --spawn a HTTPS stand-in for
+# the OpenAI endpoints runs locally with a throwaway self-signed certificate,
+# otherwise --url and --ca-cert point at a running one (mock_openai.py with
+# --tls-cert/--tls-key, or any OpenAI-compatible server). The host's handshake
+# is far cheaper than the ESP32's, so read the setup times relative to each
+# other; the handshake counts carry over as they are. This models the C
+# transport, the board itself is measured by the "benchmark connection reuse
+# against the HTTPS mock" case of components/openai/test_apps, against a
+# mock_openai.py started with --tls-cert/--tls-key.
+
+MODES = ('fresh', 'resumed', 'keepalive')
+
+BOUNDARY = '----WebKitFormBoundary9HKFexBRLrf9dcpY'
+
+class Connection(HTTPSConnection):
+    def __init__(self, host, port, context, session=None, timeout=30.0):
+        super().__init__(host, port, context=context, timeout=timeout)
+        self.session = session
+
+    def connect(self):
+        sock = socket.create_connection((self.host, self.port), self.timeout)
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.sock = self._context.wrap_socket(sock, server_hostname=self.host, session=self.session)
+
+def multipart_body(audio):
+    head = (
+        f'--{BOUNDARY}\r\nContent-Disposition: form-data; name="model"\r\n\r\nwhisper-1\r\n'
+        f'--{BOUNDARY}\r\nContent-Disposition: form-data; name="file"; filename="audio.wav"\r\n'
+        f'Content-Type: audio/x-wav\r\n\r\n'
+    ).encode('utf-8')
+    return head + audio + f'\r\n--{BOUNDARY}--\r\n'.encode('utf-8')
+
+def turn_requests(audio, prefix):
+    chat = {'model': 'gpt-3.5-turbo', 'messages': [{'role': 'user', 'content': 'How far away is the moon?'}]}
+    speech = {'model': 'tts-1', 'voice': 'alloy', 'input': 'About three hundred and eighty thousand kilometers.'}
+    return [
+        (f'{prefix}/audio/transcriptions', f'multipart/form-data; boundary={BOUNDARY}', multipart_body(audio)),
+        (f'{prefix}/chat/completions', 'application/json', json.dumps(chat).encode('utf-8')),
+        (f'{prefix}/audio/speech', 'application/json', json.dumps(speech).encode('utf-8')),
+    ]
+
+class Client:
+    def __init__(self, mode, host, port, context):
+        self.mode = mode
+        self.host = host
+        self.port = port
+        self.context = context
+        self.conn = None
+        self.session = None
+        self.handshakes = 0
+        self.resumed = 0
+
+    def _connection(self):
+        if self.conn is not None:
+            return self.conn
+        conn = Connection(self.host, self.port, self.context, self.session if self.mode == 'resumed' else None)
+        conn.connect()
+        self.handshakes += 1
+        self.resumed += conn.sock.session_reused
+        if self.mode == 'keepalive':
+            self.conn = conn
+        return conn
+
+    def request(self, path, content_type, body):
+        # note: returns (setup seconds, response bytes)
+        start = time.perf_counter()
+        conn = self._connection()
+        setup = time.perf_counter() - start
+        conn.request('POST', path, body, {'Content-Type': content_type, 'Authorization': 'Bearer mock'})
+        response = conn.getresponse()
+        data = response.read()
+        if response.status != 200:
+            raise RuntimeError(f'{path}: HTTP {response.status}')
+        if self.mode != 'keepalive':
+            # note: TLS 1.3 tickets arrive after the handshake, take the session
+            # once a response was read
+            self.session = conn.sock.session
+            conn.close()
+        return setup, len(data)
+
+    def close(self):
+        if self.conn is not None:
+            self.conn.close()
+            self.conn = None
+
+def run_mode(mode, host, port, context, requests, turns):
+    client = Client(mode, host, port, context)
+    setup, total = [], []
+    for _ in range(turns):
+        start = time.perf_counter()
+        for path, content_type, body in requests:
+            seconds, _ = client.request(path, content_type, body)
+            setup.append(seconds)
+        total.append(time.perf_counter() - start)
+    client.close()
+    return setup, total, client.handshakes, client.resumed
+
+def make_certificate(workdir):
+    cert = os.path.join(workdir, 'cert.pem')
+    key = os.path.join(workdir, 'key.pem')
+    subprocess.run(
+        ['openssl', 'req', '-x509', '-newkey', 'ec', '-pkeyopt', 'ec_paramgen_curve:prime256v1', '-nodes',
+         '-keyout', key, '-out', cert, '-days', '1', '-subj', '/CN=localhost',
+         '-addext', 'subjectAltName=DNS:localhost,IP:127.0.0.1'],
+        check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL
+    )
+    return cert, key
+
+def spawn(args):
+    workdir = tempfile.mkdtemp(prefix='tls_reuse_')
+    cert, key = make_certificate(workdir)
+    tls_context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    tls_context.load_cert_chain(cert, key)
+
+    latency = mock_openai.parse_latency_overrides(args.latency or [f'{e}=fixed:0' for e in mock_openai.DEFAULT_LATENCY])
+    port = free_port()
+    mock = mock_openai.create_server('127.0.0.1', port, latency, tls_context=tls_context)
+    threading.Thread(target=mock.serve_forever, daemon=True).start()
+    print("Spawned HTTPS stand-in on port {} with a self-signed certificate in {}".format(port, workdir))
+    return f'https://127.0.0.1:{port}/v1', cert
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare per-request connection setup with and without reuse over TLS')
+    parser.add_argument('--url', '-u', default='https://127.0.0.1:8100/v1', type = str, help='base URL of the OpenAI stand-in')
+    parser.add_argument('--ca-cert', help='CA certificate to verify the server with (default: system store)')
+    parser.add_argument('--turns', '-r', default=20, type = int, help='transcription, chat and speech sequences per mode')
+    parser.add_argument('--mode', '-m', action='append', choices=MODES, help='modes to run (default: all)')
+    parser.add_argument('--spawn', action='store_true', help='start a local HTTPS stand-in')
+    parser.add_argument('--latency', '-l', action='append', metavar='ENDPOINT=SPEC',
+                        help='stand-in latency override, see mock_openai.py (default: no delay)')
+    args = parser.parse_args()
+
+    if args.spawn:
+        args.url, args.ca_cert = spawn(args)
+
+    urlparts = parse.urlparse(args.url)
+    host, port = urlparts.hostname, urlparts.port or 443
+    context = ssl.create_default_context(cafile=args.ca_cert)
+    audio = make_tone_wav(seconds=1.0, rates=16000).getvalue()
+    requests = turn_requests(audio, urlparts.path.rstrip('/'))
+
+    print("Running {} turn(s) of {} requests per mode against {}".format(args.turns, len(requests), args.url))
+    print()
+    print("{:<10} {:>12} {:>12} {:>12} {:>12} {:>11} {:>8}".format(
+        'mode', 'setup p50', 'setup p99', 'turn p50', 'turn p99', 'handshakes', 'resumed'))
+    for mode in args.mode or MODES:
+        setup, total, handshakes, resumed = run_mode(mode, host, port, context, requests, args.turns)
+        print("{:<10} {:>10.2f}ms {:>10.2f}ms {:>10.2f}ms {:>10.2f}ms {:>11} {:>8}".format(
+            mode, percentile(setup, 50) * 1000, percentile(setup, 99) * 1000,
+            percentile(total, 50) * 1000, percentile(total, 99) * 1000, handshakes, resumed))
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -42,6 +42,8 @@ extern "C"
 
 #include "dsps_fft2r.h"
 #include "dsps_fft4r.h"
+#include "dsps_fftmr.h"
+#include "dsps_fft_plan.h"
 #include "dsps_dct.h"
 
 // Matrix operations
@@ -0,0 +1,141 @@
+// Copyright 2018-2020 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dsp_common.h"
+#include <math.h>
+
+#include "dsps_dct.h"
+#include "dsps_fft_plan.h"
+
+esp_err_t dsps_dct_f32_ref(float *data, int N, float *result)
+{
+    float factor = M_PI / N;
+    for (size_t i = 0; i < N; i++) {
+        float sum = 0;
+        for (size_t j = 0; j < N; j++) {
+            sum += data[j] * cosf((j + 0.5) * i * factor);
+        }
+        result[i] = sum;
+    }
+    return ESP_OK;
+}
+
+esp_err_t dsps_dct_inverce_f32_ref(float *data, int N, float *result)
+{
+    float factor = M_PI / N;
+    for (size_t i = 0; i < N; i++) {
+        float sum = data[0] / 2;
+        for (size_t j = 0; j < N; j++) {
+            sum += data[j] * cosf(j * (i + 0.5) * factor);
+        }
+        result[i] = sum;
+    }
+    return ESP_OK;
+}
+
+// Sin/cos of the angle pi*k/(2*N) from the bit reversed table of the default radix-2 plan,
+// where the value of bin k of an FFT of 2 * N points is at the bit reversed k
+static inline int dsps_dct_next_rev(int rev, int N2)
+{
+    int bit = N2 >> 1;
+    while (rev & bit) {
+        rev ^= bit;
+        bit >>= 1;
+    }
+    return rev | bit;
+}
+
+static esp_err_t dsps_dct_check(const dsps_fft_plan_t *plan, int N)
+{
+    if (plan->table == NULL) {
+        return ESP_ERR_DSP_REINITIALIZED;
+    }
+    if (!dsp_is_power_of_two(N) || (N < 4) || (N * 4 > plan->max_size)) {
+        return ESP_ERR_DSP_INVALID_LENGTH;
+    }
+    return ESP_OK;
+}
+
+// The DCT is a real FFT of N points of the reordered input v[n] = x[2n], v[N-1-n] = x[2n+1],
+// with the spectrum turned by pi*k/(2*N). The upper half of the data array holds v.
+esp_err_t dsps_dct_f32(float *data, int N)
+{
+    const dsps_fft_plan_t *plan = dsps_fft2r_get_plan_fc32();
+    esp_err_t ret = dsps_dct_check(plan, N);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    float *v = &data[N];
+    for (int i = 0; i < N / 2; i++) {
+        v[i] = data[i * 2];
+        v[N - 1 - i] = data[i * 2 + 1];
+    }
+    ret = dsps_fft_plan_real_fc32(plan, v, N);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // X[k] = Re(V[k] * exp(-i*pi*k/(2N))), X[N-k] = -Im(V[k] * exp(-i*pi*k/(2N)))
+    const float *w = (const float *)plan->table;
+    data[0] = v[0];
+    data[N / 2] = v[1] * M_SQRT1_2;
+    int rev = 0;
+    for (int k = 1; k < N / 2; k++) {
+        rev = dsps_dct_next_rev(rev, N * 2);
+        float c = w[rev * 2 + 0];
+        float s = w[rev * 2 + 1];
+        float re = v[k * 2 + 0];
+        float im = v[k * 2 + 1];
+        data[k] = re * c + im * s;
+        data[N - k] = re * s - im * c;
+    }
+    return ESP_OK;
+}
+
+// Inverse of dsps_dct_f32(...): V[k] = exp(i*pi*k/(2N)) * (X[k] - i*X[N-k]) is the spectrum of v,
+// scaled by N/2 for the unscaled DCT type III
+esp_err_t dsps_dct_inv_f32(float *data, int N)
+{
+    const dsps_fft_plan_t *plan = dsps_fft2r_get_plan_fc32();
+    esp_err_t ret = dsps_dct_check(plan, N);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    const float *w = (const float *)plan->table;
+    float scale = N / 2;
+    float *v = &data[N];
+    v[0] = data[0] * scale;
+    v[1] = data[N / 2] * M_SQRT2 * scale;
+    int rev = 0;
+    for (int k = 1; k < N / 2; k++) {
+        rev = dsps_dct_next_rev(rev, N * 2);
+        float c = w[rev * 2 + 0] * scale;
+        float s = w[rev * 2 + 1] * scale;
+        float re = data[k];
+        float im = data[N - k];
+        v[k * 2 + 0] = re * c + im * s;
+        v[k * 2 + 1] = re * s - im * c;
+    }
+    ret = dsps_fft_plan_real_inv_fc32(plan, v, N);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    for (int i = 0; i < N / 2; i++) {
+        data[i * 2] = v[i];
+        data[i * 2 + 1] = v[N - 1 - i];
+    }
+    return ESP_OK;
+}
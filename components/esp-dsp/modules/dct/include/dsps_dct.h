@@ -27,17 +27,20 @@ extern "C"
  * @brief      DCT of radix 2, unscaled
  *
  * DCT type II of radix 2, unscaled
- * Function is FFT based
+ * Function is based on a real FFT of N points with the default plan of dsps_fft2r_init_fc32(...),
+ * that must be called with a table_size of at least N*4.
  * The extension (_ansi) use ANSI C and could be compiled and run on any platform.
  * The extension (_ae32) is optimized for ESP32 chip.
  *
  * @param[inout] data: input/output array with size of N*2. An elements located: Re[0],Re[1], , ... Re[N-1], any data... up to N*2
  *               result of DCT will be stored to this array from 0...N-1.
- *               Size of data array must be N*2!!!
+ *               Size of data array must be N*2!!! The upper half is used as work memory.
  * @param[in] N: Size of DCT transform. Size of data array must be N*2!!!
  *
  * @return
  *      - ESP_OK on success
+ *      - ESP_ERR_DSP_REINITIALIZED if dsps_fft2r_init_fc32(...) was not called
+ *      - ESP_ERR_DSP_INVALID_LENGTH if N is not a power of two or the table is shorter than N*4
  *      - One of the error codes from DSP library
  */
 esp_err_t dsps_dct_f32(float *data, int N);
@@ -49,17 +52,20 @@ esp_err_t dsps_dct_f32(float *data, int N);
  * @brief      Inverce DCT of radix 2
  *
  * Inverce DCT type III of radix 2, unscaled
- * Function is FFT based
+ * Function is based on a real FFT of N points with the default plan of dsps_fft2r_init_fc32(...),
+ * that must be called with a table_size of at least N*4.
  * The extension (_ansi) use ANSI C and could be compiled and run on any platform.
  * The extension (_ae32) is optimized for ESP32 chip.
  *
  * @param[inout] data: input/output array with size of N*2. An elements located: Re[0],Re[1], , ... Re[N-1], any data... up to N*2
  *               result of DCT will be stored to this array from 0...N-1.
- *               Size of data array must be N*2!!!
+ *               Size of data array must be N*2!!! The upper half is used as work memory.
  * @param[in] N: Size of DCT transform. Size of data array must be N*2!!!
  *
  * @return
  *      - ESP_OK on success
+ *      - ESP_ERR_DSP_REINITIALIZED if dsps_fft2r_init_fc32(...) was not called
+ *      - ESP_ERR_DSP_INVALID_LENGTH if N is not a power of two or the table is shorter than N*4
  *      - One of the error codes from DSP library
  */
 esp_err_t dsps_dct_inv_f32(float *data, int N);
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "dsps_fft2r.h"
+#include "dsps_fft_plan.h"
 #include "dsp_common.h"
 #include "dsp_types.h"
 #include <math.h>
@@ -23,7 +24,9 @@
 int16_t *dsps_fft_w_table_sc16;
 int dsps_fft_w_table_sc16_size;
 uint8_t dsps_fft2r_sc16_initialized = 0;
-uint8_t dsps_fft2r_sc16_mem_allocated = 0;
+
+// The functions without a plan argument use this one
+static dsps_fft_plan_t dsps_fft2r_plan_sc16;
 
 unsigned short reverse(unsigned short x, unsigned short N, int order);
 
@@ -78,43 +81,31 @@ esp_err_t dsps_fft2r_init_sc16(int16_t *fft_table_buff, int table_size)
     if (table_size == 0) {
         return result;
     }
-    if (fft_table_buff != NULL) {
-        if (dsps_fft2r_sc16_mem_allocated) {
-            return ESP_ERR_DSP_REINITIALIZED;
-        }
-        dsps_fft_w_table_sc16 = fft_table_buff;
-        dsps_fft_w_table_sc16_size = table_size;
-    } else {
-        if (!dsps_fft2r_sc16_mem_allocated) {
-#if CONFIG_IDF_TARGET_ESP32S3
-            dsps_fft_w_table_sc16 = (int16_t *)memalign(16, CONFIG_DSP_MAX_FFT_SIZE * sizeof(int16_t));
-#else
-            dsps_fft_w_table_sc16 = (int16_t *)malloc(CONFIG_DSP_MAX_FFT_SIZE * sizeof(int16_t));
-#endif
-        }
-        dsps_fft_w_table_sc16_size = CONFIG_DSP_MAX_FFT_SIZE;
-        dsps_fft2r_sc16_mem_allocated = 1;
+    // The internal table is made for the longest FFT, as it always was
+    if (fft_table_buff == NULL) {
+        table_size = CONFIG_DSP_MAX_FFT_SIZE;
     }
-
-    result = dsps_gen_w_r2_sc16(dsps_fft_w_table_sc16, dsps_fft_w_table_sc16_size);
-    if (result != ESP_OK) {
-        return result;
-    }
-    result = dsps_bit_rev_sc16_ansi(dsps_fft_w_table_sc16, dsps_fft_w_table_sc16_size >> 1);
+    result = dsps_fft_plan_init(&dsps_fft2r_plan_sc16, DSPS_FFT_PLAN_FFT2R_SC16, fft_table_buff, table_size);
     if (result != ESP_OK) {
         return result;
     }
+    dsps_fft_w_table_sc16 = (int16_t *)dsps_fft2r_plan_sc16.table;
+    dsps_fft_w_table_sc16_size = table_size;
     dsps_fft2r_sc16_initialized = 1;
     return ESP_OK;
 }
 
 void dsps_fft2r_deinit_sc16()
 {
-    if (dsps_fft2r_sc16_mem_allocated) {
-        free(dsps_fft_w_table_sc16);
-    }
-    dsps_fft2r_sc16_mem_allocated = 0;
     dsps_fft2r_sc16_initialized = 0;
+    dsps_fft_w_table_sc16 = NULL;
+    dsps_fft_w_table_sc16_size = 0;
+    dsps_fft_plan_free(&dsps_fft2r_plan_sc16);
+}
+
+const dsps_fft_plan_t *dsps_fft2r_get_plan_sc16(void)
+{
+    return &dsps_fft2r_plan_sc16;
 }
 
 esp_err_t dsps_fft2r_sc16_ansi_(int16_t *data, int N, int16_t *sc_table)
@@ -122,7 +113,7 @@ esp_err_t dsps_fft2r_sc16_ansi_(int16_t *data, int N, int16_t *sc_table)
     if (!dsp_is_power_of_two(N)) {
         return ESP_ERR_DSP_INVALID_LENGTH;
     }
-    if (!dsps_fft2r_sc16_initialized) {
+    if (sc_table == NULL) {
         return ESP_ERR_DSP_UNINITIALIZED;
     }
 
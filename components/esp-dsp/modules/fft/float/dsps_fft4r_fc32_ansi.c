@@ -14,6 +14,7 @@
 
 #include "dsps_fft2r.h"
 #include "dsps_fft4r.h"
+#include "dsps_fft_plan.h"
 #include "dsp_common.h"
 #include "dsp_types.h"
 #include <math.h>
@@ -27,9 +28,9 @@ static const char *TAG = "fftr4 ansi";
 float *dsps_fft4r_w_table_fc32;
 int dsps_fft4r_w_table_size;
 uint8_t dsps_fft4r_initialized = 0;
-uint8_t dsps_fft4r_mem_allocated = 0;
-//float* win2;
-uint16_t *dsps_fft4r_ram_rev_table = NULL;
+
+// The functions without a plan argument use this one
+static dsps_fft_plan_t dsps_fft4r_plan_fc32;
 
 esp_err_t dsps_fft4r_init_fc32(float *fft_table_buff, int max_fft_size)
 {
@@ -43,38 +44,17 @@ esp_err_t dsps_fft4r_init_fc32(float *fft_table_buff, int max_fft_size)
     if (max_fft_size == 0) {
         return result;
     }
-    if (fft_table_buff != NULL) {
-        if (dsps_fft4r_mem_allocated) {
-            return ESP_ERR_DSP_REINITIALIZED;
-        }
-        dsps_fft4r_w_table_fc32 = fft_table_buff;
-        dsps_fft4r_w_table_size = max_fft_size * 2;
-    } else {
-        if (!dsps_fft4r_mem_allocated) {
-            dsps_fft4r_w_table_fc32 = (float *)malloc(max_fft_size * sizeof(float) * 4);
-            if (NULL == dsps_fft4r_w_table_fc32) {
-                return ESP_ERR_DSP_PARAM_OUTOFRANGE;
-            }
-        }
-        dsps_fft4r_w_table_size = max_fft_size * 2;
-        dsps_fft4r_mem_allocated = 1;
+    result = dsps_fft_plan_init(&dsps_fft4r_plan_fc32, DSPS_FFT_PLAN_FFT4R_FC32, fft_table_buff, max_fft_size);
+    if (result != ESP_OK) {
+        return result;
     }
+    dsps_fft4r_w_table_fc32 = (float *)dsps_fft4r_plan_fc32.table;
+    dsps_fft4r_w_table_size = dsps_fft4r_plan_fc32.table_size;
 
-    // FFT ram_rev table allocated
+    // The lookup bit reverse of this length uses the table in RAM of the plan
     int pow = dsp_power_of_two(max_fft_size) >> 1;
-    if ((pow >= 2) && (pow <= 6)) {
-        dsps_fft4r_ram_rev_table = (uint16_t *)malloc(2 * dsps_fft4r_rev_tables_fc32_size[pow - 2] * sizeof(uint16_t));
-        if (NULL == dsps_fft4r_ram_rev_table) {
-            return ESP_ERR_DSP_PARAM_OUTOFRANGE;
-        }
-        memcpy(dsps_fft4r_ram_rev_table, dsps_fft4r_rev_tables_fc32[pow - 2], 2 * dsps_fft4r_rev_tables_fc32_size[pow - 2] * sizeof(uint16_t));
-        dsps_fft4r_rev_tables_fc32[pow - 2] = dsps_fft4r_ram_rev_table;
-    }
-
-    for (int i = 0; i < dsps_fft4r_w_table_size; i++) {
-        float angle = 2 * M_PI * i / (float)dsps_fft4r_w_table_size;
-        dsps_fft4r_w_table_fc32[2 * i + 0] = cosf(angle);
-        dsps_fft4r_w_table_fc32[2 * i + 1] = sinf(angle);
+    if ((pow >= 2) && (pow <= 6) && (dsps_fft4r_plan_fc32.rev_table != NULL)) {
+        dsps_fft4r_rev_tables_fc32[pow - 2] = dsps_fft4r_plan_fc32.rev_table;
     }
 
     dsps_fft4r_initialized = 1;
@@ -84,18 +64,17 @@ esp_err_t dsps_fft4r_init_fc32(float *fft_table_buff, int max_fft_size)
 
 void dsps_fft4r_deinit_fc32()
 {
-    if (dsps_fft4r_mem_allocated) {
-        free(dsps_fft4r_w_table_fc32);
-    }
-    if (dsps_fft4r_ram_rev_table != NULL) {
-        free(dsps_fft4r_ram_rev_table);
-        dsps_fft4r_ram_rev_table = NULL;
-    }
+    dsps_fft4r_initialized = 0;
     // Re init bitrev table for next use
     dsps_fft4r_rev_tables_init_fc32();
+    dsps_fft4r_w_table_fc32 = NULL;
+    dsps_fft4r_w_table_size = 0;
+    dsps_fft_plan_free(&dsps_fft4r_plan_fc32);
+}
 
-    dsps_fft4r_mem_allocated = 0;
-    dsps_fft4r_initialized = 0;
+const dsps_fft_plan_t *dsps_fft4r_get_plan_fc32(void)
+{
+    return &dsps_fft4r_plan_fc32;
 }
 
 esp_err_t dsps_bit_rev4r_direct_fc32_ansi(float *data, int N)
@@ -103,9 +82,6 @@ esp_err_t dsps_bit_rev4r_direct_fc32_ansi(float *data, int N)
     if (!dsp_is_power_of_two(N)) {
         return ESP_ERR_DSP_INVALID_LENGTH;
     }
-    if (0 == dsps_fft4r_initialized) {
-        return ESP_ERR_DSP_UNINITIALIZED;
-    }
     esp_err_t result = ESP_OK;
     int log2N = dsp_power_of_two(N);
     int log4N = log2N >> 1;
@@ -140,7 +116,7 @@ esp_err_t dsps_bit_rev4r_direct_fc32_ansi(float *data, int N)
 
 esp_err_t dsps_fft4r_fc32_ansi_(float *data, int length, float *table, int table_size)
 {
-    if (0 == dsps_fft4r_initialized) {
+    if (table == NULL) {
         return ESP_ERR_DSP_UNINITIALIZED;
     }
 
@@ -217,7 +193,7 @@ esp_err_t dsps_fft4r_fc32_ansi_(float *data, int length, float *table, int table
 
 esp_err_t dsps_cplx2real_fc32_ansi_(float *data, int N, float *table, int table_size)
 {
-    if (0 == dsps_fft4r_initialized) {
+    if (table == NULL) {
         return ESP_ERR_DSP_UNINITIALIZED;
     }
     int wind_step = table_size / (N);
@@ -0,0 +1,253 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "dsps_fftmr.h"
+#include "dsp_types.h"
+#include <stddef.h>
+
+int dsps_fftmr_factors(int N, int *factors)
+{
+    static const int radix[] = {4, 2, 3, 5};
+    int count = 0;
+    if (N < 2) {
+        return 0;
+    }
+    for (int r = 0; r < sizeof(radix) / sizeof(radix[0]); r++) {
+        while ((N % radix[r]) == 0) {
+            if (count == DSPS_FFTMR_MAX_FACTORS) {
+                return 0;
+            }
+            if (factors != NULL) {
+                factors[count] = radix[r];
+            }
+            count++;
+            N /= radix[r];
+        }
+    }
+    return (N == 1) ? count : 0;
+}
+
+// Position of bin k in the result: the digits of k in the radices of the stages, in reverse order
+static int dsps_fftmr_digit_rev(int k, int N, const int *factors, int count)
+{
+    int result = 0;
+    int span = N;
+    for (int i = 0; i < count; i++) {
+        span /= factors[i];
+        result += (k % factors[i]) * span;
+        k /= factors[i];
+    }
+    return result;
+}
+
+int dsps_gen_digit_rev_table(uint16_t *reverse_tab, int N)
+{
+    int factors[DSPS_FFTMR_MAX_FACTORS];
+    int count = dsps_fftmr_factors(N, factors);
+    int size = 0;
+    for (int k = 1; k < N - 1; k++) {
+        // A cycle is stored once, from its smallest index
+        int len = 1;
+        int i = dsps_fftmr_digit_rev(k, N, factors, count);
+        while (i > k) {
+            i = dsps_fftmr_digit_rev(i, N, factors, count);
+            len++;
+        }
+        if ((i < k) || (len == 1)) {
+            continue;
+        }
+        if (reverse_tab != NULL) {
+            reverse_tab[size] = len;
+            i = k;
+            for (int n = 1; n <= len; n++) {
+                reverse_tab[size + n] = i;
+                i = dsps_fftmr_digit_rev(i, N, factors, count);
+            }
+        }
+        size += len + 1;
+    }
+    return size;
+}
+
+esp_err_t dsps_digit_rev_lookup_fc32_ansi(float *data, int reverse_size, const uint16_t *reverse_tab)
+{
+    fc32_t *in_data = (fc32_t *)data;
+    int n = 0;
+    while (n < reverse_size) {
+        int len = reverse_tab[n];
+        const uint16_t *cycle = &reverse_tab[n + 1];
+        fc32_t temp = in_data[cycle[0]];
+        for (int i = 1; i < len; i++) {
+            in_data[cycle[i - 1]] = in_data[cycle[i]];
+        }
+        in_data[cycle[len - 1]] = temp;
+        n += len + 1;
+    }
+    return ESP_OK;
+}
+
+// Butterflies of the decimation in frequency: the DFT of the radix values m apart,
+// with the outputs 1...radix-1 multiplied by the twiddles w[0]...w[radix-2]
+static inline void dsps_fftmr_twiddle(fc32_t *x, const fc32_t *w)
+{
+    float re = x->re;
+    x->re = re * w->re + x->im * w->im;
+    x->im = x->im * w->re - re * w->im;
+}
+
+static inline void dsps_fftmr_bf2(fc32_t *x, int m, const fc32_t *w)
+{
+    fc32_t a = x[0];
+    fc32_t b = x[m];
+    x[0].re = a.re + b.re;
+    x[0].im = a.im + b.im;
+    x[m].re = a.re - b.re;
+    x[m].im = a.im - b.im;
+    dsps_fftmr_twiddle(&x[m], &w[0]);
+}
+
+static inline void dsps_fftmr_bf3(fc32_t *x, int m, const fc32_t *w)
+{
+    const float s = 0.86602540378f; // sin(2*pi/3)
+    fc32_t a = x[0];
+    fc32_t t, u, v;
+    t.re = x[m].re + x[2 * m].re;
+    t.im = x[m].im + x[2 * m].im;
+    v.re = s * (x[m].im - x[2 * m].im);
+    v.im = s * (x[2 * m].re - x[m].re);
+    u.re = a.re - 0.5f * t.re;
+    u.im = a.im - 0.5f * t.im;
+
+    x[0].re = a.re + t.re;
+    x[0].im = a.im + t.im;
+    x[m].re = u.re + v.re;
+    x[m].im = u.im + v.im;
+    x[2 * m].re = u.re - v.re;
+    x[2 * m].im = u.im - v.im;
+    dsps_fftmr_twiddle(&x[m], &w[0]);
+    dsps_fftmr_twiddle(&x[2 * m], &w[1]);
+}
+
+static inline void dsps_fftmr_bf4(fc32_t *x, int m, const fc32_t *w)
+{
+    fc32_t t0, t1, t2, t3;
+    t0.re = x[0].re + x[2 * m].re;
+    t0.im = x[0].im + x[2 * m].im;
+    t1.re = x[0].re - x[2 * m].re;
+    t1.im = x[0].im - x[2 * m].im;
+    t2.re = x[m].re + x[3 * m].re;
+    t2.im = x[m].im + x[3 * m].im;
+    t3.re = x[m].re - x[3 * m].re;
+    t3.im = x[m].im - x[3 * m].im;
+
+    x[0].re = t0.re + t2.re;
+    x[0].im = t0.im + t2.im;
+    x[m].re = t1.re + t3.im;
+    x[m].im = t1.im - t3.re;
+    x[2 * m].re = t0.re - t2.re;
+    x[2 * m].im = t0.im - t2.im;
+    x[3 * m].re = t1.re - t3.im;
+    x[3 * m].im = t1.im + t3.re;
+    dsps_fftmr_twiddle(&x[m], &w[0]);
+    dsps_fftmr_twiddle(&x[2 * m], &w[1]);
+    dsps_fftmr_twiddle(&x[3 * m], &w[2]);
+}
+
+static inline void dsps_fftmr_bf5(fc32_t *x, int m, const fc32_t *w)
+{
+    const float c1 = 0.30901699437f;  // cos(2*pi/5)
+    const float c2 = -0.80901699437f; // cos(4*pi/5)
+    const float s1 = 0.95105651630f;  // sin(2*pi/5)
+    const float s2 = 0.58778525229f;  // sin(4*pi/5)
+    fc32_t a = x[0];
+    fc32_t a1, b1, a2, b2, u1, u2, v1, v2;
+    a1.re = x[m].re + x[4 * m].re;
+    a1.im = x[m].im + x[4 * m].im;
+    b1.re = x[m].re - x[4 * m].re;
+    b1.im = x[m].im - x[4 * m].im;
+    a2.re = x[2 * m].re + x[3 * m].re;
+    a2.im = x[2 * m].im + x[3 * m].im;
+    b2.re = x[2 * m].re - x[3 * m].re;
+    b2.im = x[2 * m].im - x[3 * m].im;
+
+    u1.re = a.re + c1 * a1.re + c2 * a2.re;
+    u1.im = a.im + c1 * a1.im + c2 * a2.im;
+    u2.re = a.re + c2 * a1.re + c1 * a2.re;
+    u2.im = a.im + c2 * a1.im + c1 * a2.im;
+    v1.re = s1 * b1.re + s2 * b2.re;
+    v1.im = s1 * b1.im + s2 * b2.im;
+    v2.re = s2 * b1.re - s1 * b2.re;
+    v2.im = s2 * b1.im - s1 * b2.im;
+
+    // Outputs 1 and 4 are u1 -/+ i*v1, outputs 2 and 3 are u2 -/+ i*v2
+    x[0].re = a.re + a1.re + a2.re;
+    x[0].im = a.im + a1.im + a2.im;
+    x[m].re = u1.re + v1.im;
+    x[m].im = u1.im - v1.re;
+    x[4 * m].re = u1.re - v1.im;
+    x[4 * m].im = u1.im + v1.re;
+    x[2 * m].re = u2.re + v2.im;
+    x[2 * m].im = u2.im - v2.re;
+    x[3 * m].re = u2.re - v2.im;
+    x[3 * m].im = u2.im + v2.re;
+    dsps_fftmr_twiddle(&x[m], &w[0]);
+    dsps_fftmr_twiddle(&x[2 * m], &w[1]);
+    dsps_fftmr_twiddle(&x[3 * m], &w[2]);
+    dsps_fftmr_twiddle(&x[4 * m], &w[3]);
+}
+
+esp_err_t dsps_fftmr_fc32_ansi_(float *data, int N, float *table, int table_size)
+{
+    if (table == NULL) {
+        return ESP_ERR_DSP_UNINITIALIZED;
+    }
+    int factors[DSPS_FFTMR_MAX_FACTORS];
+    int count = dsps_fftmr_factors(N, factors);
+    if ((count == 0) || (table_size % N)) {
+        return ESP_ERR_DSP_INVALID_LENGTH;
+    }
+
+    fc32_t *x = (fc32_t *)data;
+    const fc32_t *table_c = (const fc32_t *)table;
+    fc32_t w[4];
+    // Every stage splits the blocks of span values into radix blocks of m values
+    int span = N;
+    for (int stage = 0; stage < count; stage++) {
+        int radix = factors[stage];
+        int m = span / radix;
+        int tw_step = table_size / span;
+        for (int j = 0; j < m; j++) {
+            // The twiddles of the values j are the same for all the blocks
+            for (int p = 1; p < radix; p++) {
+                w[p - 1] = table_c[p * j * tw_step];
+            }
+            switch (radix) {
+            case 2:
+                for (int b = j; b < N; b += span) {
+                    dsps_fftmr_bf2(&x[b], m, w);
+                }
+                break;
+            case 3:
+                for (int b = j; b < N; b += span) {
+                    dsps_fftmr_bf3(&x[b], m, w);
+                }
+                break;
+            case 4:
+                for (int b = j; b < N; b += span) {
+                    dsps_fftmr_bf4(&x[b], m, w);
+                }
+                break;
+            default:
+                for (int b = j; b < N; b += span) {
+                    dsps_fftmr_bf5(&x[b], m, w);
+                }
+                break;
+            }
+        }
+        span = m;
+    }
+    return ESP_OK;
+}
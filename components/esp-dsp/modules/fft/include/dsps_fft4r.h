@@ -38,6 +38,8 @@ extern uint8_t dsps_fft4r_sc16_initialized;
  * @brief      init fft tables
  *
  * Initialization of Complex FFT Radix-4. This function initialize coefficients table.
+ * The tables belong to a default plan shared by all functions without a plan argument,
+ * see dsps_fft_plan_init(...) for FFTs with tables of their own.
  * The implementation use ANSI C and could be compiled and run on any platform
  *
  * @param[inout] fft_table_buff: pointer to floating point buffer where sin/cos table will be stored
@@ -51,7 +53,6 @@ extern uint8_t dsps_fft4r_sc16_initialized;
  * @return
  *      - ESP_OK on success
  *      - ESP_ERR_DSP_PARAM_OUTOFRANGE if table_size > CONFIG_DSP_MAX_FFT_SIZE
- *      - ESP_ERR_DSP_REINITIALIZED if buffer already allocated internally by other function
  *      - One of the error codes from DSP library
  */
 esp_err_t dsps_fft4r_init_fc32(float *fft_table_buff, int max_fft_size);
@@ -0,0 +1,219 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _dsps_fft_plan_H_
+#define _dsps_fft_plan_H_
+
+#include <stdint.h>
+#include "dsp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Enum defining the FFT a plan is made for
+ *
+ */
+typedef enum dsps_fft_plan_type {
+    DSPS_FFT_PLAN_FFT2R_FC32 = 0,   /*!< Complex FFT radix-2, single precision floating point*/
+    DSPS_FFT_PLAN_FFT2R_SC16 = 1,   /*!< Complex FFT radix-2, Q15 fixed point*/
+    DSPS_FFT_PLAN_FFT4R_FC32 = 2,   /*!< Complex FFT radix-4, single precision floating point*/
+    DSPS_FFT_PLAN_FFTMR_FC32 = 3,   /*!< Complex FFT of mixed radix 2/3/4/5, single precision floating point*/
+} dsps_fft_plan_type_t;
+
+/**
+ * @brief Data struct of the FFT plan
+ *
+ * A plan holds the sin/cos table and the bit reverse table of FFTs up to a maximum length,
+ * mixed radix plans those of one length.
+ * The FFT functions only read a plan, so one plan can be used by several tasks at the same time,
+ * and plans of different lengths can be used next to each other.
+ * All the fields of this structure are initialized by the dsps_fft_plan_init(...) function.
+ */
+typedef struct dsps_fft_plan_s {
+    dsps_fft_plan_type_t type;      /*!< FFT the plan is made for*/
+    int32_t     max_size;           /*!< Maximum FFT length, shorter FFTs of a valid length use the plan as well, except for mixed radix plans*/
+    void       *table;              /*!< sin/cos table, float for fc32 plans and int16_t for sc16 plans*/
+    int32_t     table_size;         /*!< Size of the sin/cos table as it is passed to the FFT functions*/
+    uint16_t   *rev_table;          /*!< Index pairs of the bit reverse of max_size points, NULL if it is done directly.
+                                         Cycles of the digit reverse for mixed radix plans, see dsps_gen_digit_rev_table(...)*/
+    int32_t     rev_table_size;     /*!< Number of index pairs in rev_table, number of values for mixed radix plans*/
+    int16_t     free_status;        /*!< Indicator for dsps_fft_plan_free(...) function*/
+} dsps_fft_plan_t;
+
+/**
+ * @brief      Initialize FFT plan
+ *
+ * Function initializes a plan for the FFT of a type up to max_size points. The sin/cos table
+ * and the bit reverse table of max_size points are generated into memory the plan owns.
+ * A mixed radix plan is made for FFTs of exactly max_size points, a product of 2, 3 and 5,
+ * such as 240, 320, 480 or 960.
+ * dsps_fft_plan_free(...) must be called, once the plan is not needed anymore.
+ * The implementation use ANSI C and could be compiled and run on any platform
+ *
+ * @param plan: pointer to the plan structure
+ * @param type: FFT the plan is made for
+ * @param table_buff: pointer to a buffer for the sin/cos table, that is filled by the function.
+ *                    If this parameter is NULL the buffer is allocated internally.
+ *                    The buffer holds max_size values of the plan data type for radix-2 plans
+ *                    and 4 * max_size floats for radix-4 and mixed radix plans.
+ * @param max_size: maximum FFT length, power of two, up to CONFIG_DSP_MAX_FFT_SIZE.
+ *                  For mixed radix plans the FFT length, a product of 2, 3 and 5.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_DSP_INVALID_LENGTH if max_size is not a power of two, or not a product of 2, 3 and 5 for mixed radix plans
+ *      - ESP_ERR_DSP_PARAM_OUTOFRANGE if max_size > CONFIG_DSP_MAX_FFT_SIZE or memory could not be allocated
+ *      - ESP_ERR_DSP_INVALID_PARAM if the type is unknown
+ */
+esp_err_t dsps_fft_plan_init(dsps_fft_plan_t *plan, dsps_fft_plan_type_t type, void *table_buff, int max_size);
+
+/**
+ * @brief      Free FFT plan
+ *
+ * Function frees the tables allocated by dsps_fft_plan_init(...). No task may use the plan at that time.
+ *
+ * @param plan: pointer to the plan structure
+ */
+void dsps_fft_plan_free(dsps_fft_plan_t *plan);
+
+/**@{*/
+/**
+ * @brief      Default FFT plans
+ *
+ * The plans of the FFT functions without a plan argument, initialized by dsps_fft2r_init_fc32(...),
+ * dsps_fft2r_init_sc16(...) and dsps_fft4r_init_fc32(...). They let the plan functions,
+ * e.g. dsps_fft_plan_real_fc32(...), work with the default tables.
+ *
+ * @return
+ *      - pointer to the default plan, its table is NULL until the init function is called
+ */
+const dsps_fft_plan_t *dsps_fft2r_get_plan_fc32(void);
+const dsps_fft_plan_t *dsps_fft2r_get_plan_sc16(void);
+const dsps_fft_plan_t *dsps_fft4r_get_plan_fc32(void);
+/**@}*/
+
+/**@{*/
+/**
+ * @brief      Complex FFT with a plan
+ *
+ * Complex FFT of the type of the plan. The result is in bit reversed order, as the one of
+ * dsps_fft2r_fc32(...) and dsps_fft4r_fc32(...), and is brought into order with dsps_fft_plan_bit_rev_*(...).
+ * The functions use the optimized implementation when CONFIG_DSP_OPTIMIZED is set
+ * and the chip has one.
+ *
+ * @param plan: FFT plan, initialized for the data type
+ * @param[inout] data: input/output complex array. An elements located: Re[0], Im[0], ... Re[N-1], Im[N-1]
+ *               result of FFT will be stored to this array.
+ * @param[in] N: Number of complex elements in input array, up to max_size of the plan.
+ *               A power of four for radix-4 plans, max_size for mixed radix plans.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_DSP_INVALID_LENGTH if N is not a valid length for the plan
+ *      - ESP_ERR_DSP_INVALID_PARAM if the plan is of another data type
+ *      - ESP_ERR_DSP_UNINITIALIZED if the plan was not initialized
+ */
+esp_err_t dsps_fft_plan_fc32(const dsps_fft_plan_t *plan, float *data, int N);
+esp_err_t dsps_fft_plan_sc16(const dsps_fft_plan_t *plan, int16_t *data, int N);
+/**@}*/
+
+/**@{*/
+/**
+ * @brief      Bit reverse with a plan
+ *
+ * Brings the result of dsps_fft_plan_fc32(...) or dsps_fft_plan_sc16(...) into order.
+ * FFTs of max_size points use the table of the plan, shorter ones the tables in flash
+ * or a direct bit reverse.
+ *
+ * @param plan: FFT plan the FFT was done with
+ * @param[inout] data: input/output complex array
+ * @param[in] N: Number of complex elements in input array
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - One of the error codes from DSP library
+ */
+esp_err_t dsps_fft_plan_bit_rev_fc32(const dsps_fft_plan_t *plan, float *data, int N);
+esp_err_t dsps_fft_plan_bit_rev_sc16(const dsps_fft_plan_t *plan, int16_t *data, int N);
+/**@}*/
+
+/**
+ * @brief      Convert complex FFT result to real array with a plan
+ *
+ * Same as dsps_cplx2real_fc32(...), with the sin/cos table of a radix-4 or mixed radix plan.
+ *
+ * @param plan: radix-4 fc32 plan with max_size of at least N, or mixed radix plan of N points
+ * @param[inout] data: result of the FFT of N points, with the real input packed as complex
+ * @param[in] N: Number of complex elements in input array
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - One of the error codes from DSP library
+ */
+esp_err_t dsps_fft_plan_cplx2real_fc32(const dsps_fft_plan_t *plan, float *data, int N);
+
+/**@{*/
+/**
+ * @brief      Real FFT with a plan
+ *
+ * FFT of N real values, done as a complex FFT of N/2 points of the values packed as complex
+ * ones, followed by a split step. Needs half the data memory and about half the time of
+ * a complex FFT of N points with zero imaginary parts. The result is in order.
+ * The sc16 result is scaled by 1/N, as the one of the sc16 complex FFT.
+ * The complex FFT uses the optimized implementation when CONFIG_DSP_OPTIMIZED is set
+ * and the chip has one, as does the split step of radix-4 plans.
+ *
+ * @param plan: FFT plan of the data type. N may be up to max_size for radix-2 plans,
+ *              up to 2 * max_size with N/2 a power of four for radix-4 plans,
+ *              and is 2 * max_size for mixed radix plans.
+ * @param[inout] data: input/output array of N values. An elements located: x[0], x[1], ... x[N-1]
+ *               The result is stored as: Re[0], Re[N/2], Re[1], Im[1], ... Re[N/2-1], Im[N/2-1],
+ *               Re[0] and Re[N/2] have no imaginary part, the bins above N/2 are the conjugated ones below.
+ * @param[in] N: Number of real values, a power of two, at least 4, or twice the length of a mixed radix plan
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_DSP_INVALID_LENGTH if N is not a valid length for the plan
+ *      - ESP_ERR_DSP_INVALID_PARAM if the plan is of another data type
+ *      - ESP_ERR_DSP_UNINITIALIZED if the plan was not initialized
+ */
+esp_err_t dsps_fft_plan_real_fc32(const dsps_fft_plan_t *plan, float *data, int N);
+esp_err_t dsps_fft_plan_real_sc16(const dsps_fft_plan_t *plan, int16_t *data, int N);
+/**@}*/
+
+/**@{*/
+/**
+ * @brief      Inverse real FFT with a plan
+ *
+ * Inverse FFT of a spectrum of N real values in the format of dsps_fft_plan_real_fc32(...):
+ * a merge step followed by a complex FFT of N/2 points.
+ * The result is scaled by 1/N, so the fc32 inverse of the result of dsps_fft_plan_real_fc32(...)
+ * gives back its input. The sc16 inverse of the result of dsps_fft_plan_real_sc16(...) gives
+ * back its input scaled by 1/N, as the forward one is scaled already.
+ *
+ * @param plan: FFT plan of the data type, the same N as for dsps_fft_plan_real_fc32(...)
+ * @param[inout] data: input/output array of N values. Spectrum on input, real values on output.
+ * @param[in] N: Number of real values, a power of two, at least 4, or twice the length of a mixed radix plan
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_DSP_INVALID_LENGTH if N is not a valid length for the plan
+ *      - ESP_ERR_DSP_INVALID_PARAM if the plan is of another data type
+ *      - ESP_ERR_DSP_UNINITIALIZED if the plan was not initialized
+ */
+esp_err_t dsps_fft_plan_real_inv_fc32(const dsps_fft_plan_t *plan, float *data, int N);
+esp_err_t dsps_fft_plan_real_inv_sc16(const dsps_fft_plan_t *plan, int16_t *data, int N);
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _dsps_fft_plan_H_
@@ -0,0 +1,94 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _dsps_fftmr_H_
+#define _dsps_fftmr_H_
+
+#include <stdint.h>
+#include "dsp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Maximum number of radix-2/3/4/5 stages, enough for 2^15 points
+#define DSPS_FFTMR_MAX_FACTORS 16
+
+/**
+ * @brief      Factors of a mixed radix FFT
+ *
+ * Splits N into the radices of the stages of dsps_fftmr_fc32_ansi_(...), radix 4 as often as possible.
+ *
+ * @param[in] N: Number of complex elements
+ * @param[out] factors: array of DSPS_FFTMR_MAX_FACTORS radices, may be NULL
+ *
+ * @return
+ *      - number of stages, 0 if N is not a product of 2, 3 and 5
+ */
+int dsps_fftmr_factors(int N, int *factors);
+
+/**@{*/
+/**
+ * @brief      Mixed radix complex FFT
+ *
+ * Complex FFT of N points, with N a product of 2, 3 and 5, such as the 240, 320, 480 and 960
+ * points of 10 and 20 ms frames at 16 and 24 kHz. The stages are radix-4, radix-2, radix-3 and radix-5.
+ * The result is in digit reversed order and is brought into order with dsps_digit_rev_lookup_fc32_ansi(...).
+ * Usually called through a plan of the type DSPS_FFT_PLAN_FFTMR_FC32, see dsps_fft_plan_init(...).
+ * The implementation use ANSI C and could be compiled and run on any platform
+ *
+ * @param[inout] data: input/output complex array. An elements located: Re[0], Im[0], ... Re[N-1], Im[N-1]
+ *               result of FFT will be stored to this array.
+ * @param[in] N: Number of complex elements in input array
+ * @param[in] table: sin/cos table of the angles 2*pi*i/table_size, i = 0...table_size-1
+ * @param[in] table_size: number of sin/cos pairs in the table, a multiple of N
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_DSP_INVALID_LENGTH if N is not a product of 2, 3 and 5
+ *      - ESP_ERR_DSP_UNINITIALIZED if the table is NULL
+ */
+esp_err_t dsps_fftmr_fc32_ansi_(float *data, int N, float *table, int table_size);
+/**@}*/
+
+/**@{*/
+/**
+ * @brief      Digit reverse of the mixed radix FFT result
+ *
+ * Brings the result of dsps_fftmr_fc32_ansi_(...) into order, by the cycles of the permutation
+ * generated by dsps_gen_digit_rev_table(...).
+ * The implementation use ANSI C and could be compiled and run on any platform
+ *
+ * @param[inout] data: input/output complex array
+ * @param[in] reverse_size: number of values in reverse_tab
+ * @param[in] reverse_tab: cycles of the permutation
+ *
+ * @return
+ *      - ESP_OK on success
+ */
+esp_err_t dsps_digit_rev_lookup_fc32_ansi(float *data, int reverse_size, const uint16_t *reverse_tab);
+/**@}*/
+
+/**
+ * @brief      Generate the digit reverse table
+ *
+ * Every cycle of the permutation is stored as its length followed by the indexes of its elements.
+ *
+ * @param[out] reverse_tab: table to fill, NULL to get the size only
+ * @param[in] N: Number of complex elements, a product of 2, 3 and 5
+ *
+ * @return
+ *      - number of values of the table, 0 if the data is in order already
+ */
+int dsps_gen_digit_rev_table(uint16_t *reverse_tab, int N);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _dsps_fftmr_H_
@@ -0,0 +1,369 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "dsps_fft_plan.h"
+#include "dsps_fft2r.h"
+#include "dsps_fft4r.h"
+#include "dsps_fftmr.h"
+#include "dsp_common.h"
+#include "dsp_types.h"
+#include <math.h>
+#include <string.h>
+#include <malloc.h>
+
+// The FFT functions take the table as an argument, the ones of the plan are picked here
+#if CONFIG_DSP_OPTIMIZED && (dsps_fft2r_fc32_aes3_enabled == 1)
+#define dsps_fft_plan_fft2r_fc32 dsps_fft2r_fc32_aes3_
+#elif CONFIG_DSP_OPTIMIZED && (dsps_fft2r_fc32_ae32_enabled == 1)
+#define dsps_fft_plan_fft2r_fc32 dsps_fft2r_fc32_ae32_
+#else
+#define dsps_fft_plan_fft2r_fc32 dsps_fft2r_fc32_ansi_
+#endif
+
+#if CONFIG_DSP_OPTIMIZED && (dsps_fft2r_sc16_aes3_enabled == 1)
+#define dsps_fft_plan_fft2r_sc16 dsps_fft2r_sc16_aes3_
+#elif CONFIG_DSP_OPTIMIZED && (dsps_fft2r_sc16_ae32_enabled == 1)
+#define dsps_fft_plan_fft2r_sc16 dsps_fft2r_sc16_ae32_
+#else
+#define dsps_fft_plan_fft2r_sc16 dsps_fft2r_sc16_ansi_
+#endif
+
+#if CONFIG_DSP_OPTIMIZED && (dsps_fft4r_fc32_ae32_enabled == 1)
+#define dsps_fft_plan_fft4r_fc32 dsps_fft4r_fc32_ae32_
+#else
+#define dsps_fft_plan_fft4r_fc32 dsps_fft4r_fc32_ansi_
+#endif
+
+#if CONFIG_DSP_OPTIMIZED && (dsps_cplx2real_fc32_ae32_enabled == 1)
+#define dsps_fft_plan_cplx2real_fc32_ dsps_cplx2real_fc32_ae32_
+#else
+#define dsps_fft_plan_cplx2real_fc32_ dsps_cplx2real_fc32_ansi_
+#endif
+
+// Index pairs of the bit reverse are byte offsets of fc32 values, as the tables of dsps_gen_bitrev2r_table(N, 8, "fc32")
+#define DSPS_FFT_PLAN_REV_STEP 8
+#define DSPS_FFT_PLAN_REV_MAX_SIZE (UINT16_MAX / DSPS_FFT_PLAN_REV_STEP + 1)
+
+// Tables in flash of the FFTs shorter than the plan, they are never changed
+static const uint16_t *const dsps_fft_plan_rev2r_tables[] = {
+    bitrev2r_table_16_fc32,
+    bitrev2r_table_32_fc32,
+    bitrev2r_table_64_fc32,
+    bitrev2r_table_128_fc32,
+    bitrev2r_table_256_fc32,
+    bitrev2r_table_512_fc32,
+    bitrev2r_table_1024_fc32,
+    bitrev2r_table_2048_fc32,
+    bitrev2r_table_4096_fc32,
+};
+
+static const uint16_t *const dsps_fft_plan_rev4r_tables[] = {
+    bitrev4r_table_16_fc32,
+    bitrev4r_table_64_fc32,
+    bitrev4r_table_256_fc32,
+    bitrev4r_table_1024_fc32,
+    bitrev4r_table_4096_fc32,
+};
+
+static int dsps_fft_plan_reverse(int i, int log2N, int radix4)
+{
+    int result = 0;
+    int bits = radix4 ? 2 : 1;
+    for (int cnt = log2N / bits; cnt > 0; cnt--) {
+        result = (result << bits) | (i & ((1 << bits) - 1));
+        i >>= bits;
+    }
+    return result;
+}
+
+static int dsps_fft_plan_gen_rev(uint16_t *rev_table, int N, int radix4)
+{
+    int log2N = dsp_power_of_two(N);
+    int count = 0;
+    for (int i = 1; i < N - 1; i++) {
+        int j = dsps_fft_plan_reverse(i, log2N, radix4);
+        if (i < j) {
+            if (rev_table != NULL) {
+                rev_table[count * 2 + 0] = i * DSPS_FFT_PLAN_REV_STEP;
+                rev_table[count * 2 + 1] = j * DSPS_FFT_PLAN_REV_STEP;
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+static esp_err_t dsps_fft_plan_gen_w(dsps_fft_plan_t *plan)
+{
+    esp_err_t result = ESP_OK;
+    switch (plan->type) {
+    case DSPS_FFT_PLAN_FFT2R_FC32:
+        result = dsps_gen_w_r2_fc32((float *)plan->table, plan->max_size);
+        if (result == ESP_OK) {
+            result = dsps_bit_rev_fc32_ansi((float *)plan->table, plan->max_size >> 1);
+        }
+        break;
+    case DSPS_FFT_PLAN_FFT2R_SC16:
+        result = dsps_gen_w_r2_sc16((int16_t *)plan->table, plan->max_size);
+        if (result == ESP_OK) {
+            result = dsps_bit_rev_sc16_ansi((int16_t *)plan->table, plan->max_size >> 1);
+        }
+        break;
+    case DSPS_FFT_PLAN_FFT4R_FC32:
+    case DSPS_FFT_PLAN_FFTMR_FC32: {
+        float *w = (float *)plan->table;
+        for (int i = 0; i < plan->table_size; i++) {
+            float angle = 2 * M_PI * i / (float)plan->table_size;
+            w[2 * i + 0] = cosf(angle);
+            w[2 * i + 1] = sinf(angle);
+        }
+        break;
+    }
+    default:
+        result = ESP_ERR_DSP_INVALID_PARAM;
+        break;
+    }
+    return result;
+}
+
+esp_err_t dsps_fft_plan_init(dsps_fft_plan_t *plan, dsps_fft_plan_type_t type, void *table_buff, int max_size)
+{
+    memset(plan, 0, sizeof(dsps_fft_plan_t));
+    if (type == DSPS_FFT_PLAN_FFTMR_FC32) {
+        if (dsps_fftmr_factors(max_size, NULL) == 0) {
+            return ESP_ERR_DSP_INVALID_LENGTH;
+        }
+    } else if (!dsp_is_power_of_two(max_size)) {
+        return ESP_ERR_DSP_INVALID_LENGTH;
+    }
+    if (max_size > CONFIG_DSP_MAX_FFT_SIZE) {
+        return ESP_ERR_DSP_PARAM_OUTOFRANGE;
+    }
+    plan->type = type;
+    plan->max_size = max_size;
+
+    size_t table_bytes;
+    switch (type) {
+    case DSPS_FFT_PLAN_FFT2R_FC32:
+        plan->table_size = max_size;
+        table_bytes = max_size * sizeof(float);
+        break;
+    case DSPS_FFT_PLAN_FFT2R_SC16:
+        plan->table_size = max_size;
+        table_bytes = max_size * sizeof(int16_t);
+        break;
+    case DSPS_FFT_PLAN_FFT4R_FC32:
+    case DSPS_FFT_PLAN_FFTMR_FC32:
+        plan->table_size = max_size * 2;
+        table_bytes = max_size * 4 * sizeof(float);
+        break;
+    default:
+        return ESP_ERR_DSP_INVALID_PARAM;
+    }
+
+    if (table_buff == NULL) {
+#if CONFIG_IDF_TARGET_ESP32S3
+        table_buff = memalign(16, table_bytes);
+#else
+        table_buff = malloc(table_bytes);
+#endif
+        if (table_buff == NULL) {
+            return ESP_ERR_DSP_PARAM_OUTOFRANGE;
+        }
+        plan->free_status |= 0x0001;
+    }
+    plan->table = table_buff;
+
+    esp_err_t result = dsps_fft_plan_gen_w(plan);
+    if (result != ESP_OK) {
+        dsps_fft_plan_free(plan);
+        return result;
+    }
+
+    if (type == DSPS_FFT_PLAN_FFTMR_FC32) {
+        int count = dsps_gen_digit_rev_table(NULL, max_size);
+        if (count > 0) {
+            plan->rev_table = (uint16_t *)malloc(count * sizeof(uint16_t));
+            if (plan->rev_table == NULL) {
+                dsps_fft_plan_free(plan);
+                return ESP_ERR_DSP_PARAM_OUTOFRANGE;
+            }
+            plan->free_status |= 0x0002;
+            plan->rev_table_size = dsps_gen_digit_rev_table(plan->rev_table, max_size);
+        }
+        return ESP_OK;
+    }
+
+    // The bit reverse of the full length gets its table in RAM, the radix-4 FFT only does powers of four
+    int radix4 = (type == DSPS_FFT_PLAN_FFT4R_FC32);
+    int log2N = dsp_power_of_two(max_size);
+    if ((max_size <= DSPS_FFT_PLAN_REV_MAX_SIZE) && !(radix4 && (log2N & 1))) {
+        int count = dsps_fft_plan_gen_rev(NULL, max_size, radix4);
+        if (count > 0) {
+            plan->rev_table = (uint16_t *)malloc(2 * count * sizeof(uint16_t));
+            if (plan->rev_table == NULL) {
+                dsps_fft_plan_free(plan);
+                return ESP_ERR_DSP_PARAM_OUTOFRANGE;
+            }
+            plan->free_status |= 0x0002;
+            plan->rev_table_size = dsps_fft_plan_gen_rev(plan->rev_table, max_size, radix4);
+        }
+    }
+    return ESP_OK;
+}
+
+void dsps_fft_plan_free(dsps_fft_plan_t *plan)
+{
+    if (plan->free_status & 0x0001) {
+        free(plan->table);
+    }
+    if (plan->free_status & 0x0002) {
+        free(plan->rev_table);
+    }
+    memset(plan, 0, sizeof(dsps_fft_plan_t));
+}
+
+static esp_err_t dsps_fft_plan_check(const dsps_fft_plan_t *plan, int N)
+{
+    if (plan->table == NULL) {
+        return ESP_ERR_DSP_UNINITIALIZED;
+    }
+    if (plan->type == DSPS_FFT_PLAN_FFTMR_FC32) {
+        return (N == plan->max_size) ? ESP_OK : ESP_ERR_DSP_INVALID_LENGTH;
+    }
+    if (!dsp_is_power_of_two(N) || (N > plan->max_size)) {
+        return ESP_ERR_DSP_INVALID_LENGTH;
+    }
+    if ((plan->type == DSPS_FFT_PLAN_FFT4R_FC32) && (dsp_power_of_two(N) & 1)) {
+        return ESP_ERR_DSP_INVALID_LENGTH;
+    }
+    return ESP_OK;
+}
+
+esp_err_t dsps_fft_plan_fc32(const dsps_fft_plan_t *plan, float *data, int N)
+{
+    esp_err_t result = dsps_fft_plan_check(plan, N);
+    if (result != ESP_OK) {
+        return result;
+    }
+    switch (plan->type) {
+    case DSPS_FFT_PLAN_FFT2R_FC32:
+        return dsps_fft_plan_fft2r_fc32(data, N, (float *)plan->table);
+    case DSPS_FFT_PLAN_FFT4R_FC32:
+        return dsps_fft_plan_fft4r_fc32(data, N, (float *)plan->table, plan->table_size);
+    case DSPS_FFT_PLAN_FFTMR_FC32:
+        return dsps_fftmr_fc32_ansi_(data, N, (float *)plan->table, plan->table_size);
+    default:
+        return ESP_ERR_DSP_INVALID_PARAM;
+    }
+}
+
+esp_err_t dsps_fft_plan_sc16(const dsps_fft_plan_t *plan, int16_t *data, int N)
+{
+    esp_err_t result = dsps_fft_plan_check(plan, N);
+    if (result != ESP_OK) {
+        return result;
+    }
+    if (plan->type != DSPS_FFT_PLAN_FFT2R_SC16) {
+        return ESP_ERR_DSP_INVALID_PARAM;
+    }
+    return dsps_fft_plan_fft2r_sc16(data, N, (int16_t *)plan->table);
+}
+
+static const uint16_t *dsps_fft_plan_rev_table(const dsps_fft_plan_t *plan, int N, int *rev_table_size)
+{
+    if ((N == plan->max_size) && (plan->rev_table != NULL)) {
+        *rev_table_size = plan->rev_table_size;
+        return plan->rev_table;
+    }
+    int pow = dsp_power_of_two(N);
+    if (plan->type == DSPS_FFT_PLAN_FFT4R_FC32) {
+        if ((pow & 1) || (pow < 4) || (pow > 12)) {
+            return NULL;
+        }
+        *rev_table_size = dsps_fft4r_rev_tables_fc32_size[(pow >> 1) - 2];
+        return dsps_fft_plan_rev4r_tables[(pow >> 1) - 2];
+    }
+    if ((pow < 4) || (pow > 12)) {
+        return NULL;
+    }
+    *rev_table_size = dsps_fft2r_rev_tables_fc32_size[pow - 4];
+    return dsps_fft_plan_rev2r_tables[pow - 4];
+}
+
+esp_err_t dsps_fft_plan_bit_rev_fc32(const dsps_fft_plan_t *plan, float *data, int N)
+{
+    esp_err_t result = dsps_fft_plan_check(plan, N);
+    if (result != ESP_OK) {
+        return result;
+    }
+    if (plan->type == DSPS_FFT_PLAN_FFTMR_FC32) {
+        return dsps_digit_rev_lookup_fc32_ansi(data, plan->rev_table_size, plan->rev_table);
+    }
+    int rev_table_size = 0;
+    const uint16_t *rev_table = dsps_fft_plan_rev_table(plan, N, &rev_table_size);
+    if (rev_table != NULL) {
+        return dsps_bit_rev_lookup_fc32(data, rev_table_size, (uint16_t *)rev_table);
+    }
+    switch (plan->type) {
+    case DSPS_FFT_PLAN_FFT2R_FC32:
+        return dsps_bit_rev_fc32_ansi(data, N);
+    case DSPS_FFT_PLAN_FFT4R_FC32:
+        return dsps_bit_rev4r_direct_fc32_ansi(data, N);
+    default:
+        return ESP_ERR_DSP_INVALID_PARAM;
+    }
+}
+
+esp_err_t dsps_fft_plan_bit_rev_sc16(const dsps_fft_plan_t *plan, int16_t *data, int N)
+{
+    esp_err_t result = dsps_fft_plan_check(plan, N);
+    if (result != ESP_OK) {
+        return result;
+    }
+    if (plan->type != DSPS_FFT_PLAN_FFT2R_SC16) {
+        return ESP_ERR_DSP_INVALID_PARAM;
+    }
+    int rev_table_size = 0;
+    const uint16_t *rev_table = dsps_fft_plan_rev_table(plan, N, &rev_table_size);
+    if (rev_table == NULL) {
+        return dsps_bit_rev_sc16_ansi(data, N);
+    }
+    // A complex sc16 value takes half the bytes of a fc32 one
+    uint32_t *in_data = (uint32_t *)data;
+    for (int n = 0; n < rev_table_size; n++) {
+        uint16_t i = rev_table[n * 2 + 0] / DSPS_FFT_PLAN_REV_STEP;
+        uint16_t j = rev_table[n * 2 + 1] / DSPS_FFT_PLAN_REV_STEP;
+        uint32_t temp = in_data[j];
+        in_data[j] = in_data[i];
+        in_data[i] = temp;
+    }
+    return ESP_OK;
+}
+
+esp_err_t dsps_fft_plan_cplx2real_fc32(const dsps_fft_plan_t *plan, float *data, int N)
+{
+    if (plan->table == NULL) {
+        return ESP_ERR_DSP_UNINITIALIZED;
+    }
+    if (plan->type == DSPS_FFT_PLAN_FFTMR_FC32) {
+        if (N != plan->max_size) {
+            return ESP_ERR_DSP_INVALID_LENGTH;
+        }
+        // The optimized version does two bins per loop, up to N/2 when N is a multiple of 4
+        if (N & 3) {
+            return dsps_cplx2real_fc32_ansi_(data, N, (float *)plan->table, plan->table_size);
+        }
+        return dsps_fft_plan_cplx2real_fc32_(data, N, (float *)plan->table, plan->table_size);
+    }
+    if (plan->type != DSPS_FFT_PLAN_FFT4R_FC32) {
+        return ESP_ERR_DSP_INVALID_PARAM;
+    }
+    if (!dsp_is_power_of_two(N) || (N > plan->max_size)) {
+        return ESP_ERR_DSP_INVALID_LENGTH;
+    }
+    return dsps_fft_plan_cplx2real_fc32_(data, N, (float *)plan->table, plan->table_size);
+}
@@ -0,0 +1,271 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "dsps_fft_plan.h"
+#include "dsp_common.h"
+#include "dsp_types.h"
+#include <math.h>
+
+// The N real values are packed as N/2 complex ones. The split step after the complex FFT
+// and the merge step before it pair the bins k and N/2 - k, with the sin/cos of 2*pi*k/N.
+// The table of a radix-4 or mixed radix plan is in natural order, the one of a radix-2 plan in
+// bit reversed order, where the value of bin k of an FFT of N/2 points is at the bit reversed k.
+static inline int dsps_fft_plan_real_next_rev(int rev, int M)
+{
+    int bit = M >> 1;
+    while (rev & bit) {
+        rev ^= bit;
+        bit >>= 1;
+    }
+    return rev | bit;
+}
+
+static inline int16_t dsps_fft_plan_real_sat16(int32_t value)
+{
+    if (value > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (value < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)value;
+}
+
+static esp_err_t dsps_fft_plan_real_check(const dsps_fft_plan_t *plan, int N)
+{
+    if (plan->table == NULL) {
+        return ESP_ERR_DSP_UNINITIALIZED;
+    }
+    if (plan->type == DSPS_FFT_PLAN_FFTMR_FC32) {
+        return (N == plan->max_size * 2) ? ESP_OK : ESP_ERR_DSP_INVALID_LENGTH;
+    }
+    if (!dsp_is_power_of_two(N) || (N < 4)) {
+        return ESP_ERR_DSP_INVALID_LENGTH;
+    }
+    // A radix-2 table holds the angles of max_size points, a radix-4 one those of 2 * max_size points
+    if (plan->type == DSPS_FFT_PLAN_FFT4R_FC32) {
+        if (((N >> 1) > plan->max_size) || (dsp_power_of_two(N >> 1) & 1)) {
+            return ESP_ERR_DSP_INVALID_LENGTH;
+        }
+    } else if (N > plan->max_size) {
+        return ESP_ERR_DSP_INVALID_LENGTH;
+    }
+    return ESP_OK;
+}
+
+esp_err_t dsps_fft_plan_real_fc32(const dsps_fft_plan_t *plan, float *data, int N)
+{
+    esp_err_t result = dsps_fft_plan_real_check(plan, N);
+    if (result != ESP_OK) {
+        return result;
+    }
+    if (plan->type == DSPS_FFT_PLAN_FFT2R_SC16) {
+        return ESP_ERR_DSP_INVALID_PARAM;
+    }
+    int M = N >> 1;
+    result = dsps_fft_plan_fc32(plan, data, M);
+    if (result == ESP_OK) {
+        result = dsps_fft_plan_bit_rev_fc32(plan, data, M);
+    }
+    if (result != ESP_OK) {
+        return result;
+    }
+    if (plan->type != DSPS_FFT_PLAN_FFT2R_FC32) {
+        return dsps_fft_plan_cplx2real_fc32(plan, data, M);
+    }
+
+    // Same as dsps_cplx2real_fc32_ansi_(...) with the bit reversed table
+    const float *w = (const float *)plan->table;
+    fc32_t *spectrum = (fc32_t *)data;
+    float tmp_re = spectrum[0].re;
+    spectrum[0].re = tmp_re + spectrum[0].im;
+    spectrum[0].im = tmp_re - spectrum[0].im;
+
+    fc32_t f1k, f2k;
+    int rev = 0;
+    for (int k = 1; k <= M / 2; k++) {
+        rev = dsps_fft_plan_real_next_rev(rev, M);
+        fc32_t fpk = spectrum[k];
+        fc32_t fpnk = spectrum[M - k];
+        f1k.re = fpk.re + fpnk.re;
+        f1k.im = fpk.im - fpnk.im;
+        f2k.re = fpk.re - fpnk.re;
+        f2k.im = fpk.im + fpnk.im;
+
+        float c = -w[rev * 2 + 1];
+        float s = -w[rev * 2 + 0];
+        fc32_t tw;
+        tw.re = c * f2k.re - s * f2k.im;
+        tw.im = s * f2k.re + c * f2k.im;
+
+        spectrum[k].re = 0.5 * (f1k.re + tw.re);
+        spectrum[k].im = 0.5 * (f1k.im + tw.im);
+        spectrum[M - k].re = 0.5 * (f1k.re - tw.re);
+        spectrum[M - k].im = 0.5 * (tw.im - f1k.im);
+    }
+    return ESP_OK;
+}
+
+esp_err_t dsps_fft_plan_real_inv_fc32(const dsps_fft_plan_t *plan, float *data, int N)
+{
+    esp_err_t result = dsps_fft_plan_real_check(plan, N);
+    if (result != ESP_OK) {
+        return result;
+    }
+    if (plan->type == DSPS_FFT_PLAN_FFT2R_SC16) {
+        return ESP_ERR_DSP_INVALID_PARAM;
+    }
+    int M = N >> 1;
+    int natural = (plan->type != DSPS_FFT_PLAN_FFT2R_FC32);
+    int wind_step = plan->table_size / M;
+    const float *w = (const float *)plan->table;
+    fc32_t *spectrum = (fc32_t *)data;
+
+    // The merge step gives the conjugated spectrum of the packed values scaled by 1/(N/2),
+    // so the forward FFT and a conjugation of its result do the inverse FFT
+    float scale = 1.0f / N;
+    float tmp_re = spectrum[0].re;
+    spectrum[0].re = (tmp_re + spectrum[0].im) * scale;
+    spectrum[0].im = (spectrum[0].im - tmp_re) * scale;
+
+    fc32_t f1k, f2k;
+    int rev = 0;
+    for (int k = 1; k <= M / 2; k++) {
+        rev = dsps_fft_plan_real_next_rev(rev, M);
+        const float *wk = natural ? &w[k * wind_step] : &w[rev * 2];
+        fc32_t fpk = spectrum[k];
+        fc32_t fpnk = spectrum[M - k];
+        f1k.re = fpk.re + fpnk.re;
+        f1k.im = fpk.im - fpnk.im;
+        f2k.re = fpk.re - fpnk.re;
+        f2k.im = fpk.im + fpnk.im;
+
+        float c = wk[0];
+        float s = wk[1];
+        fc32_t tw;
+        tw.re = -s * f2k.re - c * f2k.im;
+        tw.im = c * f2k.re - s * f2k.im;
+
+        spectrum[k].re = (f1k.re + tw.re) * scale;
+        spectrum[k].im = -(f1k.im + tw.im) * scale;
+        spectrum[M - k].re = (f1k.re - tw.re) * scale;
+        spectrum[M - k].im = (f1k.im - tw.im) * scale;
+    }
+
+    result = dsps_fft_plan_fc32(plan, data, M);
+    if (result == ESP_OK) {
+        result = dsps_fft_plan_bit_rev_fc32(plan, data, M);
+    }
+    if (result != ESP_OK) {
+        return result;
+    }
+    for (int i = 0; i < M; i++) {
+        data[i * 2 + 1] = -data[i * 2 + 1];
+    }
+    return ESP_OK;
+}
+
+esp_err_t dsps_fft_plan_real_sc16(const dsps_fft_plan_t *plan, int16_t *data, int N)
+{
+    esp_err_t result = dsps_fft_plan_real_check(plan, N);
+    if (result != ESP_OK) {
+        return result;
+    }
+    if (plan->type != DSPS_FFT_PLAN_FFT2R_SC16) {
+        return ESP_ERR_DSP_INVALID_PARAM;
+    }
+    int M = N >> 1;
+    result = dsps_fft_plan_sc16(plan, data, M);
+    if (result == ESP_OK) {
+        result = dsps_fft_plan_bit_rev_sc16(plan, data, M);
+    }
+    if (result != ESP_OK) {
+        return result;
+    }
+
+    // The halves are taken before the products, so the 32 bit sums do not overflow
+    const int16_t *w = (const int16_t *)plan->table;
+    sc16_t *spectrum = (sc16_t *)data;
+    int32_t tmp_re = spectrum[0].re;
+    int32_t tmp_im = spectrum[0].im;
+    spectrum[0].re = (tmp_re + tmp_im) >> 1;
+    spectrum[0].im = (tmp_re - tmp_im) >> 1;
+
+    int rev = 0;
+    for (int k = 1; k <= M / 2; k++) {
+        rev = dsps_fft_plan_real_next_rev(rev, M);
+        sc16_t fpk = spectrum[k];
+        sc16_t fpnk = spectrum[M - k];
+        int32_t f1k_re = ((int32_t)fpk.re + fpnk.re) >> 1;
+        int32_t f1k_im = ((int32_t)fpk.im - fpnk.im) >> 1;
+        int32_t f2k_re = ((int32_t)fpk.re - fpnk.re) >> 1;
+        int32_t f2k_im = ((int32_t)fpk.im + fpnk.im) >> 1;
+
+        int32_t c = -w[rev * 2 + 1];
+        int32_t s = -w[rev * 2 + 0];
+        int32_t tw_re = (c * f2k_re - s * f2k_im) >> 15;
+        int32_t tw_im = (s * f2k_re + c * f2k_im) >> 15;
+
+        spectrum[k].re = (f1k_re + tw_re) >> 1;
+        spectrum[k].im = (f1k_im + tw_im) >> 1;
+        spectrum[M - k].re = (f1k_re - tw_re) >> 1;
+        spectrum[M - k].im = (tw_im - f1k_im) >> 1;
+    }
+    return ESP_OK;
+}
+
+esp_err_t dsps_fft_plan_real_inv_sc16(const dsps_fft_plan_t *plan, int16_t *data, int N)
+{
+    esp_err_t result = dsps_fft_plan_real_check(plan, N);
+    if (result != ESP_OK) {
+        return result;
+    }
+    if (plan->type != DSPS_FFT_PLAN_FFT2R_SC16) {
+        return ESP_ERR_DSP_INVALID_PARAM;
+    }
+    int M = N >> 1;
+    const int16_t *w = (const int16_t *)plan->table;
+    sc16_t *spectrum = (sc16_t *)data;
+
+    // The sc16 FFT scales by 1/(N/2) itself, the merge step gives the conjugated spectrum unscaled
+    int32_t tmp_re = spectrum[0].re;
+    int32_t tmp_im = spectrum[0].im;
+    spectrum[0].re = (tmp_re + tmp_im) >> 1;
+    spectrum[0].im = (tmp_im - tmp_re) >> 1;
+
+    int rev = 0;
+    for (int k = 1; k <= M / 2; k++) {
+        rev = dsps_fft_plan_real_next_rev(rev, M);
+        sc16_t fpk = spectrum[k];
+        sc16_t fpnk = spectrum[M - k];
+        int32_t f1k_re = ((int32_t)fpk.re + fpnk.re) >> 1;
+        int32_t f1k_im = ((int32_t)fpk.im - fpnk.im) >> 1;
+        int32_t f2k_re = ((int32_t)fpk.re - fpnk.re) >> 1;
+        int32_t f2k_im = ((int32_t)fpk.im + fpnk.im) >> 1;
+
+        int32_t c = w[rev * 2 + 0];
+        int32_t s = w[rev * 2 + 1];
+        int32_t tw_re = (-s * f2k_re - c * f2k_im) >> 15;
+        int32_t tw_im = (c * f2k_re - s * f2k_im) >> 15;
+
+        spectrum[k].re = dsps_fft_plan_real_sat16(f1k_re + tw_re);
+        spectrum[k].im = dsps_fft_plan_real_sat16(-(f1k_im + tw_im));
+        spectrum[M - k].re = dsps_fft_plan_real_sat16(f1k_re - tw_re);
+        spectrum[M - k].im = dsps_fft_plan_real_sat16(f1k_im - tw_im);
+    }
+
+    result = dsps_fft_plan_sc16(plan, data, M);
+    if (result == ESP_OK) {
+        result = dsps_fft_plan_bit_rev_sc16(plan, data, M);
+    }
+    if (result != ESP_OK) {
+        return result;
+    }
+    for (int i = 0; i < M; i++) {
+        data[i * 2 + 1] = dsps_fft_plan_real_sat16(-(int32_t)data[i * 2 + 1]);
+    }
+    return ESP_OK;
+}
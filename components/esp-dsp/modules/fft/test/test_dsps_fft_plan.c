@@ -0,0 +1,291 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <malloc.h>
+#include "unity.h"
+#include "esp_dsp.h"
+#include "dsp_platform.h"
+#include "esp_log.h"
+
+#include "dsps_fft2r.h"
+#include "dsps_fft4r.h"
+#include "dsps_fft_plan.h"
+#include "dsp_tests.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "dsps_fft_plan";
+
+static void test_fft_plan_signal(float *data, int N)
+{
+    for (int i = 0 ; i < N ; i++) {
+        data[i * 2 + 0] = cosf(2 * M_PI * 5 * i / N) + 0.3 * sinf(2 * M_PI * 17 * i / N);
+        data[i * 2 + 1] = sinf(2 * M_PI * 9 * i / N);
+    }
+}
+
+static float test_fft_plan_diff(const float *a, const float *b, int len)
+{
+    float diff = 0;
+    for (int i = 0 ; i < len ; i++) {
+        diff = fmaxf(diff, fabsf(a[i] - b[i]));
+    }
+    return diff;
+}
+
+TEST_CASE("dsps_fft_plan_fc32 functionality", "[dsps]")
+{
+    float *data = (float *)memalign(16, 2 * 1024 * sizeof(float));
+    TEST_ASSERT_NOT_NULL(data);
+    float *check_data = (float *)memalign(16, 2 * 1024 * sizeof(float));
+    TEST_ASSERT_NOT_NULL(check_data);
+
+    // The default plan and a plan of another maximum length are used next to each other
+    TEST_ESP_OK(dsps_fft2r_init_fc32(NULL, 256));
+    dsps_fft_plan_t plan;
+    TEST_ESP_OK(dsps_fft_plan_init(&plan, DSPS_FFT_PLAN_FFT2R_FC32, NULL, 1024));
+
+    for (int N = 16 ; N <= 1024 ; N <<= 1) {
+        test_fft_plan_signal(data, N);
+        memcpy(check_data, data, 2 * N * sizeof(float));
+        TEST_ESP_OK(dsps_fft_plan_fc32(&plan, data, N));
+        TEST_ESP_OK(dsps_fft_plan_bit_rev_fc32(&plan, data, N));
+        if (N <= 256) {
+            dsps_fft2r_fc32(check_data, N);
+            dsps_bit_rev_fc32(check_data, N);
+            float diff = test_fft_plan_diff(data, check_data, 2 * N);
+            ESP_LOGI(TAG, "diff[%i] = %f", N, diff);
+            TEST_ASSERT_LESS_THAN_FLOAT(0.0001 * N, diff);
+        }
+        TEST_ASSERT_FLOAT_WITHIN(0.001 * N, N / 2, data[5 * 2]);
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_DSP_INVALID_LENGTH, dsps_fft_plan_fc32(&plan, data, 2048));
+    TEST_ASSERT_EQUAL(ESP_ERR_DSP_INVALID_PARAM, dsps_fft_plan_sc16(&plan, (int16_t *)data, 16));
+
+    dsps_fft_plan_free(&plan);
+    TEST_ASSERT_EQUAL(ESP_ERR_DSP_UNINITIALIZED, dsps_fft_plan_fc32(&plan, data, 16));
+    dsps_fft2r_deinit_fc32();
+    free(data);
+    free(check_data);
+}
+
+TEST_CASE("dsps_fft_plan fft4r and sc16 functionality", "[dsps]")
+{
+    float *data = (float *)memalign(16, 2 * 256 * sizeof(float));
+    TEST_ASSERT_NOT_NULL(data);
+    float *check_data = (float *)memalign(16, 2 * 256 * sizeof(float));
+    TEST_ASSERT_NOT_NULL(check_data);
+    int16_t *data_sc16 = (int16_t *)memalign(16, 2 * 256 * sizeof(int16_t));
+    TEST_ASSERT_NOT_NULL(data_sc16);
+    int16_t *check_data_sc16 = (int16_t *)memalign(16, 2 * 256 * sizeof(int16_t));
+    TEST_ASSERT_NOT_NULL(check_data_sc16);
+
+    dsps_fft_plan_t plan_fc32;
+    dsps_fft_plan_t plan_fft4r;
+    dsps_fft_plan_t plan_sc16;
+    TEST_ESP_OK(dsps_fft_plan_init(&plan_fc32, DSPS_FFT_PLAN_FFT2R_FC32, NULL, 256));
+    TEST_ESP_OK(dsps_fft_plan_init(&plan_fft4r, DSPS_FFT_PLAN_FFT4R_FC32, NULL, 256));
+    TEST_ESP_OK(dsps_fft_plan_init(&plan_sc16, DSPS_FFT_PLAN_FFT2R_SC16, NULL, 256));
+
+    for (int N = 16 ; N <= 256 ; N <<= 2) {
+        test_fft_plan_signal(data, N);
+        memcpy(check_data, data, 2 * N * sizeof(float));
+        TEST_ESP_OK(dsps_fft_plan_fc32(&plan_fft4r, data, N));
+        TEST_ESP_OK(dsps_fft_plan_bit_rev_fc32(&plan_fft4r, data, N));
+        TEST_ESP_OK(dsps_fft_plan_fc32(&plan_fc32, check_data, N));
+        TEST_ESP_OK(dsps_fft_plan_bit_rev_fc32(&plan_fc32, check_data, N));
+        float diff = test_fft_plan_diff(data, check_data, 2 * N);
+        ESP_LOGI(TAG, "fft4r diff[%i] = %f", N, diff);
+        TEST_ASSERT_LESS_THAN_FLOAT(0.0001 * N, diff);
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_DSP_INVALID_LENGTH, dsps_fft_plan_fc32(&plan_fft4r, data, 128));
+
+    // Without the global table, the plan's kernel, the optimized one where there is one, gives the
+    // same result as the ANSI kernel on the plan's table
+    dsps_fft2r_deinit_sc16();
+    for (int N = 16 ; N <= 256 ; N <<= 1) {
+        for (int i = 0 ; i < N * 2 ; i++) {
+            data_sc16[i] = (int16_t)(8000 * sinf(i * 0.37));
+            check_data_sc16[i] = data_sc16[i];
+        }
+        TEST_ESP_OK(dsps_fft_plan_sc16(&plan_sc16, data_sc16, N));
+        TEST_ESP_OK(dsps_fft_plan_bit_rev_sc16(&plan_sc16, data_sc16, N));
+        TEST_ESP_OK(dsps_fft2r_sc16_ansi_(check_data_sc16, N, (int16_t *)plan_sc16.table));
+        dsps_bit_rev_sc16_ansi(check_data_sc16, N);
+        for (int i = 0 ; i < N * 2 ; i++) {
+            TEST_ASSERT_INT_WITHIN(1, check_data_sc16[i], data_sc16[i]);
+        }
+    }
+
+    dsps_fft_plan_free(&plan_fc32);
+    dsps_fft_plan_free(&plan_fft4r);
+    dsps_fft_plan_free(&plan_sc16);
+    free(data);
+    free(check_data);
+    free(data_sc16);
+    free(check_data_sc16);
+}
+
+typedef struct {
+    const dsps_fft_plan_t *plan;
+    SemaphoreHandle_t semaphore;
+    int N;
+    int errors;
+} test_fft_plan_task_t;
+
+static void test_fft_plan_task(void *arg)
+{
+    test_fft_plan_task_t *context = (test_fft_plan_task_t *)arg;
+    float *data = (float *)memalign(16, 2 * context->N * sizeof(float));
+    for (int j = 0 ; j < 50 ; j++) {
+        test_fft_plan_signal(data, context->N);
+        dsps_fft_plan_fc32(context->plan, data, context->N);
+        dsps_fft_plan_bit_rev_fc32(context->plan, data, context->N);
+        if (fabsf(data[5 * 2] - context->N / 2) > 0.001 * context->N) {
+            context->errors++;
+        }
+        vTaskDelay(1);
+    }
+    free(data);
+    xSemaphoreGive(context->semaphore);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("dsps_fft_plan shared between tasks", "[dsps]")
+{
+    dsps_fft_plan_t plan;
+    TEST_ESP_OK(dsps_fft_plan_init(&plan, DSPS_FFT_PLAN_FFT2R_FC32, NULL, 1024));
+
+    SemaphoreHandle_t semaphore = xSemaphoreCreateCounting(2, 0);
+    TEST_ASSERT_NOT_NULL(semaphore);
+    test_fft_plan_task_t context[2] = {
+        { .plan = &plan, .semaphore = semaphore, .N = 256 },
+        { .plan = &plan, .semaphore = semaphore, .N = 1024 },
+    };
+    for (int i = 0 ; i < 2 ; i++) {
+        xTaskCreatePinnedToCore(test_fft_plan_task, "fft_plan", 4096, &context[i], 5, NULL, i % configNUM_CORES);
+    }
+    for (int i = 0 ; i < 2 ; i++) {
+        xSemaphoreTake(semaphore, portMAX_DELAY);
+    }
+    TEST_ASSERT_EQUAL(0, context[0].errors);
+    TEST_ASSERT_EQUAL(0, context[1].errors);
+
+    vSemaphoreDelete(semaphore);
+    dsps_fft_plan_free(&plan);
+}
+
+TEST_CASE("dsps_fft_plan_real functionality", "[dsps]")
+{
+    int max_N = 1024;
+    float *data = (float *)memalign(16, max_N * sizeof(float));
+    TEST_ASSERT_NOT_NULL(data);
+    float *input = (float *)memalign(16, max_N * sizeof(float));
+    TEST_ASSERT_NOT_NULL(input);
+    float *check_data = (float *)memalign(16, 2 * max_N * sizeof(float));
+    TEST_ASSERT_NOT_NULL(check_data);
+    int16_t *data_sc16 = (int16_t *)memalign(16, max_N * sizeof(int16_t));
+    TEST_ASSERT_NOT_NULL(data_sc16);
+
+    dsps_fft_plan_t plan_fc32;
+    dsps_fft_plan_t plan_fft4r;
+    dsps_fft_plan_t plan_sc16;
+    dsps_fft_plan_t plan_check;
+    TEST_ESP_OK(dsps_fft_plan_init(&plan_fc32, DSPS_FFT_PLAN_FFT2R_FC32, NULL, max_N));
+    TEST_ESP_OK(dsps_fft_plan_init(&plan_fft4r, DSPS_FFT_PLAN_FFT4R_FC32, NULL, max_N / 2));
+    TEST_ESP_OK(dsps_fft_plan_init(&plan_sc16, DSPS_FFT_PLAN_FFT2R_SC16, NULL, max_N));
+    TEST_ESP_OK(dsps_fft_plan_init(&plan_check, DSPS_FFT_PLAN_FFT2R_FC32, NULL, max_N));
+    // The plans work without any of the global tables, the optimized sc16 kernel included
+    dsps_fft2r_deinit_fc32();
+    dsps_fft4r_deinit_fc32();
+    dsps_fft2r_deinit_sc16();
+
+    for (int N = 16 ; N <= max_N ; N <<= 1) {
+        for (int i = 0 ; i < N ; i++) {
+            input[i] = cosf(2 * M_PI * 5 * i / N) + 0.3 * sinf(2 * M_PI * 7 * i / N) + 0.2;
+            check_data[i * 2 + 0] = input[i];
+            check_data[i * 2 + 1] = 0;
+        }
+        TEST_ESP_OK(dsps_fft_plan_fc32(&plan_check, check_data, N));
+        TEST_ESP_OK(dsps_fft_plan_bit_rev_fc32(&plan_check, check_data, N));
+        // The Nyquist bin takes the place of the imaginary part of the DC one
+        check_data[1] = check_data[N];
+
+        for (int p = 0 ; p < 2 ; p++) {
+            dsps_fft_plan_t *plan = p ? &plan_fft4r : &plan_fc32;
+            if (p && (dsp_power_of_two(N / 2) & 1)) {
+                TEST_ASSERT_EQUAL(ESP_ERR_DSP_INVALID_LENGTH, dsps_fft_plan_real_fc32(plan, data, N));
+                continue;
+            }
+            memcpy(data, input, N * sizeof(float));
+            TEST_ESP_OK(dsps_fft_plan_real_fc32(plan, data, N));
+            float diff = test_fft_plan_diff(data, check_data, N);
+            ESP_LOGI(TAG, "real plan %i diff[%i] = %f", p, N, diff);
+            TEST_ASSERT_LESS_THAN_FLOAT(0.0001 * N, diff);
+
+            TEST_ESP_OK(dsps_fft_plan_real_inv_fc32(plan, data, N));
+            diff = test_fft_plan_diff(data, input, N);
+            ESP_LOGI(TAG, "real inverse plan %i diff[%i] = %f", p, N, diff);
+            TEST_ASSERT_LESS_THAN_FLOAT(0.0001, diff);
+        }
+
+        // The sc16 result is scaled by 1/N, its inverse as well
+        for (int i = 0 ; i < N ; i++) {
+            data_sc16[i] = (int16_t)(input[i] * 12000);
+        }
+        TEST_ESP_OK(dsps_fft_plan_real_sc16(&plan_sc16, data_sc16, N));
+        for (int i = 0 ; i < N ; i++) {
+            TEST_ASSERT_INT_WITHIN(4 + dsp_power_of_two(N), (int)(check_data[i] * 12000 / N), data_sc16[i]);
+        }
+        TEST_ESP_OK(dsps_fft_plan_real_inv_sc16(&plan_sc16, data_sc16, N));
+        for (int i = 0 ; i < N ; i++) {
+            TEST_ASSERT_INT_WITHIN(3, (int)(input[i] * 12000 / N), data_sc16[i]);
+        }
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_DSP_INVALID_LENGTH, dsps_fft_plan_real_fc32(&plan_fc32, data, 2 * max_N));
+    TEST_ASSERT_EQUAL(ESP_ERR_DSP_INVALID_PARAM, dsps_fft_plan_real_sc16(&plan_fc32, data_sc16, 16));
+
+    dsps_fft_plan_free(&plan_fc32);
+    dsps_fft_plan_free(&plan_fft4r);
+    dsps_fft_plan_free(&plan_sc16);
+    dsps_fft_plan_free(&plan_check);
+    free(data);
+    free(input);
+    free(check_data);
+    free(data_sc16);
+}
+
+TEST_CASE("dsps_fft_plan_real benchmark", "[dsps]")
+{
+    int N = 1024;
+    float *data = (float *)memalign(16, 2 * N * sizeof(float));
+    TEST_ASSERT_NOT_NULL(data);
+    dsps_fft_plan_t plan;
+    TEST_ESP_OK(dsps_fft_plan_init(&plan, DSPS_FFT_PLAN_FFT2R_FC32, NULL, N));
+    test_fft_plan_signal(data, N);
+
+    unsigned int start_b = xthal_get_ccount();
+    dsps_fft_plan_fc32(&plan, data, N);
+    dsps_fft_plan_bit_rev_fc32(&plan, data, N);
+    unsigned int end_b = xthal_get_ccount();
+    ESP_LOGI(TAG, "Benchmark complex FFT - %6i cycles for %6i points", end_b - start_b, N);
+
+    start_b = xthal_get_ccount();
+    dsps_fft_plan_real_fc32(&plan, data, N);
+    end_b = xthal_get_ccount();
+    ESP_LOGI(TAG, "Benchmark real FFT    - %6i cycles for %6i points", end_b - start_b, N);
+
+    start_b = xthal_get_ccount();
+    dsps_fft_plan_real_inv_fc32(&plan, data, N);
+    end_b = xthal_get_ccount();
+    ESP_LOGI(TAG, "Benchmark real IFFT   - %6i cycles for %6i points", end_b - start_b, N);
+
+    dsps_fft_plan_free(&plan);
+    free(data);
+}
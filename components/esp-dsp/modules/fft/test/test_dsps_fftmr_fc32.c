@@ -0,0 +1,195 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <malloc.h>
+#include "unity.h"
+#include "esp_dsp.h"
+#include "dsp_platform.h"
+#include "esp_log.h"
+
+#include "dsps_fft2r.h"
+#include "dsps_fftmr.h"
+#include "dsps_fft_plan.h"
+#include "dsp_tests.h"
+
+static const char *TAG = "dsps_fftmr";
+
+static const int test_fftmr_sizes[] = {240, 320, 480, 960};
+
+static void test_fftmr_signal(float *data, int N)
+{
+    for (int i = 0 ; i < N ; i++) {
+        data[i * 2 + 0] = cosf(2 * M_PI * 5 * i / N) + 0.3 * sinf(2 * M_PI * 17 * i / N);
+        data[i * 2 + 1] = sinf(2 * M_PI * 9 * i / N) + 0.1;
+    }
+}
+
+// Direct DFT in double precision
+static void test_fftmr_dft(const float *input, float *result, int N)
+{
+    for (int k = 0 ; k < N ; k++) {
+        double re = 0;
+        double im = 0;
+        for (int i = 0 ; i < N ; i++) {
+            double angle = 2 * M_PI * (double)((k * i) % N) / N;
+            re += input[i * 2 + 0] * cos(angle) + input[i * 2 + 1] * sin(angle);
+            im += input[i * 2 + 1] * cos(angle) - input[i * 2 + 0] * sin(angle);
+        }
+        result[k * 2 + 0] = re;
+        result[k * 2 + 1] = im;
+    }
+}
+
+static float test_fftmr_diff(const float *a, const float *b, int len)
+{
+    float diff = 0;
+    for (int i = 0 ; i < len ; i++) {
+        diff = fmaxf(diff, fabsf(a[i] - b[i]));
+    }
+    return diff;
+}
+
+TEST_CASE("dsps_fftmr_fc32 functionality", "[dsps]")
+{
+    int max_N = 960;
+    float *data = (float *)memalign(16, 2 * max_N * sizeof(float));
+    TEST_ASSERT_NOT_NULL(data);
+    float *check_data = (float *)memalign(16, 2 * max_N * sizeof(float));
+    TEST_ASSERT_NOT_NULL(check_data);
+
+    for (int n = 0 ; n < sizeof(test_fftmr_sizes) / sizeof(test_fftmr_sizes[0]) ; n++) {
+        int N = test_fftmr_sizes[n];
+        dsps_fft_plan_t plan;
+        TEST_ESP_OK(dsps_fft_plan_init(&plan, DSPS_FFT_PLAN_FFTMR_FC32, NULL, N));
+
+        test_fftmr_signal(data, N);
+        test_fftmr_dft(data, check_data, N);
+        TEST_ESP_OK(dsps_fft_plan_fc32(&plan, data, N));
+        TEST_ESP_OK(dsps_fft_plan_bit_rev_fc32(&plan, data, N));
+        float diff = test_fftmr_diff(data, check_data, 2 * N);
+        ESP_LOGI(TAG, "diff[%i] = %f", N, diff);
+        TEST_ASSERT_LESS_THAN_FLOAT(0.0001 * N, diff);
+        TEST_ASSERT_FLOAT_WITHIN(0.001 * N, N / 2, data[5 * 2]);
+
+        TEST_ASSERT_EQUAL(ESP_ERR_DSP_INVALID_LENGTH, dsps_fft_plan_fc32(&plan, data, N / 2));
+        TEST_ASSERT_EQUAL(ESP_ERR_DSP_INVALID_PARAM, dsps_fft_plan_sc16(&plan, (int16_t *)data, N));
+        dsps_fft_plan_free(&plan);
+    }
+
+    // A mixed radix plan of a power of two gives the result of the radix-2 FFT
+    int N = 256;
+    dsps_fft_plan_t plan;
+    TEST_ESP_OK(dsps_fft_plan_init(&plan, DSPS_FFT_PLAN_FFTMR_FC32, NULL, N));
+    TEST_ESP_OK(dsps_fft2r_init_fc32(NULL, N));
+    test_fftmr_signal(data, N);
+    memcpy(check_data, data, 2 * N * sizeof(float));
+    TEST_ESP_OK(dsps_fft_plan_fc32(&plan, data, N));
+    TEST_ESP_OK(dsps_fft_plan_bit_rev_fc32(&plan, data, N));
+    dsps_fft2r_fc32(check_data, N);
+    dsps_bit_rev_fc32(check_data, N);
+    float diff = test_fftmr_diff(data, check_data, 2 * N);
+    ESP_LOGI(TAG, "diff to radix-2[%i] = %f", N, diff);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.0001 * N, diff);
+    dsps_fft2r_deinit_fc32();
+    dsps_fft_plan_free(&plan);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_DSP_INVALID_LENGTH, dsps_fft_plan_init(&plan, DSPS_FFT_PLAN_FFTMR_FC32, NULL, 7 * 32));
+    TEST_ASSERT_EQUAL(ESP_ERR_DSP_UNINITIALIZED, dsps_fft_plan_fc32(&plan, data, 224));
+    free(data);
+    free(check_data);
+}
+
+TEST_CASE("dsps_fftmr real functionality", "[dsps]")
+{
+    int max_N = 960;
+    float *data = (float *)memalign(16, 2 * max_N * sizeof(float));
+    TEST_ASSERT_NOT_NULL(data);
+    float *input = (float *)memalign(16, 2 * max_N * sizeof(float));
+    TEST_ASSERT_NOT_NULL(input);
+    float *check_data = (float *)memalign(16, 4 * max_N * sizeof(float));
+    TEST_ASSERT_NOT_NULL(check_data);
+    float *complex_data = (float *)memalign(16, 4 * max_N * sizeof(float));
+    TEST_ASSERT_NOT_NULL(complex_data);
+
+    for (int n = 0 ; n < sizeof(test_fftmr_sizes) / sizeof(test_fftmr_sizes[0]) ; n++) {
+        // The real FFT of N values is done with the plan of N/2 points
+        int N = test_fftmr_sizes[n] * 2;
+        dsps_fft_plan_t plan;
+        TEST_ESP_OK(dsps_fft_plan_init(&plan, DSPS_FFT_PLAN_FFTMR_FC32, NULL, N / 2));
+
+        for (int i = 0 ; i < N ; i++) {
+            input[i] = cosf(2 * M_PI * 5 * i / N) + 0.3 * sinf(2 * M_PI * 7 * i / N) + 0.2;
+            complex_data[i * 2 + 0] = input[i];
+            complex_data[i * 2 + 1] = 0;
+        }
+        test_fftmr_dft(complex_data, check_data, N);
+        // The Nyquist bin takes the place of the imaginary part of the DC one
+        check_data[1] = check_data[N];
+
+        memcpy(data, input, N * sizeof(float));
+        TEST_ESP_OK(dsps_fft_plan_real_fc32(&plan, data, N));
+        float diff = test_fftmr_diff(data, check_data, N);
+        ESP_LOGI(TAG, "real diff[%i] = %f", N, diff);
+        TEST_ASSERT_LESS_THAN_FLOAT(0.0001 * N, diff);
+
+        TEST_ESP_OK(dsps_fft_plan_real_inv_fc32(&plan, data, N));
+        diff = test_fftmr_diff(data, input, N);
+        ESP_LOGI(TAG, "real inverse diff[%i] = %f", N, diff);
+        TEST_ASSERT_LESS_THAN_FLOAT(0.0001, diff);
+
+        TEST_ASSERT_EQUAL(ESP_ERR_DSP_INVALID_LENGTH, dsps_fft_plan_real_fc32(&plan, data, N / 2));
+        dsps_fft_plan_free(&plan);
+    }
+
+    free(data);
+    free(input);
+    free(check_data);
+    free(complex_data);
+}
+
+TEST_CASE("dsps_fftmr_fc32 benchmark", "[dsps]")
+{
+    float *data = (float *)memalign(16, 2 * 1024 * sizeof(float));
+    TEST_ASSERT_NOT_NULL(data);
+
+    for (int n = 0 ; n < sizeof(test_fftmr_sizes) / sizeof(test_fftmr_sizes[0]) ; n++) {
+        int N = test_fftmr_sizes[n];
+        // The radix-2 FFT needs the frame zero padded to the next power of two
+        int N_pad = 1 << dsp_power_of_two(N);
+        if (N_pad < N) {
+            N_pad <<= 1;
+        }
+        dsps_fft_plan_t plan;
+        dsps_fft_plan_t plan_pad;
+        TEST_ESP_OK(dsps_fft_plan_init(&plan, DSPS_FFT_PLAN_FFTMR_FC32, NULL, N));
+        TEST_ESP_OK(dsps_fft_plan_init(&plan_pad, DSPS_FFT_PLAN_FFT2R_FC32, NULL, N_pad));
+
+        test_fftmr_signal(data, N);
+        unsigned int start_b = xthal_get_ccount();
+        dsps_fft_plan_fc32(&plan, data, N);
+        dsps_fft_plan_bit_rev_fc32(&plan, data, N);
+        unsigned int end_b = xthal_get_ccount();
+        ESP_LOGI(TAG, "Benchmark mixed radix FFT - %6i cycles for %6i points", end_b - start_b, N);
+
+        test_fftmr_signal(data, N_pad);
+        start_b = xthal_get_ccount();
+        dsps_fft_plan_fc32(&plan_pad, data, N_pad);
+        dsps_fft_plan_bit_rev_fc32(&plan_pad, data, N_pad);
+        end_b = xthal_get_ccount();
+        ESP_LOGI(TAG, "Benchmark radix-2 FFT     - %6i cycles for %6i points", end_b - start_b, N_pad);
+
+        test_fftmr_signal(data, N);
+        start_b = xthal_get_ccount();
+        dsps_fft_plan_real_fc32(&plan, data, 2 * N);
+        end_b = xthal_get_ccount();
+        ESP_LOGI(TAG, "Benchmark mixed radix real FFT - %6i cycles for %6i points", end_b - start_b, 2 * N);
+
+        dsps_fft_plan_free(&plan);
+        dsps_fft_plan_free(&plan_pad);
+    }
+    free(data);
+}
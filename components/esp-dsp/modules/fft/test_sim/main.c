@@ -2,12 +2,14 @@
 #include <stdio.h>
 
 void test_fft2r();
+void test_fftmr();
 
 int main(void)
 {
     printf("main starts!\n");
 //    xt_iss_profile_enable();
     test_fft2r();
+    test_fftmr();
 //    xt_iss_profile_disable();
 
     printf("Test done\n");
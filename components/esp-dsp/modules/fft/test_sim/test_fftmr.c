@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "dsp_common.h"
+
+#include "dsps_fft_plan.h"
+
+// Mixed radix plans of the 10/20 ms frames against the radix-2 plans of the frames zero padded to the
+// next power of two, FFT plus reorder. Builds for the simulator, or for the host with the ANSI kernels.
+
+#define test_fftmr_repeat 2000
+#define test_fftmr_max_size 1024
+
+static const int test_fftmr_sizes[] = {240, 320, 480, 960};
+
+static float input[test_fftmr_max_size * 2];
+static float data[test_fftmr_max_size * 2];
+
+// Time of one FFT plus reorder in us, averaged over test_fftmr_repeat runs on a fresh copy of the input
+static float test_fftmr_time(const dsps_fft_plan_t *plan, int N)
+{
+    clock_t start = clock();
+    for (int r = 0 ; r < test_fftmr_repeat ; r++) {
+        memcpy(data, input, N * 2 * sizeof(float));
+        dsps_fft_plan_fc32(plan, data, N);
+        dsps_fft_plan_bit_rev_fc32(plan, data, N);
+    }
+    clock_t end = clock();
+    return (float)(end - start) * 1000000 / CLOCKS_PER_SEC / test_fftmr_repeat;
+}
+
+void test_fftmr()
+{
+    for (int n = 0 ; n < sizeof(test_fftmr_sizes) / sizeof(test_fftmr_sizes[0]) ; n++) {
+        int N = test_fftmr_sizes[n];
+        int N_pad = 1;
+        while (N_pad < N) {
+            N_pad <<= 1;
+        }
+        dsps_fft_plan_t plan;
+        dsps_fft_plan_t plan_pad;
+        if (dsps_fft_plan_init(&plan, DSPS_FFT_PLAN_FFTMR_FC32, NULL, N) != ESP_OK ||
+                dsps_fft_plan_init(&plan_pad, DSPS_FFT_PLAN_FFT2R_FC32, NULL, N_pad) != ESP_OK) {
+            printf("ERROR: FFT plans of %i/%i points\n", N, N_pad);
+            return;
+        }
+
+        // The padded frame is the same signal followed by zeros
+        memset(input, 0, sizeof(input));
+        for (int i = 0 ; i < N ; i++) {
+            input[i * 2 + 0] = cosf(2 * M_PI * 5 * i / N) + 0.3 * sinf(2 * M_PI * 17 * i / N);
+            input[i * 2 + 1] = sinf(2 * M_PI * 9 * i / N) + 0.1;
+        }
+        float time_mr = test_fftmr_time(&plan, N);
+        float time_pad = test_fftmr_time(&plan_pad, N_pad);
+        printf("Benchmark %4i points: mixed radix %6.1f us, radix-2 of %4i points %6.1f us\n", N, time_mr, N_pad, time_pad);
+
+        dsps_fft_plan_free(&plan);
+        dsps_fft_plan_free(&plan_pad);
+    }
+
+    printf("Test Pass!\n");
+}
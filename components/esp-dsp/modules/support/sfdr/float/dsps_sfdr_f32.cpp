@@ -13,7 +13,7 @@
 // limitations under the License.
 
 #include "dsps_sfdr.h"
-#include "dsps_fft2r.h"
+#include "dsps_fft_plan.h"
 #include "dsp_common.h"
 #include <math.h>
 #include <limits>
@@ -27,16 +27,25 @@ float dsps_sfdr_f32(const float *input, int32_t len, int8_t use_dc)
         return 0;
     }
 
-    float *temp_array = new float[len * 2];
+    float *temp_array = new float[len];
     for (int i = 0 ; i < len ; i++) {
         float wind = 0.5 * (1 - cosf(i * 2 * M_PI / (float)len));
-        temp_array[i * 2 + 0] = input[i] * wind;
-        temp_array[i * 2 + 1] = 0;
+        temp_array[i] = input[i] * wind;
     }
-    dsps_fft2r_init_fc32(NULL, CONFIG_DSP_MAX_FFT_SIZE);
-
-    dsps_fft2r_fc32_ansi(temp_array, len);
-    dsps_bit_rev_fc32_ansi(temp_array, len);
+    // A plan of its own leaves the tables of dsps_fft2r_init_fc32 to the application
+    dsps_fft_plan_t plan;
+    if (dsps_fft_plan_init(&plan, DSPS_FFT_PLAN_FFT2R_FC32, NULL, len) != ESP_OK) {
+        delete[] temp_array;
+        return 0;
+    }
+    esp_err_t ret = dsps_fft_plan_real_fc32(&plan, temp_array, len);
+    dsps_fft_plan_free(&plan);
+    if (ret != ESP_OK) {
+        delete[] temp_array;
+        return 0;
+    }
+    // The real FFT keeps the Nyquist bin next to the DC one
+    temp_array[1] = 0;
 
     float min = std::numeric_limits<float>::max();
     float max = std::numeric_limits<float>::min();
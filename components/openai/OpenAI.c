@@ -0,0 +1,5393 @@
+/* SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/cdefs.h>
+#include <inttypes.h>
+#include "cJSON.h"
+#include "esp_log.h"
+#include "OpenAI.h"
+#include "OpenAI_Transport.h"
+#include "OpenAI_Private.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/event_groups.h"
+#include "esp_random.h"
+
+static const char *TAG = "OpenAI";
+
+#define OPENAI_DEFAULT_BASE_URL CONFIG_DEFAULT_OPENAI_BASE_URL
+
+//
+// JSON arena
+//
+
+#define OPENAI_JSON_PRINT_OVERHEAD 256
+
+#if CONFIG_ENABLE_JSON_ARENA
+#define OPENAI_JSON_ARENA_ALIGN 8
+
+/**
+ * @brief A block of the JSON arena, allocations are carved from data front to back.
+ *
+ */
+typedef struct OpenAI_ArenaBlock {
+    struct OpenAI_ArenaBlock *next;                         /*!< Block allocated before this one */
+    size_t size;                                            /*!< Usable length of data */
+    size_t used;                                            /*!< Bytes of data handed out */
+    uint8_t data[] __attribute__((aligned(OPENAI_JSON_ARENA_ALIGN))); /*!< Memory handed out to cJSON */
+} OpenAI_ArenaBlock_t;
+
+/**
+ * @brief Arena serving the cJSON allocations of one request at a time. The cJSON hooks are
+ *        global, so only the task owning the arena allocates from it, any other task and any
+ *        request finding the arena busy allocates from the heap as before.
+ *        No user callback may run while the arena is owned, cJSON objects it creates and
+ *        keeps would be allocated in the arena and reset with it.
+ *
+ */
+typedef struct {
+    SemaphoreHandle_t lock;                                 /*!< Held by the owner while it uses the arena */
+    TaskHandle_t owner;                                     /*!< Task allocating from the arena, NULL while it is free */
+    uint32_t depth;                                         /*!< Nesting of OpenAI_JsonArenaBegin calls of the owner */
+    uint32_t users;                                         /*!< OpenAI objects alive, the hooks are installed while there are any */
+    OpenAI_ArenaBlock_t *blocks;                            /*!< Newest block first, the oldest one is kept between requests */
+} OpenAI_Arena_t;
+
+static OpenAI_Arena_t s_json_arena;
+
+static void *OpenAI_JsonArenaAlloc(size_t size)
+{
+    size = (size + OPENAI_JSON_ARENA_ALIGN - 1) & ~(size_t)(OPENAI_JSON_ARENA_ALIGN - 1);
+    OpenAI_ArenaBlock_t *block = s_json_arena.blocks;
+    if (block == NULL || block->size - block->used < size) {
+        size_t block_size = (size > CONFIG_JSON_ARENA_BLOCK_SIZE) ? size : CONFIG_JSON_ARENA_BLOCK_SIZE;
+        block = (OpenAI_ArenaBlock_t *)malloc(sizeof(OpenAI_ArenaBlock_t) + block_size);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->next = s_json_arena.blocks;
+        block->size = block_size;
+        block->used = 0;
+        s_json_arena.blocks = block;
+    }
+    void *ptr = block->data + block->used;
+    block->used += size;
+    return ptr;
+}
+
+static void *OpenAI_JsonMalloc(size_t size)
+{
+    if (s_json_arena.owner == xTaskGetCurrentTaskHandle()) {
+        void *ptr = OpenAI_JsonArenaAlloc(size);
+        if (ptr != NULL) {
+            return ptr;
+        }
+    }
+    return malloc(size);
+}
+
+static void OpenAI_JsonFree(void *ptr)
+{
+    if (ptr != NULL && s_json_arena.owner == xTaskGetCurrentTaskHandle()) {
+        // Arena memory is released all at once by OpenAI_JsonArenaEnd
+        for (OpenAI_ArenaBlock_t *block = s_json_arena.blocks; block != NULL; block = block->next) {
+            if ((uint8_t *)ptr >= block->data && (uint8_t *)ptr < block->data + block->size) {
+                return;
+            }
+        }
+    }
+    free(ptr);
+}
+
+static void OpenAI_JsonArenaBegin(void)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    if (s_json_arena.owner == task) {
+        s_json_arena.depth++;
+        return;
+    }
+    if (s_json_arena.lock != NULL && xSemaphoreTake(s_json_arena.lock, 0) == pdTRUE) {
+        s_json_arena.owner = task;
+        s_json_arena.depth = 1;
+    }
+}
+
+static void OpenAI_JsonArenaEnd(void)
+{
+    if (s_json_arena.owner != xTaskGetCurrentTaskHandle() || --s_json_arena.depth > 0) {
+        return;
+    }
+    OpenAI_ArenaBlock_t *block = s_json_arena.blocks;
+    while (block != NULL && block->next != NULL) {
+        OpenAI_ArenaBlock_t *next = block->next;
+        free(block);
+        block = next;
+    }
+    if (block != NULL) {
+        block->used = 0;
+    }
+    s_json_arena.blocks = block;
+    s_json_arena.owner = NULL;
+    xSemaphoreGive(s_json_arena.lock);
+}
+
+static void OpenAI_JsonArenaInit(void)
+{
+    if (s_json_arena.users++ > 0) {
+        return;
+    }
+    s_json_arena.lock = xSemaphoreCreateMutex();
+    OPENAI_ERROR_CHECK_CONTINUE(s_json_arena.lock != NULL, "JSON arena disabled, xSemaphoreCreateMutex failed!");
+    cJSON_Hooks hooks = {
+        .malloc_fn = &OpenAI_JsonMalloc,
+        .free_fn = &OpenAI_JsonFree,
+    };
+    cJSON_InitHooks(&hooks);
+}
+
+static void OpenAI_JsonArenaDeinit(void)
+{
+    if (s_json_arena.users == 0 || --s_json_arena.users > 0) {
+        return;
+    }
+    // Memory allocated through the hooks outside the arena came from malloc, so it can
+    // still be freed by cJSON's defaults
+    cJSON_InitHooks(NULL);
+    if (s_json_arena.lock != NULL) {
+        vSemaphoreDelete(s_json_arena.lock);
+        s_json_arena.lock = NULL;
+    }
+    free(s_json_arena.blocks);
+    s_json_arena.blocks = NULL;
+}
+#else
+static void OpenAI_JsonArenaBegin(void) {}
+static void OpenAI_JsonArenaEnd(void) {}
+static void OpenAI_JsonArenaInit(void) {}
+static void OpenAI_JsonArenaDeinit(void) {}
+#endif
+
+/**
+ * @brief Start a request tree. Everything cJSON allocates until the tree is deleted with
+ *        OpenAI_JsonDelete comes from the arena, strings that outlive it must be copied.
+ */
+static cJSON *OpenAI_JsonCreateObject(void)
+{
+    OpenAI_JsonArenaBegin();
+    cJSON *json = cJSON_CreateObject();
+    if (json == NULL) {
+        OpenAI_JsonArenaEnd();
+    }
+    return json;
+}
+
+/**
+ * @brief Parse a response into a tree living in the arena until OpenAI_JsonDelete.
+ */
+static cJSON *OpenAI_JsonParse(const char *payload)
+{
+    OpenAI_JsonArenaBegin();
+    cJSON *json = cJSON_Parse(payload);
+    if (json == NULL) {
+        OpenAI_JsonArenaEnd();
+    }
+    return json;
+}
+
+static void OpenAI_JsonDelete(cJSON *json)
+{
+    if (json == NULL) {
+        return;
+    }
+    cJSON_Delete(json);
+    OpenAI_JsonArenaEnd();
+}
+
+/**
+ * @brief Print a request unformatted into a heap buffer allocated once for the expected
+ *        length, which is only grown if the request does not fit.
+ *
+ * @param hint Length of the longest string in the request, e.g. the prompt
+ */
+static char *OpenAI_JsonPrint(cJSON *req, size_t hint)
+{
+    size_t len = hint + OPENAI_JSON_PRINT_OVERHEAD;
+    // Escaping at most takes six bytes per character, three doublings always fit
+    for (int i = 0; i < 4; i++, len *= 2) {
+        char *buffer = (char *)malloc(len);
+        OPENAI_ERROR_CHECK(buffer != NULL, "Failed to allocate request body!", NULL);
+        if (cJSON_PrintPreallocated(req, buffer, len, false)) {
+            return buffer;
+        }
+        free(buffer);
+    }
+    ESP_LOGE(TAG, "cJSON_PrintPreallocated failed!");
+    return NULL;
+}
+
+// Macros for building the request
+#define reqAddString(var, val)                            \
+    if (cJSON_AddStringToObject(req, var, val) == NULL) { \
+        OpenAI_JsonDelete(req);                           \
+        ESP_LOGE(TAG, "cJSON_AddStringToObject failed!");      \
+        return result;                                    \
+    }
+
+#define reqAddNumber(var, val)                            \
+    if (cJSON_AddNumberToObject(req, var, val) == NULL) { \
+        OpenAI_JsonDelete(req);                           \
+        ESP_LOGE(TAG, "cJSON_AddNumberToObject failed!");      \
+        return result;                                    \
+    }
+
+#define reqAddBool(var, val)                            \
+    if (cJSON_AddBoolToObject(req, var, val) == NULL) { \
+        OpenAI_JsonDelete(req);                         \
+        ESP_LOGE(TAG, "cJSON_AddBoolToObject failed!");      \
+        return result;                                  \
+    }
+
+#define reqAddItem(var, val)                       \
+    if (!cJSON_AddItemToObject(req, var, val)) {   \
+        cJSON_Delete(val);                         \
+        OpenAI_JsonDelete(req);                    \
+        ESP_LOGE(TAG, "cJSON_AddItemToObject failed!"); \
+        return result;                             \
+    }
+
+char *getJsonError(cJSON *json)
+{
+    if (json == NULL) {
+        return strdup("cJSON_Parse failed!");
+    }
+    if (!cJSON_IsObject(json)) {
+        char *jsonStr = cJSON_PrintUnformatted(json);
+        char *errorMsg = NULL;
+        asprintf(&errorMsg, "\"code\": Response is not an object! %s", jsonStr);
+        OPENAI_ERROR_CHECK(errorMsg != NULL, "asprintf failed!", NULL);
+        cJSON_free(jsonStr);
+        return errorMsg;
+    }
+    if (cJSON_HasObjectItem(json, "error")) {
+        cJSON *error = cJSON_GetObjectItem(json, "error");
+        if (!cJSON_IsObject(error)) {
+            char *jsonStr = cJSON_PrintUnformatted(error);
+            char *errorMsg = NULL;
+            asprintf(&errorMsg, "\"code\": Error is not an object! %s", jsonStr);
+            OPENAI_ERROR_CHECK(errorMsg != NULL, "asprintf failed!", NULL);
+            cJSON_free(jsonStr);
+            return errorMsg;
+        }
+        if (!cJSON_HasObjectItem(error, "code")) {
+            char *jsonStr = cJSON_PrintUnformatted(error);
+            char *errorMsg = NULL;
+            asprintf(&errorMsg, "\"code\": Error does not contain code! %s", jsonStr);
+            OPENAI_ERROR_CHECK(errorMsg != NULL, "asprintf failed!", NULL);
+            cJSON_free(jsonStr);
+            return errorMsg;
+        }
+        cJSON *error_code = cJSON_GetObjectItem(error, "code");
+        char *errorMsg = NULL;
+        asprintf(&errorMsg, "\"code\": %s!", cJSON_GetStringValue(error_code));
+        return errorMsg;
+    }
+    return NULL;
+}
+
+//
+// Multipart upload
+//
+
+#define OPENAI_MULTIPART_BOUNDARY "----WebKitFormBoundary9HKFexBRLrf9dcpY"
+#define OPENAI_MULTIPART_MAX_PARTS 8
+#define OPENAI_UPLOAD_CHUNK_SIZE 1024
+#define OPENAI_STREAM_CHUNK_SIZE 1024
+
+/**
+ * @brief A multipart/form-data body. The form fields and part headers are collected in one
+ *        text buffer, file contents stay where they are and are only referenced.
+ *
+ */
+typedef struct {
+    OpenAI_Body_Part_t parts[OPENAI_MULTIPART_MAX_PARTS];  /*!< Body parts, text parts point into text once finished */
+    size_t text_offset[OPENAI_MULTIPART_MAX_PARTS];        /*!< Offset of each text part in text */
+    bool is_text[OPENAI_MULTIPART_MAX_PARTS];              /*!< Whether the part is taken from text */
+    size_t count;                                          /*!< Number of parts */
+    char *text;                                            /*!< Form fields and part headers */
+    size_t text_len;                                       /*!< Used length of text */
+    size_t text_cap;                                       /*!< Allocated length of text */
+    bool failed;                                           /*!< Set when an allocation failed */
+} OpenAI_Multipart_t;
+
+static void multipartAppendV(OpenAI_Multipart_t *mp, const char *fmt, va_list args)
+{
+    if (mp->failed) {
+        return;
+    }
+    va_list copy;
+    va_copy(copy, args);
+    int n = vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
+    if (n < 0 || (mp->count == OPENAI_MULTIPART_MAX_PARTS && !mp->is_text[mp->count - 1])) {
+        mp->failed = true;
+        return;
+    }
+    if (mp->text_len + n + 1 > mp->text_cap) {
+        size_t cap = mp->text_cap ? mp->text_cap : 256;
+        while (cap < mp->text_len + n + 1) {
+            cap *= 2;
+        }
+        char *text = (char *)realloc(mp->text, cap);
+        if (text == NULL) {
+            mp->failed = true;
+            return;
+        }
+        mp->text = text;
+        mp->text_cap = cap;
+    }
+    vsnprintf(mp->text + mp->text_len, mp->text_cap - mp->text_len, fmt, args);
+    // Text written right after other text extends the same part
+    if (mp->count == 0 || !mp->is_text[mp->count - 1]) {
+        mp->is_text[mp->count] = true;
+        mp->text_offset[mp->count] = mp->text_len;
+        mp->parts[mp->count].len = 0;
+        mp->count++;
+    }
+    mp->parts[mp->count - 1].len += n;
+    mp->text_len += n;
+}
+
+static void multipartAppend(OpenAI_Multipart_t *mp, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    multipartAppendV(mp, fmt, args);
+    va_end(args);
+}
+
+static void multipartAddField(OpenAI_Multipart_t *mp, const char *name, const char *fmt, ...)
+{
+    multipartAppend(mp, "--" OPENAI_MULTIPART_BOUNDARY "\r\nContent-Disposition: form-data; name=\"%s\"\r\n\r\n", name);
+    va_list args;
+    va_start(args, fmt);
+    multipartAppendV(mp, fmt, args);
+    va_end(args);
+    multipartAppend(mp, "\r\n");
+}
+
+/**
+ * @brief Add a file whose contents are the consecutive parts in file.
+ *
+ */
+static void multipartAddFile(OpenAI_Multipart_t *mp, const char *name, const char *filename, const char *mime, const OpenAI_Body_Part_t *file, size_t count)
+{
+    multipartAppend(mp, "--" OPENAI_MULTIPART_BOUNDARY "\r\nContent-Disposition: form-data; name=\"%s\"; filename=\"%s\"\r\nContent-Type: %s\r\n\r\n", name, filename, mime);
+    if (mp->failed || mp->count + count > OPENAI_MULTIPART_MAX_PARTS) {
+        mp->failed = true;
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        mp->is_text[mp->count] = false;
+        mp->parts[mp->count++] = file[i];
+    }
+    multipartAppend(mp, "\r\n");
+}
+
+static bool multipartFinish(OpenAI_Multipart_t *mp)
+{
+    multipartAppend(mp, "--" OPENAI_MULTIPART_BOUNDARY "--\r\n");
+    if (mp->failed) {
+        return false;
+    }
+    // The text buffer no longer moves, resolve the offsets of the text parts
+    for (size_t i = 0; i < mp->count; i++) {
+        if (mp->is_text[i]) {
+            mp->parts[i].data = (const uint8_t *)mp->text + mp->text_offset[i];
+        }
+    }
+    return true;
+}
+
+static void multipartFree(OpenAI_Multipart_t *mp)
+{
+    free(mp->text);
+    mp->text = NULL;
+}
+
+/**
+ * @brief A growing buffer collecting a streamed response.
+ *
+ */
+typedef struct {
+    char *data;     /*!< Received data */
+    size_t len;     /*!< Length of the received data */
+    size_t cap;     /*!< Allocated length of data */
+} OpenAI_Buffer_t;
+
+static int OpenAI_BufferWrite(void *ctx, const uint8_t *data, size_t len)
+{
+    OpenAI_Buffer_t *buffer = (OpenAI_Buffer_t *)ctx;
+    if (buffer->len + len > buffer->cap) {
+        // Doubling keeps the copies of realloc linear in the response size
+        size_t cap = buffer->cap ? buffer->cap : 4096;
+        while (cap < buffer->len + len) {
+            cap *= 2;
+        }
+        char *grown = (char *)realloc(buffer->data, cap);
+        OPENAI_ERROR_CHECK(grown != NULL, "Failed to grow response buffer!", -1);
+        buffer->data = grown;
+        buffer->cap = cap;
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+    return 0;
+}
+
+#if CONFIG_ENABLE_JSON_SCAN
+//
+// Streaming JSON scanner
+//
+
+#define OPENAI_JSON_SCAN_MAX_PATHS 8
+#define OPENAI_JSON_SCAN_MAX_STEPS 4
+#define OPENAI_JSON_SCAN_MAX_DEPTH 16
+#define OPENAI_JSON_SCAN_KEY_LEN 32
+#define OPENAI_JSON_SCAN_LITERAL_LEN 40
+
+typedef enum {
+    OPENAI_JSON_SCAN_STRING = 0,
+    OPENAI_JSON_SCAN_NUMBER,
+    OPENAI_JSON_SCAN_BOOL,
+    OPENAI_JSON_SCAN_NULL,
+} OpenAI_JsonScan_Type;
+
+/**
+ * @brief A piece of a value found at one of the paths of a scan.
+ *        Strings are passed on unescaped in as many pieces as they arrive in, other values in one piece.
+ *
+ */
+typedef struct {
+    size_t path;                /*!< Index of the matching path */
+    uint32_t index;             /*!< Position of the value in the first array on the path */
+    OpenAI_JsonScan_Type type;  /*!< Type of the value */
+    const char *data;           /*!< Piece of the value, numbers are NUL terminated */
+    size_t len;                 /*!< Length of the piece */
+    bool end;                   /*!< Last piece of the value */
+} OpenAI_JsonScan_Value_t;
+
+typedef int (*OpenAI_JsonScan_Cb)(void *ctx, const OpenAI_JsonScan_Value_t *value);
+
+typedef enum {
+    OPENAI_JSON_SCAN_STATE_VALUE = 0,
+    OPENAI_JSON_SCAN_STATE_VALUE_OR_END,
+    OPENAI_JSON_SCAN_STATE_KEY,
+    OPENAI_JSON_SCAN_STATE_KEY_OR_END,
+    OPENAI_JSON_SCAN_STATE_COLON,
+    OPENAI_JSON_SCAN_STATE_NEXT,
+    OPENAI_JSON_SCAN_STATE_STRING,
+    OPENAI_JSON_SCAN_STATE_LITERAL,
+    OPENAI_JSON_SCAN_STATE_DONE,
+    OPENAI_JSON_SCAN_STATE_ERROR,
+} OpenAI_JsonScan_State;
+
+/**
+ * @brief Pull tokenizer picking the values at a few paths out of a JSON document while it arrives,
+ *        without building a tree. A path is a list of object keys and "[]" for any array element,
+ *        e.g. "choices[].message.content". Only strings, numbers, booleans and null are matched.
+ *
+ */
+typedef struct {
+    const char *const *paths;                                       /*!< Paths to look for */
+    size_t count;                                                   /*!< Number of paths */
+    uint8_t steps[OPENAI_JSON_SCAN_MAX_PATHS];                      /*!< Number of steps of every path */
+    struct {
+        uint8_t offset;                                             /*!< Offset of the key in the path */
+        uint8_t len;                                                /*!< Length of the key, 0 for an array element */
+    } step[OPENAI_JSON_SCAN_MAX_PATHS][OPENAI_JSON_SCAN_MAX_STEPS];
+    OpenAI_JsonScan_Cb value;                                       /*!< Called with the values found */
+    void *ctx;                                                      /*!< Context of value */
+
+    OpenAI_JsonScan_State state;                                    /*!< What the tokenizer expects next */
+    struct {
+        char type;                                                  /*!< '{' or '[' */
+        uint8_t match;                                              /*!< Paths leading into the container */
+        uint32_t index;                                             /*!< Position of the current element */
+    } stack[OPENAI_JSON_SCAN_MAX_DEPTH];
+    size_t depth;                                                   /*!< Open containers */
+    uint8_t match;                                                  /*!< Paths leading to the current value */
+    int path;                                                       /*!< Path of the current scalar, -1 if none */
+    bool key;                                                       /*!< The current string is a key */
+    uint8_t escape;                                                 /*!< 1 after a backslash, 2 to 5 in the digits of \u */
+    uint32_t codepoint;                                             /*!< Digits of \u read so far */
+    uint32_t surrogate;                                             /*!< High surrogate waiting for the low one */
+    char buf[OPENAI_JSON_SCAN_LITERAL_LEN + 1];                     /*!< Current key or number, NUL terminated */
+    size_t len;                                                     /*!< Length of buf, more than fits if truncated */
+} OpenAI_JsonScan_t;
+
+static void OpenAI_JsonScanInit(OpenAI_JsonScan_t *scan, const char *const *paths, size_t count, OpenAI_JsonScan_Cb value, void *ctx)
+{
+    memset(scan, 0, sizeof(OpenAI_JsonScan_t));
+    OPENAI_ERROR_CHECK_ABORT(count <= OPENAI_JSON_SCAN_MAX_PATHS, "Too many paths to scan for!");
+    scan->paths = paths;
+    scan->count = count;
+    scan->value = value;
+    scan->ctx = ctx;
+    scan->path = -1;
+    scan->match = (uint8_t)((1u << count) - 1);
+    for (size_t p = 0; p < count; p++) {
+        const char *s = paths[p];
+        while (*s) {
+            OPENAI_ERROR_CHECK_ABORT(scan->steps[p] < OPENAI_JSON_SCAN_MAX_STEPS, "Path to scan for is too deep!");
+            scan->step[p][scan->steps[p]].offset = s - paths[p];
+            if (s[0] == '[' && s[1] == ']') {
+                s += 2;
+            } else {
+                const char *k = s;
+                while (*s && *s != '.' && *s != '[') {
+                    s++;
+                }
+                scan->step[p][scan->steps[p]].len = s - k;
+            }
+            scan->steps[p]++;
+            if (*s == '.') {
+                s++;
+            }
+        }
+    }
+}
+
+// Paths of the container on top that continue with the current key or with any array element
+static uint8_t OpenAI_JsonScanMatch(OpenAI_JsonScan_t *scan)
+{
+    uint8_t match = 0;
+    size_t s = scan->depth - 1;
+    bool element = scan->stack[s].type == '[';
+    for (size_t p = 0; p < scan->count; p++) {
+        if (!(scan->stack[s].match & (1u << p)) || s >= scan->steps[p]) {
+            continue;
+        }
+        size_t len = scan->step[p][s].len;
+        if (element ? len == 0 : (len != 0 && len == scan->len && memcmp(scan->paths[p] + scan->step[p][s].offset, scan->buf, len) == 0)) {
+            match |= 1u << p;
+        }
+    }
+    return match;
+}
+
+static int OpenAI_JsonScanEmit(OpenAI_JsonScan_t *scan, OpenAI_JsonScan_Type type, const char *data, size_t len, bool end)
+{
+    OpenAI_JsonScan_Value_t value = { .path = scan->path, .type = type, .data = data, .len = len, .end = end };
+    for (size_t s = 0; s < scan->depth; s++) {
+        if (scan->stack[s].type == '[') {
+            value.index = scan->stack[s].index;
+            break;
+        }
+    }
+    if (scan->value(scan->ctx, &value) < 0) {
+        scan->state = OPENAI_JSON_SCAN_STATE_ERROR;
+        return -1;
+    }
+    return 0;
+}
+
+static void OpenAI_JsonScanAfterValue(OpenAI_JsonScan_t *scan)
+{
+    scan->path = -1;
+    scan->state = scan->depth ? OPENAI_JSON_SCAN_STATE_NEXT : OPENAI_JSON_SCAN_STATE_DONE;
+}
+
+static void OpenAI_JsonScanBeginValue(OpenAI_JsonScan_t *scan, char c)
+{
+    if (c == '{' || c == '[') {
+        if (scan->depth == OPENAI_JSON_SCAN_MAX_DEPTH) {
+            scan->state = OPENAI_JSON_SCAN_STATE_ERROR;
+            return;
+        }
+        scan->stack[scan->depth].type = c;
+        scan->stack[scan->depth].match = scan->match;
+        scan->stack[scan->depth].index = 0;
+        scan->depth++;
+        if (c == '{') {
+            scan->state = OPENAI_JSON_SCAN_STATE_KEY_OR_END;
+        } else {
+            scan->match = OpenAI_JsonScanMatch(scan);
+            scan->state = OPENAI_JSON_SCAN_STATE_VALUE_OR_END;
+        }
+        return;
+    }
+
+    // A scalar is found when its path ends here
+    scan->path = -1;
+    for (size_t p = 0; p < scan->count; p++) {
+        if ((scan->match & (1u << p)) && scan->steps[p] == scan->depth) {
+            scan->path = p;
+            break;
+        }
+    }
+    if (c == '"') {
+        scan->key = false;
+        scan->state = OPENAI_JSON_SCAN_STATE_STRING;
+    } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+        scan->buf[0] = c;
+        scan->len = 1;
+        scan->state = OPENAI_JSON_SCAN_STATE_LITERAL;
+    } else {
+        scan->state = OPENAI_JSON_SCAN_STATE_ERROR;
+    }
+}
+
+static void OpenAI_JsonScanEnd(OpenAI_JsonScan_t *scan)
+{
+    scan->depth--;
+    OpenAI_JsonScanAfterValue(scan);
+}
+
+// Appends decoded bytes to the current key or passes them on as a piece of the current string
+static int OpenAI_JsonScanStringData(OpenAI_JsonScan_t *scan, const char *data, size_t len)
+{
+    if (scan->key) {
+        if (scan->len + len <= OPENAI_JSON_SCAN_KEY_LEN) {
+            memcpy(scan->buf + scan->len, data, len);
+        }
+        scan->len += len;
+        return 0;
+    }
+    if (scan->path < 0 || len == 0) {
+        return 0;
+    }
+    return OpenAI_JsonScanEmit(scan, OPENAI_JSON_SCAN_STRING, data, len, false);
+}
+
+static int OpenAI_JsonScanCodepoint(OpenAI_JsonScan_t *scan, uint32_t cp)
+{
+    char utf8[4];
+    size_t len;
+    if (cp < 0x80) {
+        utf8[0] = cp;
+        len = 1;
+    } else if (cp < 0x800) {
+        utf8[0] = 0xC0 | (cp >> 6);
+        utf8[1] = 0x80 | (cp & 0x3F);
+        len = 2;
+    } else if (cp < 0x10000) {
+        utf8[0] = 0xE0 | (cp >> 12);
+        utf8[1] = 0x80 | ((cp >> 6) & 0x3F);
+        utf8[2] = 0x80 | (cp & 0x3F);
+        len = 3;
+    } else {
+        utf8[0] = 0xF0 | (cp >> 18);
+        utf8[1] = 0x80 | ((cp >> 12) & 0x3F);
+        utf8[2] = 0x80 | ((cp >> 6) & 0x3F);
+        utf8[3] = 0x80 | (cp & 0x3F);
+        len = 4;
+    }
+    return OpenAI_JsonScanStringData(scan, utf8, len);
+}
+
+// A high surrogate not followed by a low one is replaced by U+FFFD
+static int OpenAI_JsonScanFlushSurrogate(OpenAI_JsonScan_t *scan)
+{
+    if (scan->surrogate == 0) {
+        return 0;
+    }
+    scan->surrogate = 0;
+    return OpenAI_JsonScanCodepoint(scan, 0xFFFD);
+}
+
+static int OpenAI_JsonScanEscape(OpenAI_JsonScan_t *scan, char c)
+{
+    if (scan->escape == 1) {
+        static const char escapes[] = "\"\"\\\\//b\bf\fn\nr\rt\t";
+        if (c == 'u') {
+            scan->escape = 2;
+            scan->codepoint = 0;
+            return 0;
+        }
+        scan->escape = 0;
+        for (size_t i = 0; i < sizeof(escapes) - 1; i += 2) {
+            if (escapes[i] == c) {
+                if (OpenAI_JsonScanFlushSurrogate(scan) < 0) {
+                    return -1;
+                }
+                return OpenAI_JsonScanStringData(scan, &escapes[i + 1], 1);
+            }
+        }
+        return -1;
+    }
+
+    int digit = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+    if (digit < 0) {
+        return -1;
+    }
+    scan->codepoint = (scan->codepoint << 4) | digit;
+    if (++scan->escape <= 5) {
+        return 0;
+    }
+    scan->escape = 0;
+    uint32_t cp = scan->codepoint;
+    if (cp >= 0xDC00 && cp <= 0xDFFF && scan->surrogate != 0) {
+        cp = 0x10000 + ((scan->surrogate - 0xD800) << 10) + (cp - 0xDC00);
+        scan->surrogate = 0;
+    } else {
+        if (OpenAI_JsonScanFlushSurrogate(scan) < 0) {
+            return -1;
+        }
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+            scan->surrogate = cp;
+            return 0;
+        }
+        if (cp >= 0xDC00 && cp <= 0xDFFF) {
+            cp = 0xFFFD;
+        }
+    }
+    return OpenAI_JsonScanCodepoint(scan, cp);
+}
+
+static const char *OpenAI_JsonScanString(OpenAI_JsonScan_t *scan, const char *p, const char *end)
+{
+    while (p < end) {
+        if (scan->escape) {
+            if (OpenAI_JsonScanEscape(scan, *p++) < 0) {
+                scan->state = OPENAI_JSON_SCAN_STATE_ERROR;
+                return p;
+            }
+            continue;
+        }
+
+        // Runs without escapes are passed on straight from the received data
+        const char *start = p;
+        while (p < end && *p != '"' && *p != '\\') {
+            p++;
+        }
+        if (p > start && (OpenAI_JsonScanFlushSurrogate(scan) < 0 || OpenAI_JsonScanStringData(scan, start, p - start) < 0)) {
+            return p;
+        }
+        if (p == end) {
+            break;
+        }
+        if (*p++ == '\\') {
+            scan->escape = 1;
+            continue;
+        }
+
+        if (OpenAI_JsonScanFlushSurrogate(scan) < 0) {
+            return p;
+        }
+        if (scan->key) {
+            scan->state = OPENAI_JSON_SCAN_STATE_COLON;
+        } else if (scan->path < 0 || OpenAI_JsonScanEmit(scan, OPENAI_JSON_SCAN_STRING, "", 0, true) == 0) {
+            OpenAI_JsonScanAfterValue(scan);
+        }
+        break;
+    }
+    return p;
+}
+
+static void OpenAI_JsonScanLiteralEnd(OpenAI_JsonScan_t *scan)
+{
+    OpenAI_JsonScan_Type type;
+    if (scan->len > OPENAI_JSON_SCAN_LITERAL_LEN) {
+        // Only a value that is looked for has to fit
+        if (scan->path >= 0) {
+            scan->state = OPENAI_JSON_SCAN_STATE_ERROR;
+        } else {
+            OpenAI_JsonScanAfterValue(scan);
+        }
+        return;
+    }
+    scan->buf[scan->len] = 0;
+    if (strcmp(scan->buf, "true") == 0 || strcmp(scan->buf, "false") == 0) {
+        type = OPENAI_JSON_SCAN_BOOL;
+    } else if (strcmp(scan->buf, "null") == 0) {
+        type = OPENAI_JSON_SCAN_NULL;
+    } else {
+        char *end = NULL;
+        strtod(scan->buf, &end);
+        if (end != scan->buf + scan->len || !(scan->buf[0] == '-' || (scan->buf[0] >= '0' && scan->buf[0] <= '9'))) {
+            scan->state = OPENAI_JSON_SCAN_STATE_ERROR;
+            return;
+        }
+        type = OPENAI_JSON_SCAN_NUMBER;
+    }
+    if (scan->path >= 0 && OpenAI_JsonScanEmit(scan, type, scan->buf, scan->len, true) < 0) {
+        return;
+    }
+    OpenAI_JsonScanAfterValue(scan);
+}
+
+static const char *OpenAI_JsonScanLiteral(OpenAI_JsonScan_t *scan, const char *p, const char *end)
+{
+    while (p < end) {
+        char c = *p;
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '+' || c == '-' || c == '.')) {
+            OpenAI_JsonScanLiteralEnd(scan);
+            break;
+        }
+        if (scan->len < OPENAI_JSON_SCAN_LITERAL_LEN) {
+            scan->buf[scan->len] = c;
+        }
+        scan->len++;
+        p++;
+    }
+    return p;
+}
+
+/**
+ * @brief Feeds the next piece of the document, an OpenAI_Write_Cb for the scanner.
+ *
+ * @return 0 to go on, -1 if the document is not valid JSON or the value callback failed
+ */
+static int OpenAI_JsonScanWrite(void *ctx, const uint8_t *data, size_t len)
+{
+    OpenAI_JsonScan_t *scan = (OpenAI_JsonScan_t *)ctx;
+    const char *p = (const char *)data;
+    const char *end = p + len;
+    while (p < end && scan->state != OPENAI_JSON_SCAN_STATE_ERROR) {
+        if (scan->state == OPENAI_JSON_SCAN_STATE_STRING) {
+            p = OpenAI_JsonScanString(scan, p, end);
+            continue;
+        }
+        if (scan->state == OPENAI_JSON_SCAN_STATE_LITERAL) {
+            p = OpenAI_JsonScanLiteral(scan, p, end);
+            continue;
+        }
+
+        char c = *p++;
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            continue;
+        }
+        switch (scan->state) {
+        case OPENAI_JSON_SCAN_STATE_VALUE_OR_END:
+            if (c == ']') {
+                OpenAI_JsonScanEnd(scan);
+                break;
+            }
+        // fall through
+        case OPENAI_JSON_SCAN_STATE_VALUE:
+            OpenAI_JsonScanBeginValue(scan, c);
+            break;
+        case OPENAI_JSON_SCAN_STATE_KEY_OR_END:
+            if (c == '}') {
+                OpenAI_JsonScanEnd(scan);
+                break;
+            }
+        // fall through
+        case OPENAI_JSON_SCAN_STATE_KEY:
+            if (c != '"') {
+                scan->state = OPENAI_JSON_SCAN_STATE_ERROR;
+                break;
+            }
+            scan->key = true;
+            scan->len = 0;
+            scan->state = OPENAI_JSON_SCAN_STATE_STRING;
+            break;
+        case OPENAI_JSON_SCAN_STATE_COLON:
+            if (c != ':') {
+                scan->state = OPENAI_JSON_SCAN_STATE_ERROR;
+                break;
+            }
+            scan->match = OpenAI_JsonScanMatch(scan);
+            scan->state = OPENAI_JSON_SCAN_STATE_VALUE;
+            break;
+        case OPENAI_JSON_SCAN_STATE_NEXT: {
+            char type = scan->stack[scan->depth - 1].type;
+            if (c == ',') {
+                if (type == '{') {
+                    scan->state = OPENAI_JSON_SCAN_STATE_KEY;
+                } else {
+                    scan->stack[scan->depth - 1].index++;
+                    scan->match = OpenAI_JsonScanMatch(scan);
+                    scan->state = OPENAI_JSON_SCAN_STATE_VALUE;
+                }
+            } else if ((type == '{' && c == '}') || (type == '[' && c == ']')) {
+                OpenAI_JsonScanEnd(scan);
+            } else {
+                scan->state = OPENAI_JSON_SCAN_STATE_ERROR;
+            }
+            break;
+        }
+        default:
+            scan->state = OPENAI_JSON_SCAN_STATE_ERROR;
+            break;
+        }
+    }
+    return scan->state == OPENAI_JSON_SCAN_STATE_ERROR ? -1 : 0;
+}
+
+/**
+ * @brief Ends the document.
+ *
+ * @return true if a complete JSON document was scanned
+ */
+static bool OpenAI_JsonScanFinish(OpenAI_JsonScan_t *scan)
+{
+    if (scan->state == OPENAI_JSON_SCAN_STATE_LITERAL) {
+        OpenAI_JsonScanLiteralEnd(scan);
+    }
+    return scan->state == OPENAI_JSON_SCAN_STATE_DONE;
+}
+
+// Buffer of the array element at index, the array grows as needed
+static OpenAI_Buffer_t *OpenAI_JsonScanBufferAt(OpenAI_Buffer_t **buffers, uint32_t *len, uint32_t index)
+{
+    if (index >= *len) {
+        OpenAI_Buffer_t *grown = (OpenAI_Buffer_t *)realloc(*buffers, (index + 1) * sizeof(OpenAI_Buffer_t));
+        OPENAI_ERROR_CHECK(grown != NULL, "Failed to grow scan buffers!", NULL);
+        memset(grown + *len, 0, (index + 1 - *len) * sizeof(OpenAI_Buffer_t));
+        *buffers = grown;
+        *len = index + 1;
+    }
+    return &(*buffers)[index];
+}
+
+// Hands out the data of a buffer, trimmed to its length
+static char *OpenAI_JsonScanBufferTake(OpenAI_Buffer_t *buffer)
+{
+    char *data = buffer->data;
+    char *trimmed = buffer->len ? (char *)realloc(data, buffer->len) : NULL;
+    memset(buffer, 0, sizeof(OpenAI_Buffer_t));
+    return trimmed != NULL ? trimmed : data;
+}
+
+static void OpenAI_JsonScanBuffersFree(OpenAI_Buffer_t *buffers, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        free(buffers[i].data);
+    }
+    free(buffers);
+}
+
+/**
+ * @brief Error of a response collected by a scan, the first two paths of such a scan are
+ *        OPENAI_JSON_SCAN_ERROR_PATHS.
+ *
+ */
+#define OPENAI_JSON_SCAN_ERROR_PATHS "error.code", "error.message"
+
+typedef struct {
+    OpenAI_Buffer_t code;       /*!< error.code */
+    OpenAI_Buffer_t message;    /*!< error.message */
+} OpenAI_JsonScanError_t;
+
+static int OpenAI_JsonScanErrorWrite(OpenAI_JsonScanError_t *error, const OpenAI_JsonScan_Value_t *value)
+{
+    OpenAI_Buffer_t *buffer = value->path == 0 ? &error->code : &error->message;
+    if (value->type != OPENAI_JSON_SCAN_STRING && value->type != OPENAI_JSON_SCAN_NUMBER) {
+        return 0;
+    }
+    return OpenAI_BufferWrite(buffer, (const uint8_t *)value->data, value->end ? value->len + 1 : value->len);
+}
+
+/**
+ * @brief The error of the response in the form of getJsonError, NULL if there was none.
+ *        Frees the collected error either way.
+ *
+ */
+static char *OpenAI_JsonScanErrorString(OpenAI_JsonScanError_t *error)
+{
+    char *errorMsg = NULL;
+    OpenAI_Buffer_t *reason = error->code.len ? &error->code : &error->message;
+    if (reason->len) {
+        asprintf(&errorMsg, "\"code\": %.*s!", (int)reason->len, reason->data);
+        OPENAI_ERROR_CHECK_CONTINUE(errorMsg != NULL, "asprintf failed!");
+    }
+    free(error->code.data);
+    free(error->message.data);
+    memset(error, 0, sizeof(OpenAI_JsonScanError_t));
+    return errorMsg;
+}
+#endif
+
+//
+// OpenAI
+//
+
+#if CONFIG_ENABLE_REQUEST_HEDGING
+#define OPENAI_LATENCY_SAMPLES 32
+#define OPENAI_LATENCY_MIN_SAMPLES 8
+
+/**
+ * @brief Latency of the last successful requests of a class, the hedging delay is a percentile of it.
+ *
+ */
+typedef struct {
+    uint32_t ms[OPENAI_LATENCY_SAMPLES];    /*!< Latency of the requests in ms, a ring */
+    uint8_t count;                          /*!< Samples in ms */
+    uint8_t next;                           /*!< Index the next sample is written to */
+} OpenAI_Latency_t;
+#endif
+
+#if CONFIG_ENABLE_REQUEST_TIMING
+/**
+ * @brief Requests to one endpoint and the timing of the last successful ones.
+ *
+ */
+typedef struct {
+    char endpoint[32];                                                  /*!< Endpoint of the requests */
+    uint32_t requests;                                                  /*!< Requests recorded */
+    uint32_t failures;                                                  /*!< Requests without a complete 2xx response */
+    uint32_t last_used;                                                 /*!< Sequence number of the last request, the least recently used endpoint makes room */
+    uint8_t count;                                                      /*!< Requests in window */
+    uint8_t next;                                                       /*!< Index the next request is written to */
+    OpenAI_Request_Timing_t window[CONFIG_REQUEST_TIMING_WINDOW];       /*!< Timing of the last successful requests, a ring */
+} OpenAI_EndpointTiming_t;
+#endif
+
+typedef struct _OpenAI {
+    OpenAI_t parent;                                                                                             /*!<  Parent object */
+    char *api_key;                                                                                               /*!<  API key for OpenAI */
+    char *base_url;                                                                                              /*!<  Base URL for OpenAI or Other compatible API */
+
+    OpenAI_Transport_t *transport;                                                                               /*!<  Transport the requests are sent with */
+
+    char *(*get)(struct _OpenAI *oai, const char *endpoint);                                                     /*!<  Perform an HTTP GET request. */
+    char *(*del)(struct _OpenAI *oai, const char *endpoint);                                                     /*!<  Perform an HTTP DELETE request. */
+    char *(*post)(struct _OpenAI *oai, const char *endpoint, char *jsonBody);                                    /*!<  Perform an HTTP POST request. */
+    char *(*speechpost)(struct _OpenAI *oai, const char *endpoint, char *jsonBody, size_t *output_len);          /*!<  Perform an HTTP POST request for speech. */
+    esp_err_t (*stream)(struct _OpenAI *oai, const char *endpoint, char *jsonBody, OpenAI_Write_Cb write, void *ctx); /*!<  Perform an HTTP POST request and pass on the response while it arrives. */
+    esp_err_t (*events)(struct _OpenAI *oai, const char *endpoint, char *jsonBody, OpenAI_Write_Cb write, void *ctx); /*!<  Same as stream, error responses are passed on as well. */
+    char *(*upload)(struct _OpenAI *oai, const char *endpoint, const OpenAI_Body_Part_t *parts, size_t count);   /*!<  Upload a multipart body using an HTTP request. */
+#if CONFIG_ENABLE_JSON_SCAN
+    esp_err_t (*scan)(struct _OpenAI *oai, const char *endpoint, char *jsonBody, OpenAI_JsonScan_t *scan);    /*!<  Perform an HTTP POST request and scan the JSON response while it arrives. */
+    esp_err_t (*uploadscan)(struct _OpenAI *oai, const char *endpoint, const OpenAI_Body_Part_t *parts, size_t count, OpenAI_JsonScan_t *scan); /*!<  Upload a multipart body and scan the JSON response while it arrives. */
+#endif
+
+    QueueHandle_t async_queue;                                                                                   /*!<  Async requests waiting for a worker task */
+    SemaphoreHandle_t async_lock;                                                                                /*!<  Protects the state of the async requests */
+    SemaphoreHandle_t async_exited;                                                                              /*!<  Given by every worker task when it exits */
+    uint32_t async_workers;                                                                                      /*!<  Worker tasks started */
+    struct _OpenAI_AsyncRequest *async_requests;                                                                 /*!<  Async requests that did not end yet */
+
+    OpenAI_Request_Profile_t profiles[OPENAI_REQUEST_CLASS_MAX];                                                 /*!<  Timeouts, retries and hedging per class of requests */
+#if CONFIG_ENABLE_REQUEST_HEDGING
+    SemaphoreHandle_t hedge_lock;                                                                                /*!<  Protects the latency samples and the hedged requests */
+    OpenAI_Latency_t latency[OPENAI_REQUEST_CLASS_MAX];                                                          /*!<  Latency of recent successful requests per class */
+    uint32_t hedge_tasks;                                                                                        /*!<  Attempt tasks of hedged requests still running */
+#endif
+#if CONFIG_ENABLE_REQUEST_TIMING
+    SemaphoreHandle_t timing_lock;                                                                               /*!<  Protects the timing callback and the endpoint stats */
+    OpenAI_Timing_Cb timing_cb;                                                                                  /*!<  Called with the timing of every request */
+    void *timing_ctx;                                                                                            /*!<  User context of timing_cb */
+    OpenAI_EndpointTiming_t *endpoint_timing[CONFIG_REQUEST_TIMING_ENDPOINTS];                                   /*!<  Stats of the endpoints, allocated on their first request */
+    uint32_t timing_seq;                                                                                         /*!<  Requests recorded, orders the endpoints by their last use */
+#endif
+} _OpenAI_t;
+
+//
+// Async requests
+//
+
+#if CONFIG_ENABLE_ASYNC
+#define OPENAI_ASYNC_ENDED_BIT BIT0
+
+typedef struct _OpenAI_AsyncRequest {
+    OpenAI_AsyncRequest_t parent;                                   /*!< Parent object */
+    _OpenAI_t *oai;                                                 /*!< OpenAI object whose workers run the request */
+    void (*run)(struct _OpenAI_AsyncRequest *request);              /*!< Performs the request on the worker task and stores result */
+    void (*free_result)(void *result);                              /*!< Deletes a result nobody took */
+    void *object;                                                   /*!< Chat, transcription or speech object of the request */
+    char *text;                                                     /*!< Copy of the prompt or speech input */
+    bool save;                                                      /*!< Save the chat message with its response */
+    const uint8_t *audio;                                           /*!< Audio to transcribe, owned by the caller */
+    size_t audio_len;                                               /*!< Length of audio */
+    size_t audio_pos;                                               /*!< Bytes of audio uploaded so far */
+    OpenAI_Audio_Input_Format format;                               /*!< Format of audio */
+    OpenAI_Buffer_t received;                                       /*!< Speech audio received so far */
+    OpenAI_Async_Config_t config;                                   /*!< How the request reports back */
+    OpenAI_Async_State state;                                       /*!< State, changed under oai->async_lock */
+    volatile bool cancelled;                                        /*!< Set by cancel, polled by the running request */
+    void *result;                                                   /*!< Result until it is taken */
+    uint32_t refs;                                                  /*!< References of the caller and the worker task */
+    EventGroupHandle_t ended;                                       /*!< OPENAI_ASYNC_ENDED_BIT is set when the request ended */
+    struct _OpenAI_AsyncRequest *next;                              /*!< Next request in oai->async_requests */
+} _OpenAI_AsyncRequest_t;
+
+static void OpenAI_AsyncRelease(_OpenAI_AsyncRequest_t *request)
+{
+    xSemaphoreTake(request->oai->async_lock, portMAX_DELAY);
+    bool last = (--request->refs == 0);
+    xSemaphoreGive(request->oai->async_lock);
+    if (!last) {
+        return;
+    }
+    if (request->result != NULL) {
+        request->free_result(request->result);
+    }
+    if (request->ended != NULL) {
+        vEventGroupDelete(request->ended);
+    }
+    free(request->text);
+    free(request);
+}
+
+static void OpenAI_AsyncUnlink(_OpenAI_AsyncRequest_t *request)
+{
+    _OpenAI_AsyncRequest_t **link = &request->oai->async_requests;
+    while (*link != NULL && *link != request) {
+        link = &(*link)->next;
+    }
+    if (*link != NULL) {
+        *link = request->next;
+    }
+}
+
+static void OpenAI_AsyncFinish(_OpenAI_AsyncRequest_t *request)
+{
+    void *discarded = NULL;
+    xSemaphoreTake(request->oai->async_lock, portMAX_DELAY);
+    if (request->cancelled) {
+        discarded = request->result;
+        request->result = NULL;
+        request->state = OPENAI_ASYNC_STATE_CANCELLED;
+    } else {
+        request->state = (request->result != NULL) ? OPENAI_ASYNC_STATE_DONE : OPENAI_ASYNC_STATE_FAILED;
+    }
+    OpenAI_AsyncUnlink(request);
+    xSemaphoreGive(request->oai->async_lock);
+    if (discarded != NULL) {
+        request->free_result(discarded);
+    }
+
+    xEventGroupSetBits(request->ended, OPENAI_ASYNC_ENDED_BIT);
+    if (request->config.event_group != NULL) {
+        xEventGroupSetBits(request->config.event_group, request->config.bits);
+    }
+    if (request->config.done != NULL) {
+        request->config.done(&request->parent, request->config.ctx);
+    }
+    OpenAI_AsyncRelease(request);
+}
+
+static void OpenAI_AsyncWorker(void *arg)
+{
+    _OpenAI_t *oai = (_OpenAI_t *)arg;
+    _OpenAI_AsyncRequest_t *request = NULL;
+    // A NULL request asks the worker to exit
+    while (xQueueReceive(oai->async_queue, &request, portMAX_DELAY) == pdTRUE && request != NULL) {
+        xSemaphoreTake(oai->async_lock, portMAX_DELAY);
+        bool run = !request->cancelled;
+        if (run) {
+            request->state = OPENAI_ASYNC_STATE_RUNNING;
+        }
+        xSemaphoreGive(oai->async_lock);
+        if (run) {
+            request->run(request);
+        }
+        OpenAI_AsyncFinish(request);
+    }
+    xSemaphoreGive(oai->async_exited);
+    vTaskDelete(NULL);
+}
+
+static OpenAI_Async_State OpenAI_AsyncRequestGetState(OpenAI_AsyncRequest_t *request)
+{
+    _OpenAI_AsyncRequest_t *_request = __containerof(request, _OpenAI_AsyncRequest_t, parent);
+    xSemaphoreTake(_request->oai->async_lock, portMAX_DELAY);
+    OpenAI_Async_State state = _request->state;
+    xSemaphoreGive(_request->oai->async_lock);
+    return state;
+}
+
+static bool OpenAI_AsyncRequestWait(OpenAI_AsyncRequest_t *request, TickType_t timeout)
+{
+    _OpenAI_AsyncRequest_t *_request = __containerof(request, _OpenAI_AsyncRequest_t, parent);
+    return (xEventGroupWaitBits(_request->ended, OPENAI_ASYNC_ENDED_BIT, pdFALSE, pdTRUE, timeout) & OPENAI_ASYNC_ENDED_BIT) != 0;
+}
+
+static void OpenAI_AsyncRequestCancel(OpenAI_AsyncRequest_t *request)
+{
+    _OpenAI_AsyncRequest_t *_request = __containerof(request, _OpenAI_AsyncRequest_t, parent);
+    xSemaphoreTake(_request->oai->async_lock, portMAX_DELAY);
+    if (_request->state == OPENAI_ASYNC_STATE_QUEUED || _request->state == OPENAI_ASYNC_STATE_RUNNING) {
+        _request->cancelled = true;
+    }
+    xSemaphoreGive(_request->oai->async_lock);
+}
+
+static void *OpenAI_AsyncRequestGetResult(OpenAI_AsyncRequest_t *request)
+{
+    _OpenAI_AsyncRequest_t *_request = __containerof(request, _OpenAI_AsyncRequest_t, parent);
+    void *result = NULL;
+    xSemaphoreTake(_request->oai->async_lock, portMAX_DELAY);
+    if (_request->state == OPENAI_ASYNC_STATE_DONE) {
+        result = _request->result;
+        _request->result = NULL;
+    }
+    xSemaphoreGive(_request->oai->async_lock);
+    return result;
+}
+
+static void OpenAI_AsyncRequestDelete(OpenAI_AsyncRequest_t *request)
+{
+    _OpenAI_AsyncRequest_t *_request = __containerof(request, _OpenAI_AsyncRequest_t, parent);
+    OpenAI_AsyncRequestCancel(request);
+    OpenAI_AsyncRelease(_request);
+}
+
+static _OpenAI_AsyncRequest_t *OpenAI_AsyncRequestCreate(_OpenAI_t *oai, void *object, const OpenAI_Async_Config_t *config)
+{
+    OPENAI_ERROR_CHECK(oai->async_lock != NULL, "Async requests are not available!", NULL);
+    _OpenAI_AsyncRequest_t *request = (_OpenAI_AsyncRequest_t *)calloc(1, sizeof(_OpenAI_AsyncRequest_t));
+    OPENAI_ERROR_CHECK(request != NULL, "calloc failed!", NULL);
+    request->ended = xEventGroupCreate();
+    if (request->ended == NULL) {
+        ESP_LOGE(TAG, "xEventGroupCreate failed!");
+        free(request);
+        return NULL;
+    }
+    request->oai = oai;
+    request->object = object;
+    if (config != NULL) {
+        request->config = *config;
+    }
+    request->parent.getState = &OpenAI_AsyncRequestGetState;
+    request->parent.wait = &OpenAI_AsyncRequestWait;
+    request->parent.cancel = &OpenAI_AsyncRequestCancel;
+    request->parent.getResult = &OpenAI_AsyncRequestGetResult;
+    request->parent.delete = &OpenAI_AsyncRequestDelete;
+    return request;
+}
+
+/**
+ * @brief Queue a request created by OpenAI_AsyncRequestCreate, starting the worker tasks with the first one.
+ *        The request is freed if it cannot be queued.
+ */
+static OpenAI_AsyncRequest_t *OpenAI_AsyncSubmit(_OpenAI_AsyncRequest_t *request)
+{
+    _OpenAI_t *oai = request->oai;
+    xSemaphoreTake(oai->async_lock, portMAX_DELAY);
+    while (oai->async_workers < CONFIG_ASYNC_WORKERS) {
+        char name[16];
+        snprintf(name, sizeof(name), "openai_async%" PRIu32, oai->async_workers);
+        if (xTaskCreate(&OpenAI_AsyncWorker, name, CONFIG_ASYNC_WORKER_STACK_SIZE, oai, CONFIG_ASYNC_WORKER_PRIORITY, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to start async worker task!");
+            break;
+        }
+        oai->async_workers++;
+    }
+    bool queued = false;
+    if (oai->async_workers > 0) {
+        request->state = OPENAI_ASYNC_STATE_QUEUED;
+        request->refs = 2;
+        queued = (xQueueSend(oai->async_queue, &request, 0) == pdTRUE);
+        if (queued) {
+            request->next = oai->async_requests;
+            oai->async_requests = request;
+        }
+    }
+    xSemaphoreGive(oai->async_lock);
+    if (!queued) {
+        ESP_LOGE(TAG, "Too many async requests queued!");
+        request->refs = 1;
+        OpenAI_AsyncRelease(request);
+        return NULL;
+    }
+    return &request->parent;
+}
+
+static void OpenAI_AsyncInit(_OpenAI_t *oai)
+{
+    oai->async_queue = xQueueCreate(CONFIG_ASYNC_QUEUE_LENGTH, sizeof(_OpenAI_AsyncRequest_t *));
+    oai->async_lock = xSemaphoreCreateMutex();
+    oai->async_exited = xSemaphoreCreateCounting(CONFIG_ASYNC_WORKERS, 0);
+    if (oai->async_queue == NULL || oai->async_lock == NULL || oai->async_exited == NULL) {
+        ESP_LOGE(TAG, "Failed to create async queue, async requests are not available!");
+        if (oai->async_queue != NULL) {
+            vQueueDelete(oai->async_queue);
+            oai->async_queue = NULL;
+        }
+        if (oai->async_lock != NULL) {
+            vSemaphoreDelete(oai->async_lock);
+            oai->async_lock = NULL;
+        }
+        if (oai->async_exited != NULL) {
+            vSemaphoreDelete(oai->async_exited);
+            oai->async_exited = NULL;
+        }
+    }
+}
+
+/**
+ * @brief Cancel all requests that did not end yet and wait for the worker tasks to exit.
+ *        Queued requests end right away, running ones at their next chunk.
+ */
+static void OpenAI_AsyncDeinit(_OpenAI_t *oai)
+{
+    if (oai->async_lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(oai->async_lock, portMAX_DELAY);
+    for (_OpenAI_AsyncRequest_t *request = oai->async_requests; request != NULL; request = request->next) {
+        request->cancelled = true;
+    }
+    uint32_t workers = oai->async_workers;
+    xSemaphoreGive(oai->async_lock);
+    _OpenAI_AsyncRequest_t *stop = NULL;
+    for (uint32_t i = 0; i < workers; i++) {
+        xQueueSend(oai->async_queue, &stop, portMAX_DELAY);
+    }
+    for (uint32_t i = 0; i < workers; i++) {
+        xSemaphoreTake(oai->async_exited, portMAX_DELAY);
+    }
+    vQueueDelete(oai->async_queue);
+    vSemaphoreDelete(oai->async_lock);
+    vSemaphoreDelete(oai->async_exited);
+    oai->async_queue = NULL;
+    oai->async_lock = NULL;
+    oai->async_exited = NULL;
+}
+#else
+static void OpenAI_AsyncInit(_OpenAI_t *oai) {}
+static void OpenAI_AsyncDeinit(_OpenAI_t *oai) {}
+#endif
+
+//
+// OpenAI_EmbeddingResponse
+//
+
+typedef struct {
+    OpenAI_EmbeddingResponse_t parent;
+    uint32_t usage;
+    uint32_t len;
+    OpenAI_EmbeddingData_t *data;
+    char *error_str;
+} _OpenAI_EmbeddingResponse_t;
+
+static void OpenAI_EmbeddingResponseDelete(OpenAI_EmbeddingResponse_t *embeddingResponse)
+{
+    _OpenAI_EmbeddingResponse_t *_embeddingResponse = __containerof(embeddingResponse, _OpenAI_EmbeddingResponse_t, parent);
+    if (_embeddingResponse != NULL) {
+        if (_embeddingResponse->data) {
+            for (int i = 0; i < _embeddingResponse->len; i++) {
+                free(_embeddingResponse->data[i].data);
+                _embeddingResponse->data[i].data = NULL;
+            }
+            free(_embeddingResponse->data);
+            _embeddingResponse->data = NULL;
+        }
+
+        if (_embeddingResponse->error_str != NULL) {
+            free(_embeddingResponse->error_str);
+            _embeddingResponse->error_str = NULL;
+        }
+
+        free(_embeddingResponse);
+        _embeddingResponse = NULL;
+    }
+}
+
+static uint32_t OpenAI_EmbeddingResponseGetUsage(OpenAI_EmbeddingResponse_t *embeddingResponse)
+{
+    _OpenAI_EmbeddingResponse_t *_embeddingResponse = __containerof(embeddingResponse, _OpenAI_EmbeddingResponse_t, parent);
+    return _embeddingResponse->usage;
+}
+
+static uint32_t OpenAI_EmbeddingResponseGetLen(OpenAI_EmbeddingResponse_t *embeddingResponse)
+{
+    _OpenAI_EmbeddingResponse_t *_embeddingResponse = __containerof(embeddingResponse, _OpenAI_EmbeddingResponse_t, parent);
+    return _embeddingResponse->len;
+}
+
+static OpenAI_EmbeddingData_t *OpenAI_EmbeddingResponseGetDate(OpenAI_EmbeddingResponse_t *embeddingResponse, uint32_t index)
+{
+    _OpenAI_EmbeddingResponse_t *_embeddingResponse = __containerof(embeddingResponse, _OpenAI_EmbeddingResponse_t, parent);
+    if (index < _embeddingResponse->len) {
+        return &_embeddingResponse->data[index];
+    }
+    return NULL;
+}
+
+static char *OpenAI_EmbeddingResponseGetError(OpenAI_EmbeddingResponse_t *embeddingResponse)
+{
+    _OpenAI_EmbeddingResponse_t *_embeddingResponse = __containerof(embeddingResponse, _OpenAI_EmbeddingResponse_t, parent);
+    return _embeddingResponse->error_str;
+}
+
+#if !CONFIG_ENABLE_JSON_SCAN
+static OpenAI_EmbeddingResponse_t *OpenAI_EmbeddingResponseCreate(char *payload)
+{
+    cJSON *u, *tokens, *d, *json;
+    int dl = 0;
+
+    OPENAI_ERROR_CHECK(payload != NULL, "payload is NULL", NULL);
+    json = OpenAI_JsonParse(payload);
+    free(payload);
+    _OpenAI_EmbeddingResponse_t *_embeddingResponse = (_OpenAI_EmbeddingResponse_t *)calloc(1, sizeof(_OpenAI_EmbeddingResponse_t));
+    OPENAI_ERROR_CHECK(NULL != _embeddingResponse, "calloc failed!", NULL);
+    char *error =  getJsonError(json);
+    if (error != NULL) {
+        _embeddingResponse->error_str = error;
+        ESP_LOGE(TAG, "Error: %s", error);
+        goto end;
+    }
+
+    // Get total_tokens
+    OPENAI_ERROR_CHECK_GOTO(cJSON_HasObjectItem(json, "usage"), "Usage was not found", end);
+    u = cJSON_GetObjectItem(json, "usage");
+    if (u == NULL || !cJSON_IsObject(u) || !cJSON_HasObjectItem(u, "total_tokens")) {
+        ESP_LOGE(TAG, "Total tokens were not found");
+        goto end;
+    }
+    tokens = cJSON_GetObjectItem(u, "total_tokens");
+    OPENAI_ERROR_CHECK_GOTO(NULL != tokens, "Total tokens were not found", end);
+    _embeddingResponse->usage = cJSON_GetNumberValue(tokens);
+
+    // Parse data
+    OPENAI_ERROR_CHECK_GOTO(cJSON_HasObjectItem(json, "data"), "Data was not found", end);
+    d = cJSON_GetObjectItem(json, "data");
+    if (d == NULL || !cJSON_IsArray(d)) {
+        ESP_LOGE(TAG, "Data is not array");
+        goto end;
+    }
+
+    dl = cJSON_GetArraySize(d);
+    OPENAI_ERROR_CHECK_GOTO(dl > 0, "Data is empty", end);
+    _embeddingResponse->data = (OpenAI_EmbeddingData_t *)malloc(dl * sizeof(OpenAI_EmbeddingData_t));
+    OPENAI_ERROR_CHECK_GOTO(_embeddingResponse->data != NULL, "Data could not be allocated", end);
+    for (int di = 0; di < dl; di++) {
+        cJSON *ditem = cJSON_GetArrayItem(d, di);
+        if (ditem == NULL || !cJSON_IsObject(ditem) || !cJSON_HasObjectItem(ditem, "embedding")) {
+            ESP_LOGE(TAG, "Embedding was not found");
+            goto end;
+        }
+        cJSON *numberArray = cJSON_GetObjectItem(ditem, "embedding");
+        if (numberArray == NULL || !cJSON_IsArray(numberArray)) {
+            ESP_LOGE(TAG, "Embedding is not array");
+            goto end;
+        }
+        int l = cJSON_GetArraySize(numberArray);
+        OPENAI_ERROR_CHECK_GOTO(l > 0, "Embedding is empty", end);
+        _embeddingResponse->data[di].data = (double *)malloc(l * sizeof(double));
+        OPENAI_ERROR_CHECK_GOTO(_embeddingResponse->data[di].data != NULL, "Embedding could not be allocated", end);
+        _embeddingResponse->len++;
+        _embeddingResponse->data[di].len = l;
+        for (int i = 0; i < l; i++) {
+            cJSON *item = cJSON_GetArrayItem(numberArray, i);
+            OPENAI_ERROR_CHECK_GOTO(item != NULL, "Embedding item could not be read", end)
+            _embeddingResponse->data[di].data[i] = cJSON_GetNumberValue(item);
+        }
+    }
+
+    _embeddingResponse->parent.getUsage = &OpenAI_EmbeddingResponseGetUsage;
+    _embeddingResponse->parent.getLen = &OpenAI_EmbeddingResponseGetLen;
+    _embeddingResponse->parent.getData = &OpenAI_EmbeddingResponseGetDate;
+    _embeddingResponse->parent.getError = &OpenAI_EmbeddingResponseGetError;
+    _embeddingResponse->parent.delete = &OpenAI_EmbeddingResponseDelete;
+    OpenAI_JsonDelete(json);
+    return &_embeddingResponse->parent;
+end:
+    OpenAI_JsonDelete(json);
+    OpenAI_EmbeddingResponseDelete(&_embeddingResponse->parent);
+    return NULL;
+}
+#else
+static const char *const embedding_response_paths[] = {
+    OPENAI_JSON_SCAN_ERROR_PATHS,
+    "usage.total_tokens",
+    "data[].embedding[]",
+};
+
+typedef struct {
+    OpenAI_JsonScanError_t error;   /*!< Error of the response */
+    OpenAI_Buffer_t *data;          /*!< Numbers of every embedding, as double */
+    uint32_t len;                   /*!< Number of embeddings */
+    uint32_t usage;                 /*!< Total tokens */
+    bool usage_found;               /*!< usage.total_tokens was found */
+} OpenAI_EmbeddingResponseScan_t;
+
+static int OpenAI_EmbeddingResponseScanValue(void *ctx, const OpenAI_JsonScan_Value_t *value)
+{
+    OpenAI_EmbeddingResponseScan_t *result = (OpenAI_EmbeddingResponseScan_t *)ctx;
+    if (value->path < 2) {
+        return OpenAI_JsonScanErrorWrite(&result->error, value);
+    }
+    if (value->path == 2) {
+        OPENAI_ERROR_CHECK(value->type == OPENAI_JSON_SCAN_NUMBER, "Total tokens could not be read", -1);
+        result->usage = strtoul(value->data, NULL, 10);
+        result->usage_found = true;
+        return 0;
+    }
+    OPENAI_ERROR_CHECK(value->type == OPENAI_JSON_SCAN_NUMBER, "Embedding item could not be read", -1);
+    OpenAI_Buffer_t *embedding = OpenAI_JsonScanBufferAt(&result->data, &result->len, value->index);
+    OPENAI_ERROR_CHECK(embedding != NULL, "Data could not be allocated", -1);
+    double number = strtod(value->data, NULL);
+    return OpenAI_BufferWrite(embedding, (const uint8_t *)&number, sizeof(number));
+}
+#endif
+
+/**
+ * @brief POSTs an embeddings request. The numbers are picked out of the response while it arrives
+ *        with ENABLE_JSON_SCAN, without holding the response text.
+ *
+ */
+static OpenAI_EmbeddingResponse_t *OpenAI_EmbeddingResponseRequest(_OpenAI_t *oai, const char *endpoint, char *jsonBody)
+{
+#if CONFIG_ENABLE_JSON_SCAN
+    OpenAI_EmbeddingResponseScan_t result = {0};
+    OpenAI_JsonScan_t scan;
+    OpenAI_JsonScanInit(&scan, embedding_response_paths, sizeof(embedding_response_paths) / sizeof(embedding_response_paths[0]), &OpenAI_EmbeddingResponseScanValue, &result);
+    esp_err_t err = oai->scan(oai, endpoint, jsonBody, &scan);
+
+    _OpenAI_EmbeddingResponse_t *_embeddingResponse = NULL;
+    char *error = OpenAI_JsonScanErrorString(&result.error);
+    if (error != NULL) {
+        ESP_LOGE(TAG, "Error: %s", error);
+        free(error);
+        goto end;
+    }
+    OPENAI_ERROR_CHECK_GOTO(err == ESP_OK && OpenAI_JsonScanFinish(&scan), "Response could not be parsed", end);
+    OPENAI_ERROR_CHECK_GOTO(result.usage_found, "Usage was not found", end);
+    OPENAI_ERROR_CHECK_GOTO(result.len > 0, "Data is empty", end);
+
+    _embeddingResponse = (_OpenAI_EmbeddingResponse_t *)calloc(1, sizeof(_OpenAI_EmbeddingResponse_t));
+    OPENAI_ERROR_CHECK_GOTO(NULL != _embeddingResponse, "calloc failed!", end);
+    _embeddingResponse->data = (OpenAI_EmbeddingData_t *)malloc(result.len * sizeof(OpenAI_EmbeddingData_t));
+    OPENAI_ERROR_CHECK_GOTO(_embeddingResponse->data != NULL, "Data could not be allocated", end);
+    for (uint32_t di = 0; di < result.len; di++) {
+        OPENAI_ERROR_CHECK_GOTO(result.data[di].len > 0, "Embedding is empty", end);
+        _embeddingResponse->data[di].len = result.data[di].len / sizeof(double);
+        _embeddingResponse->data[di].data = (double *)OpenAI_JsonScanBufferTake(&result.data[di]);
+        _embeddingResponse->len++;
+    }
+    _embeddingResponse->usage = result.usage;
+    OpenAI_JsonScanBuffersFree(result.data, result.len);
+
+    _embeddingResponse->parent.getUsage = &OpenAI_EmbeddingResponseGetUsage;
+    _embeddingResponse->parent.getLen = &OpenAI_EmbeddingResponseGetLen;
+    _embeddingResponse->parent.getData = &OpenAI_EmbeddingResponseGetDate;
+    _embeddingResponse->parent.getError = &OpenAI_EmbeddingResponseGetError;
+    _embeddingResponse->parent.delete = &OpenAI_EmbeddingResponseDelete;
+    return &_embeddingResponse->parent;
+end:
+    OpenAI_JsonScanBuffersFree(result.data, result.len);
+    if (_embeddingResponse != NULL) {
+        OpenAI_EmbeddingResponseDelete(&_embeddingResponse->parent);
+    }
+    return NULL;
+#else
+    char *response = oai->post(oai, endpoint, jsonBody);
+    OPENAI_ERROR_CHECK(response != NULL, "Empty response!", NULL);
+    return OpenAI_EmbeddingResponseCreate(response);
+#endif
+}
+
+//
+// OpenAI_ModerationResponse
+//
+
+typedef struct {
+    OpenAI_ModerationResponse_t parent;
+    uint32_t len;
+    bool *data;
+    char *error_str;
+} _OpenAI_ModerationResponse_t;
+
+static void OpenAI_ModerationResponseDelete(OpenAI_ModerationResponse_t *moderationResponse)
+{
+    _OpenAI_ModerationResponse_t *_moderationResponse = __containerof(moderationResponse, _OpenAI_ModerationResponse_t, parent);
+    if (_moderationResponse != NULL) {
+        if (_moderationResponse->data) {
+            free(_moderationResponse->data);
+            _moderationResponse->data = NULL;
+        }
+
+        if (_moderationResponse->error_str != NULL) {
+            free(_moderationResponse->error_str);
+            _moderationResponse->error_str = NULL;
+        }
+
+        free(_moderationResponse);
+        _moderationResponse = NULL;
+    }
+}
+
+static uint32_t OpenAI_ModerationResponseGetLen(struct OpenAI_ModerationResponse *moderationResponse)
+{
+    _OpenAI_ModerationResponse_t *_moderationResponse = __containerof(moderationResponse, _OpenAI_ModerationResponse_t, parent);
+    return _moderationResponse->len;
+}
+
+static bool OpenAI_ModerationResponseGetDate(struct OpenAI_ModerationResponse *moderationResponse, uint32_t index)
+{
+    _OpenAI_ModerationResponse_t *_moderationResponse = __containerof(moderationResponse, _OpenAI_ModerationResponse_t, parent);
+    if (index < _moderationResponse->len) {
+        return _moderationResponse->data[index];
+    }
+    return false;
+}
+
+static char *OpenAI_ModerationResponseGetError(struct OpenAI_ModerationResponse *moderationResponse)
+{
+    _OpenAI_ModerationResponse_t *_moderationResponse = __containerof(moderationResponse, _OpenAI_ModerationResponse_t, parent);
+    return _moderationResponse->error_str;
+}
+
+static OpenAI_ModerationResponse_t *OpenAI_ModerationResponseCreate(const char *payload)
+{
+    cJSON *d;
+    int dl;
+    _OpenAI_ModerationResponse_t *_moderationResponse = (_OpenAI_ModerationResponse_t *)calloc(1, sizeof(_OpenAI_ModerationResponse_t));
+    OPENAI_ERROR_CHECK(NULL != _moderationResponse, "calloc failed!", NULL);
+    if (payload == NULL) {
+        return &_moderationResponse->parent;
+    }
+
+    // Parse payload
+    cJSON *json = OpenAI_JsonParse(payload);
+    char *error = getJsonError(json);
+    if (error != NULL) {
+        _moderationResponse->error_str = error;
+        ESP_LOGE(TAG, "Error: %s", error);
+        goto end;
+    }
+
+    // Parse data
+    OPENAI_ERROR_CHECK_GOTO(cJSON_HasObjectItem(json, "results"), "Data was not found", end);
+    d = cJSON_GetObjectItem(json, "results");
+    if (d == NULL || !cJSON_IsArray(d)) {
+        ESP_LOGE(TAG, "Results is not array");
+        goto end;
+    }
+    dl = cJSON_GetArraySize(d);
+    OPENAI_ERROR_CHECK_GOTO(dl > 0, "Results is empty", end);
+    _moderationResponse->data = (bool *)malloc(dl * sizeof(bool));
+    OPENAI_ERROR_CHECK_GOTO(_moderationResponse->data != NULL, "Data could not be allocated", end);
+    _moderationResponse->len = dl;
+    for (int di = 0; di < dl; di++) {
+        cJSON *ditem = cJSON_GetArrayItem(d, di);
+        if (ditem == NULL || !cJSON_IsObject(ditem) || !cJSON_HasObjectItem(ditem, "flagged")) {
+            ESP_LOGE(TAG, "Flagged was not found");
+            goto end;
+        }
+        cJSON *flagged = cJSON_GetObjectItem(ditem, "flagged");
+        if (flagged == NULL || !cJSON_IsBool(flagged)) {
+            ESP_LOGE(TAG, "Flagged is not bool");
+            goto end;
+        }
+    }
+    OpenAI_JsonDelete(json);
+    _moderationResponse->parent.getLen = &OpenAI_ModerationResponseGetLen;
+    _moderationResponse->parent.getData = &OpenAI_ModerationResponseGetDate;
+    _moderationResponse->parent.getError = &OpenAI_ModerationResponseGetError;
+    _moderationResponse->parent.delete = &OpenAI_ModerationResponseDelete;
+    return &_moderationResponse->parent;
+end:
+    OpenAI_JsonDelete(json);
+    OpenAI_ModerationResponseDelete(&_moderationResponse->parent);
+    return NULL;
+}
+
+//
+// OpenAI_ImageResponse
+//
+
+typedef struct  {
+    OpenAI_ImageResponse_t parent;
+    uint32_t len;
+    char **data;
+    char *error_str;
+} _OpenAI_ImageResponse_t;
+
+static void OpenAI_ImageResponseDelete(OpenAI_ImageResponse_t *imageResponse)
+{
+    _OpenAI_ImageResponse_t *_imageResponse = __containerof(imageResponse, _OpenAI_ImageResponse_t, parent);
+    if (_imageResponse != NULL) {
+        if (_imageResponse->data) {
+            for (int di = 0; di < _imageResponse->len; di++) {
+                if (_imageResponse->data[di] != NULL) {
+                    free(_imageResponse->data[di]);
+                    _imageResponse->data[di] = NULL;
+                }
+            }
+            free(_imageResponse->data);
+            _imageResponse->data = NULL;
+        }
+
+        if (_imageResponse->error_str != NULL) {
+            free(_imageResponse->error_str);
+            _imageResponse->error_str = NULL;
+        }
+
+        free(_imageResponse);
+        _imageResponse = NULL;
+    }
+}
+
+static uint32_t OpenAI_ImageResponseGetLen(OpenAI_ImageResponse_t *imageResponse)
+{
+    _OpenAI_ImageResponse_t *_imageResponse = __containerof(imageResponse, _OpenAI_ImageResponse_t, parent);
+    return _imageResponse->len;
+}
+
+static char *OpenAI_ImageResponseGetDate(OpenAI_ImageResponse_t *imageResponse, uint32_t index)
+{
+    _OpenAI_ImageResponse_t *_imageResponse = __containerof(imageResponse, _OpenAI_ImageResponse_t, parent);
+    if (index < _imageResponse->len) {
+        return _imageResponse->data[index];
+    }
+    return NULL;
+}
+
+static char *OpenAI_ImageResponseGetError(OpenAI_ImageResponse_t *imageResponse)
+{
+    _OpenAI_ImageResponse_t *_imageResponse = __containerof(imageResponse, _OpenAI_ImageResponse_t, parent);
+    return _imageResponse->error_str;
+}
+
+OpenAI_ImageResponse_t *OpenAI_ImageResponseCreate(const char *payload)
+{
+    cJSON *d;
+    int dl;
+    _OpenAI_ImageResponse_t *_imageResponse = (_OpenAI_ImageResponse_t *)calloc(1, sizeof(_OpenAI_ImageResponse_t));
+    OPENAI_ERROR_CHECK(NULL != _imageResponse, "calloc failed!", NULL);
+    if (payload == NULL) {
+        return &_imageResponse->parent;
+    }
+    // Parse payload
+    cJSON *json = OpenAI_JsonParse(payload);
+
+    // Check for error
+    char *error = getJsonError(json);
+    if (error != NULL) {
+        _imageResponse->error_str = error;
+        ESP_LOGE(TAG, "Error: %s", error);
+        goto end;
+    }
+
+    // Parse data
+    OPENAI_ERROR_CHECK_GOTO(cJSON_HasObjectItem(json, "data"), "Data was not found", end);
+    d = cJSON_GetObjectItem(json, "data");
+    if (d == NULL || !cJSON_IsArray(d)) {
+        ESP_LOGE(TAG, "Data is not array");
+        goto end;
+    }
+    dl = cJSON_GetArraySize(d);
+    OPENAI_ERROR_CHECK_GOTO(dl > 0, "Data is empty", end);
+    _imageResponse->data = (char **)malloc(dl * sizeof(char *));
+    OPENAI_ERROR_CHECK_GOTO(_imageResponse->data != NULL, "Data could not be allocated", end);
+    for (int di = 0; di < dl; di++) {
+        cJSON *item = cJSON_GetArrayItem(d, di);
+        if (item == NULL || !cJSON_IsObject(item) || (!cJSON_HasObjectItem(item, "url") && !cJSON_HasObjectItem(item, "b64_json"))) {
+            ESP_LOGE(TAG, "Image was not found");
+            goto end;
+        }
+        if (cJSON_HasObjectItem(item, "url")) {
+            cJSON *url = cJSON_GetObjectItem(item, "url");
+            if (url == NULL || !cJSON_IsString(url)) {
+                ESP_LOGE(TAG, "Image url could not be read");
+                goto end;
+            }
+            _imageResponse->data[di] = strdup(cJSON_GetStringValue(url));
+            if (_imageResponse->data[di] == NULL) {
+                ESP_LOGE(TAG, "Image url could not be copied");
+                goto end;
+            }
+            _imageResponse->len++;
+        } else if (cJSON_HasObjectItem(item, "b64_json")) {
+            cJSON *b64_json = cJSON_GetObjectItem(item, "b64_json");
+            if (b64_json == NULL || !cJSON_IsString(b64_json)) {
+                ESP_LOGE(TAG, "Image b64_json could not be read");
+                goto end;
+            }
+            _imageResponse->data[di] = strdup(cJSON_GetStringValue(b64_json));
+            if (_imageResponse->data[di] == NULL) {
+                ESP_LOGE(TAG, "Image b64_json could not be copied");
+                goto end;
+            }
+            _imageResponse->len++;
+        }
+    }
+    OpenAI_JsonDelete(json);
+    _imageResponse->parent.getLen = &OpenAI_ImageResponseGetLen;
+    _imageResponse->parent.getData = &OpenAI_ImageResponseGetDate;
+    _imageResponse->parent.getError = &OpenAI_ImageResponseGetError;
+    _imageResponse->parent.delete = &OpenAI_ImageResponseDelete;
+    return &_imageResponse->parent;
+end:
+    OpenAI_JsonDelete(json);
+    OpenAI_ImageResponseDelete(&_imageResponse->parent);
+    return NULL;
+}
+
+//
+// OpenAI_StringResponse
+//
+
+typedef struct {
+    OpenAI_StringResponse_t parent;
+    uint32_t usage;
+    uint32_t len;
+    char **data;
+    char *error_str;
+} _OpenAI_StringResponse_t;
+
+static void OpenAI_StringResponseDelete(OpenAI_StringResponse_t *stringResponse)
+{
+    _OpenAI_StringResponse_t *_stringResponse = __containerof(stringResponse, _OpenAI_StringResponse_t, parent);
+    if (_stringResponse != NULL) {
+        if (_stringResponse->data) {
+            for (int di = 0; di < _stringResponse->len; di++) {
+                if (_stringResponse->data[di] != NULL) {
+                    free(_stringResponse->data[di]);
+                    _stringResponse->data[di] = NULL;
+                }
+            }
+            free(_stringResponse->data);
+            _stringResponse->data = NULL;
+        }
+
+        if (_stringResponse->error_str != NULL) {
+            free(_stringResponse->error_str);
+            _stringResponse->error_str = NULL;
+        }
+
+        free(_stringResponse);
+        _stringResponse = NULL;
+    }
+}
+
+static uint32_t OpenAI_StringResponseGetUsage(OpenAI_StringResponse_t *stringResponse)
+{
+    _OpenAI_StringResponse_t *_stringResponse = __containerof(stringResponse, _OpenAI_StringResponse_t, parent);
+    return _stringResponse->usage;
+}
+
+static uint32_t OpenAI_StringResponseGetLen(OpenAI_StringResponse_t *stringResponse)
+{
+    _OpenAI_StringResponse_t *_stringResponse = __containerof(stringResponse, _OpenAI_StringResponse_t, parent);
+    return _stringResponse->len;
+}
+
+static char *OpenAI_StringResponseGetDate(OpenAI_StringResponse_t *stringResponse, uint32_t index)
+{
+    _OpenAI_StringResponse_t *_stringResponse = __containerof(stringResponse, _OpenAI_StringResponse_t, parent);
+    if (index < _stringResponse->len) {
+        return _stringResponse->data[index];
+    }
+    return NULL;
+}
+
+static char *OpenAI_StringResponseGetError(OpenAI_StringResponse_t *stringResponse)
+{
+    _OpenAI_StringResponse_t *_stringResponse = __containerof(stringResponse, _OpenAI_StringResponse_t, parent);
+    return _stringResponse->error_str;
+}
+
+/**
+ * @brief A response without data, carrying the error returned by the API.
+ *
+ */
+static OpenAI_StringResponse_t *OpenAI_StringResponseCreateError(char *error)
+{
+    _OpenAI_StringResponse_t *_stringResponse = (_OpenAI_StringResponse_t *)calloc(1, sizeof(_OpenAI_StringResponse_t));
+    if (_stringResponse == NULL) {
+        ESP_LOGE(TAG, "calloc failed!");
+        free(error);
+        return NULL;
+    }
+    _stringResponse->error_str = error;
+
+    _stringResponse->parent.getUsage = &OpenAI_StringResponseGetUsage;
+    _stringResponse->parent.getLen = &OpenAI_StringResponseGetLen;
+    _stringResponse->parent.getData = &OpenAI_StringResponseGetDate;
+    _stringResponse->parent.getError = &OpenAI_StringResponseGetError;
+    _stringResponse->parent.delete = &OpenAI_StringResponseDelete;
+    return &_stringResponse->parent;
+}
+
+#if !CONFIG_ENABLE_JSON_SCAN
+static OpenAI_StringResponse_t *OpenAI_StringResponseCreate(char *payload)
+{
+    cJSON *u, *tokens, *d;
+    int dl;
+    _OpenAI_StringResponse_t *_stringResponse = (_OpenAI_StringResponse_t *)calloc(1, sizeof(_OpenAI_StringResponse_t));
+    OPENAI_ERROR_CHECK(NULL != _stringResponse, "calloc failed!", NULL);
+    if (payload == NULL) {
+        return &_stringResponse->parent;
+    }
+
+    // Parse payload
+    cJSON *json = OpenAI_JsonParse(payload);
+    free(payload);
+
+    // Check for error
+    char *error = getJsonError(json);
+    if (error != NULL) {
+        ESP_LOGE(TAG, "Error: %s", error);
+        OpenAI_JsonDelete(json);
+        OpenAI_StringResponseDelete(&_stringResponse->parent);
+        return OpenAI_StringResponseCreateError(error);
+    }
+
+    // Get total_tokens
+    OPENAI_ERROR_CHECK_GOTO(cJSON_HasObjectItem(json, "usage"), "Usage was not found", end);
+    u = cJSON_GetObjectItem(json, "usage");
+    if (u == NULL || !cJSON_IsObject(u) || !cJSON_HasObjectItem(u, "total_tokens")) {
+        ESP_LOGE(TAG, "Total tokens were not found");
+        goto end;
+    }
+    tokens = cJSON_GetObjectItem(u, "total_tokens");
+    OPENAI_ERROR_CHECK_GOTO(tokens != NULL, "Total tokens could not be read", end);
+    _stringResponse->usage = cJSON_GetNumberValue(tokens);
+
+    // Parse data
+    OPENAI_ERROR_CHECK_GOTO(cJSON_HasObjectItem(json, "choices"), "Choices was not found", end);
+    d = cJSON_GetObjectItem(json, "choices");
+    if (d == NULL || !cJSON_IsArray(d)) {
+        ESP_LOGE(TAG, "Choices is not array");
+        goto end;
+    }
+    dl = cJSON_GetArraySize(d);
+    OPENAI_ERROR_CHECK_GOTO(dl > 0, "Choices is empty", end);
+    _stringResponse->data = (char **)malloc(dl * sizeof(char *));
+    OPENAI_ERROR_CHECK_GOTO(_stringResponse->data != NULL, "Data could not be allocated", end);
+
+    for (int di = 0; di < dl; di++) {
+        cJSON *item = cJSON_GetArrayItem(d, di);
+        if (item == NULL || !cJSON_IsObject(item) || (!cJSON_HasObjectItem(item, "text") && !cJSON_HasObjectItem(item, "message"))) {
+            ESP_LOGE(TAG, "Message was not found");
+            goto end;
+        }
+        if (cJSON_HasObjectItem(item, "text")) {
+            cJSON *text = cJSON_GetObjectItem(item, "text");
+            if (text == NULL || !cJSON_IsString(text)) {
+                ESP_LOGE(TAG, "Text could not be read");
+                goto end;
+            }
+            _stringResponse->data[di] = strdup(cJSON_GetStringValue(text));
+            OPENAI_ERROR_CHECK_GOTO(_stringResponse->data[di] != NULL, "Text could not be copied", end);
+            _stringResponse->len++;
+        } else if (cJSON_HasObjectItem(item, "message")) {
+            cJSON *message = cJSON_GetObjectItem(item, "message");
+            if (message == NULL || !cJSON_IsObject(message) || !cJSON_HasObjectItem(message, "content")) {
+                ESP_LOGE(TAG, "Message is not object");
+                goto end;
+            }
+            cJSON *mesg = cJSON_GetObjectItem(message, "content");
+            if (mesg == NULL || !cJSON_IsString(mesg)) {
+                ESP_LOGE(TAG, "Message could not be read");
+                goto end;
+            }
+            _stringResponse->data[di] = strdup(cJSON_GetStringValue(mesg));
+            OPENAI_ERROR_CHECK_GOTO(_stringResponse->data[di] != NULL, "Message could not be copied", end);
+            _stringResponse->len = di + 1;
+        }
+    }
+
+    OpenAI_JsonDelete(json);
+    _stringResponse->parent.getUsage = &OpenAI_StringResponseGetUsage;
+    _stringResponse->parent.getLen = &OpenAI_StringResponseGetLen;
+    _stringResponse->parent.getData = &OpenAI_StringResponseGetDate;
+    _stringResponse->parent.getError = &OpenAI_StringResponseGetError;
+    _stringResponse->parent.delete = &OpenAI_StringResponseDelete;
+    return &_stringResponse->parent;
+end:
+    OpenAI_JsonDelete(json);
+    OpenAI_StringResponseDelete(&_stringResponse->parent);
+    return NULL;
+}
+#endif
+
+static OpenAI_StringResponse_t *OpenAI_StringResponseCreateText(char *text, uint32_t usage)
+{
+    _OpenAI_StringResponse_t *_stringResponse = (_OpenAI_StringResponse_t *)calloc(1, sizeof(_OpenAI_StringResponse_t));
+    OPENAI_ERROR_CHECK_GOTO(NULL != _stringResponse, "calloc failed!", fail);
+    _stringResponse->data = (char **)malloc(sizeof(char *));
+    OPENAI_ERROR_CHECK_GOTO(_stringResponse->data != NULL, "Data could not be allocated", fail);
+    _stringResponse->data[0] = text;
+    _stringResponse->len = 1;
+    _stringResponse->usage = usage;
+
+    _stringResponse->parent.getUsage = &OpenAI_StringResponseGetUsage;
+    _stringResponse->parent.getLen = &OpenAI_StringResponseGetLen;
+    _stringResponse->parent.getData = &OpenAI_StringResponseGetDate;
+    _stringResponse->parent.getError = &OpenAI_StringResponseGetError;
+    _stringResponse->parent.delete = &OpenAI_StringResponseDelete;
+    return &_stringResponse->parent;
+fail:
+    free(_stringResponse);
+    free(text);
+    return NULL;
+}
+
+#if CONFIG_ENABLE_JSON_SCAN
+static const char *const string_response_paths[] = {
+    OPENAI_JSON_SCAN_ERROR_PATHS,
+    "usage.total_tokens",
+    "choices[].text",
+    "choices[].message.content",
+};
+
+typedef struct {
+    OpenAI_JsonScanError_t error;   /*!< Error of the response */
+    OpenAI_Buffer_t *choices;       /*!< Text of every choice, NUL terminated */
+    uint32_t len;                   /*!< Number of choices */
+    uint32_t usage;                 /*!< Total tokens */
+    bool usage_found;               /*!< usage.total_tokens was found */
+} OpenAI_StringResponseScan_t;
+
+static int OpenAI_StringResponseScanValue(void *ctx, const OpenAI_JsonScan_Value_t *value)
+{
+    OpenAI_StringResponseScan_t *result = (OpenAI_StringResponseScan_t *)ctx;
+    if (value->path < 2) {
+        return OpenAI_JsonScanErrorWrite(&result->error, value);
+    }
+    if (value->path == 2) {
+        OPENAI_ERROR_CHECK(value->type == OPENAI_JSON_SCAN_NUMBER, "Total tokens could not be read", -1);
+        result->usage = strtoul(value->data, NULL, 10);
+        result->usage_found = true;
+        return 0;
+    }
+    OPENAI_ERROR_CHECK(value->type == OPENAI_JSON_SCAN_STRING, "Message could not be read", -1);
+    OpenAI_Buffer_t *choice = OpenAI_JsonScanBufferAt(&result->choices, &result->len, value->index);
+    OPENAI_ERROR_CHECK(choice != NULL, "Data could not be allocated", -1);
+    return OpenAI_BufferWrite(choice, (const uint8_t *)value->data, value->end ? value->len + 1 : value->len);
+}
+#endif
+
+/**
+ * @brief POSTs a request answered with choices of text, for completions, chat completions and edits.
+ *        The text is picked out of the response while it arrives with ENABLE_JSON_SCAN.
+ *
+ */
+static OpenAI_StringResponse_t *OpenAI_StringResponseRequest(_OpenAI_t *oai, const char *endpoint, char *jsonBody)
+{
+#if CONFIG_ENABLE_JSON_SCAN
+    OpenAI_StringResponseScan_t result = {0};
+    OpenAI_JsonScan_t scan;
+    OpenAI_JsonScanInit(&scan, string_response_paths, sizeof(string_response_paths) / sizeof(string_response_paths[0]), &OpenAI_StringResponseScanValue, &result);
+    esp_err_t err = oai->scan(oai, endpoint, jsonBody, &scan);
+
+    _OpenAI_StringResponse_t *_stringResponse = NULL;
+    char *error = OpenAI_JsonScanErrorString(&result.error);
+    if (error != NULL) {
+        ESP_LOGE(TAG, "Error: %s", error);
+        OpenAI_JsonScanBuffersFree(result.choices, result.len);
+        return OpenAI_StringResponseCreateError(error);
+    }
+    OPENAI_ERROR_CHECK_GOTO(err == ESP_OK && OpenAI_JsonScanFinish(&scan), "Response could not be parsed", end);
+    OPENAI_ERROR_CHECK_GOTO(result.usage_found, "Usage was not found", end);
+    OPENAI_ERROR_CHECK_GOTO(result.len > 0, "Choices is empty", end);
+
+    _stringResponse = (_OpenAI_StringResponse_t *)calloc(1, sizeof(_OpenAI_StringResponse_t));
+    OPENAI_ERROR_CHECK_GOTO(NULL != _stringResponse, "calloc failed!", end);
+    _stringResponse->data = (char **)malloc(result.len * sizeof(char *));
+    OPENAI_ERROR_CHECK_GOTO(_stringResponse->data != NULL, "Data could not be allocated", end);
+    for (uint32_t di = 0; di < result.len; di++) {
+        OPENAI_ERROR_CHECK_GOTO(result.choices[di].len > 0, "Message was not found", end);
+        _stringResponse->data[di] = OpenAI_JsonScanBufferTake(&result.choices[di]);
+        _stringResponse->len++;
+    }
+    _stringResponse->usage = result.usage;
+    OpenAI_JsonScanBuffersFree(result.choices, result.len);
+
+    _stringResponse->parent.getUsage = &OpenAI_StringResponseGetUsage;
+    _stringResponse->parent.getLen = &OpenAI_StringResponseGetLen;
+    _stringResponse->parent.getData = &OpenAI_StringResponseGetDate;
+    _stringResponse->parent.getError = &OpenAI_StringResponseGetError;
+    _stringResponse->parent.delete = &OpenAI_StringResponseDelete;
+    return &_stringResponse->parent;
+end:
+    OpenAI_JsonScanBuffersFree(result.choices, result.len);
+    if (_stringResponse != NULL) {
+        OpenAI_StringResponseDelete(&_stringResponse->parent);
+    }
+    return NULL;
+#else
+    char *res = oai->post(oai, endpoint, jsonBody);
+    OPENAI_ERROR_CHECK(res != NULL, "Empty result!", NULL);
+    return OpenAI_StringResponseCreate(res);
+#endif
+}
+
+// completions { //Creates a completion for the provided prompt and parameters
+//   "model": "text-davinci-003",//required
+//   "prompt": "<|endoftext|>",//string, array of strings, array of tokens, or array of token arrays.
+//   "max_tokens": 16,//integer. The maximum number of tokens to generate in the completion.
+//   "temperature": 1,//float between 0 and 2
+//   "top_p": 1,//float between 0 and 1. recommended to alter this or temperature but not both.
+//   "n": 1,//integer. How many completions to generate for each prompt.
+//   "stream": false,//boolean. Whether to stream back partial progress. keep false
+//   "logprobs": null,//integer. Include the log probabilities on the logprobs most likely tokens, as well the chosen tokens.
+//   "echo": false,//boolean. Echo back the prompt in addition to the completion
+//   "stop": null,//string or array. Up to 4 sequences where the API will stop generating further tokens.
+//   "presence_penalty": 0,//float between -2.0 and 2.0. Positive values penalize new tokens based on whether they appear in the text so far, increasing the model's likelihood to talk about new topics.
+//   "frequency_penalty": 0,//float between -2.0 and 2.0. Positive values penalize new tokens based on their existing frequency in the text so far, decreasing the model's likelihood to repeat the same line verbatim.
+//   "best_of": 1,//integer. Generates best_of completions server-side and returns the "best". best_of must be greater than n
+//   "logit_bias": null,//map. Modify the likelihood of specified tokens appearing in the completion.
+//   "user": null//string. A unique identifier representing your end-user, which can help OpenAI to monitor and detect abuse.
+// }
+
+/**
+ * @brief Given a prompt, the model will return one or more predicted completions,
+ * and can also return the probabilities of alternative tokens at each position.
+ *
+ */
+typedef struct {
+    OpenAI_Completion_t parent; /*!< Parent object */
+    _OpenAI_t *oai;             /*!< Pointer to the OpenAI object */
+    char *model;                /*!< ID of the model to use. */
+    uint32_t max_tokens;        /*!< The maximum number of tokens to generate in the completion. */
+    float temperature;          /*!< float between 0 and 2. Higher value gives more random results. */
+    float top_p;                /*!< An alternative to sampling with temperature, called nucleus sampling, where the model considers the results of the tokens with top_p probability mass. So 0.1 means only the tokens comprising the top 10% probability mass are considered. */
+    uint32_t n;                 /*!< How many completions to generate for each prompt. */
+    bool echo;                  /*!< Echo back the prompt in addition to the completion */
+    char *stop;                 /*!< Up to 4 sequences where the API will stop generating further tokens. The returned text will not contain the stop sequence. */
+    float presence_penalty;     /*!< Number between -2.0 and 2.0. Positive values penalize new tokens based on whether they appear in the text so far, increasing the model's likelihood to talk about new topics. */
+    float frequency_penalty;    /*!< Number between -2.0 and 2.0. Positive values penalize new tokens based on their existing frequency in the text so far, decreasing the model's likelihood to repeat the same line verbatim. */
+    uint32_t best_of;           /*!< Generates best_of completions server-side and returns the "best" (the one with the highest log probability per token). Results cannot be streamed.
+                                     When used with n, best_of controls the number of candidate completions and n specifies how many to return – best_of must be greater than n.*/
+    char *user;                 /*!< A unique identifier representing your end-user, which can help OpenAI to monitor and detect abuse. */
+} _OpenAI_Completion_t;
+
+static void OpenAI_CompletionDelete(OpenAI_Completion_t *completion)
+{
+    _OpenAI_Completion_t *_completion = __containerof(completion, _OpenAI_Completion_t, parent);
+    if (_completion != NULL) {
+        if (_completion->model != NULL) {
+            free(_completion->model);
+            _completion->model = NULL;
+        }
+
+        if (_completion->stop != NULL) {
+            free(_completion->stop);
+            _completion->stop = NULL;
+        }
+
+        if (_completion->user != NULL) {
+            free(_completion->user);
+            _completion->user = NULL;
+        }
+
+        free(_completion);
+        _completion = NULL;
+    }
+}
+
+static void OpenAI_CompletionSetModel(OpenAI_Completion_t *completion, const char *m)
+{
+    _OpenAI_Completion_t *_completion = __containerof(completion, _OpenAI_Completion_t, parent);
+    if (_completion->model != NULL) {
+        free(_completion->model);
+        _completion->model = NULL;
+    }
+    _completion->model = strdup(m);
+}
+
+static void OpenAI_CompletionSetMaxTokens(OpenAI_Completion_t *completion, uint32_t mt)
+{
+    _OpenAI_Completion_t *_completion = __containerof(completion, _OpenAI_Completion_t, parent);
+    if (mt > 0) {
+        _completion->max_tokens = mt;
+    }
+}
+
+static void OpenAI_CompletionSetTemperature(OpenAI_Completion_t *completion, float t)
+{
+    _OpenAI_Completion_t *_completion = __containerof(completion, _OpenAI_Completion_t, parent);
+    if (t >= 0 && t <= 2.0) {
+        _completion->temperature = t;
+    }
+}
+
+static void OpenAI_CompletionSetTopP(OpenAI_Completion_t *completion, float tp)
+{
+    _OpenAI_Completion_t *_completion = __containerof(completion, _OpenAI_Completion_t, parent);
+    if (tp >= 0 && tp <= 1.0) {
+        _completion->top_p = tp;
+    }
+}
+
+static void OpenAI_CompletionSetN(OpenAI_Completion_t *completion, uint32_t n)
+{
+    _OpenAI_Completion_t *_completion = __containerof(completion, _OpenAI_Completion_t, parent);
+    if (n > 0) {
+        _completion->n = n;
+    }
+}
+
+static void OpenAI_CompletionSetEcho(OpenAI_Completion_t *completion, bool e)
+{
+    _OpenAI_Completion_t *_completion = __containerof(completion, _OpenAI_Completion_t, parent);
+    _completion->echo = e;
+}
+
+static void OpenAI_CompletionSetStop(OpenAI_Completion_t *completion, const char *s)
+{
+    _OpenAI_Completion_t *_completion = __containerof(completion, _OpenAI_Completion_t, parent);
+    if (_completion->stop != NULL) {
+        free(_completion->stop);
+        _completion->stop = NULL;
+    }
+    _completion->stop = strdup(s);
+}
+
+static void OpenAI_CompletionSetPresencePenalty(OpenAI_Completion_t *completion, float pp)
+{
+    _OpenAI_Completion_t *_completion = __containerof(completion, _OpenAI_Completion_t, parent);
+    if (pp >= -2.0 && pp <= 2.0) {
+        _completion->presence_penalty = pp;
+    }
+}
+
+static void OpenAI_CompletionSetFrequencyPenalty(OpenAI_Completion_t *completion, float fp)
+{
+    _OpenAI_Completion_t *_completion = __containerof(completion, _OpenAI_Completion_t, parent);
+    if (fp >= -2.0 && fp <= 2.0) {
+        _completion->frequency_penalty = fp;
+    }
+}
+
+static void OpenAI_CompletionSetBestOf(OpenAI_Completion_t *completion, uint32_t bo)
+{
+    _OpenAI_Completion_t *_completion = __containerof(completion, _OpenAI_Completion_t, parent);
+    if (bo > 0) {
+        _completion->best_of = bo;
+    }
+}
+
+static void OpenAI_CompletionSetUser(OpenAI_Completion_t *completion, const char *u)
+{
+    _OpenAI_Completion_t *_completion = __containerof(completion, _OpenAI_Completion_t, parent);
+    if (_completion->user != NULL) {
+        free(_completion->user);
+        _completion->user = NULL;
+    }
+    _completion->user = strdup(u);
+}
+
+static OpenAI_StringResponse_t *OpenAI_CompletionPrompt(OpenAI_Completion_t *completion, char *p)
+{
+    _OpenAI_Completion_t *_completion = __containerof(completion, _OpenAI_Completion_t, parent);
+    const char *endpoint = "completions";
+    OpenAI_StringResponse_t *result = NULL;
+    cJSON *req = OpenAI_JsonCreateObject();
+    OPENAI_ERROR_CHECK(req != NULL, "cJSON_CreateObject failed!", NULL);
+    reqAddString("model", (_completion->model == NULL) ? "text-davinci-003" : _completion->model);
+    if (strncmp(p, "[", 1) == 0) {
+        cJSON *in = cJSON_Parse(p);
+        if (in == NULL || !cJSON_IsArray(in)) {
+            ESP_LOGE(TAG, "Input not JSON Array!");
+            cJSON_Delete(in);
+            OpenAI_JsonDelete(req);
+            return NULL;
+        }
+        reqAddItem("prompt", in);
+    } else {
+        reqAddString("prompt", p);
+    }
+    if (_completion->max_tokens) {
+        reqAddNumber("max_tokens", _completion->max_tokens);
+    }
+    if (_completion->temperature != 1) {
+        reqAddNumber("temperature", _completion->temperature);
+    }
+    if (_completion->top_p != 1) {
+        reqAddNumber("top_p", _completion->top_p);
+    }
+    if (_completion->n != 1) {
+        reqAddNumber("n", _completion->n);
+    }
+    if (_completion->echo) {
+        reqAddBool("echo", true);
+    }
+    if (_completion->stop != NULL) {
+        reqAddString("stop", _completion->stop);
+    }
+    if (_completion->presence_penalty != 0) {
+        reqAddNumber("presence_penalty", _completion->presence_penalty);
+    }
+    if (_completion->frequency_penalty != 0) {
+        reqAddNumber("frequency_penalty", _completion->frequency_penalty);
+    }
+    if (_completion->best_of != 1) {
+        reqAddNumber("best_of", _completion->best_of);
+    }
+    if (_completion->user != NULL) {
+        reqAddString("user", _completion->user);
+    }
+    char *jsonBody = OpenAI_JsonPrint(req, strlen(p));
+    OpenAI_JsonDelete(req);
+    OPENAI_ERROR_CHECK(jsonBody != NULL, "Request could not be serialized", NULL);
+    result = OpenAI_StringResponseRequest(_completion->oai, endpoint, jsonBody);
+    free(jsonBody);
+    return result;
+}
+
+static OpenAI_Completion_t *OpenAI_CompletionCreate(OpenAI_t *openai)
+{
+    _OpenAI_Completion_t *_completion = (_OpenAI_Completion_t *)calloc(1, sizeof(_OpenAI_Completion_t));
+    OPENAI_ERROR_CHECK(_completion != NULL, "Completion could not be allocated", NULL);
+    _completion->oai = __containerof(openai, _OpenAI_t, parent);
+    _completion->max_tokens = 1;
+    _completion->top_p = 1;
+    _completion->n = 1;
+    _completion->best_of = 1;
+
+    _completion->parent.setModel = &OpenAI_CompletionSetModel;
+    _completion->parent.setMaxTokens = &OpenAI_CompletionSetMaxTokens;
+    _completion->parent.setTemperature = &OpenAI_CompletionSetTemperature;
+    _completion->parent.setTopP = &OpenAI_CompletionSetTopP;
+    _completion->parent.setN = &OpenAI_CompletionSetN;
+    _completion->parent.setEcho = &OpenAI_CompletionSetEcho;
+    _completion->parent.setStop = &OpenAI_CompletionSetStop;
+    _completion->parent.setPresencePenalty = &OpenAI_CompletionSetPresencePenalty;
+    _completion->parent.setFrequencyPenalty = &OpenAI_CompletionSetFrequencyPenalty;
+    _completion->parent.setBestOf = &OpenAI_CompletionSetBestOf;
+    _completion->parent.setUser = &OpenAI_CompletionSetUser;
+    _completion->parent.prompt = &OpenAI_CompletionPrompt;
+    return &_completion->parent;
+}
+
+//
+// Server-sent events of streamed chat completions
+//
+
+#define OPENAI_SSE_MAX_LINE 8192
+
+/**
+ * @brief Incremental parser of a streamed chat completion. The response is split into lines,
+ *        every "data:" line holds one JSON chunk whose delta is passed on and collected.
+ *
+ */
+typedef struct {
+    char *line;                 /*!< The line received so far */
+    size_t line_len;            /*!< Length of line */
+    size_t line_cap;            /*!< Allocated length of line */
+    OpenAI_Buffer_t content;    /*!< All deltas received so far */
+    OpenAI_Buffer_t body;       /*!< A response that is a JSON document instead of events, such as an error */
+    uint32_t usage;             /*!< Total tokens, sent with the last chunk */
+    char *error;                /*!< Error sent instead of a chunk, or in the body */
+    bool started;               /*!< The response started as an event stream */
+    bool done;                  /*!< Set by "data: [DONE]" */
+    OpenAI_Delta_Cb delta;      /*!< Callback receiving every delta */
+    void *ctx;                  /*!< User context of delta */
+} OpenAI_SSE_t;
+
+static int OpenAI_SSEEvent(OpenAI_SSE_t *sse, const char *data)
+{
+    if (strcmp(data, "[DONE]") == 0) {
+        sse->done = true;
+        return 0;
+    }
+    cJSON *json = OpenAI_JsonParse(data);
+    OPENAI_ERROR_CHECK(json != NULL, "Stream chunk is not JSON!", -1);
+    int ret = 0;
+    char *error = getJsonError(json);
+    if (error != NULL) {
+        ESP_LOGE(TAG, "Error: %s", error);
+        free(sse->error);
+        sse->error = error;
+        ret = -1;
+        goto end;
+    }
+    cJSON *usage = cJSON_GetObjectItem(json, "usage");
+    if (cJSON_IsObject(usage) && cJSON_IsNumber(cJSON_GetObjectItem(usage, "total_tokens"))) {
+        sse->usage = cJSON_GetNumberValue(cJSON_GetObjectItem(usage, "total_tokens"));
+    }
+    // Only the first choice is streamed, like message() only saves the first response
+    cJSON *choice = cJSON_GetArrayItem(cJSON_GetObjectItem(json, "choices"), 0);
+    cJSON *content = cJSON_GetObjectItem(cJSON_GetObjectItem(choice, "delta"), "content");
+    const char *text = cJSON_GetStringValue(content);
+    size_t start = sse->content.len;
+    if (text != NULL && *text != '\0') {
+        // Copied with its NUL, which the next delta overwrites
+        ret = OpenAI_BufferWrite(&sse->content, (const uint8_t *)text, strlen(text) + 1);
+    }
+end:
+    // The chunk lives in the arena, which the callback must not see: whatever cJSON
+    // allocates in there is gone once the chunk is deleted
+    OpenAI_JsonDelete(json);
+    if (ret < 0 || sse->content.len == start) {
+        return ret;
+    }
+    sse->content.len--;
+    if (sse->delta != NULL && sse->delta(sse->ctx, sse->content.data + start) < 0) {
+        ESP_LOGW(TAG, "Stream aborted by the delta callback");
+        return -1;
+    }
+    return 0;
+}
+
+static int OpenAI_SSEWrite(void *ctx, const uint8_t *data, size_t len)
+{
+    OpenAI_SSE_t *sse = (OpenAI_SSE_t *)ctx;
+    // Error responses of the API are JSON, they are collected and parsed once they ended
+    if (sse->body.len > 0 || (!sse->started && len > 0 && data[0] == '{')) {
+        OPENAI_ERROR_CHECK(sse->body.len + len <= OPENAI_SSE_MAX_LINE, "Response too long!", -1);
+        return OpenAI_BufferWrite(&sse->body, data, len);
+    }
+    sse->started = sse->started || len > 0;
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] != '\n') {
+            if (sse->line_len + 1 >= sse->line_cap) {
+                size_t cap = sse->line_cap ? sse->line_cap * 2 : 256;
+                OPENAI_ERROR_CHECK(cap <= OPENAI_SSE_MAX_LINE, "Stream line too long!", -1);
+                char *line = (char *)realloc(sse->line, cap);
+                OPENAI_ERROR_CHECK(line != NULL, "Failed to grow stream line!", -1);
+                sse->line = line;
+                sse->line_cap = cap;
+            }
+            sse->line[sse->line_len++] = data[i];
+            continue;
+        }
+        if (sse->line_len == 0) {
+            continue;
+        }
+        if (sse->line[sse->line_len - 1] == '\r') {
+            sse->line_len--;
+        }
+        sse->line[sse->line_len] = '\0';
+        sse->line_len = 0;
+        // Comments, event names and ids carry nothing for chat completions
+        if (strncmp(sse->line, "data:", 5) != 0 || sse->done) {
+            continue;
+        }
+        const char *event = sse->line + 5;
+        if (*event == ' ') {
+            event++;
+        }
+        if (OpenAI_SSEEvent(sse, event) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// chat/completions { //Given a chat conversation, the model will return a chat completion response.
+//   "model": "gpt-3.5-turbo",//required
+//   "messages": [//required array
+//     {"role": "system", "content": "Description of the required assistant"},
+//     {"role": "user", "content": "First question from the user"},
+//     {"role": "assistant", "content": "Response from the assistant"},
+//     {"role": "user", "content": "Next question from the user to be answered"}
+//   ],
+//   "temperature": 1,//float between 0 and 2
+//   "top_p": 1,//float between 0 and 1. recommended to alter this or temperature but not both.
+//   "stream": false,//boolean. Whether to stream back partial progress as server-sent events. true for messageStream
+//   "stop": null,//string or array. Up to 4 sequences where the API will stop generating further tokens.
+//   "max_tokens": 16,//integer. The maximum number of tokens to generate in the completion.
+//   "presence_penalty": 0,//float between -2.0 and 2.0. Positive values penalize new tokens based on whether they appear in the text so far, increasing the model's likelihood to talk about new topics.
+//   "frequency_penalty": 0,//float between -2.0 and 2.0. Positive values penalize new tokens based on their existing frequency in the text so far, decreasing the model's likelihood to repeat the same line verbatim.
+//   "logit_bias": null,//map. Modify the likelihood of specified tokens appearing in the completion.
+//   "user": null//string. A unique identifier representing your end-user, which can help OpenAI to monitor and detect abuse.
+// }
+
+typedef struct {
+    OpenAI_ChatCompletion_t parent; /*!< Parent object */
+    _OpenAI_t *oai;                 /*!< Pointer to the OpenAI object */
+    cJSON *messages;                /*!< Array of messages */
+    char *model;                    /*!< ID of the model to use. */
+    char *description;              /*!< The description of what the function does.. */
+    uint32_t max_tokens;            /*!< The maximum number of tokens to generate in the chat completion. */
+    float temperature;              /*!< float between 0 and 2. Higher value gives more random results. */
+    float top_p;                    /*!< An alternative to sampling with temperature, called nucleus sampling,
+                                         where the model considers the results of the tokens with top_p probability mass.
+                                         So 0.1 means only the tokens comprising the top 10% probability mass are considered. */
+    char *stop;                     /*!< Up to 4 sequences where the API will stop generating further tokens. */
+    float presence_penalty;         /*!< Number between -2.0 and 2.0. Positive values penalize new tokens based on whether they
+                                         appear in the text so far, increasing the model's likelihood to talk about new topics. */
+    float frequency_penalty;        /*!< Number between -2.0 and 2.0. Positive values penalize new tokens based on their existing
+                                         frequency in the text so far, decreasing the model's likelihood to repeat the same line verbatim. */
+    char *user;                     /*!< A unique identifier representing your end-user, which can help OpenAI to monitor and detect abuse. */
+    uint32_t max_history_tokens;    /*!< Token budget of the saved conversation, the oldest turns are dropped beyond it. 0 means unlimited. */
+    uint32_t history_tokens;        /*!< Estimated number of tokens of the saved conversation. */
+    char *history_prefix;           /*!< Cached serialized system message and saved conversation, rebuilt after either changes. */
+    SemaphoreHandle_t lock;         /*!< Protects the settings and the conversation, requests of a worker task and of the caller
+                                         build their bodies and save their answers under it */
+} _OpenAI_ChatCompletion_t;
+
+// Roughly 4 characters per token plus the per-message overhead of the chat format
+#define CHAT_MESSAGE_OVERHEAD_TOKENS 4
+
+static uint32_t estimateChatTokens(const char *content)
+{
+    return (strlen(content) + 3) / 4 + CHAT_MESSAGE_OVERHEAD_TOKENS;
+}
+
+static void OpenAI_ChatCompletionInvalidatePrefix(_OpenAI_ChatCompletion_t *_chatCompletion)
+{
+    if (_chatCompletion->history_prefix != NULL) {
+        cJSON_free(_chatCompletion->history_prefix);
+        _chatCompletion->history_prefix = NULL;
+    }
+}
+
+static void OpenAI_ChatCompletionDelete(OpenAI_ChatCompletion_t *chatCompletion)
+{
+    _OpenAI_ChatCompletion_t *_chatCompletion = __containerof(chatCompletion, _OpenAI_ChatCompletion_t, parent);
+    if (_chatCompletion != NULL) {
+        if (_chatCompletion->model != NULL) {
+            free(_chatCompletion->model);
+            _chatCompletion->model = NULL;
+        }
+        if (_chatCompletion->description != NULL) {
+            free(_chatCompletion->description);
+            _chatCompletion->description = NULL;
+        }
+        if (_chatCompletion->stop != NULL) {
+            free(_chatCompletion->stop);
+            _chatCompletion->stop = NULL;
+        }
+        if (_chatCompletion->user != NULL) {
+            free(_chatCompletion->user);
+            _chatCompletion->user = NULL;
+        }
+        if (_chatCompletion->messages != NULL) {
+            cJSON_Delete(_chatCompletion->messages);
+            _chatCompletion->messages = NULL;
+        }
+        OpenAI_ChatCompletionInvalidatePrefix(_chatCompletion);
+        if (_chatCompletion->lock != NULL) {
+            vSemaphoreDelete(_chatCompletion->lock);
+            _chatCompletion->lock = NULL;
+        }
+        free(_chatCompletion);
+        _chatCompletion = NULL;
+    }
+}
+
+static void OpenAI_ChatCompletionSetModel(OpenAI_ChatCompletion_t *chatCompletion, const char *m)
+{
+    _OpenAI_ChatCompletion_t *_chatCompletion = __containerof(chatCompletion, _OpenAI_ChatCompletion_t, parent);
+    xSemaphoreTake(_chatCompletion->lock, portMAX_DELAY);
+    if (_chatCompletion->model != NULL) {
+        free(_chatCompletion->model);
+    }
+    _chatCompletion->model = strdup(m);
+    xSemaphoreGive(_chatCompletion->lock);
+}
+
+static void OpenAI_ChatCompletionSetSystem(OpenAI_ChatCompletion_t *chatCompletion, const char *s)
+{
+    _OpenAI_ChatCompletion_t *_chatCompletion = __containerof(chatCompletion, _OpenAI_ChatCompletion_t, parent);
+    xSemaphoreTake(_chatCompletion->lock, portMAX_DELAY);
+    if (_chatCompletion->description != NULL) {
+        free(_chatCompletion->description);
+    }
+    _chatCompletion->description = strdup(s);
+    OpenAI_ChatCompletionInvalidatePrefix(_chatCompletion);
+    xSemaphoreGive(_chatCompletion->lock);
+}
+
+static void OpenAI_ChatCompletionSetMaxTokens(OpenAI_ChatCompletion_t *chatCompletion, uint32_t mt)
+{
+    _OpenAI_ChatCompletion_t *_chatCompletion = __containerof(chatCompletion, _OpenAI_ChatCompletion_t, parent);
+    if (mt > 0) {
+        _chatCompletion->max_tokens = mt;
+    }
+}
+
+static void OpenAI_ChatCompletionSetTemperature(OpenAI_ChatCompletion_t *chatCompletion, float t)
+{
+    _OpenAI_ChatCompletion_t *_chatCompletion = __containerof(chatCompletion, _OpenAI_ChatCompletion_t, parent);
+    if (t >= 0 && t <= 2.0) {
+        _chatCompletion->temperature = t;
+    }
+}
+
+static void OpenAI_ChatCompletionSetTopP(OpenAI_ChatCompletion_t *chatCompletion, float tp)
+{
+    _OpenAI_ChatCompletion_t *_chatCompletion = __containerof(chatCompletion, _OpenAI_ChatCompletion_t, parent);
+    if (tp >= 0 && tp <= 1.0) {
+        _chatCompletion->top_p = tp;
+    }
+}
+
+static void OpenAI_ChatCompletionSetStop(OpenAI_ChatCompletion_t *chatCompletion, const char *s)
+{
+    _OpenAI_ChatCompletion_t *_chatCompletion = __containerof(chatCompletion, _OpenAI_ChatCompletion_t, parent);
+    xSemaphoreTake(_chatCompletion->lock, portMAX_DELAY);
+    if (_chatCompletion->stop != NULL) {
+        free(_chatCompletion->stop);
+    }
+    _chatCompletion->stop = strdup(s);
+    xSemaphoreGive(_chatCompletion->lock);
+}
+
+static void OpenAI_ChatCompletionSetPresencePenalty(OpenAI_ChatCompletion_t *chatCompletion, float pp)
+{
+    _OpenAI_ChatCompletion_t *_chatCompletion = __containerof(chatCompletion, _OpenAI_ChatCompletion_t, parent);
+    if (pp >= -2.0 && pp <= 2.0) {
+        _chatCompletion->presence_penalty = pp;
+    }
+}
+
+static void OpenAI_ChatCompletionSetFrequencyPenalty(OpenAI_ChatCompletion_t *chatCompletion, float fp)
+{
+    _OpenAI_ChatCompletion_t *_chatCompletion = __containerof(chatCompletion, _OpenAI_ChatCompletion_t, parent);
+    if (fp >= -2.0 && fp <= 2.0) {
+        _chatCompletion->frequency_penalty = fp;
+    }
+}
+
+static void OpenAI_ChatCompletionSetUser(OpenAI_ChatCompletion_t *chatCompletion, const char *u)
+{
+    _OpenAI_ChatCompletion_t *_chatCompletion = __containerof(chatCompletion, _OpenAI_ChatCompletion_t, parent);
+    xSemaphoreTake(_chatCompletion->lock, portMAX_DELAY);
+    if (_chatCompletion->user != NULL) {
+        free(_chatCompletion->user);
+    }
+    _chatCompletion->user = strdup(u);
+    xSemaphoreGive(_chatCompletion->lock);
+}
+
+static void OpenAI_ChatCompletionClearConversation(OpenAI_ChatCompletion_t *chatCompletion)
+{
+    _OpenAI_ChatCompletion_t *_chatCompletion = __containerof(chatCompletion, _OpenAI_ChatCompletion_t, parent);
+    xSemaphoreTake(_chatCompletion->lock, portMAX_DELAY);
+    if (_chatCompletion->messages != NULL) {
+        cJSON_Delete(_chatCompletion->messages);
+        _chatCompletion->messages = cJSON_CreateArray();
+    }
+    _chatCompletion->history_tokens = 0;
+    OpenAI_ChatCompletionInvalidatePrefix(_chatCompletion);
+    xSemaphoreGive(_chatCompletion->lock);
+}
+
+static void OpenAI_ChatCompletionTrimHistory(_OpenAI_ChatCompletion_t *_chatCompletion)
+{
+    if (_chatCompletion->max_history_tokens == 0 || _chatCompletion->messages == NULL) {
+        return;
+    }
+    // Drop the oldest user/assistant turns until the conversation fits the budget, a whole turn at a time
+    // so that the conversation never starts with an answer to a question it no longer has
+    while (_chatCompletion->history_tokens > _chatCompletion->max_history_tokens && cJSON_GetArraySize(_chatCompletion->messages) > 0) {
+        cJSON *item = cJSON_GetArrayItem(_chatCompletion->messages, 0);
+        const char *role = NULL;
+        do {
+            const char *content = cJSON_GetStringValue(cJSON_GetObjectItem(item, "content"));
+            uint32_t tokens = content ? estimateChatTokens(content) : CHAT_MESSAGE_OVERHEAD_TOKENS;
+            _chatCompletion->history_tokens -= (tokens < _chatCompletion->history_tokens) ? tokens : _chatCompletion->history_tokens;
+            cJSON_DeleteItemFromArray(_chatCompletion->messages, 0);
+            item = cJSON_GetArrayItem(_chatCompletion->messages, 0);
+            role = cJSON_GetStringValue(cJSON_GetObjectItem(item, "role"));
+        } while (item != NULL && (role == NULL || strcmp(role, "user") != 0));
+    }
+    OpenAI_ChatCompletionInvalidatePrefix(_chatCompletion);
+}
+
+static void OpenAI_ChatCompletionSetMaxHistoryTokens(OpenAI_ChatCompletion_t *chatCompletion, uint32_t mt)
+{
+    _OpenAI_ChatCompletion_t *_chatCompletion = __containerof(chatCompletion, _OpenAI_ChatCompletion_t, parent);
+    xSemaphoreTake(_chatCompletion->lock, portMAX_DELAY);
+    _chatCompletion->max_history_tokens = mt;
+    OpenAI_ChatCompletionTrimHistory(_chatCompletion);
+    xSemaphoreGive(_chatCompletion->lock);
+}
+
+static cJSON *createChatMessage(cJSON *messages, const char *role, const char *content)
+{
+    cJSON *message = cJSON_CreateObject();
+    OPENAI_ERROR_CHECK(message != NULL, "cJSON_CreateObject failed!", NULL);
+    if (cJSON_AddStringToObject(message, "role", role) == NULL) {
+        cJSON_Delete(message);
+        ESP_LOGE(TAG, "cJSON_AddStringToObject failed!");
+        return NULL;
+    }
+    if (cJSON_AddStringToObject(message, "content", content) == NULL) {
+        cJSON_Delete(message);
+        ESP_LOGE(TAG, "cJSON_AddStringToObject failed!");
+        return NULL;
+    }
+    if (!cJSON_AddItemToArray(messages, message)) {
+        cJSON_Delete(message);
+        ESP_LOGE(TAG, "cJSON_AddItemToArray failed!");
+        return NULL;
+    }
+    return message;
+}
+
+/**
+ * @brief Serialized messages sent ahead of every prompt (system message and saved
+ *        conversation) without the enclosing brackets. Cached until either changes.
+ */
+static const char *OpenAI_ChatCompletionGetPrefix(_OpenAI_ChatCompletion_t *_chatCompletion)
+{
+    if (_chatCompletion->history_prefix != NULL) {
+        return _chatCompletion->history_prefix;
+    }
+
+    cJSON *prefix = cJSON_CreateArray();
+    OPENAI_ERROR_CHECK(prefix != NULL, "cJSON_CreateArray failed!", NULL);
+    if (_chatCompletion->description != NULL) {
+        OPENAI_ERROR_CHECK_GOTO(createChatMessage(prefix, "system", _chatCompletion->description) != NULL, "createChatMessage failed!", end);
+    }
+    if (_chatCompletion->messages != NULL && cJSON_IsArray(_chatCompletion->messages)) {
+        cJSON *item = NULL;
+        cJSON_ArrayForEach(item, _chatCompletion->messages) {
+            if (cJSON_IsObject(item)) {
+                OPENAI_ERROR_CHECK_GOTO(cJSON_AddItemReferenceToArray(prefix, item), "cJSON_AddItemReferenceToArray failed!", end);
+            }
+        }
+    }
+
+    char *json = cJSON_PrintUnformatted(prefix);
+    OPENAI_ERROR_CHECK_GOTO(json != NULL, "cJSON_PrintUnformatted failed!", end);
+    size_t len = strlen(json);
+    memmove(json, json + 1, len - 2);
+    json[len - 2] = '\0';
+    _chatCompletion->history_prefix = json;
+end:
+    cJSON_Delete(prefix);
+    return _chatCompletion->history_prefix;
+}
+
+static char *OpenAI_ChatCompletionBody(_OpenAI_ChatCompletion_t *_chatCompletion, const char *p, bool stream)
+{
+    char *result = NULL;
+    const char *prefix = OpenAI_ChatCompletionGetPrefix(_chatCompletion);
+    OPENAI_ERROR_CHECK(prefix != NULL, "Conversation could not be serialized", result);
+
+    cJSON *req = OpenAI_JsonCreateObject();
+    OPENAI_ERROR_CHECK(req != NULL, "cJSON_CreateObject failed!", result);
+    reqAddString("model", (_chatCompletion->model == NULL) ? "gpt-3.5-turbo" : _chatCompletion->model);
+    if (_chatCompletion->max_tokens) {
+        reqAddNumber("max_tokens", _chatCompletion->max_tokens);
+    }
+    if (_chatCompletion->temperature != 1) {
+        reqAddNumber("temperature", _chatCompletion->temperature);
+    }
+    if (_chatCompletion->top_p != 1) {
+        reqAddNumber("top_p", _chatCompletion->top_p);
+    }
+    if (_chatCompletion->stop != NULL) {
+        reqAddString("stop", _chatCompletion->stop);
+    }
+    if (_chatCompletion->presence_penalty != 0) {
+        reqAddNumber("presence_penalty", _chatCompletion->presence_penalty);
+    }
+    if (_chatCompletion->frequency_penalty != 0) {
+        reqAddNumber("frequency_penalty", _chatCompletion->frequency_penalty);
+    }
+    if (_chatCompletion->user != NULL) {
+        reqAddString("user", _chatCompletion->user);
+    }
+    if (stream) {
+        reqAddBool("stream", true);
+        // Ask for the token usage, it comes with one more chunk at the end
+        cJSON *options = cJSON_CreateObject();
+        OPENAI_ERROR_CHECK_GOTO(options != NULL && cJSON_AddBoolToObject(options, "include_usage", true) != NULL, "cJSON_AddBoolToObject failed!", fail);
+        reqAddItem("stream_options", options);
+    }
+
+    // The new user message is serialized on its own and spliced after the cached
+    // prefix, so the saved conversation is not rebuilt and printed on every call.
+    // Both are printed into the arena, only the spliced body is allocated from the heap.
+    char *params = cJSON_PrintUnformatted(req);
+    cJSON *message = cJSON_CreateString(p);
+    char *content = (message != NULL) ? cJSON_PrintUnformatted(message) : NULL;
+    if (params != NULL && content != NULL) {
+        asprintf(&result, "{\"messages\":[%s%s{\"role\":\"user\",\"content\":%s}],%s",
+                 prefix, (*prefix != '\0') ? "," : "", content, params + 1);
+    }
+    cJSON_free(params);
+    cJSON_free(content);
+    cJSON_Delete(message);
+    OpenAI_JsonDelete(req);
+    return result;
+fail:
+    OpenAI_JsonDelete(req);
+    return NULL;
+}
+
+/**
+ * @brief Append a question and its answer to the conversation. Requests still running were sent without them.
+ */
+static void OpenAI_ChatCompletionSave(_OpenAI_ChatCompletion_t *_chatCompletion, const char *p, const char *answer)
+{
+    xSemaphoreTake(_chatCompletion->lock, portMAX_DELAY);
+    if (createChatMessage(_chatCompletion->messages, "user", p) == NULL) {
+        ESP_LOGE(TAG, "createChatMessage failed!");
+    }
+    if (createChatMessage(_chatCompletion->messages, "assistant", answer) == NULL) {
+        ESP_LOGE(TAG, "createChatMessage failed!");
+    }
+    _chatCompletion->history_tokens += estimateChatTokens(p) + estimateChatTokens(answer);
+    OpenAI_ChatCompletionInvalidatePrefix(_chatCompletion);
+    OpenAI_ChatCompletionTrimHistory(_chatCompletion);
+    xSemaphoreGive(_chatCompletion->lock);
+}
+
+OpenAI_StringResponse_t *OpenAI_ChatCompletionMessage(OpenAI_ChatCompletion_t *chatCompletion, const char *p, bool save)
+{
+    const char *endpoint = "chat/completions";
+    OpenAI_StringResponse_t *result = NULL;
+
+    _OpenAI_ChatCompletion_t *_chatCompletion = __containerof(chatCompletion, _OpenAI_ChatCompletion_t, parent);
+    xSemaphoreTake(_chatCompletion->lock, portMAX_DELAY);
+    char *jsonBody = OpenAI_ChatCompletionBody(_chatCompletion, p, false);
+    xSemaphoreGive(_chatCompletion->lock);
+    OPENAI_ERROR_CHECK(jsonBody != NULL, "Request could not be serialized", result);
+
+    result = OpenAI_StringResponseRequest(_chatCompletion->oai, endpoint, jsonBody);
+    free(jsonBody);
+    if (save && result != NULL && result->getLen(result)) {
+        OpenAI_ChatCompletionSave(_chatCompletion, p, result->getData(result, 0));
+    }
+    return result;
+}
+
+static OpenAI_StringResponse_t *OpenAI_ChatCompletionMessageStream(OpenAI_ChatCompletion_t *chatCompletion, const char *p, bool save, OpenAI_Delta_Cb delta, void *ctx)
+{
+    const char *endpoint = "chat/completions";
+    OpenAI_StringResponse_t *result = NULL;
+
+    _OpenAI_ChatCompletion_t *_chatCompletion = __containerof(chatCompletion, _OpenAI_ChatCompletion_t, parent);
+    xSemaphoreTake(_chatCompletion->lock, portMAX_DELAY);
+    char *jsonBody = OpenAI_ChatCompletionBody(_chatCompletion, p, true);
+    xSemaphoreGive(_chatCompletion->lock);
+    OPENAI_ERROR_CHECK(jsonBody != NULL, "Request could not be serialized", result);
+
+    OpenAI_SSE_t sse = { .delta = delta, .ctx = ctx };
+    esp_err_t err = _chatCompletion->oai->events(_chatCompletion->oai, endpoint, jsonBody, &OpenAI_SSEWrite, &sse);
+    free(jsonBody);
+    free(sse.line);
+    if (sse.body.len > 0 && OpenAI_BufferWrite(&sse.body, (const uint8_t *)"", 1) == 0) {
+        cJSON *json = OpenAI_JsonParse(sse.body.data);
+        sse.error = getJsonError(json);
+        OpenAI_JsonDelete(json);
+        if (sse.error == NULL) {
+            sse.error = strdup("\"code\": Response is not an event stream!");
+        }
+        ESP_LOGE(TAG, "Error: %s", sse.error);
+    }
+    free(sse.body.data);
+    // An answer cut short is not returned or saved as if it was complete
+    if (err == ESP_OK && sse.error == NULL && !sse.done) {
+        sse.error = strdup("\"code\": Stream ended without [DONE]!");
+        ESP_LOGE(TAG, "Stream ended without [DONE]");
+    }
+    // Errors of the API come with a response like the ones of message()
+    if (sse.error != NULL) {
+        free(sse.content.data);
+        return OpenAI_StringResponseCreateError(sse.error);
+    }
+    if (err != ESP_OK || OpenAI_BufferWrite(&sse.content, (const uint8_t *)"", 1) != 0) {
+        free(sse.content.data);
+        ESP_LOGE(TAG, "Streamed chat completion failed!");
+        return result;
+    }
+
+    result = OpenAI_StringResponseCreateText(sse.content.data, sse.usage);
+    if (save && result != NULL) {
+        OpenAI_ChatCompletionSave(_chatCompletion, p, result->getData(result, 0));
+    }
+    return result;
+}
+
+#if CONFIG_ENABLE_ASYNC
+static int OpenAI_ChatCompletionAsyncDelta(void *ctx, const char *delta)
+{
+    _OpenAI_AsyncRequest_t *request = (_OpenAI_AsyncRequest_t *)ctx;
+    if (request->cancelled) {
+        return -1;
+    }
+    return (request->config.delta != NULL) ? request->config.delta(request->config.ctx, delta) : 0;
+}
+
+static void OpenAI_ChatCompletionAsyncRun(_OpenAI_AsyncRequest_t *request)
+{
+    // Streamed, so a cancelled request stops at the next chunk instead of the end of the response
+    request->result = OpenAI_ChatCompletionMessageStream((OpenAI_ChatCompletion_t *)request->object, request->text, request->save, &OpenAI_ChatCompletionAsyncDelta, request);
+}
+
+static void OpenAI_ChatCompletionAsyncFree(void *result)
+{
+    OpenAI_StringResponse_t *response = (OpenAI_StringResponse_t *)result;
+    response->delete (response);
+}
+
+static OpenAI_AsyncRequest_t *OpenAI_ChatCompletionMessageAsync(OpenAI_ChatCompletion_t *chatCompletion, const char *p, bool save, const OpenAI_Async_Config_t *config)
+{
+    _OpenAI_ChatCompletion_t *_chatCompletion = __containerof(chatCompletion, _OpenAI_ChatCompletion_t, parent);
+    _OpenAI_AsyncRequest_t *request = OpenAI_AsyncRequestCreate(_chatCompletion->oai, chatCompletion, config);
+    OPENAI_ERROR_CHECK(request != NULL, "Failed to create async request!", NULL);
+    request->run = &OpenAI_ChatCompletionAsyncRun;
+    request->free_result = &OpenAI_ChatCompletionAsyncFree;
+    request->save = save;
+    request->text = strdup(p);
+    if (request->text == NULL) {
+        ESP_LOGE(TAG, "strdup failed!");
+        request->refs = 1;
+        OpenAI_AsyncRelease(request);
+        return NULL;
+    }
+    return OpenAI_AsyncSubmit(request);
+}
+#endif
+
+static OpenAI_ChatCompletion_t *OpenAI_ChatCompletionCreate(OpenAI_t *openai)
+{
+    _OpenAI_ChatCompletion_t *_chatCompletion = (_OpenAI_ChatCompletion_t *)calloc(1, sizeof(_OpenAI_ChatCompletion_t));
+    OPENAI_ERROR_CHECK(_chatCompletion != NULL, "chatCompletion could not be allocated", NULL);
+    _chatCompletion->oai = __containerof(openai, _OpenAI_t, parent);
+    _chatCompletion->temperature = 1;
+    _chatCompletion->top_p = 1;
+    _chatCompletion->messages = cJSON_CreateArray();
+    _chatCompletion->max_history_tokens = CONFIG_DEFAULT_CHAT_HISTORY_TOKENS;
+    _chatCompletion->lock = xSemaphoreCreateMutex();
+    if (_chatCompletion->lock == NULL) {
+        ESP_LOGE(TAG, "xSemaphoreCreateMutex failed!");
+        OpenAI_ChatCompletionDelete(&_chatCompletion->parent);
+        return NULL;
+    }
+
+    _chatCompletion->parent.setModel = &OpenAI_ChatCompletionSetModel;
+    _chatCompletion->parent.setSystem = &OpenAI_ChatCompletionSetSystem;
+    _chatCompletion->parent.setMaxTokens = &OpenAI_ChatCompletionSetMaxTokens;
+    _chatCompletion->parent.setTemperature = &OpenAI_ChatCompletionSetTemperature;
+    _chatCompletion->parent.setTopP = &OpenAI_ChatCompletionSetTopP;
+    _chatCompletion->parent.setStop = &OpenAI_ChatCompletionSetStop;
+    _chatCompletion->parent.setPresencePenalty = &OpenAI_ChatCompletionSetPresencePenalty;
+    _chatCompletion->parent.setFrequencyPenalty = &OpenAI_ChatCompletionSetFrequencyPenalty;
+    _chatCompletion->parent.setUser = &OpenAI_ChatCompletionSetUser;
+    _chatCompletion->parent.setMaxHistoryTokens = &OpenAI_ChatCompletionSetMaxHistoryTokens;
+    _chatCompletion->parent.clearConversation = &OpenAI_ChatCompletionClearConversation;
+    _chatCompletion->parent.message = &OpenAI_ChatCompletionMessage;
+    _chatCompletion->parent.messageStream = &OpenAI_ChatCompletionMessageStream;
+#if CONFIG_ENABLE_ASYNC
+    _chatCompletion->parent.messageAsync = &OpenAI_ChatCompletionMessageAsync;
+#endif
+
+    return &_chatCompletion->parent;
+}
+
+// edits { //Creates a new edit for the provided input, instruction, and parameters.
+//   "model": "text-davinci-edit-001",//required
+//   "input": "",//string. The input text to use as a starting point for the edit.
+//   "instruction": "Fix the spelling mistakes",//required string. The instruction that tells the model how to edit the prompt.
+//   "n": 1,//integer. How many edits to generate for the input and instruction.
+//   "temperature": 1,//float between 0 and 2
+//   "top_p": 1//float between 0 and 1. recommended to alter this or temperature but not both.
+// }
+
+/**
+ * @brief Given a prompt and an instruction, the model will return an edited version of the prompt.
+ *
+ */
+typedef struct {
+    OpenAI_Edit_t parent;    /*!< Pointer to the parent object */
+    _OpenAI_t *oai;          /*!< Pointer to the OpenAI object */
+    char *model;             /*!< default "text-davinci-edit-001". ID of the model to use. */
+    float temperature;       /*!< float between 0 and 2. Higher value gives more random results. */
+    float top_p;             /*!< float between 0 and 1. recommended to alter this or temperature but not both.*/
+    uint32_t n;              /*!< How many edits to generate for the input and instruction. */
+} _OpenAI_Edit_t;
+
+static void OpenAI_EditDelete(OpenAI_Edit_t *edit)
+{
+    _OpenAI_Edit_t *_edit = __containerof(edit, _OpenAI_Edit_t, parent);
+    if (_edit != NULL) {
+        if (_edit->model != NULL) {
+            free(_edit->model);
+            _edit->model = NULL;
+        }
+
+        free(_edit);
+        _edit = NULL;
+    }
+}
+
+static void OpenAI_EditSetModel(OpenAI_Edit_t *edit, const char *m)
+{
+    _OpenAI_Edit_t *_edit = __containerof(edit, _OpenAI_Edit_t, parent);
+    if (_edit->model != NULL) {
+        free(_edit->model);
+        _edit->model = NULL;
+    }
+
+    _edit->model = strdup(m);
+}
+
+static void OpenAI_EditSetTemperature(OpenAI_Edit_t *edit, float t)
+{
+    _OpenAI_Edit_t *_edit = __containerof(edit, _OpenAI_Edit_t, parent);
+    if (t >= 0 && t <= 2.0) {
+        _edit->temperature = t;
+    }
+}
+
+static void OpenAI_EditSetTopP(OpenAI_Edit_t *edit, float t)
+{
+    _OpenAI_Edit_t *_edit = __containerof(edit, _OpenAI_Edit_t, parent);
+    if (t >= 0 && t <= 1.0) {
+        _edit->top_p = t;
+    }
+}
+
+static void OpenAI_EditSetN(OpenAI_Edit_t *edit, uint32_t n)
+{
+    _OpenAI_Edit_t *_edit = __containerof(edit, _OpenAI_Edit_t, parent);
+    if (n > 0) {
+        _edit->n = n;
+    }
+}
+
+OpenAI_StringResponse_t *OpenAI_EditProcess(OpenAI_Edit_t *edit, char *instruction, char *input)
+{
+    const char *endpoint = "edits";
+    OpenAI_StringResponse_t *result = NULL;
+    cJSON *req = OpenAI_JsonCreateObject();
+    OPENAI_ERROR_CHECK(req != NULL, "cJSON_CreateObject failed!", NULL);
+    _OpenAI_Edit_t *_edit = __containerof(edit, _OpenAI_Edit_t, parent);
+    reqAddString("model", (_edit->model == NULL) ? "text-davinci-edit-001" : _edit->model);
+    reqAddString("instruction", instruction);
+    if (input != NULL) {
+        reqAddString("input", input);
+    }
+    if (_edit->temperature != 1) {
+        reqAddNumber("temperature", _edit->temperature);
+    }
+    if (_edit->top_p != 1) {
+        reqAddNumber("top_p", _edit->top_p);
+    }
+    if (_edit->n != 1) {
+        reqAddNumber("n", _edit->n);
+    }
+    char *jsonBody = OpenAI_JsonPrint(req, strlen(instruction) + ((input != NULL) ? strlen(input) : 0));
+    OpenAI_JsonDelete(req);
+    OPENAI_ERROR_CHECK(jsonBody != NULL, "Request could not be serialized", result);
+    result = OpenAI_StringResponseRequest(_edit->oai, endpoint, jsonBody);
+    free(jsonBody);
+    return result;
+}
+
+static OpenAI_Edit_t *OpenAI_EditCreate(OpenAI_t *openai)
+{
+    _OpenAI_Edit_t *_edit = (_OpenAI_Edit_t *)calloc(1, sizeof(_OpenAI_Edit_t));
+    OPENAI_ERROR_CHECK(_edit != NULL, "edit calloc failed!", NULL);
+    _edit->oai = __containerof(openai, _OpenAI_t, parent);;
+    _edit->temperature = 1;
+    _edit->top_p = 1;
+    _edit->n = 1;
+
+    _edit->parent.setModel = &OpenAI_EditSetModel;
+    _edit->parent.setTemperature = &OpenAI_EditSetTemperature;
+    _edit->parent.setTopP = &OpenAI_EditSetTopP;
+    _edit->parent.setN = &OpenAI_EditSetN;
+    _edit->parent.process = &OpenAI_EditProcess;
+    return &_edit->parent;
+}
+
+//
+// Images
+//
+
+static const char *image_sizes[] = {"1024x1024", "512x512", "256x256"};
+static const char *image_response_formats[] = {"url", "b64_json"};
+
+// images/generations { //Creates an image given a prompt.
+//   "prompt": "A cute baby sea otter",//required
+//   "n": 1,//integer. The number of images to generate. Must be between 1 and 10.
+//   "size": "1024x1024",//string. The size of the generated images. Must be one of "256x256", "512x512", or "1024x1024"
+//   "response_format": "url",//string. The format in which the generated images are returned. Must be one of "url" or "b64_json".
+//   "user": null//string. A unique identifier representing your end-user, which can help OpenAI to monitor and detect abuse.
+// }
+
+/**
+ * @brief Creates an image given a prompt.
+ *
+ */
+typedef struct {
+    OpenAI_ImageGeneration_t parent;               /*!< The parent object */
+    _OpenAI_t *oai;                                /*!< Pointer to the OpenAI object */
+    OpenAI_Image_Size size;                        /*!< The size of the generated images. Must be one of "256x256", "512x512", or "1024x1024" */
+    OpenAI_Image_Response_Format response_format;  /*!< The format in which the generated images are returned. Must be one of url or b64_json */
+    uint32_t n;                                    /*!< The number of images to generate. Must be between 1 and 10. */
+    char *user;                                    /*!< A unique identifier representing your end-user, which can help OpenAI to monitor and detect abuse. */
+} _OpenAI_ImageGeneration_t;
+
+static void OpenAI_ImageGenerationDelete(OpenAI_ImageGeneration_t *imageGeneration)
+{
+    _OpenAI_ImageGeneration_t *_imageGeneration = __containerof(imageGeneration, _OpenAI_ImageGeneration_t, parent);
+    if (_imageGeneration != NULL) {
+        if (_imageGeneration->user != NULL) {
+            free(_imageGeneration->user);
+            _imageGeneration->user = NULL;
+        }
+
+        free(_imageGeneration);
+        _imageGeneration = NULL;
+    }
+}
+
+static void OpenAI_ImageGenerationSetSize(OpenAI_ImageGeneration_t *imageGeneration, OpenAI_Image_Size s)
+{
+    _OpenAI_ImageGeneration_t *_imageGeneration = __containerof(imageGeneration, _OpenAI_ImageGeneration_t, parent);
+    if (s >= OPENAI_IMAGE_SIZE_1024x1024 && s <= OPENAI_IMAGE_SIZE_256x256) {
+        _imageGeneration->size = s;
+    }
+}
+
+static void OpenAI_ImageGenerationSetResponseFormat(OpenAI_ImageGeneration_t *imageGeneration, OpenAI_Image_Response_Format rf)
+{
+    _OpenAI_ImageGeneration_t *_imageGeneration = __containerof(imageGeneration, _OpenAI_ImageGeneration_t, parent);
+    if (rf >= OPENAI_IMAGE_RESPONSE_FORMAT_URL && rf <= OPENAI_IMAGE_RESPONSE_FORMAT_B64_JSON) {
+        _imageGeneration->response_format = rf;
+    }
+}
+
+static void OpenAI_ImageGenerationSetN(OpenAI_ImageGeneration_t *imageGeneration, uint32_t n)
+{
+    _OpenAI_ImageGeneration_t *_imageGeneration = __containerof(imageGeneration, _OpenAI_ImageGeneration_t, parent);
+    if (n > 0 && n <= 10) {
+        _imageGeneration->n = n;
+    }
+}
+
+static void OpenAI_ImageGenerationSetUser(OpenAI_ImageGeneration_t *imageGeneration, const char *u)
+{
+    _OpenAI_ImageGeneration_t *_imageGeneration = __containerof(imageGeneration, _OpenAI_ImageGeneration_t, parent);
+    if (_imageGeneration->user != NULL) {
+        free(_imageGeneration->user);
+        _imageGeneration->user = NULL;
+    }
+
+    _imageGeneration->user = strdup(u);
+}
+
+OpenAI_ImageResponse_t *OpenAI_ImageGenerationPrompt(OpenAI_ImageGeneration_t *imageGeneration, char *p)
+{
+    const char *endpoint = "images/generations";
+    OpenAI_ImageResponse_t *result = NULL;
+    cJSON *req = OpenAI_JsonCreateObject();
+    OPENAI_ERROR_CHECK(req != NULL, "cJSON_CreateObject failed!", NULL);
+    reqAddString("prompt", p);
+    _OpenAI_ImageGeneration_t *_imageGeneration = __containerof(imageGeneration, _OpenAI_ImageGeneration_t, parent);
+    if (_imageGeneration->size != OPENAI_IMAGE_SIZE_1024x1024) {
+        reqAddString("size", image_sizes[_imageGeneration->size]);
+    }
+    if (_imageGeneration->response_format != OPENAI_IMAGE_RESPONSE_FORMAT_URL) {
+        reqAddString("response_format", image_response_formats[_imageGeneration->response_format]);
+    }
+    if (_imageGeneration->n != 1) {
+        reqAddNumber("n", _imageGeneration->n);
+    }
+    if (_imageGeneration->user != NULL) {
+        reqAddString("user", _imageGeneration->user);
+    }
+    char *jsonBody = OpenAI_JsonPrint(req, strlen(p));
+    OpenAI_JsonDelete(req);
+    OPENAI_ERROR_CHECK(jsonBody != NULL, "Request could not be serialized", result);
+    char *res = _imageGeneration->oai->post(_imageGeneration->oai, endpoint, jsonBody);
+    free(jsonBody);
+    OPENAI_ERROR_CHECK(res != NULL, "Empty result!", result);
+    return OpenAI_ImageResponseCreate(res);
+}
+
+static OpenAI_ImageGeneration_t *OpenAI_ImageGenerationCreate(OpenAI_t *openai)
+{
+    _OpenAI_ImageGeneration_t *_imageGeneration = (_OpenAI_ImageGeneration_t *)calloc(1, sizeof(_OpenAI_ImageGeneration_t));
+    OPENAI_ERROR_CHECK(_imageGeneration != NULL, "_imageGeneration calloc failed!", NULL);
+    _imageGeneration->oai = __containerof(openai, _OpenAI_t, parent);;
+    _imageGeneration->size = OPENAI_IMAGE_SIZE_1024x1024;
+    _imageGeneration->response_format = OPENAI_IMAGE_RESPONSE_FORMAT_URL;
+    _imageGeneration->n = 1;
+
+    _imageGeneration->parent.setSize = &OpenAI_ImageGenerationSetSize;
+    _imageGeneration->parent.setResponseFormat = &OpenAI_ImageGenerationSetResponseFormat;
+    _imageGeneration->parent.setN = &OpenAI_ImageGenerationSetN;
+    _imageGeneration->parent.setUser = &OpenAI_ImageGenerationSetUser;
+    _imageGeneration->parent.prompt = &OpenAI_ImageGenerationPrompt;
+
+    return &_imageGeneration->parent;
+}
+
+// images/variations { //Creates a variation of a given image.
+//   "image": "",//required string. The image to edit. Must be a valid PNG file, less than 4MB, and square.
+//   "n": 1,//integer. The number of images to generate. Must be between 1 and 10.
+//   "size": "1024x1024",//string. The size of the generated images. Must be one of "256x256", "512x512", or "1024x1024"
+//   "response_format": "url",//string. The format in which the generated images are returned. Must be one of "url" or "b64_json".
+//   "user": null//string. A unique identifier representing your end-user, which can help OpenAI to monitor and detect abuse.
+// }
+
+/**
+ * @brief Creates a variation of a given image.
+ *
+ */
+typedef struct {
+    OpenAI_ImageVariation_t parent;               /*!< Parent object */
+    _OpenAI_t *oai;                               /*!< Pointer to the OpenAI object */
+    OpenAI_Image_Size size;                       /*!< The size of the generated images. Must be one of 256x256, 512x512, or 1024x1024. */
+    OpenAI_Image_Response_Format response_format; /*!< The format in which the generated images are returned. Must be one of url or b64_json. */
+    uint32_t n;                                   /*!< The number of images to generate. Must be between 1 and 10. */
+    char *user;                                   /*!< A unique identifier representing your end-user, which can help OpenAI to monitor and detect abuse. */
+} _OpenAI_ImageVariation_t;
+
+static void OpenAI_ImageVariationDelete(OpenAI_ImageVariation_t *imageVariation)
+{
+    _OpenAI_ImageVariation_t *_imageVariation = __containerof(imageVariation, _OpenAI_ImageVariation_t, parent);
+    if (_imageVariation != NULL) {
+        if (_imageVariation->user != NULL) {
+            free(_imageVariation->user);
+            _imageVariation->user = NULL;
+        }
+
+        free(_imageVariation);
+        _imageVariation = NULL;
+    }
+}
+
+static void OpenAI_ImageVariationSetSize(OpenAI_ImageVariation_t *imageVariation, OpenAI_Image_Size s)
+{
+    _OpenAI_ImageVariation_t *_imageVariation = __containerof(imageVariation, _OpenAI_ImageVariation_t, parent);
+    if (s >= OPENAI_IMAGE_SIZE_1024x1024 && s <= OPENAI_IMAGE_SIZE_256x256) {
+        _imageVariation->size = s;
+    }
+}
+
+static void OpenAI_ImageVariationSetResponseFormat(OpenAI_ImageVariation_t *imageVariation, OpenAI_Image_Response_Format rf)
+{
+    _OpenAI_ImageVariation_t *_imageVariation = __containerof(imageVariation, _OpenAI_ImageVariation_t, parent);
+    if (rf >= OPENAI_IMAGE_RESPONSE_FORMAT_URL && rf <= OPENAI_IMAGE_RESPONSE_FORMAT_B64_JSON) {
+        _imageVariation->response_format = rf;
+    }
+}
+
+static void OpenAI_ImageVariationSetN(OpenAI_ImageVariation_t *imageVariation, uint32_t n)
+{
+    _OpenAI_ImageVariation_t *_imageVariation = __containerof(imageVariation, _OpenAI_ImageVariation_t, parent);
+    if (n > 0 && n <= 10) {
+        _imageVariation->n = n;
+    }
+}
+
+static void OpenAI_ImageVariationSetUser(OpenAI_ImageVariation_t *imageVariation, const char *u)
+{
+    _OpenAI_ImageVariation_t *_imageVariation = __containerof(imageVariation, _OpenAI_ImageVariation_t, parent);
+    if (_imageVariation->user != NULL) {
+        free(_imageVariation->user);
+        _imageVariation->user = NULL;
+    }
+
+    _imageVariation->user = strdup(u);
+}
+
+static OpenAI_ImageResponse_t *OpenAI_ImageVariationImage(OpenAI_ImageVariation_t *imageVariation, uint8_t *img_data, size_t img_len)
+{
+    const char *endpoint = "images/variations";
+    OpenAI_Multipart_t mp = {0};
+    _OpenAI_ImageVariation_t *_imageVariation = __containerof(imageVariation, _OpenAI_ImageVariation_t, parent);
+    if (_imageVariation->size != OPENAI_IMAGE_SIZE_1024x1024) {
+        multipartAddField(&mp, "size", "%s", image_sizes[_imageVariation->size]);
+    }
+    if (_imageVariation->response_format != OPENAI_IMAGE_RESPONSE_FORMAT_URL) {
+        multipartAddField(&mp, "response_format", "%s", image_response_formats[_imageVariation->response_format]);
+    }
+    if (_imageVariation->n != 1) {
+        multipartAddField(&mp, "n", "%"PRIu32, _imageVariation->n);
+    }
+    if (_imageVariation->user != NULL) {
+        multipartAddField(&mp, "user", "%s", _imageVariation->user);
+    }
+    OpenAI_Body_Part_t image = { .data = img_data, .len = img_len };
+    multipartAddFile(&mp, "image", "image.png", "image/png", &image, 1);
+    char *res = NULL;
+    OPENAI_ERROR_CHECK_GOTO(multipartFinish(&mp), "Failed to allocate request body!", end);
+    res = _imageVariation->oai->upload(_imageVariation->oai, endpoint, mp.parts, mp.count);
+end:
+    multipartFree(&mp);
+    OPENAI_ERROR_CHECK(res != NULL, "Empty result!", NULL);
+    return OpenAI_ImageResponseCreate(res);
+}
+
+static OpenAI_ImageVariation_t *OpenAI_ImageVariationCreate(OpenAI_t *openai)
+{
+    _OpenAI_ImageVariation_t *_imageVariation = (_OpenAI_ImageVariation_t *)calloc(1, sizeof(_OpenAI_ImageVariation_t));
+    OPENAI_ERROR_CHECK(_imageVariation != NULL, "imageVariation calloc failed!", NULL);
+    _imageVariation->oai = __containerof(openai, _OpenAI_t, parent);;
+    _imageVariation->size = OPENAI_IMAGE_SIZE_1024x1024;
+    _imageVariation->response_format = OPENAI_IMAGE_RESPONSE_FORMAT_URL;
+    _imageVariation->n = 1;
+
+    _imageVariation->parent.setSize = &OpenAI_ImageVariationSetSize;
+    _imageVariation->parent.setResponseFormat = &OpenAI_ImageVariationSetResponseFormat;
+    _imageVariation->parent.setN = &OpenAI_ImageVariationSetN;
+    _imageVariation->parent.setUser = &OpenAI_ImageVariationSetUser;
+    _imageVariation->parent.image = &OpenAI_ImageVariationImage;
+
+    return &_imageVariation->parent;
+}
+
+// images/edits { //Creates an edited or extended image given an original image and a prompt.
+//   "image": "",//required string. The image to edit. Must be a valid PNG file, less than 4MB, and square. If mask is not provided, image must have transparency, which will be used as the mask.
+//   "mask": "",//optional string. An additional image whose fully transparent areas (e.g. where alpha is zero) indicate where image should be edited. Must be a valid PNG file, less than 4MB, and have the same dimensions as image.
+//   "prompt": "A cute baby sea otter",//required. A text description of the desired image(s). The maximum length is 1000 characters.
+//   "n": 1,//integer. The number of images to generate. Must be between 1 and 10.
+//   "size": "1024x1024",//string. The size of the generated images. Must be one of "256x256", "512x512", or "1024x1024"
+//   "response_format": "url",//string. The format in which the generated images are returned. Must be one of "url" or "b64_json".
+//   "user": null//string. A unique identifier representing your end-user, which can help OpenAI to monitor and detect abuse.
+// }
+
+/**
+ * @brief Creates an edited or extended image given an original image and a prompt.
+ *
+ */
+typedef struct {
+    OpenAI_ImageEdit_t parent;                    /*!< Parent object */
+    _OpenAI_t *oai;                               /*!< Pointer to the OpenAI object */
+    char *prompt;                                 /*!< A text description of the desired image(s). The maximum length is 1000 characters. */
+    OpenAI_Image_Size size;                       /*!< The size of the generated images. Must be one of 256x256, 512x512, or 1024x1024. */
+    OpenAI_Image_Response_Format response_format; /*!< The format in which the generated images are returned. Must be one of url or b64_json. */
+    uint32_t n;                                   /*!< The number of images to generate. Must be between 1 and 10. */
+    char *user;                                   /*!< A unique identifier representing your end-user, which can help OpenAI to monitor and detect abuse. */
+} _OpenAI_ImageEdit_t;
+
+static void OpenAI_ImageEditDelete(OpenAI_ImageEdit_t *imageEdit)
+{
+    _OpenAI_ImageEdit_t *_imageEdit = __containerof(imageEdit, _OpenAI_ImageEdit_t, parent);
+    if (_imageEdit != NULL) {
+        if (_imageEdit->prompt != NULL) {
+            free(_imageEdit->prompt);
+            _imageEdit->prompt = NULL;
+        }
+
+        if (_imageEdit->user != NULL) {
+            free(_imageEdit->user);
+            _imageEdit->user = NULL;
+        }
+
+        free(_imageEdit);
+        _imageEdit = NULL;
+    }
+}
+
+static void OpenAI_ImageEditSetPrompt(OpenAI_ImageEdit_t *imageEdit, const char *p)
+{
+    _OpenAI_ImageEdit_t *_imageEdit = __containerof(imageEdit, _OpenAI_ImageEdit_t, parent);
+    if (_imageEdit->prompt != NULL) {
+        free(_imageEdit->prompt);
+        _imageEdit->prompt = NULL;
+    }
+
+    _imageEdit->prompt = strdup(p);
+}
+
+static void OpenAI_ImageEditSetSize(OpenAI_ImageEdit_t *imageEdit, OpenAI_Image_Size s)
+{
+    _OpenAI_ImageEdit_t *_imageEdit = __containerof(imageEdit, _OpenAI_ImageEdit_t, parent);
+    _imageEdit->size = s;
+}
+
+static void OpenAI_ImageEditSetResponseFormat(OpenAI_ImageEdit_t *imageEdit, OpenAI_Image_Response_Format rf)
+{
+    _OpenAI_ImageEdit_t *_imageEdit = __containerof(imageEdit, _OpenAI_ImageEdit_t, parent);
+    if (rf >= OPENAI_IMAGE_RESPONSE_FORMAT_URL && rf <= OPENAI_IMAGE_RESPONSE_FORMAT_B64_JSON) {
+        _imageEdit->response_format = rf;
+    }
+}
+
+static void OpenAI_ImageEditSetN(OpenAI_ImageEdit_t *imageEdit, uint32_t n)
+{
+    _OpenAI_ImageEdit_t *_imageEdit = __containerof(imageEdit, _OpenAI_ImageEdit_t, parent);
+    if (n > 0 && n <= 10) {
+        _imageEdit->n = n;
+    }
+}
+
+static void OpenAI_ImageEditSetUser(OpenAI_ImageEdit_t *imageEdit, const char *u)
+{
+    _OpenAI_ImageEdit_t *_imageEdit = __containerof(imageEdit, _OpenAI_ImageEdit_t, parent);
+    if (_imageEdit->user != NULL) {
+        free(_imageEdit->user);
+        _imageEdit->user = NULL;
+    }
+
+    _imageEdit->user = strdup(u);
+}
+
+static OpenAI_ImageResponse_t *OpenAI_ImageEditImage(OpenAI_ImageEdit_t *imageEdit, uint8_t *img_data, size_t img_len, uint8_t *mask_data, size_t mask_len)
+{
+    const char *endpoint = "images/edits";
+    OpenAI_Multipart_t mp = {0};
+    _OpenAI_ImageEdit_t *_imageEdit = __containerof(imageEdit, _OpenAI_ImageEdit_t, parent);
+    if (_imageEdit->prompt != NULL) {
+        multipartAddField(&mp, "prompt", "%s", _imageEdit->prompt);
+    }
+    if (_imageEdit->size != OPENAI_IMAGE_SIZE_1024x1024) {
+        multipartAddField(&mp, "size", "%s", image_sizes[_imageEdit->size]);
+    }
+    if (_imageEdit->response_format != OPENAI_IMAGE_RESPONSE_FORMAT_URL) {
+        multipartAddField(&mp, "response_format", "%s", image_response_formats[_imageEdit->response_format]);
+    }
+    if (_imageEdit->n != 1) {
+        multipartAddField(&mp, "n", "%"PRIu32, _imageEdit->n);
+    }
+    if (_imageEdit->user != NULL) {
+        multipartAddField(&mp, "user", "%s", _imageEdit->user);
+    }
+    OpenAI_Body_Part_t image = { .data = img_data, .len = img_len };
+    multipartAddFile(&mp, "image", "image.png", "image/png", &image, 1);
+    if (mask_data != NULL && mask_len > 0) {
+        OpenAI_Body_Part_t mask = { .data = mask_data, .len = mask_len };
+        multipartAddFile(&mp, "mask", "mask.png", "image/png", &mask, 1);
+    }
+    char *res = NULL;
+    OPENAI_ERROR_CHECK_GOTO(multipartFinish(&mp), "Failed to allocate request body!", end);
+    res = _imageEdit->oai->upload(_imageEdit->oai, endpoint, mp.parts, mp.count);
+end:
+    multipartFree(&mp);
+    OPENAI_ERROR_CHECK(res != NULL, "Empty result!", NULL);
+    return OpenAI_ImageResponseCreate(res);
+}
+
+static OpenAI_ImageEdit_t *OpenAI_ImageEditCreate(OpenAI_t *openai)
+{
+    _OpenAI_ImageEdit_t *_imageEdit = (_OpenAI_ImageEdit_t *)calloc(1, sizeof(_OpenAI_ImageEdit_t));
+    OPENAI_ERROR_CHECK(_imageEdit != NULL, "Failed to allocate _OpenAI_ImageEdit_t!", NULL);
+
+    _imageEdit->oai = __containerof(openai, _OpenAI_t, parent);;
+    _imageEdit->size = OPENAI_IMAGE_SIZE_1024x1024;
+    _imageEdit->response_format = OPENAI_IMAGE_RESPONSE_FORMAT_URL;
+    _imageEdit->n = 1;
+
+    _imageEdit->parent.setPrompt = &OpenAI_ImageEditSetPrompt;
+    _imageEdit->parent.setSize = &OpenAI_ImageEditSetSize;
+    _imageEdit->parent.setResponseFormat = &OpenAI_ImageEditSetResponseFormat;
+    _imageEdit->parent.setN = &OpenAI_ImageEditSetN;
+    _imageEdit->parent.setUser = &OpenAI_ImageEditSetUser;
+    _imageEdit->parent.image = &OpenAI_ImageEditImage;
+    return &_imageEdit->parent;
+}
+
+// audio/transcriptions { //Transcribes audio into the input language.
+//   "file": "audio.mp3",//required. The audio file to transcribe, in one of these formats: mp3, mp4, mpeg, mpga, m4a, wav, or webm.
+//   "model": "whisper-1",//required. ID of the model to use. Only whisper-1 is currently available.
+//   "prompt": "A cute baby sea otter",//An optional text to guide the model's style or continue a previous audio segment. The prompt should match the audio language.
+//   "response_format": "json",//string. The format of the transcript output, in one of these options: "json", "text", "srt", "verbose_json", or "vtt".
+//   "temperature": 1,//float between 0 and 2
+//   "language": null//string. The language of the input audio. Supplying the input language in ISO-639-1 format will improve accuracy and latency.
+// }
+
+static const char *audio_input_formats[] = {
+    "mp3",
+    "mp4",
+    "mpeg",
+    "mpga",
+    "m4a",
+    "wav",
+    "webm"
+};
+
+static const char *audio_input_mime[] = {
+    "audio/mpeg",
+    "audio/mp4",
+    "audio/mpeg",
+    "audio/mpeg",
+    "audio/x-m4a",
+    "audio/x-wav",
+    "audio/webm"
+};
+
+static const char *audio_speech_formats[] = {"mp3", "opus", "aac", "flac"};
+
+#define OPENAI_WAV_HEADER_SIZE 44
+
+static void wavPut16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void wavPut32(uint8_t *p, uint32_t v)
+{
+    wavPut16(p, v & 0xffff);
+    wavPut16(p + 2, v >> 16);
+}
+
+/**
+ * @brief Fill in the RIFF header that makes len bytes of interleaved little-endian PCM a WAV file.
+ *        The header is uploaded as its own part in front of the samples, they are never copied.
+ *
+ */
+static bool OpenAI_WavHeader(uint8_t header[OPENAI_WAV_HEADER_SIZE], size_t len, uint32_t sample_rate, uint8_t bits, uint8_t channels)
+{
+    OPENAI_ERROR_CHECK(sample_rate > 0 && channels > 0, "Invalid PCM format!", false);
+    OPENAI_ERROR_CHECK(bits == 8 || bits == 16 || bits == 24 || bits == 32, "Invalid PCM sample size!", false);
+    uint32_t block_align = channels * (bits / 8);
+    OPENAI_ERROR_CHECK(len % block_align == 0, "PCM length is not a whole number of frames!", false);
+    OPENAI_ERROR_CHECK(len <= UINT32_MAX - (OPENAI_WAV_HEADER_SIZE - 8), "PCM too long for a WAV file!", false);
+    memcpy(header, "RIFF", 4);
+    wavPut32(header + 4, OPENAI_WAV_HEADER_SIZE - 8 + len);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    wavPut32(header + 16, 16);
+    wavPut16(header + 20, 1);   // PCM
+    wavPut16(header + 22, channels);
+    wavPut32(header + 24, sample_rate);
+    wavPut32(header + 28, sample_rate * block_align);
+    wavPut16(header + 32, block_align);
+    wavPut16(header + 34, bits);
+    memcpy(header + 36, "data", 4);
+    wavPut32(header + 40, len);
+    return true;
+}
+
+#if CONFIG_ENABLE_JSON_SCAN
+static const char *const audio_text_paths[] = {
+    OPENAI_JSON_SCAN_ERROR_PATHS,
+    "text",
+};
+
+typedef struct {
+    OpenAI_JsonScanError_t error;   /*!< Error of the response */
+    OpenAI_Buffer_t text;           /*!< Text, NUL terminated */
+} OpenAI_AudioTextScan_t;
+
+static int OpenAI_AudioTextScanValue(void *ctx, const OpenAI_JsonScan_Value_t *value)
+{
+    OpenAI_AudioTextScan_t *result = (OpenAI_AudioTextScan_t *)ctx;
+    if (value->path < 2) {
+        return OpenAI_JsonScanErrorWrite(&result->error, value);
+    }
+    OPENAI_ERROR_CHECK(value->type == OPENAI_JSON_SCAN_STRING, "Text could not be read", -1);
+    return OpenAI_BufferWrite(&result->text, (const uint8_t *)value->data, value->end ? value->len + 1 : value->len);
+}
+
+/**
+ * @brief Uploads audio for a transcription or translation and picks the text out of the JSON response
+ *        while it arrives.
+ *
+ * @return The text, the error of the response, or NULL
+ */
+static char *OpenAI_AudioTextUpload(_OpenAI_t *oai, const char *endpoint, const OpenAI_Body_Part_t *parts, size_t count)
+{
+    OpenAI_AudioTextScan_t result = {0};
+    OpenAI_JsonScan_t scan;
+    OpenAI_JsonScanInit(&scan, audio_text_paths, sizeof(audio_text_paths) / sizeof(audio_text_paths[0]), &OpenAI_AudioTextScanValue, &result);
+    esp_err_t err = oai->uploadscan(oai, endpoint, parts, count, &scan);
+
+    char *error = OpenAI_JsonScanErrorString(&result.error);
+    if (error != NULL) {
+        ESP_LOGE(TAG, "%s", error);
+        free(result.text.data);
+        return error;
+    }
+    if (err != ESP_OK || !OpenAI_JsonScanFinish(&scan)) {
+        ESP_LOGE(TAG, "Response could not be parsed");
+        free(result.text.data);
+        return NULL;
+    }
+    return OpenAI_JsonScanBufferTake(&result.text);
+}
+#endif
+
+/**
+ * @brief Gives audio from the input text.
+ *
+ */
+typedef struct {
+    OpenAI_AudioSpeech_t parent;              /*!< Base object */
+    _OpenAI_t *oai;                                  /*!< Pointer to the OpenAI object */
+    char *model;                                     /*!< ID of the model to use. */
+    char *voice;
+    float speed;
+    OpenAI_Audio_Output_Format response_format;    /*!< The format of the output, in one of these options: "mp3", "opus", "aac", or "flac"*/
+} _OpenAI_AudioSpeech_t;
+
+static void OpenAI_AudioSpeechDelete(OpenAI_AudioSpeech_t *audioSpeech)
+{
+    _OpenAI_AudioSpeech_t *_audioSpeech = __containerof(audioSpeech, _OpenAI_AudioSpeech_t, parent);
+    if (_audioSpeech != NULL) {
+        if (_audioSpeech->model != NULL) {
+            free(_audioSpeech->model);
+            _audioSpeech->model = NULL;
+        }
+        if (_audioSpeech->voice != NULL) {
+            free(_audioSpeech->voice);
+            _audioSpeech->voice = NULL;
+        }
+        free(_audioSpeech);
+        _audioSpeech = NULL;
+    }
+}
+
+static void OpenAI_AudioSpeechSetModel(OpenAI_AudioSpeech_t *speech, const char *m)
+{
+    _OpenAI_AudioSpeech_t *_speech = __containerof(speech, _OpenAI_AudioSpeech_t, parent);
+    if (_speech->model != NULL) {
+        free(_speech->model);
+        _speech->model = NULL;
+    }
+    _speech->model = strdup(m);
+}
+
+static void OpenAI_AudioSpeechSetVoice(OpenAI_AudioSpeech_t *speech, const char *m)
+{
+    _OpenAI_AudioSpeech_t *_speech = __containerof(speech, _OpenAI_AudioSpeech_t, parent);
+    if (_speech->voice != NULL) {
+        free(_speech->voice);
+        _speech->voice = NULL;
+    }
+    _speech->voice = strdup(m);
+}
+
+static void OpenAI_AudioSpeechSetSpeed(OpenAI_AudioSpeech_t *speech, float t)
+{
+    _OpenAI_AudioSpeech_t *_speech = __containerof(speech, _OpenAI_AudioSpeech_t, parent);
+    if (t >= 0.25 && t <= 4.0) {
+        _speech->speed = t;
+    }
+}
+
+static void OpenAI_AudioSpeechSetResponseFormat(OpenAI_AudioSpeech_t *audioCreateSpeech, OpenAI_Audio_Output_Format rf)
+{
+    _OpenAI_AudioSpeech_t *_audioCreateSpeech = __containerof(audioCreateSpeech, _OpenAI_AudioSpeech_t, parent);
+    if (rf >= OPENAI_AUDIO_OUTPUT_FORMAT_MP3 && rf <= OPENAI_AUDIO_OUTPUT_FORMAT_FLAC) {
+        _audioCreateSpeech->response_format = rf;
+    }
+}
+
+/**
+ * @brief Gives an audio from the input text.
+ *
+ */
+typedef struct {
+    OpenAI_SpeechResponse_t parent;
+    uint32_t len;
+    char *data;
+} _OpenAI_SpeechResponse_t;
+
+static void OpenAI_SpeechResponseDelete(OpenAI_SpeechResponse_t *audioSpeech)
+{
+    _OpenAI_SpeechResponse_t *_audioSpeech = __containerof(audioSpeech, _OpenAI_SpeechResponse_t, parent);
+
+    if (_audioSpeech != NULL) {
+        if (_audioSpeech->data) {
+            free(_audioSpeech->data);
+            _audioSpeech->data = NULL;
+        }
+
+        free(_audioSpeech);
+        _audioSpeech = NULL;
+    }
+}
+
+static uint32_t OpenAI_SpeechBufferGetLen(OpenAI_SpeechResponse_t *audioSpeech)
+{
+    _OpenAI_SpeechResponse_t *_audioSpeech = __containerof(audioSpeech, _OpenAI_SpeechResponse_t, parent);
+    return _audioSpeech->len;
+}
+
+static char *OpenAI_SpeechGetDate(OpenAI_SpeechResponse_t *audioSpeech)
+{
+    _OpenAI_SpeechResponse_t *_audioSpeech = __containerof(audioSpeech, _OpenAI_SpeechResponse_t, parent);
+    return (_audioSpeech->data);
+}
+
+static OpenAI_SpeechResponse_t *OpenAI_SpeechResponseCreate(char *payload, size_t dataLength)
+{
+    _OpenAI_SpeechResponse_t  *_audioSpeech = (_OpenAI_SpeechResponse_t *)calloc(1, sizeof(_OpenAI_SpeechResponse_t));
+    OPENAI_ERROR_CHECK(NULL != _audioSpeech, "calloc failed!", NULL);
+    if (payload == NULL || 0 == dataLength) {
+        return &_audioSpeech->parent;
+    }
+
+    // The response keeps the received buffer instead of a copy of it
+    _audioSpeech->len = dataLength;
+    _audioSpeech->data = payload;
+
+    _audioSpeech->parent.getLen = &OpenAI_SpeechBufferGetLen;
+    _audioSpeech->parent.getData = &OpenAI_SpeechGetDate;
+    _audioSpeech->parent.delete = &OpenAI_SpeechResponseDelete;
+    return &_audioSpeech->parent;
+}
+
+static char *OpenAI_AudioSpeechBody(_OpenAI_AudioSpeech_t *_audioSpeech, char *p)
+{
+    char *result = NULL;
+    cJSON *req = OpenAI_JsonCreateObject();
+    OPENAI_ERROR_CHECK(req != NULL, "cJSON_CreateObject failed!", NULL);
+    reqAddString("model", (_audioSpeech->model == NULL) ? "tts-1" : _audioSpeech->model);
+    reqAddString("input", p);
+    reqAddString("voice", (_audioSpeech->voice == NULL) ? "alloy" : _audioSpeech->voice);
+    if (_audioSpeech->response_format != OPENAI_AUDIO_OUTPUT_FORMAT_MP3) {
+        reqAddString("response_format", audio_speech_formats[_audioSpeech->response_format]);
+    }
+    if (_audioSpeech->speed != 1.0) {
+        reqAddNumber("speed", _audioSpeech->speed);
+    }
+    result = OpenAI_JsonPrint(req, strlen(p));
+    ESP_LOGD(TAG, "json body for Speech Message %s", result);
+    OpenAI_JsonDelete(req);
+    return result;
+}
+
+OpenAI_SpeechResponse_t *OpenAI_AudioSpeechMessage(OpenAI_AudioSpeech_t *audioSpeech, char *p)
+{
+    size_t dataLength = 0;
+    const char *endpoint = "audio/speech";
+    OpenAI_SpeechResponse_t *result = NULL;
+    _OpenAI_AudioSpeech_t *_audioSpeech = __containerof(audioSpeech, _OpenAI_AudioSpeech_t, parent);
+    char *jsonBody = OpenAI_AudioSpeechBody(_audioSpeech, p);
+    OPENAI_ERROR_CHECK(jsonBody != NULL, "Failed to build request!", result);
+    char *res = _audioSpeech->oai->speechpost(_audioSpeech->oai, endpoint, jsonBody, &dataLength);
+    free(jsonBody);
+    OPENAI_ERROR_CHECK(res != NULL, "Empty result!", result);
+    return OpenAI_SpeechResponseCreate(res, dataLength);
+}
+
+static esp_err_t OpenAI_AudioSpeechMessageStream(OpenAI_AudioSpeech_t *audioSpeech, char *p, OpenAI_Write_Cb write, void *ctx)
+{
+    const char *endpoint = "audio/speech";
+    OPENAI_ERROR_CHECK(write != NULL, "Invalid write callback!", ESP_ERR_INVALID_ARG);
+    _OpenAI_AudioSpeech_t *_audioSpeech = __containerof(audioSpeech, _OpenAI_AudioSpeech_t, parent);
+    char *jsonBody = OpenAI_AudioSpeechBody(_audioSpeech, p);
+    OPENAI_ERROR_CHECK(jsonBody != NULL, "Failed to build request!", ESP_ERR_NO_MEM);
+    esp_err_t err = _audioSpeech->oai->stream(_audioSpeech->oai, endpoint, jsonBody, write, ctx);
+    free(jsonBody);
+    return err;
+}
+
+#if CONFIG_ENABLE_ASYNC
+static int OpenAI_AudioSpeechAsyncWrite(void *ctx, const uint8_t *data, size_t len)
+{
+    _OpenAI_AsyncRequest_t *request = (_OpenAI_AsyncRequest_t *)ctx;
+    if (request->cancelled) {
+        return -1;
+    }
+    return OpenAI_BufferWrite(&request->received, data, len);
+}
+
+static void OpenAI_AudioSpeechAsyncRun(_OpenAI_AsyncRequest_t *request)
+{
+    esp_err_t err = OpenAI_AudioSpeechMessageStream((OpenAI_AudioSpeech_t *)request->object, request->text, &OpenAI_AudioSpeechAsyncWrite, request);
+    if (err == ESP_OK && request->received.len > 0) {
+        // The response takes over the received buffer
+        request->result = OpenAI_SpeechResponseCreate(request->received.data, request->received.len);
+    }
+    if (request->result == NULL) {
+        free(request->received.data);
+    }
+    request->received = (OpenAI_Buffer_t) {0};
+}
+
+static void OpenAI_AudioSpeechAsyncFree(void *result)
+{
+    OpenAI_SpeechResponse_t *response = (OpenAI_SpeechResponse_t *)result;
+    response->delete (response);
+}
+
+static OpenAI_AsyncRequest_t *OpenAI_AudioSpeechMessageAsync(OpenAI_AudioSpeech_t *audioSpeech, const char *p, const OpenAI_Async_Config_t *config)
+{
+    _OpenAI_AudioSpeech_t *_audioSpeech = __containerof(audioSpeech, _OpenAI_AudioSpeech_t, parent);
+    _OpenAI_AsyncRequest_t *request = OpenAI_AsyncRequestCreate(_audioSpeech->oai, audioSpeech, config);
+    OPENAI_ERROR_CHECK(request != NULL, "Failed to create async request!", NULL);
+    request->run = &OpenAI_AudioSpeechAsyncRun;
+    request->free_result = &OpenAI_AudioSpeechAsyncFree;
+    request->text = strdup(p);
+    if (request->text == NULL) {
+        ESP_LOGE(TAG, "strdup failed!");
+        request->refs = 1;
+        OpenAI_AsyncRelease(request);
+        return NULL;
+    }
+    return OpenAI_AsyncSubmit(request);
+}
+#endif
+
+static OpenAI_AudioSpeech_t *OpenAI_AudioSpeechCreate(OpenAI_t *openai)
+{
+    _OpenAI_AudioSpeech_t *_audioCreateSpeech = (_OpenAI_AudioSpeech_t *)calloc(1, sizeof(_OpenAI_AudioSpeech_t));
+    OPENAI_ERROR_CHECK(_audioCreateSpeech != NULL, "Failed to allocate _audioCreateSpeech!", NULL);
+
+    _audioCreateSpeech->oai = __containerof(openai, _OpenAI_t, parent);
+    _audioCreateSpeech->response_format = OPENAI_AUDIO_OUTPUT_FORMAT_MP3;
+    _audioCreateSpeech->parent.setModel = &OpenAI_AudioSpeechSetModel;
+    _audioCreateSpeech->parent.setVoice = &OpenAI_AudioSpeechSetVoice;
+    _audioCreateSpeech->parent.setSpeed = &OpenAI_AudioSpeechSetSpeed;
+    _audioCreateSpeech->parent.setResponseFormat = &OpenAI_AudioSpeechSetResponseFormat;
+    _audioCreateSpeech->parent.speech = &OpenAI_AudioSpeechMessage;
+    _audioCreateSpeech->parent.speechStream = &OpenAI_AudioSpeechMessageStream;
+#if CONFIG_ENABLE_ASYNC
+    _audioCreateSpeech->parent.speechAsync = &OpenAI_AudioSpeechMessageAsync;
+#endif
+
+    return &_audioCreateSpeech->parent;
+}
+
+/**
+ * @brief Transcribes audio into the input language.
+ *
+ */
+typedef struct {
+    OpenAI_AudioTranscription_t parent;              /*!< Base object */
+    _OpenAI_t *oai;                                  /*!< Pointer to the OpenAI object */
+    char *prompt;                                    /*!< An optional text to guide the model's style or continue a previous audio segment. The prompt should match the audio language. */
+    OpenAI_Audio_Response_Format response_format;    /*!< The format of the transcript output, in one of these options: "json", "text", "srt", "verbose_json", or "vtt". */
+    float temperature;                               /*!< float between 0 and 2. Higher value gives more random results. */
+    char *language;                                  /*!< The language of the input audio. Supplying the input language in ISO-639-1 format will improve accuracy and latency. */
+} _OpenAI_AudioTranscription_t;
+
+static const char *audio_response_formats[] = {"json", "text", "srt", "verbose_json", "vtt"};
+
+static void OpenAI_AudioTranscriptionDelete(OpenAI_AudioTranscription_t *audioTranscription)
+{
+    _OpenAI_AudioTranscription_t *_audioTranscription = __containerof(audioTranscription, _OpenAI_AudioTranscription_t, parent);
+    if (_audioTranscription != NULL) {
+        if (_audioTranscription->prompt != NULL) {
+            free(_audioTranscription->prompt);
+            _audioTranscription->prompt = NULL;
+        }
+        if (_audioTranscription->language != NULL) {
+            free(_audioTranscription->language);
+            _audioTranscription->language = NULL;
+        }
+        free(_audioTranscription);
+        _audioTranscription = NULL;
+    }
+}
+
+static void OpenAI_AudioTranscriptionSetPrompt(OpenAI_AudioTranscription_t *audioTranscription, const char *p)
+{
+    _OpenAI_AudioTranscription_t *_audioTranscription = __containerof(audioTranscription, _OpenAI_AudioTranscription_t, parent);
+    if (_audioTranscription->prompt != NULL) {
+        free(_audioTranscription->prompt);
+        _audioTranscription->prompt = NULL;
+    }
+    if (p != NULL) {
+        _audioTranscription->prompt = strdup(p);
+    }
+}
+
+static void OpenAI_AudioTranscriptionSetResponseFormat(OpenAI_AudioTranscription_t *audioTranscription, OpenAI_Audio_Response_Format rf)
+{
+    _OpenAI_AudioTranscription_t *_audioTranscription = __containerof(audioTranscription, _OpenAI_AudioTranscription_t, parent);
+    if (rf >= OPENAI_AUDIO_RESPONSE_FORMAT_JSON && rf <= OPENAI_AUDIO_RESPONSE_FORMAT_VTT) {
+        _audioTranscription->response_format = rf;
+    }
+}
+
+static void OpenAI_AudioTranscriptionSetTemperature(OpenAI_AudioTranscription_t *audioTranscription, float t)
+{
+    _OpenAI_AudioTranscription_t *_audioTranscription = __containerof(audioTranscription, _OpenAI_AudioTranscription_t, parent);
+    if (t >= 0 && t <= 2.0) {
+        _audioTranscription->temperature = t;
+    }
+}
+
+static void OpenAI_AudioTranscriptionSetLanguage(OpenAI_AudioTranscription_t *audioTranscription, const char *l)
+{
+    _OpenAI_AudioTranscription_t *_audioTranscription = __containerof(audioTranscription, _OpenAI_AudioTranscription_t, parent);
+    if (_audioTranscription->language != NULL) {
+        free(_audioTranscription->language);
+        _audioTranscription->language = NULL;
+    }
+    if (l != NULL) {
+        _audioTranscription->language = strdup(l);
+    }
+}
+
+static char *OpenAI_AudioTranscriptionUpload(OpenAI_AudioTranscription_t *audioTranscription, const OpenAI_Body_Part_t *audio, size_t count, OpenAI_Audio_Input_Format f)
+{
+    const char *endpoint = "audio/transcriptions";
+    OpenAI_Multipart_t mp = {0};
+    _OpenAI_AudioTranscription_t *_audioTranscription = __containerof(audioTranscription, _OpenAI_AudioTranscription_t, parent);
+    multipartAddField(&mp, "model", "whisper-1");
+    if (_audioTranscription->prompt != NULL) {
+        multipartAddField(&mp, "prompt", "%s", _audioTranscription->prompt);
+    }
+    if (_audioTranscription->response_format != OPENAI_AUDIO_RESPONSE_FORMAT_JSON) {
+        multipartAddField(&mp, "response_format", "%s", audio_response_formats[_audioTranscription->response_format]);
+    }
+    if (_audioTranscription->temperature != 0) {
+        multipartAddField(&mp, "temperature", "%f", _audioTranscription->temperature);
+    }
+    if (_audioTranscription->language != NULL) {
+        multipartAddField(&mp, "language", "%s", _audioTranscription->language);
+    }
+    char filename[16];
+    snprintf(filename, sizeof(filename), "audio.%s", audio_input_formats[f]);
+    multipartAddFile(&mp, "file", filename, audio_input_mime[f], audio, count);
+    char *result = NULL;
+    OPENAI_ERROR_CHECK_GOTO(multipartFinish(&mp), "Failed to allocate request body!", end);
+#if CONFIG_ENABLE_JSON_SCAN
+    result = OpenAI_AudioTextUpload(_audioTranscription->oai, endpoint, mp.parts, mp.count);
+#else
+    result = _audioTranscription->oai->upload(_audioTranscription->oai, endpoint, mp.parts, mp.count);
+#endif
+end:
+    multipartFree(&mp);
+#if CONFIG_ENABLE_JSON_SCAN
+    return result;
+#else
+    OPENAI_ERROR_CHECK(result != NULL, "Empty result!", NULL);
+    cJSON *json = OpenAI_JsonParse(result);
+    free(result);
+    result = NULL;
+    char *error = getJsonError(json);
+    if (error != NULL) {
+        if (strcmp(error, "cJSON_Parse failed!") == 0) {
+            free(error);
+            error = NULL;
+        }
+        result = error;
+    } else {
+        if (cJSON_HasObjectItem(json, "text")) {
+            cJSON *text = cJSON_GetObjectItem(json, "text");
+            result = strdup(cJSON_GetStringValue(text));
+        }
+    }
+
+    OpenAI_JsonDelete(json);
+    return result;
+#endif
+}
+
+static char *OpenAI_AudioTranscriptionFile(OpenAI_AudioTranscription_t *audioTranscription, uint8_t *audio_data, size_t audio_len, OpenAI_Audio_Input_Format f)
+{
+    OpenAI_Body_Part_t audio = { .data = audio_data, .len = audio_len };
+    return OpenAI_AudioTranscriptionUpload(audioTranscription, &audio, 1, f);
+}
+
+static char *OpenAI_AudioTranscriptionFileStream(OpenAI_AudioTranscription_t *audioTranscription, OpenAI_Read_Cb read, void *ctx, size_t audio_len, OpenAI_Audio_Input_Format f)
+{
+    OPENAI_ERROR_CHECK(read != NULL, "Invalid read callback!", NULL);
+    OpenAI_Body_Part_t audio = { .len = audio_len, .read = read, .ctx = ctx };
+    return OpenAI_AudioTranscriptionUpload(audioTranscription, &audio, 1, f);
+}
+
+static char *OpenAI_AudioTranscriptionFilePcm(OpenAI_AudioTranscription_t *audioTranscription, const uint8_t *pcm_data, size_t pcm_len, uint32_t sample_rate, uint8_t bits, uint8_t channels)
+{
+    uint8_t header[OPENAI_WAV_HEADER_SIZE];
+    OPENAI_ERROR_CHECK(OpenAI_WavHeader(header, pcm_len, sample_rate, bits, channels), "Failed to build WAV header!", NULL);
+    OpenAI_Body_Part_t audio[] = {
+        { .data = header, .len = sizeof(header) },
+        { .data = pcm_data, .len = pcm_len },
+    };
+    return OpenAI_AudioTranscriptionUpload(audioTranscription, audio, 2, OPENAI_AUDIO_INPUT_FORMAT_WAV);
+}
+
+static char *OpenAI_AudioTranscriptionFilePcmStream(OpenAI_AudioTranscription_t *audioTranscription, OpenAI_Read_Cb read, void *ctx, size_t pcm_len, uint32_t sample_rate, uint8_t bits, uint8_t channels)
+{
+    OPENAI_ERROR_CHECK(read != NULL, "Invalid read callback!", NULL);
+    uint8_t header[OPENAI_WAV_HEADER_SIZE];
+    OPENAI_ERROR_CHECK(OpenAI_WavHeader(header, pcm_len, sample_rate, bits, channels), "Failed to build WAV header!", NULL);
+    OpenAI_Body_Part_t audio[] = {
+        { .data = header, .len = sizeof(header) },
+        { .len = pcm_len, .read = read, .ctx = ctx },
+    };
+    return OpenAI_AudioTranscriptionUpload(audioTranscription, audio, 2, OPENAI_AUDIO_INPUT_FORMAT_WAV);
+}
+
+#if CONFIG_ENABLE_ASYNC
+static int OpenAI_AudioTranscriptionAsyncRead(void *ctx, uint8_t *buf, size_t len)
+{
+    _OpenAI_AsyncRequest_t *request = (_OpenAI_AsyncRequest_t *)ctx;
+    if (request->cancelled) {
+        return -1;
+    }
+    size_t left = request->audio_len - request->audio_pos;
+    if (len > left) {
+        len = left;
+    }
+    memcpy(buf, request->audio + request->audio_pos, len);
+    request->audio_pos += len;
+    return len;
+}
+
+static void OpenAI_AudioTranscriptionAsyncRun(_OpenAI_AsyncRequest_t *request)
+{
+    // Uploaded through a read callback, so a cancelled request stops at the next chunk of audio
+    request->result = OpenAI_AudioTranscriptionFileStream((OpenAI_AudioTranscription_t *)request->object, &OpenAI_AudioTranscriptionAsyncRead, request, request->audio_len, request->format);
+}
+
+static OpenAI_AsyncRequest_t *OpenAI_AudioTranscriptionFileAsync(OpenAI_AudioTranscription_t *audioTranscription, const uint8_t *audio_data, size_t audio_len, OpenAI_Audio_Input_Format f, const OpenAI_Async_Config_t *config)
+{
+    _OpenAI_AudioTranscription_t *_audioTranscription = __containerof(audioTranscription, _OpenAI_AudioTranscription_t, parent);
+    _OpenAI_AsyncRequest_t *request = OpenAI_AsyncRequestCreate(_audioTranscription->oai, audioTranscription, config);
+    OPENAI_ERROR_CHECK(request != NULL, "Failed to create async request!", NULL);
+    request->run = &OpenAI_AudioTranscriptionAsyncRun;
+    request->free_result = &free;
+    request->audio = audio_data;
+    request->audio_len = audio_len;
+    request->format = f;
+    return OpenAI_AsyncSubmit(request);
+}
+#endif
+
+static OpenAI_AudioTranscription_t *OpenAI_AudioTranscriptionCreate(OpenAI_t *openai)
+{
+    _OpenAI_AudioTranscription_t *_audioTranscription = (_OpenAI_AudioTranscription_t *)calloc(1, sizeof(_OpenAI_AudioTranscription_t));
+    OPENAI_ERROR_CHECK(_audioTranscription != NULL, "Failed to allocate _audioTranscription!", NULL);
+
+    _audioTranscription->oai = __containerof(openai, _OpenAI_t, parent);
+    _audioTranscription->response_format = OPENAI_AUDIO_RESPONSE_FORMAT_JSON;
+
+    _audioTranscription->parent.setPrompt = &OpenAI_AudioTranscriptionSetPrompt;
+    _audioTranscription->parent.setResponseFormat = &OpenAI_AudioTranscriptionSetResponseFormat;
+    _audioTranscription->parent.setTemperature = &OpenAI_AudioTranscriptionSetTemperature;
+    _audioTranscription->parent.setLanguage = &OpenAI_AudioTranscriptionSetLanguage;
+    _audioTranscription->parent.file = &OpenAI_AudioTranscriptionFile;
+    _audioTranscription->parent.fileStream = &OpenAI_AudioTranscriptionFileStream;
+    _audioTranscription->parent.filePcm = &OpenAI_AudioTranscriptionFilePcm;
+    _audioTranscription->parent.filePcmStream = &OpenAI_AudioTranscriptionFilePcmStream;
+#if CONFIG_ENABLE_ASYNC
+    _audioTranscription->parent.fileAsync = &OpenAI_AudioTranscriptionFileAsync;
+#endif
+    return &_audioTranscription->parent;
+}
+
+// audio/translations { //Translates audio into into English.
+//   "file": "german.m4a",//required. The audio file to translate, in one of these formats: mp3, mp4, mpeg, mpga, m4a, wav, or webm.
+//   "model": "whisper-1",//required. ID of the model to use. Only whisper-1 is currently available.
+//   "prompt": "A cute baby sea otter",//An optional text to guide the model's style or continue a previous audio segment. The prompt should match the audio language.
+//   "response_format": "json",//string. The format of the transcript output, in one of these options: "json", "text", "srt", "verbose_json", or "vtt".
+//   "temperature": 1//float between 0 and 2
+// }
+
+/**
+ * @brief Translates audio into into English.
+ *
+ */
+typedef struct {
+    OpenAI_AudioTranslation_t parent;               /*!< Parent object member */
+    _OpenAI_t *oai;                                 /*!< Pointer to the OpenAI object */
+    char *prompt;                                   /*!< An optional text to guide the model's style or continue a previous audio segment. The prompt should match the audio language. */
+    OpenAI_Audio_Response_Format response_format;   /*!< The format of the transcript output, in one of these options: "json", "text", "srt", "verbose_json", or "vtt". */
+    float temperature;                              /*!< float between 0 and 2. Higher value gives more random results. */
+} _OpenAI_AudioTranslation_t;
+
+static void OpenAI_AudioTranslationDelete(OpenAI_AudioTranslation_t *audioTranslation)
+{
+    _OpenAI_AudioTranslation_t *_audioTranslation = __containerof(audioTranslation, _OpenAI_AudioTranslation_t, parent);
+    if (_audioTranslation != NULL) {
+        if (_audioTranslation->prompt != NULL) {
+            free(_audioTranslation->prompt);
+            _audioTranslation->prompt = NULL;
+        }
+        free(_audioTranslation);
+        _audioTranslation = NULL;
+    }
+}
+
+static void OpenAI_AudioTranslationSetPrompt(OpenAI_AudioTranslation_t *audioTranslation, const char *p)
+{
+    _OpenAI_AudioTranslation_t *_audioTranslation = __containerof(audioTranslation, _OpenAI_AudioTranslation_t, parent);
+    if (_audioTranslation->prompt != NULL) {
+        free(_audioTranslation->prompt);
+        _audioTranslation->prompt = NULL;
+    }
+    if (p != NULL) {
+        _audioTranslation->prompt = strdup(p);
+    }
+}
+
+static void OpenAI_AudioTranslationSetResponseFormat(OpenAI_AudioTranslation_t *audioTranslation, OpenAI_Audio_Response_Format rf)
+{
+    _OpenAI_AudioTranslation_t *_audioTranslation = __containerof(audioTranslation, _OpenAI_AudioTranslation_t, parent);
+    if (rf >= OPENAI_AUDIO_RESPONSE_FORMAT_JSON && rf <= OPENAI_AUDIO_RESPONSE_FORMAT_VTT) {
+        _audioTranslation->response_format = rf;
+    }
+}
+
+static void OpenAI_AudioTranslationSetTemperature(OpenAI_AudioTranslation_t *audioTranslation, float t)
+{
+    _OpenAI_AudioTranslation_t *_audioTranslation = __containerof(audioTranslation, _OpenAI_AudioTranslation_t, parent);
+    if (t >= 0 && t <= 2.0) {
+        _audioTranslation->temperature = t;
+    }
+}
+
+static char *OpenAI_AudioTranslationUpload(OpenAI_AudioTranslation_t *audioTranslation, const OpenAI_Body_Part_t *audio, size_t count, OpenAI_Audio_Input_Format f)
+{
+    const char *endpoint = "audio/translations";
+    OpenAI_Multipart_t mp = {0};
+    _OpenAI_AudioTranslation_t *_audioTranslation = __containerof(audioTranslation, _OpenAI_AudioTranslation_t, parent);
+    multipartAddField(&mp, "model", "whisper-1");
+    if (_audioTranslation->prompt != NULL) {
+        multipartAddField(&mp, "prompt", "%s", _audioTranslation->prompt);
+    }
+    if (_audioTranslation->response_format != OPENAI_AUDIO_RESPONSE_FORMAT_JSON) {
+        multipartAddField(&mp, "response_format", "%s", audio_response_formats[_audioTranslation->response_format]);
+    }
+    if (_audioTranslation->temperature != 0) {
+        multipartAddField(&mp, "temperature", "%f", _audioTranslation->temperature);
+    }
+    char filename[16];
+    snprintf(filename, sizeof(filename), "audio.%s", audio_input_formats[f]);
+    multipartAddFile(&mp, "file", filename, audio_input_mime[f], audio, count);
+    char *result = NULL;
+    OPENAI_ERROR_CHECK_GOTO(multipartFinish(&mp), "Failed to allocate request body!", end);
+#if CONFIG_ENABLE_JSON_SCAN
+    result = OpenAI_AudioTextUpload(_audioTranslation->oai, endpoint, mp.parts, mp.count);
+#else
+    result = _audioTranslation->oai->upload(_audioTranslation->oai, endpoint, mp.parts, mp.count);
+#endif
+end:
+    multipartFree(&mp);
+#if CONFIG_ENABLE_JSON_SCAN
+    return result;
+#else
+    OPENAI_ERROR_CHECK(result != NULL, "Empty result!", NULL);
+    cJSON *json = OpenAI_JsonParse(result);
+    char *error = getJsonError(json);
+    if (error != NULL) {
+        ESP_LOGE(TAG, "%s", error);
+    } else {
+        free(result);
+        if (cJSON_HasObjectItem(json, "text")) {
+            cJSON *text = cJSON_GetObjectItem(json, "text");
+            result = strdup(cJSON_GetStringValue(text));
+        }
+    }
+    OpenAI_JsonDelete(json);
+    return result;
+#endif
+}
+
+static char *OpenAI_AudioTranslationFile(OpenAI_AudioTranslation_t *audioTranslation, uint8_t *audio_data, size_t audio_len, OpenAI_Audio_Input_Format f)
+{
+    OpenAI_Body_Part_t audio = { .data = audio_data, .len = audio_len };
+    return OpenAI_AudioTranslationUpload(audioTranslation, &audio, 1, f);
+}
+
+static char *OpenAI_AudioTranslationFileStream(OpenAI_AudioTranslation_t *audioTranslation, OpenAI_Read_Cb read, void *ctx, size_t audio_len, OpenAI_Audio_Input_Format f)
+{
+    OPENAI_ERROR_CHECK(read != NULL, "Invalid read callback!", NULL);
+    OpenAI_Body_Part_t audio = { .len = audio_len, .read = read, .ctx = ctx };
+    return OpenAI_AudioTranslationUpload(audioTranslation, &audio, 1, f);
+}
+
+static char *OpenAI_AudioTranslationFilePcm(OpenAI_AudioTranslation_t *audioTranslation, const uint8_t *pcm_data, size_t pcm_len, uint32_t sample_rate, uint8_t bits, uint8_t channels)
+{
+    uint8_t header[OPENAI_WAV_HEADER_SIZE];
+    OPENAI_ERROR_CHECK(OpenAI_WavHeader(header, pcm_len, sample_rate, bits, channels), "Failed to build WAV header!", NULL);
+    OpenAI_Body_Part_t audio[] = {
+        { .data = header, .len = sizeof(header) },
+        { .data = pcm_data, .len = pcm_len },
+    };
+    return OpenAI_AudioTranslationUpload(audioTranslation, audio, 2, OPENAI_AUDIO_INPUT_FORMAT_WAV);
+}
+
+static char *OpenAI_AudioTranslationFilePcmStream(OpenAI_AudioTranslation_t *audioTranslation, OpenAI_Read_Cb read, void *ctx, size_t pcm_len, uint32_t sample_rate, uint8_t bits, uint8_t channels)
+{
+    OPENAI_ERROR_CHECK(read != NULL, "Invalid read callback!", NULL);
+    uint8_t header[OPENAI_WAV_HEADER_SIZE];
+    OPENAI_ERROR_CHECK(OpenAI_WavHeader(header, pcm_len, sample_rate, bits, channels), "Failed to build WAV header!", NULL);
+    OpenAI_Body_Part_t audio[] = {
+        { .data = header, .len = sizeof(header) },
+        { .len = pcm_len, .read = read, .ctx = ctx },
+    };
+    return OpenAI_AudioTranslationUpload(audioTranslation, audio, 2, OPENAI_AUDIO_INPUT_FORMAT_WAV);
+}
+
+static OpenAI_AudioTranslation_t *OpenAI_AudioTranslationCreate(OpenAI_t *openai)
+{
+    _OpenAI_AudioTranslation_t *_audioTranslation = (_OpenAI_AudioTranslation_t *)calloc(1, sizeof(_OpenAI_AudioTranslation_t));
+    OPENAI_ERROR_CHECK(_audioTranslation != NULL, "Failed to allocate _audioTranslation!", NULL);
+    _audioTranslation->oai = __containerof(openai, _OpenAI_t, parent);
+    _audioTranslation->response_format = OPENAI_AUDIO_RESPONSE_FORMAT_JSON;
+
+    _audioTranslation->parent.setPrompt = &OpenAI_AudioTranslationSetPrompt;
+    _audioTranslation->parent.setResponseFormat = &OpenAI_AudioTranslationSetResponseFormat;
+    _audioTranslation->parent.setTemperature = &OpenAI_AudioTranslationSetTemperature;
+    _audioTranslation->parent.file = &OpenAI_AudioTranslationFile;
+    _audioTranslation->parent.fileStream = &OpenAI_AudioTranslationFileStream;
+    _audioTranslation->parent.filePcm = &OpenAI_AudioTranslationFilePcm;
+    _audioTranslation->parent.filePcmStream = &OpenAI_AudioTranslationFilePcmStream;
+    return &_audioTranslation->parent;
+}
+
+// embeddings { //Creates an embedding vector representing the input text.
+//   "model": "text-embedding-ada-002",//required
+//   "input": "The food was delicious and the waiter...",//required string or array. Input text to get embeddings for, encoded as a string or array of tokens. To get embeddings for multiple inputs in a single request, pass an array of strings or array of token arrays. Each input must not exceed 8192 tokens in length.
+//   "user": null//string. A unique identifier representing your end-user, which can help OpenAI to monitor and detect abuse.
+// }
+
+/**
+ * @brief Get a vector representation of a given input that can be easily consumed by machine learning models and algorithms.
+ *
+ * @param openai Pointer to the OpenAI object
+ * @param input Input text to embed, encoded as a string or array of tokens. To embed multiple inputs in a single request,
+ *              pass an array of strings or array of token arrays. Each input must not exceed the max input tokens for the model (8191 tokens for text-embedding-ada-002).
+ * @param model ID of the model to use.
+ * @param user A unique identifier representing your end-user, which can help OpenAI to monitor and detect abuse.
+ * @return Pointer to the OpenAI_EmbeddingResponse_t.
+ */
+OpenAI_EmbeddingResponse_t *OpenAI_EmbeddingCreate(OpenAI_t *openai, char *input, const char *model, const char *user)
+{
+    const char *endpoint = "embeddings";
+    OpenAI_EmbeddingResponse_t *result = NULL;
+    cJSON *req = OpenAI_JsonCreateObject();
+
+    OPENAI_ERROR_CHECK(req != NULL, "cJSON_CreateObject failed!", NULL);
+    reqAddString("model", (model == NULL) ? "text-embedding-ada-002" : model);
+    if (input[0] == '[') {
+        cJSON *in = cJSON_Parse(input);
+        if (in == NULL) {
+            ESP_LOGE(TAG, "cJSON_Parse failed!");
+            OpenAI_JsonDelete(req);
+            return NULL;
+        }
+        reqAddItem("input", in);
+    } else {
+        reqAddString("input", input);
+    }
+    if (user != NULL) {
+        reqAddString("user", user);
+    }
+    char *jsonBody = OpenAI_JsonPrint(req, strlen(input));
+    OpenAI_JsonDelete(req);
+    OPENAI_ERROR_CHECK(jsonBody != NULL, "Request could not be serialized", NULL);
+    _OpenAI_t *_openai = __containerof(openai, _OpenAI_t, parent);
+    result = OpenAI_EmbeddingResponseRequest(_openai, endpoint, jsonBody);
+    free(jsonBody);
+    return result;
+}
+
+// moderations { //Classifies if text violates OpenAI's Content Policy
+//   "input": "I want to kill them.",//required string or array
+//   "model": "text-moderation-latest"//optional. Two content moderations models are available: text-moderation-stable and text-moderation-latest.
+// }
+
+/**
+ * @brief Given a input text, outputs if the model classifies it as violating OpenAI's content policy.
+ *
+ * @param openai Pointer to the OpenAI object
+ * @param input The input text to classify
+ * @param model Two content moderations models are available: text-moderation-stable and text-moderation-latest.
+ * @return Pointer to the OpenAI_ModerationResponse_t
+ */
+OpenAI_ModerationResponse_t *OpenAI_ModerationCreate(OpenAI_t *openai, char *input, const char *model)
+{
+    const char *endpoint = "moderations";
+    OpenAI_ModerationResponse_t *result = NULL;
+    char *res = NULL;
+    cJSON *req = OpenAI_JsonCreateObject();
+    OPENAI_ERROR_CHECK(req != NULL, "cJSON_CreateObject failed!", NULL);
+    if (input[0] == '[') {
+        cJSON *in = cJSON_Parse(input);
+        if (in == NULL) {
+            ESP_LOGE(TAG, "cJSON_Parse failed!");
+            OpenAI_JsonDelete(req);
+            return NULL;
+        }
+        reqAddItem("input", in);
+    } else {
+        reqAddString("input", input);
+    }
+    if (model != NULL) {
+        reqAddString("model", model);
+    }
+    char *jsonBody = OpenAI_JsonPrint(req, strlen(input));
+    OpenAI_JsonDelete(req);
+    OPENAI_ERROR_CHECK(jsonBody != NULL, "Request could not be serialized", NULL);
+    _OpenAI_t *_openai = __containerof(openai, _OpenAI_t, parent);
+    res = _openai->post(_openai, endpoint, jsonBody);
+    free(jsonBody);
+    OPENAI_ERROR_CHECK(res != NULL, "Empty result!", NULL);
+    return OpenAI_ModerationResponseCreate(res);
+}
+
+void OpenAIChangeBaseURL(OpenAI_t *oai, const char *baseURL)
+{
+    _OpenAI_t *_oai = __containerof(oai, _OpenAI_t, parent);
+    if (_oai->base_url != NULL) {
+        free(_oai->base_url);
+    }
+    _oai->base_url = strdup(baseURL);
+}
+
+esp_err_t OpenAI_TransportWriteBody(const OpenAI_Body_Part_t *parts, size_t count, OpenAI_Body_Write_Cb write, void *ctx)
+{
+    uint8_t *chunk = NULL;
+    for (size_t i = 0; i < count; i++) {
+        const OpenAI_Body_Part_t *part = &parts[i];
+        if (part->data != NULL || part->len == 0) {
+            OPENAI_ERROR_CHECK_GOTO(write(ctx, (const char *)part->data, part->len) == 0, "Failed to write client!", fail);
+            continue;
+        }
+        // Data from a read callback goes through one small chunk buffer
+        if (chunk == NULL) {
+            chunk = (uint8_t *)malloc(OPENAI_UPLOAD_CHUNK_SIZE);
+            OPENAI_ERROR_CHECK_GOTO(chunk != NULL, "Failed to allocate upload chunk!", fail);
+        }
+        size_t remaining = part->len;
+        while (remaining > 0) {
+            int rlen = part->read(part->ctx, chunk, remaining < OPENAI_UPLOAD_CHUNK_SIZE ? remaining : OPENAI_UPLOAD_CHUNK_SIZE);
+            OPENAI_ERROR_CHECK_GOTO(rlen > 0 && (size_t)rlen <= remaining, "Upload read callback failed!", fail);
+            OPENAI_ERROR_CHECK_GOTO(write(ctx, (const char *)chunk, rlen) == 0, "Failed to write client!", fail);
+            remaining -= rlen;
+        }
+    }
+    free(chunk);
+    return ESP_OK;
+
+fail:
+    free(chunk);
+    return ESP_FAIL;
+}
+
+//
+// Request profiles
+//
+
+#if CONFIG_REQUEST_RETRIES > 0
+#define OPENAI_REQUEST_RETRY_DELAY_MS CONFIG_REQUEST_RETRY_DELAY
+#else
+#define OPENAI_REQUEST_RETRY_DELAY_MS 0
+#endif
+
+static const struct {
+    const char *prefix;
+    OpenAI_Request_Class requestClass;
+} request_classes[] = {
+    { "chat/", OPENAI_REQUEST_CLASS_CHAT },
+    { "completions", OPENAI_REQUEST_CLASS_CHAT },
+    { "edits", OPENAI_REQUEST_CLASS_CHAT },
+    { "audio/speech", OPENAI_REQUEST_CLASS_SPEECH },
+    { "audio/", OPENAI_REQUEST_CLASS_AUDIO_TEXT },
+    { "images/", OPENAI_REQUEST_CLASS_IMAGE },
+};
+
+static OpenAI_Request_Class OpenAI_RequestClass(const char *endpoint)
+{
+    for (size_t i = 0; i < sizeof(request_classes) / sizeof(request_classes[0]); i++) {
+        if (strncmp(endpoint, request_classes[i].prefix, strlen(request_classes[i].prefix)) == 0) {
+            return request_classes[i].requestClass;
+        }
+    }
+    return OPENAI_REQUEST_CLASS_DEFAULT;
+}
+
+static void OpenAI_RequestProfilesInit(_OpenAI_t *oai)
+{
+    // Time to the response headers and to the end of the response, generated text and images take longest
+    static const uint32_t timeouts[OPENAI_REQUEST_CLASS_MAX][2] = {
+        [OPENAI_REQUEST_CLASS_DEFAULT] = { 30000, 60000 },
+        [OPENAI_REQUEST_CLASS_CHAT] = { 30000, 120000 },
+        [OPENAI_REQUEST_CLASS_AUDIO_TEXT] = { 30000, 60000 },
+        [OPENAI_REQUEST_CLASS_SPEECH] = { 20000, 60000 },
+        [OPENAI_REQUEST_CLASS_IMAGE] = { 60000, 120000 },
+    };
+    for (int i = 0; i < OPENAI_REQUEST_CLASS_MAX; i++) {
+        OpenAI_Request_Profile_t *profile = &oai->profiles[i];
+        profile->connect_timeout_ms = CONFIG_REQUEST_CONNECT_TIMEOUT;
+        profile->ttfb_timeout_ms = timeouts[i][0];
+        profile->timeout_ms = timeouts[i][1];
+        profile->retries = CONFIG_REQUEST_RETRIES;
+        profile->retry_delay_ms = OPENAI_REQUEST_RETRY_DELAY_MS;
+#if CONFIG_ENABLE_REQUEST_HEDGING
+        profile->hedge = (i == OPENAI_REQUEST_CLASS_AUDIO_TEXT || i == OPENAI_REQUEST_CLASS_SPEECH);
+#endif
+    }
+}
+
+void OpenAISetRequestProfile(OpenAI_t *oai, OpenAI_Request_Class requestClass, const OpenAI_Request_Profile_t *profile)
+{
+    OPENAI_ERROR_CHECK_RETURN_VOID(requestClass < OPENAI_REQUEST_CLASS_MAX && profile != NULL, "Invalid request profile!");
+    _OpenAI_t *_oai = __containerof(oai, _OpenAI_t, parent);
+    _oai->profiles[requestClass] = *profile;
+}
+
+void OpenAIGetRequestProfile(OpenAI_t *oai, OpenAI_Request_Class requestClass, OpenAI_Request_Profile_t *profile)
+{
+    OPENAI_ERROR_CHECK_RETURN_VOID(requestClass < OPENAI_REQUEST_CLASS_MAX && profile != NULL, "Invalid request profile!");
+    _OpenAI_t *_oai = __containerof(oai, _OpenAI_t, parent);
+    *profile = _oai->profiles[requestClass];
+}
+
+static bool OpenAI_BodyReplayable(const OpenAI_Body_Part_t *parts, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (parts[i].data == NULL && parts[i].len > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool OpenAI_StatusRetryable(int status)
+{
+    return status == 408 || status == 429 || status == 500 || status == 502 || status == 503 || status == 504;
+}
+
+#if CONFIG_ENABLE_REQUEST_HEDGING
+static void OpenAI_LatencyRecord(_OpenAI_t *oai, OpenAI_Request_Class requestClass, TickType_t start)
+{
+    if (oai->hedge_lock == NULL) {
+        return;
+    }
+    uint32_t ms = pdTICKS_TO_MS(xTaskGetTickCount() - start);
+    xSemaphoreTake(oai->hedge_lock, portMAX_DELAY);
+    OpenAI_Latency_t *latency = &oai->latency[requestClass];
+    latency->ms[latency->next] = ms;
+    latency->next = (latency->next + 1) % OPENAI_LATENCY_SAMPLES;
+    if (latency->count < OPENAI_LATENCY_SAMPLES) {
+        latency->count++;
+    }
+    xSemaphoreGive(oai->hedge_lock);
+}
+
+/**
+ * @brief The CONFIG_REQUEST_HEDGE_PERCENTILE of the latency of recent successful requests of a class,
+ *        0 while there are too few of them.
+ *
+ */
+static uint32_t OpenAI_HedgeDelayMs(_OpenAI_t *oai, OpenAI_Request_Class requestClass)
+{
+    uint32_t sorted[OPENAI_LATENCY_SAMPLES];
+    xSemaphoreTake(oai->hedge_lock, portMAX_DELAY);
+    const OpenAI_Latency_t *latency = &oai->latency[requestClass];
+    uint32_t count = latency->count;
+    memcpy(sorted, latency->ms, count * sizeof(uint32_t));
+    xSemaphoreGive(oai->hedge_lock);
+    if (count < OPENAI_LATENCY_MIN_SAMPLES) {
+        return 0;
+    }
+    for (uint32_t i = 1; i < count; i++) {
+        uint32_t ms = sorted[i];
+        uint32_t j = i;
+        for (; j > 0 && sorted[j - 1] > ms; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = ms;
+    }
+    uint32_t rank = (count * CONFIG_REQUEST_HEDGE_PERCENTILE + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0] + 1;
+}
+#else
+static inline void OpenAI_LatencyRecord(_OpenAI_t *oai, OpenAI_Request_Class requestClass, TickType_t start)
+{
+}
+#endif
+
+//
+// Request timing
+//
+
+/**
+ * @brief Timing of a request while it runs, reported once it ended.
+ *
+ */
+typedef struct {
+    OpenAI_Request_Timing_t timing;     /*!< Phases of the last attempt and totals of the request */
+    int64_t start_us;                   /*!< Time the request started */
+    int64_t headers_us;                 /*!< Time the response headers of the last attempt arrived, 0 without them */
+} OpenAI_Timer_t;
+
+static void OpenAI_TimerStart(OpenAI_Timer_t *timer)
+{
+    memset(timer, 0, sizeof(OpenAI_Timer_t));
+    timer->start_us = OpenAI_TimeUs();
+}
+
+#if CONFIG_ENABLE_REQUEST_TIMING
+#define OPENAI_TIMING_VALUES 10
+
+// The figures of a timing that are averaged in the endpoint stats
+static void OpenAI_TimingToValues(const OpenAI_Request_Timing_t *timing, uint32_t *values)
+{
+    values[0] = timing->dns_us;
+    values[1] = timing->connect_us;
+    values[2] = timing->tls_us;
+    values[3] = timing->upload_us;
+    values[4] = timing->ttfb_us;
+    values[5] = timing->download_us;
+    values[6] = timing->total_us;
+    values[7] = timing->sent;
+    values[8] = timing->received;
+    values[9] = timing->attempts;
+}
+
+static void OpenAI_TimingFromValues(OpenAI_Request_Timing_t *timing, const uint32_t *values)
+{
+    timing->dns_us = values[0];
+    timing->connect_us = values[1];
+    timing->tls_us = values[2];
+    timing->upload_us = values[3];
+    timing->ttfb_us = values[4];
+    timing->download_us = values[5];
+    timing->total_us = values[6];
+    timing->sent = values[7];
+    timing->received = values[8];
+    timing->attempts = values[9];
+}
+
+/**
+ * @brief The stats of an endpoint, with create a new or the least recently used one is taken for an endpoint
+ *        without stats. Called with timing_lock held.
+ *
+ */
+static OpenAI_EndpointTiming_t *OpenAI_EndpointTimingFind(_OpenAI_t *oai, const char *endpoint, bool create)
+{
+    // Taken for a new endpoint: an empty slot, else the least recently used one
+    int slot = -1;
+    for (int i = 0; i < CONFIG_REQUEST_TIMING_ENDPOINTS; i++) {
+        OpenAI_EndpointTiming_t *stats = oai->endpoint_timing[i];
+        if (stats == NULL) {
+            slot = slot < 0 || oai->endpoint_timing[slot] != NULL ? i : slot;
+            continue;
+        }
+        if (strncmp(stats->endpoint, endpoint, sizeof(stats->endpoint) - 1) == 0) {
+            return stats;
+        }
+        if (slot < 0 || (oai->endpoint_timing[slot] != NULL && stats->last_used < oai->endpoint_timing[slot]->last_used)) {
+            slot = i;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    if (oai->endpoint_timing[slot] == NULL) {
+        oai->endpoint_timing[slot] = (OpenAI_EndpointTiming_t *)malloc(sizeof(OpenAI_EndpointTiming_t));
+        OPENAI_ERROR_CHECK(oai->endpoint_timing[slot] != NULL, "Failed to allocate endpoint stats!", NULL);
+    }
+    OpenAI_EndpointTiming_t *stats = oai->endpoint_timing[slot];
+    memset(stats, 0, sizeof(OpenAI_EndpointTiming_t));
+    snprintf(stats->endpoint, sizeof(stats->endpoint), "%s", endpoint);
+    return stats;
+}
+
+static void OpenAI_TimingRecord(_OpenAI_t *oai, const char *endpoint, const OpenAI_Request_Timing_t *timing, bool success)
+{
+    if (oai->timing_lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(oai->timing_lock, portMAX_DELAY);
+    OpenAI_Timing_Cb cb = oai->timing_cb;
+    void *ctx = oai->timing_ctx;
+    OpenAI_EndpointTiming_t *stats = OpenAI_EndpointTimingFind(oai, endpoint, true);
+    if (stats != NULL) {
+        stats->requests++;
+        stats->last_used = ++oai->timing_seq;
+        if (success) {
+            stats->window[stats->next] = *timing;
+            stats->next = (stats->next + 1) % CONFIG_REQUEST_TIMING_WINDOW;
+            if (stats->count < CONFIG_REQUEST_TIMING_WINDOW) {
+                stats->count++;
+            }
+        } else {
+            stats->failures++;
+        }
+    }
+    xSemaphoreGive(oai->timing_lock);
+    // Outside the lock, the callback may get the stats
+    if (cb != NULL) {
+        cb(ctx, endpoint, timing);
+    }
+}
+
+void OpenAISetTimingCallback(OpenAI_t *oai, OpenAI_Timing_Cb cb, void *ctx)
+{
+    _OpenAI_t *_oai = __containerof(oai, _OpenAI_t, parent);
+    OPENAI_ERROR_CHECK_RETURN_VOID(_oai->timing_lock != NULL, "Request timing unavailable!");
+    xSemaphoreTake(_oai->timing_lock, portMAX_DELAY);
+    _oai->timing_cb = cb;
+    _oai->timing_ctx = ctx;
+    xSemaphoreGive(_oai->timing_lock);
+}
+
+esp_err_t OpenAIGetEndpointStats(OpenAI_t *oai, const char *endpoint, OpenAI_Endpoint_Stats_t *stats)
+{
+    OPENAI_ERROR_CHECK(endpoint != NULL && stats != NULL, "Invalid arguments!", ESP_ERR_INVALID_ARG);
+    _OpenAI_t *_oai = __containerof(oai, _OpenAI_t, parent);
+    OPENAI_ERROR_CHECK(_oai->timing_lock != NULL, "Request timing unavailable!", ESP_ERR_INVALID_STATE);
+    memset(stats, 0, sizeof(OpenAI_Endpoint_Stats_t));
+    uint64_t sum[OPENAI_TIMING_VALUES] = {0};
+    uint32_t max[OPENAI_TIMING_VALUES] = {0};
+    uint32_t values[OPENAI_TIMING_VALUES];
+    xSemaphoreTake(_oai->timing_lock, portMAX_DELAY);
+    const OpenAI_EndpointTiming_t *timing = OpenAI_EndpointTimingFind(_oai, endpoint, false);
+    if (timing != NULL) {
+        stats->requests = timing->requests;
+        stats->failures = timing->failures;
+        stats->window = timing->count;
+        for (uint32_t i = 0; i < timing->count; i++) {
+            stats->reused += timing->window[i].reused;
+            OpenAI_TimingToValues(&timing->window[i], values);
+            for (int v = 0; v < OPENAI_TIMING_VALUES; v++) {
+                sum[v] += values[v];
+                max[v] = values[v] > max[v] ? values[v] : max[v];
+            }
+        }
+    }
+    xSemaphoreGive(_oai->timing_lock);
+    if (timing == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (stats->window > 0) {
+        for (int v = 0; v < OPENAI_TIMING_VALUES; v++) {
+            values[v] = sum[v] / stats->window;
+        }
+        OpenAI_TimingFromValues(&stats->mean, values);
+        OpenAI_TimingFromValues(&stats->max, max);
+    }
+    return ESP_OK;
+}
+
+void OpenAIResetEndpointStats(OpenAI_t *oai)
+{
+    _OpenAI_t *_oai = __containerof(oai, _OpenAI_t, parent);
+    OPENAI_ERROR_CHECK_RETURN_VOID(_oai->timing_lock != NULL, "Request timing unavailable!");
+    xSemaphoreTake(_oai->timing_lock, portMAX_DELAY);
+    for (int i = 0; i < CONFIG_REQUEST_TIMING_ENDPOINTS; i++) {
+        free(_oai->endpoint_timing[i]);
+        _oai->endpoint_timing[i] = NULL;
+    }
+    xSemaphoreGive(_oai->timing_lock);
+}
+
+static void OpenAI_TimingInit(_OpenAI_t *oai)
+{
+    oai->timing_lock = xSemaphoreCreateMutex();
+    OPENAI_ERROR_CHECK_CONTINUE(oai->timing_lock != NULL, "Failed to create timing lock, requests will not be timed!");
+}
+
+static void OpenAI_TimingDeinit(_OpenAI_t *oai)
+{
+    if (oai->timing_lock == NULL) {
+        return;
+    }
+    OpenAIResetEndpointStats(&oai->parent);
+    vSemaphoreDelete(oai->timing_lock);
+    oai->timing_lock = NULL;
+}
+#else
+static inline void OpenAI_TimingRecord(_OpenAI_t *oai, const char *endpoint, const OpenAI_Request_Timing_t *timing, bool success)
+{
+}
+static void OpenAI_TimingInit(_OpenAI_t *oai) {}
+static void OpenAI_TimingDeinit(_OpenAI_t *oai) {}
+#endif
+
+/**
+ * @brief Ends the timing of a request after its exchange was finished and reports it.
+ *
+ * @param success Whether a complete 2xx response was received
+ */
+static void OpenAI_TimerEnd(_OpenAI_t *oai, const char *endpoint, OpenAI_Timer_t *timer, bool success)
+{
+    int64_t now = OpenAI_TimeUs();
+    if (timer->headers_us != 0) {
+        timer->timing.download_us = now - timer->headers_us;
+    }
+    timer->timing.total_us = now - timer->start_us;
+    OpenAI_TimingRecord(oai, endpoint, &timer->timing, success);
+}
+
+/**
+ * @brief Sends a request with the transport of the OpenAI object, with the timeouts of its request profile.
+ *
+ * @return The exchange to read the response from and finish, NULL on failure
+ */
+static void *OpenAI_Send(_OpenAI_t *oai, const char *endpoint, const char *content_type, OpenAI_Http_Method method, const OpenAI_Body_Part_t *parts, size_t count, int *status, int64_t *content_length, OpenAI_Timer_t *timer)
+{
+    const OpenAI_Request_Profile_t *profile = &oai->profiles[OpenAI_RequestClass(endpoint)];
+    OpenAI_Request_Timing_t phases = {0};
+    OpenAI_Http_Request_t request = {
+        .method = method,
+        .content_type = content_type,
+        .parts = parts,
+        .count = count,
+        .connect_timeout_ms = profile->connect_timeout_ms,
+        .ttfb_timeout_ms = profile->ttfb_timeout_ms,
+        .timeout_ms = profile->timeout_ms,
+        .timing = &phases,
+    };
+    for (size_t i = 0; i < count; i++) {
+        request.len += parts[i].len;
+    }
+    ESP_LOGD(TAG, "\"%s\", len=%u", endpoint, (unsigned)request.len);
+    char *url = NULL;
+    char *authorization = NULL;
+    void *exchange = NULL;
+    asprintf(&url, "%s%s", oai->base_url, endpoint);
+    OPENAI_ERROR_CHECK(url != NULL, "Failed to allocate url!", NULL);
+    asprintf(&authorization, "Bearer %s", oai->api_key);
+    OPENAI_ERROR_CHECK_GOTO(authorization != NULL, "Failed to allocate headers!", end);
+    request.url = url;
+    request.authorization = authorization;
+    exchange = oai->transport->send(oai->transport, &request, status, content_length);
+
+end:
+    free(url);
+    free(authorization);
+    // The phases are those of the last attempt, the attempts add up
+    phases.attempts = timer->timing.attempts + 1;
+    if (exchange != NULL) {
+        phases.sent = request.len;
+        phases.status = *status;
+    }
+    timer->timing = phases;
+    timer->headers_us = exchange != NULL ? OpenAI_TimeUs() : 0;
+    return exchange;
+}
+
+/**
+ * @brief Sends a request like OpenAI_Send and sends it again while there is no response or a 408, 429 or 5xx one,
+ *        up to the retries of its request profile. Bodies read through a callback are sent only once.
+ *
+ * @return The exchange of the last attempt whatever its status, NULL if it got no response
+ */
+static void *OpenAI_SendRetry(_OpenAI_t *oai, const char *endpoint, const char *content_type, OpenAI_Http_Method method, const OpenAI_Body_Part_t *parts, size_t count, int *status, int64_t *content_length, OpenAI_Timer_t *timer)
+{
+    const OpenAI_Request_Profile_t *profile = &oai->profiles[OpenAI_RequestClass(endpoint)];
+    uint32_t retries = OpenAI_BodyReplayable(parts, count) ? profile->retries : 0;
+    for (uint32_t attempt = 0;; attempt++) {
+        void *exchange = OpenAI_Send(oai, endpoint, content_type, method, parts, count, status, content_length, timer);
+        if (attempt == retries || (exchange != NULL && !OpenAI_StatusRetryable(*status))) {
+            return exchange;
+        }
+        if (exchange != NULL) {
+            ESP_LOGW(TAG, "\"%s\" answered %d, retrying", endpoint, *status);
+            oai->transport->finish(oai->transport, exchange);
+        } else {
+            ESP_LOGW(TAG, "\"%s\" failed, retrying", endpoint);
+        }
+        // A random delay below a doubling bound keeps clients that failed together from retrying together
+        uint32_t bound = profile->retry_delay_ms << attempt;
+        if (bound > 0) {
+            vTaskDelay(pdMS_TO_TICKS(esp_random() % bound) + 1);
+        }
+    }
+}
+
+static char *OpenAI_Request(_OpenAI_t *oai, const char *endpoint, const char *content_type, OpenAI_Http_Method method, const OpenAI_Body_Part_t *parts, size_t count)
+{
+    TickType_t start = xTaskGetTickCount();
+    OpenAI_Timer_t timer;
+    OpenAI_TimerStart(&timer);
+    int status = 0;
+    int64_t content_length = -1;
+    void *exchange = OpenAI_SendRetry(oai, endpoint, content_type, method, parts, count, &status, &content_length, &timer);
+    ESP_LOGD(TAG, "status=%d, content_length=%" PRId64, status, content_length);
+    if (exchange == NULL) {
+        OpenAI_TimerEnd(oai, endpoint, &timer, false);
+    }
+    OPENAI_ERROR_CHECK(exchange != NULL, "HTTP client fetch headers failed!", NULL);
+
+    // A response without a length up front, e.g. a chunked one, doubles the buffer as it arrives
+    OpenAI_Buffer_t buffer = {0};
+    buffer.cap = content_length >= 0 ? content_length + 1 : OPENAI_STREAM_CHUNK_SIZE;
+    buffer.data = (char *)malloc(buffer.cap);
+    OPENAI_ERROR_CHECK_GOTO(buffer.data != NULL, "Failed to allocate response buffer!", fail);
+    while (content_length < 0 || buffer.len < content_length) {
+        if (buffer.len + 1 == buffer.cap) {
+            char *grown = (char *)realloc(buffer.data, buffer.cap * 2);
+            OPENAI_ERROR_CHECK_GOTO(grown != NULL, "Failed to grow response buffer!", fail);
+            buffer.data = grown;
+            buffer.cap *= 2;
+        }
+        int read = oai->transport->read(oai->transport, exchange, buffer.data + buffer.len, buffer.cap - buffer.len - 1);
+        OPENAI_ERROR_CHECK_GOTO(read >= 0, "Failed to read response!", fail);
+        if (read == 0) {
+            break;
+        }
+        buffer.len += read;
+        timer.timing.received = buffer.len;
+    }
+    if (content_length >= 0 && buffer.len != content_length) {
+        ESP_LOGE(TAG, "HTTP_ERROR: read=%d, length=%" PRId64, (int)buffer.len, content_length);
+        goto fail;
+    }
+    buffer.data[buffer.len] = 0;
+    ESP_LOGD(TAG, "result: %s, size: %d", buffer.data, (int)buffer.len);
+    oai->transport->finish(oai->transport, exchange);
+    OpenAI_TimerEnd(oai, endpoint, &timer, status >= 200 && status < 300);
+    if (status >= 200 && status < 300) {
+        OpenAI_LatencyRecord(oai, OpenAI_RequestClass(endpoint), start);
+    }
+    return buffer.data;
+
+fail:
+    free(buffer.data);
+    oai->transport->finish(oai->transport, exchange);
+    OpenAI_TimerEnd(oai, endpoint, &timer, false);
+    return NULL;
+}
+
+static esp_err_t OpenAI_Stream_Request(_OpenAI_t *oai, const char *endpoint, const char *content_type, OpenAI_Http_Method method, const OpenAI_Body_Part_t *parts, size_t count, OpenAI_Write_Cb write, void *ctx, bool errors)
+{
+    TickType_t start = xTaskGetTickCount();
+    OpenAI_Timer_t timer;
+    OpenAI_TimerStart(&timer);
+    esp_err_t err = ESP_FAIL;
+    int status = 0;
+    int64_t content_length = -1;
+    void *exchange = OpenAI_SendRetry(oai, endpoint, content_type, method, parts, count, &status, &content_length, &timer);
+    ESP_LOGD(TAG, "status=%d, content_length=%" PRId64, status, content_length);
+    if (exchange == NULL) {
+        OpenAI_TimerEnd(oai, endpoint, &timer, false);
+    }
+    OPENAI_ERROR_CHECK(exchange != NULL, "HTTP client fetch headers failed!", ESP_FAIL);
+    char *chunk = (char *)malloc(OPENAI_STREAM_CHUNK_SIZE + 1);
+    OPENAI_ERROR_CHECK_GOTO(chunk != NULL, "Failed to allocate stream chunk!", end);
+
+    // An error response is JSON, it must not end up in the caller's stream unless it expects JSON anyway
+    if (!errors && (status < 200 || status >= 300)) {
+        int read = oai->transport->read(oai->transport, exchange, chunk, OPENAI_STREAM_CHUNK_SIZE);
+        chunk[read > 0 ? read : 0] = 0;
+        ESP_LOGE(TAG, "HTTP_ERROR: status=%d, %s", status, chunk);
+        goto end;
+    }
+
+    int read = 0;
+    while ((read = oai->transport->read(oai->transport, exchange, chunk, OPENAI_STREAM_CHUNK_SIZE)) > 0) {
+        timer.timing.received += read;
+        OPENAI_ERROR_CHECK_GOTO(write(ctx, (const uint8_t *)chunk, read) >= 0, "Stream aborted!", end);
+    }
+    OPENAI_ERROR_CHECK_GOTO(read == 0, "Failed to read response!", end);
+    err = ESP_OK;
+    if (status >= 200 && status < 300) {
+        OpenAI_LatencyRecord(oai, OpenAI_RequestClass(endpoint), start);
+    }
+
+end:
+    free(chunk);
+    oai->transport->finish(oai->transport, exchange);
+    OpenAI_TimerEnd(oai, endpoint, &timer, err == ESP_OK && status >= 200 && status < 300);
+    return err;
+}
+
+//
+// Hedged requests
+//
+
+#if CONFIG_ENABLE_REQUEST_HEDGING
+#define OPENAI_HEDGE_ATTEMPTS 2
+#define OPENAI_HEDGE_DONE_BIT(i) (BIT0 << (i))
+
+struct OpenAI_Hedge;
+
+/**
+ * @brief One of the identical requests of a hedged request, sent and read by its own task.
+ *
+ */
+typedef struct {
+    struct OpenAI_Hedge *hedge;     /*!< Hedged request of the attempt */
+    int index;                      /*!< Index of the attempt, 0 is the first one sent */
+    size_t part;                    /*!< Part of the body the attempt sends next */
+    size_t offset;                  /*!< Offset in that part */
+    OpenAI_Buffer_t response;       /*!< Response body received */
+    int status;                     /*!< HTTP status, 0 without a response */
+    bool complete;                  /*!< Response body received to its end */
+} OpenAI_HedgeAttempt_t;
+
+/**
+ * @brief A request sent once more when its response is late, shared by the caller and the attempt
+ *        tasks, freed by the last of them.
+ *
+ */
+typedef struct OpenAI_Hedge {
+    _OpenAI_t *oai;                                         /*!< OpenAI object sending the request */
+    char *endpoint;                                         /*!< Endpoint of the request */
+    const char *content_type;                               /*!< Content type of the body */
+    const OpenAI_Body_Part_t *parts;                        /*!< Body of the caller, NULL once the caller returned */
+    size_t count;                                           /*!< Number of parts */
+    size_t len;                                             /*!< Length of the body */
+    TickType_t start;                                       /*!< Tick count the first attempt was started at */
+    EventGroupHandle_t events;                              /*!< OPENAI_HEDGE_DONE_BIT of the attempts that ended */
+    int winner;                                             /*!< Attempt with the first complete 2xx response, -1 until there is one */
+    uint32_t refs;                                          /*!< Caller and attempt tasks still using the request */
+    OpenAI_HedgeAttempt_t attempts[OPENAI_HEDGE_ATTEMPTS];  /*!< Attempts of the request */
+} OpenAI_Hedge_t;
+
+static void OpenAI_HedgeRelease(OpenAI_Hedge_t *hedge)
+{
+    xSemaphoreTake(hedge->oai->hedge_lock, portMAX_DELAY);
+    bool last = --hedge->refs == 0;
+    xSemaphoreGive(hedge->oai->hedge_lock);
+    if (!last) {
+        return;
+    }
+    for (int i = 0; i < OPENAI_HEDGE_ATTEMPTS; i++) {
+        free(hedge->attempts[i].response.data);
+    }
+    vEventGroupDelete(hedge->events);
+    free(hedge->endpoint);
+    free(hedge);
+}
+
+/**
+ * @brief Copies the body of the caller for one attempt. The caller's parts are only touched under the lock,
+ *        so the caller can return while a late attempt is still sending.
+ *
+ */
+static int OpenAI_HedgeRead(void *ctx, uint8_t *buf, size_t len)
+{
+    OpenAI_HedgeAttempt_t *attempt = (OpenAI_HedgeAttempt_t *)ctx;
+    OpenAI_Hedge_t *hedge = attempt->hedge;
+    size_t total = 0;
+    xSemaphoreTake(hedge->oai->hedge_lock, portMAX_DELAY);
+    if (hedge->parts != NULL && hedge->winner < 0) {
+        while (total < len && attempt->part < hedge->count) {
+            const OpenAI_Body_Part_t *part = &hedge->parts[attempt->part];
+            size_t n = part->len - attempt->offset;
+            n = n < len - total ? n : len - total;
+            if (n > 0) {
+                memcpy(buf + total, part->data + attempt->offset, n);
+            }
+            total += n;
+            attempt->offset += n;
+            if (attempt->offset == part->len) {
+                attempt->part++;
+                attempt->offset = 0;
+            }
+        }
+    }
+    xSemaphoreGive(hedge->oai->hedge_lock);
+    return total > 0 ? (int)total : -1;
+}
+
+/**
+ * @brief Collects the response of one attempt, stops once another attempt won.
+ *
+ */
+static int OpenAI_HedgeWrite(OpenAI_HedgeAttempt_t *attempt, const char *data, size_t len)
+{
+    OpenAI_Hedge_t *hedge = attempt->hedge;
+    xSemaphoreTake(hedge->oai->hedge_lock, portMAX_DELAY);
+    bool lost = hedge->winner >= 0;
+    xSemaphoreGive(hedge->oai->hedge_lock);
+    if (lost) {
+        return -1;
+    }
+    return OpenAI_BufferWrite(&attempt->response, (const uint8_t *)data, len);
+}
+
+static void OpenAI_HedgeTask(void *arg)
+{
+    OpenAI_HedgeAttempt_t *attempt = (OpenAI_HedgeAttempt_t *)arg;
+    OpenAI_Hedge_t *hedge = attempt->hedge;
+    _OpenAI_t *oai = hedge->oai;
+    OpenAI_Body_Part_t body = {
+        .len = hedge->len,
+        .read = &OpenAI_HedgeRead,
+        .ctx = attempt,
+    };
+    int64_t content_length = -1;
+    OpenAI_Timer_t timer;
+    OpenAI_TimerStart(&timer);
+    void *exchange = OpenAI_Send(oai, hedge->endpoint, hedge->content_type, OPENAI_HTTP_METHOD_POST, &body, 1, &attempt->status, &content_length, &timer);
+    if (exchange != NULL) {
+        char *chunk = (char *)malloc(OPENAI_STREAM_CHUNK_SIZE);
+        int read = -1;
+        if (chunk != NULL) {
+            while ((read = oai->transport->read(oai->transport, exchange, chunk, OPENAI_STREAM_CHUNK_SIZE)) > 0) {
+                if (OpenAI_HedgeWrite(attempt, chunk, read) != 0) {
+                    read = -1;
+                    break;
+                }
+            }
+            free(chunk);
+        }
+        attempt->complete = read == 0 && (content_length < 0 || attempt->response.len == content_length);
+        oai->transport->finish(oai->transport, exchange);
+        timer.timing.received = attempt->response.len;
+    } else {
+        attempt->status = 0;
+    }
+    OpenAI_TimerEnd(oai, hedge->endpoint, &timer, attempt->complete && attempt->status >= 200 && attempt->status < 300);
+
+    xSemaphoreTake(oai->hedge_lock, portMAX_DELAY);
+    bool won = hedge->winner < 0 && attempt->complete && attempt->status >= 200 && attempt->status < 300;
+    if (won) {
+        hedge->winner = attempt->index;
+    }
+    xSemaphoreGive(oai->hedge_lock);
+    if (won) {
+        OpenAI_LatencyRecord(oai, OpenAI_RequestClass(hedge->endpoint), hedge->start);
+    }
+    xEventGroupSetBits(hedge->events, OPENAI_HEDGE_DONE_BIT(attempt->index));
+    OpenAI_HedgeRelease(hedge);
+
+    // Last use of the OpenAI object, OpenAIDelete waits for this count to drop to 0
+    xSemaphoreTake(oai->hedge_lock, portMAX_DELAY);
+    oai->hedge_tasks--;
+    xSemaphoreGive(oai->hedge_lock);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t OpenAI_HedgeStart(OpenAI_Hedge_t *hedge, int index)
+{
+    _OpenAI_t *oai = hedge->oai;
+    OpenAI_HedgeAttempt_t *attempt = &hedge->attempts[index];
+    attempt->hedge = hedge;
+    attempt->index = index;
+    xSemaphoreTake(oai->hedge_lock, portMAX_DELAY);
+    hedge->refs++;
+    oai->hedge_tasks++;
+    xSemaphoreGive(oai->hedge_lock);
+    // Attempts run at the priority of the caller, which is blocked until one of them is done
+    if (xTaskCreate(&OpenAI_HedgeTask, "openai_hedge", CONFIG_REQUEST_HEDGE_STACK_SIZE, attempt, uxTaskPriorityGet(NULL), NULL) != pdPASS) {
+        xSemaphoreTake(oai->hedge_lock, portMAX_DELAY);
+        oai->hedge_tasks--;
+        xSemaphoreGive(oai->hedge_lock);
+        OpenAI_HedgeRelease(hedge);
+        ESP_LOGE(TAG, "Failed to create hedging task!");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Sends a POST request and, when no response is complete after the CONFIG_REQUEST_HEDGE_PERCENTILE
+ *        of the recent latency of its class, the same request once more. The first complete 2xx response
+ *        is returned, the other attempt is abandoned and ends in the background.
+ *
+ *        When all attempts end without a response or with a 408, 429 or 5xx one, the request is left to be
+ *        sent the usual way, with the retries of its request profile.
+ *
+ * @param response[out] Response body of any status, to be freed by the caller
+ * @param status[out] HTTP status of the response
+ * @return ESP_OK with a response, ESP_FAIL without one, ESP_ERR_NOT_SUPPORTED if the request is not to be
+ *         hedged or is to be retried, and has to be sent the usual way
+ */
+static esp_err_t OpenAI_Hedged_Request(_OpenAI_t *oai, const char *endpoint, const char *content_type, const OpenAI_Body_Part_t *parts, size_t count, OpenAI_Buffer_t *response, int *status)
+{
+    OpenAI_Request_Class requestClass = OpenAI_RequestClass(endpoint);
+    if (oai->hedge_lock == NULL || !oai->profiles[requestClass].hedge || !OpenAI_BodyReplayable(parts, count)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    uint32_t delay_ms = OpenAI_HedgeDelayMs(oai, requestClass);
+    if (delay_ms == 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    OpenAI_Hedge_t *hedge = (OpenAI_Hedge_t *)calloc(1, sizeof(OpenAI_Hedge_t));
+    OPENAI_ERROR_CHECK(hedge != NULL, "Failed to allocate hedged request!", ESP_ERR_NOT_SUPPORTED);
+    hedge->oai = oai;
+    hedge->endpoint = strdup(endpoint);
+    hedge->events = xEventGroupCreate();
+    if (hedge->endpoint == NULL || hedge->events == NULL) {
+        if (hedge->events != NULL) {
+            vEventGroupDelete(hedge->events);
+        }
+        free(hedge->endpoint);
+        free(hedge);
+        ESP_LOGE(TAG, "Failed to allocate hedged request!");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    hedge->content_type = content_type;
+    hedge->parts = parts;
+    hedge->count = count;
+    for (size_t i = 0; i < count; i++) {
+        hedge->len += parts[i].len;
+    }
+    hedge->winner = -1;
+    hedge->refs = 1;
+    hedge->start = xTaskGetTickCount();
+    if (OpenAI_HedgeStart(hedge, 0) != ESP_OK) {
+        OpenAI_HedgeRelease(hedge);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    EventBits_t started = OPENAI_HEDGE_DONE_BIT(0);
+    EventBits_t done = xEventGroupWaitBits(hedge->events, started, pdFALSE, pdFALSE, pdMS_TO_TICKS(delay_ms));
+    if (done == 0) {
+        ESP_LOGW(TAG, "\"%s\" slower than %" PRIu32 " ms, hedging", endpoint, delay_ms);
+        if (OpenAI_HedgeStart(hedge, 1) == ESP_OK) {
+            started |= OPENAI_HEDGE_DONE_BIT(1);
+        }
+    }
+    // Wait for a winner, or for all attempts to end without one
+    int winner = -1;
+    for (;;) {
+        if ((done & started) != started) {
+            done |= xEventGroupWaitBits(hedge->events, started & ~done, pdFALSE, pdFALSE, portMAX_DELAY);
+        }
+        xSemaphoreTake(oai->hedge_lock, portMAX_DELAY);
+        winner = hedge->winner;
+        if (winner >= 0 || (done & started) == started) {
+            // A late attempt still sending stops at its next read of the body
+            hedge->parts = NULL;
+            xSemaphoreGive(oai->hedge_lock);
+            break;
+        }
+        xSemaphoreGive(oai->hedge_lock);
+    }
+
+    // Without a winner all attempts ended, the first with a response is reported
+    OpenAI_HedgeAttempt_t *attempt = NULL;
+    if (winner >= 0) {
+        attempt = &hedge->attempts[winner];
+    } else {
+        for (int i = 0; i < OPENAI_HEDGE_ATTEMPTS && attempt == NULL; i++) {
+            if ((started & OPENAI_HEDGE_DONE_BIT(i)) && hedge->attempts[i].status != 0 && hedge->attempts[i].complete) {
+                attempt = &hedge->attempts[i];
+            }
+        }
+    }
+    const OpenAI_Request_Profile_t *profile = &oai->profiles[requestClass];
+    if (winner < 0 && profile->retries > 0 && (attempt == NULL || OpenAI_StatusRetryable(attempt->status))) {
+        if (attempt != NULL) {
+            ESP_LOGW(TAG, "\"%s\" answered %d, retrying", endpoint, attempt->status);
+        } else {
+            ESP_LOGW(TAG, "\"%s\" failed, retrying", endpoint);
+        }
+        OpenAI_HedgeRelease(hedge);
+        // The same random delay as before the first retry of OpenAI_SendRetry
+        if (profile->retry_delay_ms > 0) {
+            vTaskDelay(pdMS_TO_TICKS(esp_random() % profile->retry_delay_ms) + 1);
+        }
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    esp_err_t err = ESP_FAIL;
+    if (attempt != NULL) {
+        *response = attempt->response;
+        *status = attempt->status;
+        memset(&attempt->response, 0, sizeof(OpenAI_Buffer_t));
+        err = ESP_OK;
+    }
+    OpenAI_HedgeRelease(hedge);
+    return err;
+}
+
+static void OpenAI_HedgeInit(_OpenAI_t *oai)
+{
+    oai->hedge_lock = xSemaphoreCreateMutex();
+    OPENAI_ERROR_CHECK_CONTINUE(oai->hedge_lock != NULL, "Failed to create hedge lock, requests will not be hedged!");
+}
+
+/**
+ * @brief Wait for the losing attempts of hedged requests, they end at their next chunk or timeout.
+ *
+ */
+static void OpenAI_HedgeDeinit(_OpenAI_t *oai)
+{
+    if (oai->hedge_lock == NULL) {
+        return;
+    }
+    for (;;) {
+        xSemaphoreTake(oai->hedge_lock, portMAX_DELAY);
+        uint32_t tasks = oai->hedge_tasks;
+        xSemaphoreGive(oai->hedge_lock);
+        if (tasks == 0) {
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    vSemaphoreDelete(oai->hedge_lock);
+    oai->hedge_lock = NULL;
+}
+#else
+static esp_err_t OpenAI_Hedged_Request(_OpenAI_t *oai, const char *endpoint, const char *content_type, const OpenAI_Body_Part_t *parts, size_t count, OpenAI_Buffer_t *response, int *status)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+static void OpenAI_HedgeInit(_OpenAI_t *oai) {}
+static void OpenAI_HedgeDeinit(_OpenAI_t *oai) {}
+#endif
+
+static esp_err_t OpenAI_Stream(_OpenAI_t *oai, const char *endpoint, char *jsonBody, OpenAI_Write_Cb write, void *ctx)
+{
+    OpenAI_Body_Part_t body = { .data = (const uint8_t *)jsonBody, .len = strlen(jsonBody) };
+    return OpenAI_Stream_Request(oai, endpoint, "application/json", OPENAI_HTTP_METHOD_POST, &body, 1, write, ctx, false);
+}
+
+static esp_err_t OpenAI_Events(_OpenAI_t *oai, const char *endpoint, char *jsonBody, OpenAI_Write_Cb write, void *ctx)
+{
+    OpenAI_Body_Part_t body = { .data = (const uint8_t *)jsonBody, .len = strlen(jsonBody) };
+    return OpenAI_Stream_Request(oai, endpoint, "application/json", OPENAI_HTTP_METHOD_POST, &body, 1, write, ctx, true);
+}
+
+#if CONFIG_ENABLE_JSON_SCAN
+static esp_err_t OpenAI_Scan(_OpenAI_t *oai, const char *endpoint, char *jsonBody, OpenAI_JsonScan_t *scan)
+{
+    OpenAI_Body_Part_t body = { .data = (const uint8_t *)jsonBody, .len = strlen(jsonBody) };
+    return OpenAI_Stream_Request(oai, endpoint, "application/json", OPENAI_HTTP_METHOD_POST, &body, 1, &OpenAI_JsonScanWrite, scan, true);
+}
+
+static esp_err_t OpenAI_Upload_Scan(_OpenAI_t *oai, const char *endpoint, const OpenAI_Body_Part_t *parts, size_t count, OpenAI_JsonScan_t *scan)
+{
+    OpenAI_Buffer_t buffer = {0};
+    int status = 0;
+    esp_err_t err = OpenAI_Hedged_Request(oai, endpoint, "multipart/form-data; boundary=" OPENAI_MULTIPART_BOUNDARY, parts, count, &buffer, &status);
+    if (err != ESP_ERR_NOT_SUPPORTED) {
+        // The response of a hedged request is only known to be the one to use once it is complete
+        if (err == ESP_OK && OpenAI_JsonScanWrite(scan, (const uint8_t *)buffer.data, buffer.len) != 0) {
+            err = ESP_FAIL;
+        }
+        free(buffer.data);
+        return err;
+    }
+    return OpenAI_Stream_Request(oai, endpoint, "multipart/form-data; boundary=" OPENAI_MULTIPART_BOUNDARY, OPENAI_HTTP_METHOD_POST, parts, count, &OpenAI_JsonScanWrite, scan, true);
+}
+#endif
+
+static char *OpenAI_Speech_Post(_OpenAI_t *oai, const char *endpoint, char *jsonBody, size_t *output_len)
+{
+    OpenAI_Buffer_t buffer = {0};
+    *output_len = 0;
+    OpenAI_Body_Part_t body = { .data = (const uint8_t *)jsonBody, .len = strlen(jsonBody) };
+    int status = 0;
+    esp_err_t err = OpenAI_Hedged_Request(oai, endpoint, "application/json", &body, 1, &buffer, &status);
+    if (err == ESP_OK && (status < 200 || status >= 300)) {
+        ESP_LOGE(TAG, "HTTP_ERROR: status=%d, %.*s", status, (int)buffer.len, buffer.data ? buffer.data : "");
+        err = ESP_FAIL;
+    } else if (err == ESP_ERR_NOT_SUPPORTED) {
+        err = OpenAI_Stream(oai, endpoint, jsonBody, &OpenAI_BufferWrite, &buffer);
+    }
+    if (err != ESP_OK) {
+        free(buffer.data);
+        return NULL;
+    }
+    ESP_LOGD(TAG, "output_len: %d", (int)buffer.len);
+    *output_len = buffer.len;
+    return buffer.data;
+}
+
+static char *OpenAI_Upload(_OpenAI_t *oai, const char *endpoint, const OpenAI_Body_Part_t *parts, size_t count)
+{
+    OpenAI_Buffer_t buffer = {0};
+    int status = 0;
+    esp_err_t err = OpenAI_Hedged_Request(oai, endpoint, "multipart/form-data; boundary=" OPENAI_MULTIPART_BOUNDARY, parts, count, &buffer, &status);
+    if (err != ESP_ERR_NOT_SUPPORTED) {
+        if (err != ESP_OK || OpenAI_BufferWrite(&buffer, (const uint8_t *)"", 1) != 0) {
+            free(buffer.data);
+            return NULL;
+        }
+        return buffer.data;
+    }
+    return OpenAI_Request(oai, endpoint, "multipart/form-data; boundary=" OPENAI_MULTIPART_BOUNDARY, OPENAI_HTTP_METHOD_POST, parts, count);
+}
+
+static char *OpenAI_Post(_OpenAI_t *oai, const char *endpoint, char *jsonBody)
+{
+    OpenAI_Body_Part_t body = { .data = (const uint8_t *)jsonBody, .len = strlen(jsonBody) };
+    return OpenAI_Request(oai, endpoint, "application/json", OPENAI_HTTP_METHOD_POST, &body, 1);
+}
+
+static char *OpenAI_Get(_OpenAI_t *oai, const char *endpoint)
+{
+    return OpenAI_Request(oai, endpoint, "application/json", OPENAI_HTTP_METHOD_GET, NULL, 0);
+}
+
+static char *OpenAI_Del(_OpenAI_t *oai, const char *endpoint)
+{
+    return OpenAI_Request(oai, endpoint, "application/json", OPENAI_HTTP_METHOD_DELETE, NULL, 0);
+}
+
+OpenAI_t *OpenAICreate(const char *api_key)
+{
+#if !CONFIG_IDF_TARGET_LINUX
+    OpenAI_Transport_t *transport = OpenAI_TransportEspHttpCreate();
+#else
+    OpenAI_Transport_t *transport = OpenAI_TransportPosixCreate();
+#endif
+    OPENAI_ERROR_CHECK(transport != NULL, "Failed to create transport!", NULL);
+    return OpenAICreateWithTransport(api_key, transport);
+}
+
+OpenAI_t *OpenAICreateWithTransport(const char *api_key, struct OpenAI_Transport *transport)
+{
+    ESP_LOGI(TAG, "OpenAI create, version: %d.%d.%d", OPENAI_VER_MAJOR, OPENAI_VER_MINOR, OPENAI_VER_PATCH);
+    OPENAI_ERROR_CHECK(transport != NULL, "Invalid transport!", NULL);
+    _OpenAI_t *_oai = (_OpenAI_t *)calloc(1, sizeof(_OpenAI_t));
+    if (_oai == NULL) {
+        transport->delete(transport);
+        ESP_LOGE(TAG, "Failed to allocate _OpenAI!");
+        return NULL;
+    }
+    _oai->api_key = strdup(api_key);
+    _oai->base_url = strdup(OPENAI_DEFAULT_BASE_URL);
+    _oai->transport = transport;
+    OpenAI_JsonArenaInit();
+    OpenAI_RequestProfilesInit(_oai);
+    OpenAI_HedgeInit(_oai);
+    OpenAI_TimingInit(_oai);
+    OpenAI_AsyncInit(_oai);
+
+#if CONFIG_ENABLE_EMBEDDING
+    _oai->parent.embeddingCreate = &OpenAI_EmbeddingCreate;
+#endif
+
+#if CONFIG_ENABLE_MODERATION
+    _oai->parent.moderationCreate = &OpenAI_ModerationCreate;
+#endif
+
+#if CONFIG_ENABLE_COMPLETION
+    _oai->parent.completionCreate = &OpenAI_CompletionCreate;
+    _oai->parent.completionDelete = &OpenAI_CompletionDelete;
+#endif
+
+#if CONFIG_ENABLE_CHAT_COMPLETION
+    _oai->parent.chatCreate = &OpenAI_ChatCompletionCreate;
+    _oai->parent.chatDelete = &OpenAI_ChatCompletionDelete;
+#endif
+
+#if CONFIG_ENABLE_EDIT
+    _oai->parent.editCreate = &OpenAI_EditCreate;
+    _oai->parent.editDelete = &OpenAI_EditDelete;
+#endif
+
+#if CONFIG_ENABLE_IMAGE_GENERATION
+    _oai->parent.imageGenerationCreate = &OpenAI_ImageGenerationCreate;
+    _oai->parent.imageGenerationDelete = &OpenAI_ImageGenerationDelete;
+#endif
+
+#if CONFIG_ENABLE_IMAGE_VARIATION
+    _oai->parent.imageVariationCreate = &OpenAI_ImageVariationCreate;
+    _oai->parent.imageVariationDelete = &OpenAI_ImageVariationDelete;
+#endif
+
+#if CONFIG_ENABLE_IMAGE_EDIT
+    _oai->parent.imageEditCreate = &OpenAI_ImageEditCreate;
+    _oai->parent.imageEditDelete = &OpenAI_ImageEditDelete;
+#endif
+
+#if CONFIG_ENABLE_AUDIO_TRANSCRIPTION
+    _oai->parent.audioTranscriptionCreate = &OpenAI_AudioTranscriptionCreate;
+    _oai->parent.audioTranscriptionDelete = &OpenAI_AudioTranscriptionDelete;
+#endif
+
+#if CONFIG_ENABLE_AUDIO_TRANSLATION
+    _oai->parent.audioTranslationCreate = &OpenAI_AudioTranslationCreate;
+    _oai->parent.audioTranslationDelete = &OpenAI_AudioTranslationDelete;
+#endif
+
+#if CONFIG_ENABLE_AUDIO_SPEECH
+    _oai->parent.audioSpeechCreate = &OpenAI_AudioSpeechCreate;
+    _oai->parent.audioSpeechDelete = &OpenAI_AudioSpeechDelete;
+#endif
+
+#if CONFIG_ENABLE_ANSWER_CACHE
+    _oai->parent.answerCacheCreate = &OpenAI_AnswerCacheCreate;
+    _oai->parent.answerCacheDelete = &OpenAI_AnswerCacheDelete;
+#endif
+
+    _oai->get = &OpenAI_Get;
+    _oai->del = &OpenAI_Del;
+    _oai->post = &OpenAI_Post;
+    _oai->speechpost = &OpenAI_Speech_Post;
+    _oai->stream = &OpenAI_Stream;
+    _oai->events = &OpenAI_Events;
+    _oai->upload = &OpenAI_Upload;
+#if CONFIG_ENABLE_JSON_SCAN
+    _oai->scan = &OpenAI_Scan;
+    _oai->uploadscan = &OpenAI_Upload_Scan;
+#endif
+    return &_oai->parent;
+}
+
+void OpenAIDelete(OpenAI_t *oai)
+{
+    _OpenAI_t *_oai = __containerof(oai, _OpenAI_t, parent);
+    if (_oai != NULL) {
+        // Requests still running use the client and the keys below
+        OpenAI_AsyncDeinit(_oai);
+        OpenAI_HedgeDeinit(_oai);
+        OpenAI_TimingDeinit(_oai);
+        if (_oai->api_key != NULL) {
+            free(_oai->api_key);
+            free(_oai->base_url);
+            _oai->api_key = NULL;
+        }
+        if (_oai->transport != NULL) {
+            _oai->transport->delete(_oai->transport);
+            _oai->transport = NULL;
+        }
+        OpenAI_JsonArenaDeinit();
+        free(_oai);
+        _oai = NULL;
+    }
+}
@@ -0,0 +1,434 @@
+/* SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <math.h>
+#include <sys/cdefs.h>
+#include <inttypes.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "OpenAI_Private.h"
+
+#if CONFIG_ENABLE_ANSWER_CACHE
+#include "esp_idf_version.h"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "dsps_dotprod.h"
+#include "OpenAI.h"
+
+static const char *TAG = "OpenAI_AnswerCache";
+
+// dsps_dotprod_s16 works on multiples of 4 samples, 8 keeps every vector 16 byte aligned in flash
+_Static_assert(CONFIG_ANSWER_CACHE_DIMENSIONS % 8 == 0, "ANSWER_CACHE_DIMENSIONS must be a multiple of 8");
+
+#define OPENAI_ANSWER_CACHE_MAGIC 0x4341414f    /* "OAAC" */
+#define OPENAI_ANSWER_CACHE_VERSION 1
+#define OPENAI_ANSWER_CACHE_SECTOR 4096
+#define OPENAI_ANSWER_CACHE_ERASED 0xffffffff
+#define OPENAI_ANSWER_CACHE_ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+typedef esp_partition_mmap_handle_t OpenAI_AnswerCacheMap_t;
+#define OPENAI_ANSWER_CACHE_MMAP_DATA ESP_PARTITION_MMAP_DATA
+#define OpenAI_AnswerCacheUnmap esp_partition_munmap
+#else
+typedef spi_flash_mmap_handle_t OpenAI_AnswerCacheMap_t;
+#define OPENAI_ANSWER_CACHE_MMAP_DATA SPI_FLASH_MMAP_DATA
+#define OpenAI_AnswerCacheUnmap spi_flash_munmap
+#endif
+
+/*
+ * Layout of the partition, every region starts at a sector:
+ *
+ *   header    OpenAI_AnswerCacheHeader_t
+ *   entries   capacity x OpenAI_AnswerCacheEntry_t, taken in order
+ *   vectors   capacity x dimensions x int16_t, the normalized embeddings in Q15
+ *   data      text and audio of the answers, appended
+ *
+ * Everything is written once after an erase of the whole partition. An entry is taken by writing its
+ * data location, and only counts once its committed word is written after its data and vector, so an
+ * answer interrupted by a reset is skipped.
+ */
+typedef struct {
+    uint32_t magic;             /*!< OPENAI_ANSWER_CACHE_MAGIC */
+    uint16_t version;           /*!< OPENAI_ANSWER_CACHE_VERSION */
+    uint16_t dimensions;        /*!< Dimensions of the vectors */
+    uint32_t capacity;          /*!< Number of entries and vectors */
+    uint32_t entries_offset;    /*!< Offset of the entries */
+    uint32_t vectors_offset;    /*!< Offset of the vectors */
+    uint32_t data_offset;       /*!< Offset of the data */
+    char model[32];             /*!< Embedding model of the vectors */
+} OpenAI_AnswerCacheHeader_t;
+
+typedef struct {
+    uint32_t data_offset;       /*!< Offset of the text followed by the audio, erased while the entry is free */
+    uint32_t text_len;          /*!< Length of the text including its NUL */
+    uint32_t audio_len;         /*!< Length of the audio */
+    uint32_t committed;         /*!< OPENAI_ANSWER_CACHE_MAGIC once data and vector are written */
+} OpenAI_AnswerCacheEntry_t;
+
+typedef struct {
+    OpenAI_AnswerCache_t parent;            /*!< Base object */
+    OpenAI_t *openai;                       /*!< Embeds the questions */
+    const esp_partition_t *partition;       /*!< Partition of the cache */
+    const uint8_t *map;                     /*!< The partition memory-mapped */
+    OpenAI_AnswerCacheMap_t map_handle;     /*!< Handle of the mapping */
+    SemaphoreHandle_t lock;                 /*!< Serializes searches and writes, embedding runs outside of it */
+    SemaphoreHandle_t released;             /*!< Given when the last hit is released */
+    uint32_t holds;                         /*!< Hits not released yet, the partition is not erased while there are any */
+    int16_t threshold;                      /*!< Similarity of a hit in Q15 */
+    uint32_t used;                          /*!< Entries taken */
+    uint32_t count;                         /*!< Entries committed */
+    uint32_t data_end;                      /*!< Offset the next data is written to */
+    char *question;                         /*!< Question embedded last, protected by lock */
+    int16_t vector[CONFIG_ANSWER_CACHE_DIMENSIONS]; /*!< Embedding of question in Q15, protected by lock */
+} _OpenAI_AnswerCache_t;
+
+static inline const OpenAI_AnswerCacheHeader_t *OpenAI_AnswerCacheHeader(_OpenAI_AnswerCache_t *cache)
+{
+    return (const OpenAI_AnswerCacheHeader_t *)cache->map;
+}
+
+static inline const OpenAI_AnswerCacheEntry_t *OpenAI_AnswerCacheEntry(_OpenAI_AnswerCache_t *cache, uint32_t index)
+{
+    return (const OpenAI_AnswerCacheEntry_t *)(cache->map + OpenAI_AnswerCacheHeader(cache)->entries_offset) + index;
+}
+
+static inline const int16_t *OpenAI_AnswerCacheVector(_OpenAI_AnswerCache_t *cache, uint32_t index)
+{
+    return (const int16_t *)(cache->map + OpenAI_AnswerCacheHeader(cache)->vectors_offset) + index * CONFIG_ANSWER_CACHE_DIMENSIONS;
+}
+
+static esp_err_t OpenAI_AnswerCacheFormat(_OpenAI_AnswerCache_t *cache)
+{
+    size_t size = cache->partition->size;
+    size_t vector_size = CONFIG_ANSWER_CACHE_DIMENSIONS * sizeof(int16_t);
+    // Entries and vectors get at most half of the partition, the header and their rounding a sector each
+    uint32_t capacity = CONFIG_ANSWER_CACHE_ENTRIES;
+    if (size < 4 * OPENAI_ANSWER_CACHE_SECTOR) {
+        capacity = 0;
+    } else if (capacity > (size / 2 - 3 * OPENAI_ANSWER_CACHE_SECTOR) / (sizeof(OpenAI_AnswerCacheEntry_t) + vector_size)) {
+        capacity = (size / 2 - 3 * OPENAI_ANSWER_CACHE_SECTOR) / (sizeof(OpenAI_AnswerCacheEntry_t) + vector_size);
+    }
+    OPENAI_ERROR_CHECK(capacity > 0, "Partition too small!", ESP_ERR_INVALID_SIZE);
+
+    OpenAI_AnswerCacheHeader_t header = {
+        .magic = OPENAI_ANSWER_CACHE_MAGIC,
+        .version = OPENAI_ANSWER_CACHE_VERSION,
+        .dimensions = CONFIG_ANSWER_CACHE_DIMENSIONS,
+        .capacity = capacity,
+        .entries_offset = OPENAI_ANSWER_CACHE_SECTOR,
+    };
+    header.vectors_offset = header.entries_offset + OPENAI_ANSWER_CACHE_ALIGN(capacity * sizeof(OpenAI_AnswerCacheEntry_t), OPENAI_ANSWER_CACHE_SECTOR);
+    header.data_offset = header.vectors_offset + OPENAI_ANSWER_CACHE_ALIGN(capacity * vector_size, OPENAI_ANSWER_CACHE_SECTOR);
+    strncpy(header.model, CONFIG_ANSWER_CACHE_MODEL, sizeof(header.model) - 1);
+
+    ESP_LOGI(TAG, "Formatting \"%s\" for %" PRIu32 " answers", cache->partition->label, capacity);
+    esp_err_t err = esp_partition_erase_range(cache->partition, 0, size);
+    OPENAI_ERROR_CHECK(err == ESP_OK, "Failed to erase partition!", err);
+    err = esp_partition_write(cache->partition, 0, &header, sizeof(header));
+    OPENAI_ERROR_CHECK(err == ESP_OK, "Failed to write header!", err);
+    cache->used = 0;
+    cache->count = 0;
+    cache->data_end = header.data_offset;
+    return ESP_OK;
+}
+
+/**
+ * @brief Picks up the entries of a partition formatted before, formats it if it is not an answer cache of
+ *        the configured model and dimensions.
+ *
+ */
+static esp_err_t OpenAI_AnswerCacheOpen(_OpenAI_AnswerCache_t *cache)
+{
+    const OpenAI_AnswerCacheHeader_t *header = OpenAI_AnswerCacheHeader(cache);
+    if (header->magic != OPENAI_ANSWER_CACHE_MAGIC || header->version != OPENAI_ANSWER_CACHE_VERSION
+            || header->dimensions != CONFIG_ANSWER_CACHE_DIMENSIONS
+            || strncmp(header->model, CONFIG_ANSWER_CACHE_MODEL, sizeof(header->model)) != 0
+            || header->data_offset > cache->partition->size) {
+        return OpenAI_AnswerCacheFormat(cache);
+    }
+    cache->used = 0;
+    cache->count = 0;
+    cache->data_end = header->data_offset;
+    for (uint32_t i = 0; i < header->capacity; i++) {
+        const OpenAI_AnswerCacheEntry_t *entry = OpenAI_AnswerCacheEntry(cache, i);
+        if (entry->data_offset == OPENAI_ANSWER_CACHE_ERASED) {
+            break;
+        }
+        // An uncommitted entry may have written part of its data, the next data goes behind it either way
+        cache->used = i + 1;
+        cache->count += entry->committed == OPENAI_ANSWER_CACHE_MAGIC;
+        uint32_t end = entry->data_offset + OPENAI_ANSWER_CACHE_ALIGN(entry->text_len + entry->audio_len, 4);
+        if (end > cache->data_end) {
+            cache->data_end = end;
+        }
+    }
+    ESP_LOGI(TAG, "%" PRIu32 " answers cached in \"%s\"", cache->count, cache->partition->label);
+    return ESP_OK;
+}
+
+/**
+ * @brief Embeds the question into vector, cut to the configured dimensions and normalized again.
+ *        The embedding of the same question as last time is reused. Called without the lock, the request
+ *        does not hold up the lookups and stores of other tasks.
+ *
+ */
+static esp_err_t OpenAI_AnswerCacheEmbed(_OpenAI_AnswerCache_t *cache, const char *question, int16_t *vector)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    bool same = cache->question != NULL && strcmp(cache->question, question) == 0;
+    if (same) {
+        memcpy(vector, cache->vector, sizeof(cache->vector));
+    }
+    xSemaphoreGive(cache->lock);
+    if (same) {
+        return ESP_OK;
+    }
+
+    esp_err_t err = ESP_FAIL;
+    OpenAI_EmbeddingResponse_t *result = cache->openai->embeddingCreate(cache->openai, (char *)question, CONFIG_ANSWER_CACHE_MODEL, NULL);
+    OPENAI_ERROR_CHECK(result != NULL, "Failed to embed question!", ESP_FAIL);
+    OpenAI_EmbeddingData_t *data = result->getLen(result) > 0 ? result->getData(result, 0) : NULL;
+    OPENAI_ERROR_CHECK_GOTO(result->getError(result) == NULL && data != NULL, "Failed to embed question!", end);
+    OPENAI_ERROR_CHECK_GOTO(data->len >= CONFIG_ANSWER_CACHE_DIMENSIONS, "Embedding shorter than ANSWER_CACHE_DIMENSIONS!", end);
+
+    double norm = 0;
+    for (int i = 0; i < CONFIG_ANSWER_CACHE_DIMENSIONS; i++) {
+        norm += data->data[i] * data->data[i];
+    }
+    norm = sqrt(norm);
+    OPENAI_ERROR_CHECK_GOTO(norm > 0, "Empty embedding!", end);
+    for (int i = 0; i < CONFIG_ANSWER_CACHE_DIMENSIONS; i++) {
+        long q = lround(data->data[i] / norm * 32767);
+        vector[i] = q > 32767 ? 32767 : q < -32767 ? -32767 : q;
+    }
+    char *copy = strdup(question);
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    free(cache->question);
+    cache->question = copy;
+    if (copy != NULL) {
+        memcpy(cache->vector, vector, sizeof(cache->vector));
+    }
+    xSemaphoreGive(cache->lock);
+    err = ESP_OK;
+
+end:
+    result->delete (result);
+    return err;
+}
+
+/**
+ * @brief Waits until the hits handed out are released, before the partition they point into is erased.
+ *        Called with the lock held, it is released meanwhile.
+ *
+ */
+static void OpenAI_AnswerCacheWaitReleased(_OpenAI_AnswerCache_t *cache)
+{
+    while (cache->holds > 0) {
+        ESP_LOGD(TAG, "Waiting for %" PRIu32 " hits to be released", cache->holds);
+        xSemaphoreGive(cache->lock);
+        xSemaphoreTake(cache->released, portMAX_DELAY);
+        xSemaphoreTake(cache->lock, portMAX_DELAY);
+    }
+}
+
+static void OpenAI_AnswerCacheSetThreshold(OpenAI_AnswerCache_t *answerCache, float threshold)
+{
+    _OpenAI_AnswerCache_t *cache = __containerof(answerCache, _OpenAI_AnswerCache_t, parent);
+    threshold = threshold < 0 ? 0 : threshold > 1 ? 1 : threshold;
+    cache->threshold = (int16_t)lroundf(threshold * 32767);
+}
+
+static esp_err_t OpenAI_AnswerCacheLookup(OpenAI_AnswerCache_t *answerCache, const char *question, OpenAI_AnswerCacheHit_t *hit)
+{
+    OPENAI_ERROR_CHECK(question != NULL && hit != NULL, "Invalid arguments!", ESP_ERR_INVALID_ARG);
+    _OpenAI_AnswerCache_t *cache = __containerof(answerCache, _OpenAI_AnswerCache_t, parent);
+    int16_t *vector = (int16_t *)malloc(sizeof(cache->vector));
+    OPENAI_ERROR_CHECK(vector != NULL, "Failed to allocate vector!", ESP_ERR_NO_MEM);
+    esp_err_t err = OpenAI_AnswerCacheEmbed(cache, question, vector);
+    if (err != ESP_OK) {
+        free(vector);
+        return err;
+    }
+
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    // Both vectors are normalized Q15, their dot product is the cosine similarity in Q15
+    int32_t best = -1;
+    int16_t best_similarity = cache->threshold;
+    for (uint32_t i = 0; i < cache->used; i++) {
+        if (OpenAI_AnswerCacheEntry(cache, i)->committed != OPENAI_ANSWER_CACHE_MAGIC) {
+            continue;
+        }
+        int16_t similarity = 0;
+        dsps_dotprod_s16(vector, OpenAI_AnswerCacheVector(cache, i), &similarity, CONFIG_ANSWER_CACHE_DIMENSIONS, 0);
+        if (similarity >= best_similarity) {
+            best_similarity = similarity;
+            best = i;
+        }
+    }
+    err = ESP_ERR_NOT_FOUND;
+    if (best >= 0) {
+        const OpenAI_AnswerCacheEntry_t *entry = OpenAI_AnswerCacheEntry(cache, best);
+        hit->similarity = best_similarity / 32767.0f;
+        hit->text = (const char *)cache->map + entry->data_offset;
+        hit->audio = entry->audio_len ? cache->map + entry->data_offset + entry->text_len : NULL;
+        hit->audioLen = entry->audio_len;
+        ESP_LOGD(TAG, "Hit %" PRId32 ", similarity %.3f", best, hit->similarity);
+        cache->holds++;
+        err = ESP_OK;
+    }
+    xSemaphoreGive(cache->lock);
+    free(vector);
+    return err;
+}
+
+static void OpenAI_AnswerCacheRelease(OpenAI_AnswerCache_t *answerCache, OpenAI_AnswerCacheHit_t *hit)
+{
+    _OpenAI_AnswerCache_t *cache = __containerof(answerCache, _OpenAI_AnswerCache_t, parent);
+    if (hit == NULL || hit->text == NULL) {
+        return;
+    }
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    if (cache->holds > 0 && --cache->holds == 0) {
+        xSemaphoreGive(cache->released);
+    }
+    xSemaphoreGive(cache->lock);
+    hit->text = NULL;
+    hit->audio = NULL;
+    hit->audioLen = 0;
+}
+
+static esp_err_t OpenAI_AnswerCacheStore(OpenAI_AnswerCache_t *answerCache, const char *question, const char *text, const uint8_t *audio, size_t audioLen)
+{
+    OPENAI_ERROR_CHECK(question != NULL && text != NULL && (audio != NULL || audioLen == 0), "Invalid arguments!", ESP_ERR_INVALID_ARG);
+    _OpenAI_AnswerCache_t *cache = __containerof(answerCache, _OpenAI_AnswerCache_t, parent);
+    const OpenAI_AnswerCacheHeader_t *header = OpenAI_AnswerCacheHeader(cache);
+    const esp_partition_t *partition = cache->partition;
+    size_t text_len = strlen(text) + 1;
+    size_t size = OPENAI_ANSWER_CACHE_ALIGN(text_len + audioLen, 4);
+    OPENAI_ERROR_CHECK(header->data_offset + size <= partition->size, "Answer larger than the cache!", ESP_ERR_NO_MEM);
+    int16_t *vector = (int16_t *)malloc(sizeof(cache->vector));
+    OPENAI_ERROR_CHECK(vector != NULL, "Failed to allocate vector!", ESP_ERR_NO_MEM);
+    esp_err_t err = OpenAI_AnswerCacheEmbed(cache, question, vector);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to embed question!");
+        free(vector);
+        return err;
+    }
+
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    if (cache->used == header->capacity || cache->data_end + size > partition->size) {
+        OpenAI_AnswerCacheWaitReleased(cache);
+    }
+    // Another store may have cleared it while the hits were released
+    if (cache->used == header->capacity || cache->data_end + size > partition->size) {
+        // Flash is erased by the sector, starting over is the one eviction that needs no rewriting
+        ESP_LOGW(TAG, "Answer cache full, clearing it");
+        err = OpenAI_AnswerCacheFormat(cache);
+        OPENAI_ERROR_CHECK_GOTO(err == ESP_OK, "Failed to clear answer cache!", end);
+    }
+
+    uint32_t index = cache->used;
+    uint32_t entry_offset = header->entries_offset + index * sizeof(OpenAI_AnswerCacheEntry_t);
+    OpenAI_AnswerCacheEntry_t entry = {
+        .data_offset = cache->data_end,
+        .text_len = text_len,
+        .audio_len = audioLen,
+    };
+    // The entry is taken even if writing its data fails, its flash is not erased anymore
+    err = esp_partition_write(partition, entry_offset, &entry, offsetof(OpenAI_AnswerCacheEntry_t, committed));
+    OPENAI_ERROR_CHECK_GOTO(err == ESP_OK, "Failed to write entry!", end);
+    cache->used++;
+    cache->data_end += size;
+    err = esp_partition_write(partition, entry.data_offset, text, text_len);
+    OPENAI_ERROR_CHECK_GOTO(err == ESP_OK, "Failed to write text!", end);
+    if (audioLen > 0) {
+        err = esp_partition_write(partition, entry.data_offset + text_len, audio, audioLen);
+        OPENAI_ERROR_CHECK_GOTO(err == ESP_OK, "Failed to write audio!", end);
+    }
+    err = esp_partition_write(partition, header->vectors_offset + index * sizeof(cache->vector), vector, sizeof(cache->vector));
+    OPENAI_ERROR_CHECK_GOTO(err == ESP_OK, "Failed to write vector!", end);
+    uint32_t committed = OPENAI_ANSWER_CACHE_MAGIC;
+    err = esp_partition_write(partition, entry_offset + offsetof(OpenAI_AnswerCacheEntry_t, committed), &committed, sizeof(committed));
+    OPENAI_ERROR_CHECK_GOTO(err == ESP_OK, "Failed to commit entry!", end);
+    cache->count++;
+
+end:
+    xSemaphoreGive(cache->lock);
+    free(vector);
+    return err;
+}
+
+static uint32_t OpenAI_AnswerCacheGetCount(OpenAI_AnswerCache_t *answerCache)
+{
+    _OpenAI_AnswerCache_t *cache = __containerof(answerCache, _OpenAI_AnswerCache_t, parent);
+    return cache->count;
+}
+
+static esp_err_t OpenAI_AnswerCacheClear(OpenAI_AnswerCache_t *answerCache)
+{
+    _OpenAI_AnswerCache_t *cache = __containerof(answerCache, _OpenAI_AnswerCache_t, parent);
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    OpenAI_AnswerCacheWaitReleased(cache);
+    esp_err_t err = OpenAI_AnswerCacheFormat(cache);
+    xSemaphoreGive(cache->lock);
+    return err;
+}
+
+void OpenAI_AnswerCacheDelete(OpenAI_AnswerCache_t *answerCache)
+{
+    if (answerCache == NULL) {
+        return;
+    }
+    _OpenAI_AnswerCache_t *cache = __containerof(answerCache, _OpenAI_AnswerCache_t, parent);
+    if (cache->map != NULL) {
+        OpenAI_AnswerCacheUnmap(cache->map_handle);
+    }
+    if (cache->lock != NULL) {
+        vSemaphoreDelete(cache->lock);
+    }
+    if (cache->released != NULL) {
+        vSemaphoreDelete(cache->released);
+    }
+    free(cache->question);
+    free(cache);
+}
+
+OpenAI_AnswerCache_t *OpenAI_AnswerCacheCreate(OpenAI_t *openai, const char *label)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    OPENAI_ERROR_CHECK(partition != NULL, "Answer cache partition not found!", NULL);
+    _OpenAI_AnswerCache_t *cache = (_OpenAI_AnswerCache_t *)calloc(1, sizeof(_OpenAI_AnswerCache_t));
+    OPENAI_ERROR_CHECK(cache != NULL, "Failed to allocate answer cache!", NULL);
+    cache->openai = openai;
+    cache->partition = partition;
+    cache->lock = xSemaphoreCreateMutex();
+    cache->released = xSemaphoreCreateBinary();
+    OPENAI_ERROR_CHECK_GOTO(cache->lock != NULL && cache->released != NULL, "Failed to create answer cache lock!", fail);
+    // Searches read the vectors straight from flash through the cache of the MMU, nothing is copied to RAM
+    const void *map = NULL;
+    esp_err_t err = esp_partition_mmap(partition, 0, partition->size, OPENAI_ANSWER_CACHE_MMAP_DATA, &map, &cache->map_handle);
+    OPENAI_ERROR_CHECK_GOTO(err == ESP_OK, "Failed to map answer cache partition!", fail);
+    cache->map = (const uint8_t *)map;
+    OPENAI_ERROR_CHECK_GOTO(OpenAI_AnswerCacheOpen(cache) == ESP_OK, "Failed to open answer cache!", fail);
+
+    OpenAI_AnswerCacheSetThreshold(&cache->parent, CONFIG_ANSWER_CACHE_THRESHOLD / 100.0f);
+    cache->parent.setThreshold = &OpenAI_AnswerCacheSetThreshold;
+    cache->parent.lookup = &OpenAI_AnswerCacheLookup;
+    cache->parent.release = &OpenAI_AnswerCacheRelease;
+    cache->parent.store = &OpenAI_AnswerCacheStore;
+    cache->parent.getCount = &OpenAI_AnswerCacheGetCount;
+    cache->parent.clear = &OpenAI_AnswerCacheClear;
+    return &cache->parent;
+
+fail:
+    OpenAI_AnswerCacheDelete(&cache->parent);
+    return NULL;
+}
+#endif
@@ -0,0 +1,244 @@
+/* SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <sys/cdefs.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "OpenAI_Transport.h"
+#include "OpenAI_Private.h"
+
+static const char *TAG = "OpenAI_EspHttp";
+
+static const esp_http_client_method_t http_methods[] = {
+    [OPENAI_HTTP_METHOD_GET] = HTTP_METHOD_GET,
+    [OPENAI_HTTP_METHOD_POST] = HTTP_METHOD_POST,
+    [OPENAI_HTTP_METHOD_DELETE] = HTTP_METHOD_DELETE,
+};
+
+/**
+ * @brief A request in progress and the client it was sent with.
+ *
+ */
+typedef struct {
+    esp_http_client_handle_t client;        /*!< Client of the exchange */
+    uint32_t ttfb_timeout_ms;               /*!< Longest pause while reading the response */
+    uint32_t timeout_ms;                    /*!< Time limit of the whole exchange, 0 for none */
+    TickType_t deadline;                    /*!< Tick count the exchange has to end by when timeout_ms is set */
+} OpenAI_EspHttpExchange_t;
+
+/**
+ * @brief Sends the requests with esp_http_client. The persistent exchange keeps its client between
+ *        requests, requests from other tasks while it is busy get a one-off exchange and client.
+ *
+ */
+typedef struct {
+    OpenAI_Transport_t parent;              /*!< Base object */
+    OpenAI_EspHttpExchange_t exchange;      /*!< Persistent exchange, its client is kept alive between requests */
+    SemaphoreHandle_t client_lock;          /*!< Taken while a request uses exchange */
+    TickType_t client_last_used;            /*!< Tick count at the end of the last request on exchange */
+} OpenAI_EspHttpTransport_t;
+
+static esp_http_client_handle_t OpenAI_EspHttpClientInit(const char *url, esp_http_client_method_t method, uint32_t timeout_ms)
+{
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = method,
+        .timeout_ms = timeout_ms,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+        .keep_alive_enable = true,
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        // Reconnects of the same client resume the TLS session instead of a full handshake
+        .save_client_session = true,
+#endif
+    };
+    return esp_http_client_init(&config);
+}
+
+static OpenAI_EspHttpExchange_t *OpenAI_EspHttpConnect(OpenAI_EspHttpTransport_t *transport, const OpenAI_Http_Request_t *request, bool *reused)
+{
+    esp_http_client_method_t method = http_methods[request->method];
+    *reused = false;
+    // Requests from other tasks while the persistent client is busy get a one-off client instead of waiting
+    if (transport->client_lock != NULL && xSemaphoreTake(transport->client_lock, 0) == pdTRUE) {
+        OpenAI_EspHttpExchange_t *exchange = &transport->exchange;
+        if (exchange->client == NULL) {
+            exchange->client = OpenAI_EspHttpClientInit(request->url, method, request->connect_timeout_ms);
+            if (exchange->client == NULL) {
+                xSemaphoreGive(transport->client_lock);
+                ESP_LOGE(TAG, "Failed to init client!");
+                return NULL;
+            }
+        } else {
+            // Servers drop idle keep-alive connections, don't risk writing into one
+            if (xTaskGetTickCount() - transport->client_last_used > pdMS_TO_TICKS(OPENAI_CONNECTION_IDLE_TIMEOUT_MS)) {
+                esp_http_client_close(exchange->client);
+            } else {
+                *reused = true;
+            }
+            // Same host keeps the connection open, another host closes it
+            esp_http_client_set_url(exchange->client, request->url);
+            esp_http_client_set_method(exchange->client, method);
+        }
+        return exchange;
+    }
+    OpenAI_EspHttpExchange_t *exchange = (OpenAI_EspHttpExchange_t *)calloc(1, sizeof(OpenAI_EspHttpExchange_t));
+    OPENAI_ERROR_CHECK(exchange != NULL, "Failed to allocate exchange!", NULL);
+    exchange->client = OpenAI_EspHttpClientInit(request->url, method, request->connect_timeout_ms);
+    if (exchange->client == NULL) {
+        free(exchange);
+        ESP_LOGE(TAG, "Failed to init client!");
+        return NULL;
+    }
+    return exchange;
+}
+
+static void OpenAI_EspHttpFinish(OpenAI_Transport_t *transport, void *exchange)
+{
+    OpenAI_EspHttpTransport_t *_transport = __containerof(transport, OpenAI_EspHttpTransport_t, parent);
+    OpenAI_EspHttpExchange_t *_exchange = (OpenAI_EspHttpExchange_t *)exchange;
+    if (_exchange != &_transport->exchange) {
+        esp_http_client_close(_exchange->client);
+        esp_http_client_cleanup(_exchange->client);
+        free(_exchange);
+    } else {
+        // Only a fully read response leaves the connection ready for the next request
+        if (!esp_http_client_is_complete_data_received(_exchange->client)) {
+            esp_http_client_close(_exchange->client);
+        }
+        _transport->client_last_used = xTaskGetTickCount();
+        xSemaphoreGive(_transport->client_lock);
+    }
+}
+
+static bool OpenAI_EspHttpBodyReplayable(const OpenAI_Http_Request_t *request)
+{
+    for (size_t i = 0; i < request->count; i++) {
+        if (request->parts[i].data == NULL && request->parts[i].len > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int OpenAI_EspHttpWrite(void *ctx, const char *data, size_t len)
+{
+    esp_http_client_handle_t client = (esp_http_client_handle_t)ctx;
+    while (len > 0) {
+        int wlen = esp_http_client_write(client, data, len);
+        if (wlen <= 0) {
+            return -1;
+        }
+        data += wlen;
+        len -= wlen;
+    }
+    return 0;
+}
+
+static int64_t OpenAI_EspHttpSendOnce(esp_http_client_handle_t client, const OpenAI_Http_Request_t *request, OpenAI_Request_Timing_t *timing)
+{
+    esp_http_client_set_header(client, "Content-Type", request->content_type);
+    esp_http_client_set_header(client, "Authorization", request->authorization);
+
+    // The timeout of the client applies to every socket operation, the connection setup gets its own
+    esp_http_client_set_timeout_ms(client, request->connect_timeout_ms);
+    // The length is known up front, the body is written part by part without being assembled
+    int64_t start = OpenAI_TimeUs();
+    esp_err_t err = esp_http_client_open(client, request->len);
+    // Opening resolves, connects and shakes hands in one go, on a kept-alive connection it only writes the head
+    int64_t opened = OpenAI_TimeUs();
+    if (!timing->reused) {
+        timing->connect_us = opened - start;
+        start = opened;
+    }
+    OPENAI_ERROR_CHECK(err == ESP_OK, "Failed to open client!", -1);
+    esp_http_client_set_timeout_ms(client, request->ttfb_timeout_ms);
+    err = OpenAI_TransportWriteBody(request->parts, request->count, &OpenAI_EspHttpWrite, client);
+    OPENAI_ERROR_CHECK(err == ESP_OK, "Failed to write request body!", -1);
+    int64_t sent = OpenAI_TimeUs();
+    timing->upload_us = sent - start;
+    int64_t length = esp_http_client_fetch_headers(client);
+    timing->ttfb_us = OpenAI_TimeUs() - sent;
+    return length;
+}
+
+static void *OpenAI_EspHttpSend(OpenAI_Transport_t *transport, const OpenAI_Http_Request_t *request, int *status, int64_t *content_length)
+{
+    OpenAI_EspHttpTransport_t *_transport = __containerof(transport, OpenAI_EspHttpTransport_t, parent);
+    TickType_t start = xTaskGetTickCount();
+    bool reused = false;
+    OpenAI_EspHttpExchange_t *exchange = OpenAI_EspHttpConnect(_transport, request, &reused);
+    OPENAI_ERROR_CHECK(exchange != NULL, "Failed to connect!", NULL);
+    exchange->ttfb_timeout_ms = request->ttfb_timeout_ms;
+    exchange->timeout_ms = request->timeout_ms;
+    exchange->deadline = start + pdMS_TO_TICKS(request->timeout_ms);
+
+    OpenAI_Request_Timing_t timing = { .reused = reused };
+    int64_t length = OpenAI_EspHttpSendOnce(exchange->client, request, &timing);
+    if (length < 0 && reused && OpenAI_EspHttpBodyReplayable(request)) {
+        // The server closed the kept-alive connection in the meantime, send again on a new one
+        ESP_LOGW(TAG, "Reused connection failed, reconnecting");
+        esp_http_client_close(exchange->client);
+        timing.reused = false;
+        length = OpenAI_EspHttpSendOnce(exchange->client, request, &timing);
+    }
+    if (request->timing != NULL) {
+        *request->timing = timing;
+    }
+    if (length < 0) {
+        OpenAI_EspHttpFinish(transport, exchange);
+        return NULL;
+    }
+    *status = esp_http_client_get_status_code(exchange->client);
+    *content_length = esp_http_client_is_chunked_response(exchange->client) ? -1 : length;
+    return exchange;
+}
+
+static int OpenAI_EspHttpRead(OpenAI_Transport_t *transport, void *exchange, char *buf, size_t len)
+{
+    OpenAI_EspHttpExchange_t *_exchange = (OpenAI_EspHttpExchange_t *)exchange;
+    uint32_t timeout_ms = _exchange->ttfb_timeout_ms;
+    if (_exchange->timeout_ms != 0) {
+        uint32_t left = OpenAI_TimeLeftMs(_exchange->deadline);
+        OPENAI_ERROR_CHECK(left > 0, "Request timed out!", -1);
+        timeout_ms = left < timeout_ms ? left : timeout_ms;
+    }
+    esp_http_client_set_timeout_ms(_exchange->client, timeout_ms);
+    return esp_http_client_read(_exchange->client, buf, len);
+}
+
+static void OpenAI_EspHttpDelete(OpenAI_Transport_t *transport)
+{
+    OpenAI_EspHttpTransport_t *_transport = __containerof(transport, OpenAI_EspHttpTransport_t, parent);
+    if (_transport->exchange.client != NULL) {
+        esp_http_client_cleanup(_transport->exchange.client);
+        _transport->exchange.client = NULL;
+    }
+    if (_transport->client_lock != NULL) {
+        vSemaphoreDelete(_transport->client_lock);
+        _transport->client_lock = NULL;
+    }
+    free(_transport);
+}
+OpenAI_Transport_t *OpenAI_TransportEspHttpCreate(void)
+{
+    OpenAI_EspHttpTransport_t *_transport = (OpenAI_EspHttpTransport_t *)calloc(1, sizeof(OpenAI_EspHttpTransport_t));
+    OPENAI_ERROR_CHECK(_transport != NULL, "Failed to allocate transport!", NULL);
+#if CONFIG_ENABLE_PERSISTENT_CONNECTION
+    _transport->client_lock = xSemaphoreCreateMutex();
+    OPENAI_ERROR_CHECK_CONTINUE(_transport->client_lock != NULL, "Failed to create client lock, connections will not be reused!");
+#endif
+    _transport->parent.send = &OpenAI_EspHttpSend;
+    _transport->parent.read = &OpenAI_EspHttpRead;
+    _transport->parent.finish = &OpenAI_EspHttpFinish;
+    _transport->parent.delete = &OpenAI_EspHttpDelete;
+    return &_transport->parent;
+}
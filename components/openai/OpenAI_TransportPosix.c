@@ -0,0 +1,497 @@
+/* SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/cdefs.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "OpenAI_Transport.h"
+#include "OpenAI_Private.h"
+
+static const char *TAG = "OpenAI_Posix";
+
+#define OPENAI_POSIX_HOST_MAX 128
+#define OPENAI_POSIX_LINE_MAX 1024
+#define OPENAI_POSIX_BUFFER_SIZE 1024
+
+static const char *http_methods[] = {
+    [OPENAI_HTTP_METHOD_GET] = "GET",
+    [OPENAI_HTTP_METHOD_POST] = "POST",
+    [OPENAI_HTTP_METHOD_DELETE] = "DELETE",
+};
+
+/**
+ * @brief One HTTP/1.1 connection and the state of the response read from it.
+ *
+ */
+typedef struct {
+    int sock;                                   /*!< Socket, -1 when not connected */
+    char host[OPENAI_POSIX_HOST_MAX];           /*!< Host the socket is connected to */
+    char port[8];                               /*!< Port the socket is connected to */
+    char buf[OPENAI_POSIX_BUFFER_SIZE];         /*!< Received data not consumed yet */
+    size_t buf_pos;                             /*!< Start of the unconsumed data in buf */
+    size_t buf_len;                             /*!< End of the unconsumed data in buf */
+    bool chunked;                               /*!< Body uses chunked transfer encoding */
+    int64_t remaining;                          /*!< Body bytes left, or left in the current chunk, -1 until close */
+    bool done;                                  /*!< The whole body was read */
+    bool keep_alive;                            /*!< The server keeps the connection open after the response */
+    uint32_t ttfb_timeout_ms;                   /*!< Longest pause while reading the response */
+    uint32_t timeout_ms;                        /*!< Time limit of the whole exchange, 0 for none */
+    TickType_t deadline;                        /*!< Tick count the exchange has to end by when timeout_ms is set */
+    uint32_t recv_timeout_ms;                   /*!< Receive timeout currently set on sock */
+} OpenAI_PosixExchange_t;
+
+/**
+ * @brief Sends the requests over plain sockets. The persistent exchange is kept connected between
+ *        requests, requests from other tasks while it is busy get a one-off exchange.
+ *
+ */
+typedef struct {
+    OpenAI_Transport_t parent;                  /*!< Base object */
+    OpenAI_PosixExchange_t exchange;            /*!< Persistent keep-alive connection */
+    SemaphoreHandle_t lock;                     /*!< Taken while a request uses exchange */
+    TickType_t last_used;                       /*!< Tick count at the end of the last request on exchange */
+} OpenAI_PosixTransport_t;
+
+static void OpenAI_PosixClose(OpenAI_PosixExchange_t *exchange)
+{
+    if (exchange->sock >= 0) {
+        close(exchange->sock);
+        exchange->sock = -1;
+    }
+    exchange->buf_pos = exchange->buf_len = 0;
+}
+
+static esp_err_t OpenAI_PosixParseUrl(const char *url, char *host, char *port, const char **path)
+{
+    if (strncmp(url, "https://", 8) == 0) {
+        ESP_LOGE(TAG, "https is not supported by the POSIX transport, use an http base URL");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    OPENAI_ERROR_CHECK(strncmp(url, "http://", 7) == 0, "Invalid URL!", ESP_ERR_INVALID_ARG);
+    const char *start = url + 7;
+    const char *end = start + strcspn(start, "/");
+    const char *colon = memchr(start, ':', end - start);
+    const char *host_end = colon ? colon : end;
+    OPENAI_ERROR_CHECK(host_end > start && host_end - start < OPENAI_POSIX_HOST_MAX, "Invalid host!", ESP_ERR_INVALID_ARG);
+    memcpy(host, start, host_end - start);
+    host[host_end - start] = 0;
+    if (colon) {
+        OPENAI_ERROR_CHECK(end - colon - 1 > 0 && end - colon - 1 < 8, "Invalid port!", ESP_ERR_INVALID_ARG);
+        memcpy(port, colon + 1, end - colon - 1);
+        port[end - colon - 1] = 0;
+    } else {
+        strcpy(port, "80");
+    }
+    *path = *end ? end : "/";
+    return ESP_OK;
+}
+
+static void OpenAI_PosixSetTimeout(int sock, int option, uint32_t timeout_ms)
+{
+    struct timeval timeout = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000,
+    };
+    setsockopt(sock, SOL_SOCKET, option, &timeout, sizeof(timeout));
+}
+
+static int OpenAI_PosixConnectSocket(const struct addrinfo *ai, uint32_t timeout_ms)
+{
+    int sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (sock < 0) {
+        return -1;
+    }
+    // Connect without blocking to bound the time the handshake may take
+    int flags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+    int err = connect(sock, ai->ai_addr, ai->ai_addrlen);
+    if (err < 0 && errno == EINPROGRESS) {
+        struct pollfd pfd = { .fd = sock, .events = POLLOUT };
+        int error = ETIMEDOUT;
+        socklen_t error_len = sizeof(error);
+        if (poll(&pfd, 1, timeout_ms) == 1) {
+            getsockopt(sock, SOL_SOCKET, SO_ERROR, &error, &error_len);
+        }
+        err = error == 0 ? 0 : -1;
+    }
+    if (err < 0) {
+        close(sock);
+        return -1;
+    }
+    fcntl(sock, F_SETFL, flags);
+    return sock;
+}
+
+static esp_err_t OpenAI_PosixConnect(OpenAI_PosixExchange_t *exchange, const char *host, const char *port, uint32_t timeout_ms, OpenAI_Request_Timing_t *timing)
+{
+    struct addrinfo hints = {
+        .ai_family = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+    };
+    struct addrinfo *res = NULL;
+    int64_t start = OpenAI_TimeUs();
+    int err = getaddrinfo(host, port, &hints, &res);
+    int64_t resolved = OpenAI_TimeUs();
+    timing->dns_us = resolved - start;
+    OPENAI_ERROR_CHECK(err == 0 && res != NULL, "Failed to resolve host!", ESP_FAIL);
+
+    for (struct addrinfo *ai = res; ai != NULL && exchange->sock < 0; ai = ai->ai_next) {
+        exchange->sock = OpenAI_PosixConnectSocket(ai, timeout_ms);
+    }
+    freeaddrinfo(res);
+    timing->connect_us = OpenAI_TimeUs() - resolved;
+    OPENAI_ERROR_CHECK(exchange->sock >= 0, "Failed to connect!", ESP_FAIL);
+    int one = 1;
+    // The requests go out as a head and a body, don't hold the body back for the head's ACK
+    setsockopt(exchange->sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    snprintf(exchange->host, sizeof(exchange->host), "%s", host);
+    snprintf(exchange->port, sizeof(exchange->port), "%s", port);
+    exchange->buf_pos = exchange->buf_len = 0;
+    exchange->recv_timeout_ms = 0;
+    return ESP_OK;
+}
+
+static int OpenAI_PosixWrite(void *ctx, const char *data, size_t len)
+{
+    OpenAI_PosixExchange_t *exchange = (OpenAI_PosixExchange_t *)ctx;
+    while (len > 0) {
+        ssize_t wlen = send(exchange->sock, data, len, MSG_NOSIGNAL);
+        if (wlen < 0 && errno == EINTR) {
+            continue;
+        }
+        if (wlen <= 0) {
+            return -1;
+        }
+        data += wlen;
+        len -= wlen;
+    }
+    return 0;
+}
+
+static int OpenAI_PosixFill(OpenAI_PosixExchange_t *exchange)
+{
+    ssize_t rlen;
+    do {
+        rlen = recv(exchange->sock, exchange->buf, sizeof(exchange->buf), 0);
+    } while (rlen < 0 && errno == EINTR);
+    if (rlen > 0) {
+        exchange->buf_pos = 0;
+        exchange->buf_len = rlen;
+    }
+    return rlen;
+}
+
+static int OpenAI_PosixRecv(OpenAI_PosixExchange_t *exchange, char *buf, size_t len)
+{
+    if (exchange->buf_pos == exchange->buf_len) {
+        // Large reads go straight to the caller's buffer
+        if (len >= sizeof(exchange->buf)) {
+            ssize_t rlen;
+            do {
+                rlen = recv(exchange->sock, buf, len, 0);
+            } while (rlen < 0 && errno == EINTR);
+            return rlen;
+        }
+        int rlen = OpenAI_PosixFill(exchange);
+        if (rlen <= 0) {
+            return rlen;
+        }
+    }
+    size_t n = exchange->buf_len - exchange->buf_pos;
+    n = n < len ? n : len;
+    memcpy(buf, exchange->buf + exchange->buf_pos, n);
+    exchange->buf_pos += n;
+    return n;
+}
+
+static esp_err_t OpenAI_PosixReadLine(OpenAI_PosixExchange_t *exchange, char *line, size_t size)
+{
+    size_t len = 0;
+    for (;;) {
+        if (exchange->buf_pos == exchange->buf_len && OpenAI_PosixFill(exchange) <= 0) {
+            return ESP_FAIL;
+        }
+        char c = exchange->buf[exchange->buf_pos++];
+        if (c == '\n') {
+            break;
+        }
+        if (len + 1 < size) {
+            line[len++] = c;
+        }
+    }
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    line[len] = 0;
+    return ESP_OK;
+}
+
+static esp_err_t OpenAI_PosixReadHead(OpenAI_PosixExchange_t *exchange, int *status)
+{
+    char line[OPENAI_POSIX_LINE_MAX];
+    int code = 0;
+    do {
+        // Informational responses come before the final one, skip them with their headers
+        OPENAI_ERROR_CHECK(OpenAI_PosixReadLine(exchange, line, sizeof(line)) == ESP_OK, "Failed to read status line!", ESP_FAIL);
+        int minor = 0;
+        OPENAI_ERROR_CHECK(sscanf(line, "HTTP/1.%d %d", &minor, &code) == 2, "Invalid status line!", ESP_FAIL);
+        exchange->keep_alive = minor >= 1;
+        exchange->chunked = false;
+        exchange->remaining = -1;
+        for (;;) {
+            OPENAI_ERROR_CHECK(OpenAI_PosixReadLine(exchange, line, sizeof(line)) == ESP_OK, "Failed to read headers!", ESP_FAIL);
+            if (line[0] == 0) {
+                break;
+            }
+            char *value = strchr(line, ':');
+            if (value == NULL) {
+                continue;
+            }
+            *value++ = 0;
+            value += strspn(value, " \t");
+            if (strcasecmp(line, "Content-Length") == 0) {
+                exchange->remaining = strtoll(value, NULL, 10);
+            } else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+                exchange->chunked = strcasestr(value, "chunked") != NULL;
+            } else if (strcasecmp(line, "Connection") == 0) {
+                if (strcasestr(value, "close") != NULL) {
+                    exchange->keep_alive = false;
+                } else if (strcasestr(value, "keep-alive") != NULL) {
+                    exchange->keep_alive = true;
+                }
+            }
+        }
+    } while (code >= 100 && code < 200);
+
+    if (exchange->chunked) {
+        exchange->remaining = 0;
+    } else if (code == 204 || code == 304) {
+        exchange->remaining = 0;
+    } else if (exchange->remaining < 0) {
+        // The body ends when the server closes the connection
+        exchange->keep_alive = false;
+    }
+    exchange->done = !exchange->chunked && exchange->remaining == 0;
+    *status = code;
+    return ESP_OK;
+}
+
+static esp_err_t OpenAI_PosixSendOnce(OpenAI_PosixExchange_t *exchange, const OpenAI_Http_Request_t *request, const char *path, int *status, OpenAI_Request_Timing_t *timing)
+{
+    char head[OPENAI_POSIX_LINE_MAX];
+    int len = snprintf(head, sizeof(head),
+                       "%s %s HTTP/1.1\r\n"
+                       "Host: %s:%s\r\n"
+                       "User-Agent: ESP32 Http Client\r\n"
+                       "Content-Type: %s\r\n"
+                       "Authorization: %s\r\n"
+                       "Content-Length: %zu\r\n"
+                       "Connection: keep-alive\r\n"
+                       "\r\n",
+                       http_methods[request->method], path, exchange->host, exchange->port,
+                       request->content_type, request->authorization, request->len);
+    OPENAI_ERROR_CHECK(len > 0 && len < sizeof(head), "Request head too long!", ESP_ERR_INVALID_SIZE);
+    OpenAI_PosixSetTimeout(exchange->sock, SO_SNDTIMEO, request->ttfb_timeout_ms);
+    if (exchange->recv_timeout_ms != request->ttfb_timeout_ms) {
+        OpenAI_PosixSetTimeout(exchange->sock, SO_RCVTIMEO, request->ttfb_timeout_ms);
+        exchange->recv_timeout_ms = request->ttfb_timeout_ms;
+    }
+    int64_t start = OpenAI_TimeUs();
+    OPENAI_ERROR_CHECK(OpenAI_PosixWrite(exchange, head, len) == 0, "Failed to write request head!", ESP_FAIL);
+    esp_err_t err = OpenAI_TransportWriteBody(request->parts, request->count, &OpenAI_PosixWrite, exchange);
+    OPENAI_ERROR_CHECK(err == ESP_OK, "Failed to write request body!", err);
+    int64_t sent = OpenAI_TimeUs();
+    timing->upload_us = sent - start;
+    err = OpenAI_PosixReadHead(exchange, status);
+    timing->ttfb_us = OpenAI_TimeUs() - sent;
+    return err;
+}
+
+static bool OpenAI_PosixBodyReplayable(const OpenAI_Http_Request_t *request)
+{
+    for (size_t i = 0; i < request->count; i++) {
+        if (request->parts[i].data == NULL && request->parts[i].len > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void OpenAI_PosixFinish(OpenAI_Transport_t *transport, void *exchange)
+{
+    OpenAI_PosixTransport_t *_transport = __containerof(transport, OpenAI_PosixTransport_t, parent);
+    OpenAI_PosixExchange_t *_exchange = (OpenAI_PosixExchange_t *)exchange;
+    if (_exchange != &_transport->exchange) {
+        OpenAI_PosixClose(_exchange);
+        free(_exchange);
+        return;
+    }
+    // Only a fully read response leaves the connection ready for the next request
+    if (!_exchange->done || !_exchange->keep_alive) {
+        OpenAI_PosixClose(_exchange);
+    }
+    _transport->last_used = xTaskGetTickCount();
+    xSemaphoreGive(_transport->lock);
+}
+
+static void *OpenAI_PosixSend(OpenAI_Transport_t *transport, const OpenAI_Http_Request_t *request, int *status, int64_t *content_length)
+{
+    OpenAI_PosixTransport_t *_transport = __containerof(transport, OpenAI_PosixTransport_t, parent);
+    TickType_t start = xTaskGetTickCount();
+    char host[OPENAI_POSIX_HOST_MAX];
+    char port[8];
+    const char *path = NULL;
+    OPENAI_ERROR_CHECK(OpenAI_PosixParseUrl(request->url, host, port, &path) == ESP_OK, "Unsupported URL!", NULL);
+
+    OpenAI_PosixExchange_t *exchange = NULL;
+    bool reused = false;
+    // Requests from other tasks while the persistent connection is busy get a one-off connection instead of waiting
+    if (_transport->lock != NULL && xSemaphoreTake(_transport->lock, 0) == pdTRUE) {
+        exchange = &_transport->exchange;
+        if (exchange->sock >= 0) {
+            // Servers drop idle keep-alive connections, don't risk writing into one
+            if (xTaskGetTickCount() - _transport->last_used > pdMS_TO_TICKS(OPENAI_CONNECTION_IDLE_TIMEOUT_MS)
+                    || strcmp(exchange->host, host) != 0 || strcmp(exchange->port, port) != 0) {
+                OpenAI_PosixClose(exchange);
+            } else {
+                reused = true;
+            }
+        }
+    } else {
+        exchange = (OpenAI_PosixExchange_t *)calloc(1, sizeof(OpenAI_PosixExchange_t));
+        OPENAI_ERROR_CHECK(exchange != NULL, "Failed to allocate exchange!", NULL);
+        exchange->sock = -1;
+    }
+
+    exchange->ttfb_timeout_ms = request->ttfb_timeout_ms;
+    exchange->timeout_ms = request->timeout_ms;
+    exchange->deadline = start + pdMS_TO_TICKS(request->timeout_ms);
+
+    // Plain HTTP, no TLS phase
+    OpenAI_Request_Timing_t timing = { .reused = reused };
+    esp_err_t err = ESP_OK;
+    if (exchange->sock < 0) {
+        err = OpenAI_PosixConnect(exchange, host, port, request->connect_timeout_ms, &timing);
+    }
+    if (err == ESP_OK) {
+        err = OpenAI_PosixSendOnce(exchange, request, path, status, &timing);
+        if (err != ESP_OK && reused && OpenAI_PosixBodyReplayable(request)) {
+            // The server closed the kept-alive connection in the meantime, send again on a new one
+            ESP_LOGW(TAG, "Reused connection failed, reconnecting");
+            OpenAI_PosixClose(exchange);
+            timing.reused = false;
+            err = OpenAI_PosixConnect(exchange, host, port, request->connect_timeout_ms, &timing);
+            if (err == ESP_OK) {
+                err = OpenAI_PosixSendOnce(exchange, request, path, status, &timing);
+            }
+        }
+    }
+    if (request->timing != NULL) {
+        *request->timing = timing;
+    }
+    if (err != ESP_OK) {
+        exchange->done = false;
+        OpenAI_PosixFinish(transport, exchange);
+        return NULL;
+    }
+    *content_length = exchange->chunked ? -1 : exchange->remaining;
+    return exchange;
+}
+
+static int OpenAI_PosixRead(OpenAI_Transport_t *transport, void *exchange, char *buf, size_t len)
+{
+    OpenAI_PosixExchange_t *_exchange = (OpenAI_PosixExchange_t *)exchange;
+    if (_exchange->done || len == 0) {
+        return 0;
+    }
+    uint32_t timeout_ms = _exchange->ttfb_timeout_ms;
+    if (_exchange->timeout_ms != 0) {
+        uint32_t left = OpenAI_TimeLeftMs(_exchange->deadline);
+        OPENAI_ERROR_CHECK(left > 0, "Request timed out!", -1);
+        timeout_ms = left < timeout_ms ? left : timeout_ms;
+    }
+    if (_exchange->recv_timeout_ms != timeout_ms) {
+        OpenAI_PosixSetTimeout(_exchange->sock, SO_RCVTIMEO, timeout_ms);
+        _exchange->recv_timeout_ms = timeout_ms;
+    }
+    if (_exchange->chunked && _exchange->remaining == 0) {
+        char line[64];
+        OPENAI_ERROR_CHECK(OpenAI_PosixReadLine(_exchange, line, sizeof(line)) == ESP_OK, "Failed to read chunk size!", -1);
+        // Every chunk but the first is preceded by the CRLF ending the previous one
+        if (line[0] == 0) {
+            OPENAI_ERROR_CHECK(OpenAI_PosixReadLine(_exchange, line, sizeof(line)) == ESP_OK, "Failed to read chunk size!", -1);
+        }
+        char *end = NULL;
+        _exchange->remaining = strtoll(line, &end, 16);
+        OPENAI_ERROR_CHECK(end != line && _exchange->remaining >= 0, "Invalid chunk size!", -1);
+        if (_exchange->remaining == 0) {
+            // Skip the trailers up to the empty line ending the body
+            do {
+                OPENAI_ERROR_CHECK(OpenAI_PosixReadLine(_exchange, line, sizeof(line)) == ESP_OK, "Failed to read trailer!", -1);
+            } while (line[0] != 0);
+            _exchange->done = true;
+            return 0;
+        }
+    }
+    if (_exchange->remaining >= 0 && (int64_t)len > _exchange->remaining) {
+        len = _exchange->remaining;
+    }
+    int rlen = OpenAI_PosixRecv(_exchange, buf, len);
+    if (rlen == 0 && _exchange->remaining < 0) {
+        _exchange->done = true;
+        return 0;
+    }
+    OPENAI_ERROR_CHECK(rlen > 0, "Connection closed before the end of the body!", -1);
+    if (_exchange->remaining >= 0) {
+        _exchange->remaining -= rlen;
+        if (!_exchange->chunked && _exchange->remaining == 0) {
+            _exchange->done = true;
+        }
+    }
+    return rlen;
+}
+
+static void OpenAI_PosixDelete(OpenAI_Transport_t *transport)
+{
+    OpenAI_PosixTransport_t *_transport = __containerof(transport, OpenAI_PosixTransport_t, parent);
+    OpenAI_PosixClose(&_transport->exchange);
+    if (_transport->lock != NULL) {
+        vSemaphoreDelete(_transport->lock);
+        _transport->lock = NULL;
+    }
+    free(_transport);
+}
+
+OpenAI_Transport_t *OpenAI_TransportPosixCreate(void)
+{
+    OpenAI_PosixTransport_t *_transport = (OpenAI_PosixTransport_t *)calloc(1, sizeof(OpenAI_PosixTransport_t));
+    OPENAI_ERROR_CHECK(_transport != NULL, "Failed to allocate transport!", NULL);
+    _transport->exchange.sock = -1;
+#if CONFIG_ENABLE_PERSISTENT_CONNECTION
+    _transport->lock = xSemaphoreCreateMutex();
+    OPENAI_ERROR_CHECK_CONTINUE(_transport->lock != NULL, "Failed to create connection lock, connections will not be reused!");
+#endif
+    _transport->parent.send = &OpenAI_PosixSend;
+    _transport->parent.read = &OpenAI_PosixRead;
+    _transport->parent.finish = &OpenAI_PosixFinish;
+    _transport->parent.delete = &OpenAI_PosixDelete;
+    return &_transport->parent;
+}
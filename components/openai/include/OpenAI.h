@@ -11,6 +11,9 @@ extern "C" {
 
 #include <stdbool.h>
 #include "cJSON.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
 
 /*<! Enum for image sizes */
 typedef enum {
@@ -53,6 +56,133 @@ typedef enum {
     OPENAI_AUDIO_OUTPUT_FORMAT_FLAC
 } OpenAI_Audio_Output_Format;
 
+/**
+ * @brief Callback that delivers the next piece of an upload, e.g. from an audio ring buffer.
+ *
+ * @param ctx[in] the user context given together with the callback
+ * @param buf[out] where to store the data
+ * @param len[in] the maximum number of bytes to store
+ * @return int the number of bytes stored, 0 or negative to abort the upload
+ */
+typedef int (*OpenAI_Read_Cb)(void *ctx, uint8_t *buf, size_t len);
+
+/**
+ * @brief Callback that receives the next piece of a streamed response as soon as it arrived.
+ *
+ * @param ctx[in] the user context given together with the callback
+ * @param data[in] the received data, only valid during the call
+ * @param len[in] the length of data
+ * @return int 0 to continue, negative to abort the stream
+ */
+typedef int (*OpenAI_Write_Cb)(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * @brief Callback that receives the text of a streamed chat completion piece by piece.
+ *
+ * @param ctx[in] the user context given together with the callback
+ * @param delta[in] the newly generated text, only valid during the call
+ * @return int 0 to continue, negative to abort the stream
+ */
+typedef int (*OpenAI_Delta_Cb)(void *ctx, const char *delta);
+
+/**
+ * @brief Kinds of requests that share a request profile.
+ */
+typedef enum {
+    OPENAI_REQUEST_CLASS_DEFAULT = 0,   /*!< Embeddings, moderations and every other endpoint */
+    OPENAI_REQUEST_CLASS_CHAT,          /*!< Completions, chat completions and edits */
+    OPENAI_REQUEST_CLASS_AUDIO_TEXT,    /*!< Audio transcriptions and translations */
+    OPENAI_REQUEST_CLASS_SPEECH,        /*!< Audio speech */
+    OPENAI_REQUEST_CLASS_IMAGE,         /*!< Image generations, edits and variations */
+    OPENAI_REQUEST_CLASS_MAX,
+} OpenAI_Request_Class;
+
+/**
+ * @brief Timeouts, retries and hedging of one class of requests.
+ */
+typedef struct {
+    uint32_t connect_timeout_ms;        /*!< Time to open the connection, TLS handshake included */
+    uint32_t ttfb_timeout_ms;           /*!< Time from the end of the request to the response headers, also the longest pause in a response */
+    uint32_t timeout_ms;                /*!< Time for the whole request including the response, 0 for no limit */
+    uint8_t retries;                    /*!< Attempts after the first one when there was no response or it was 408, 429 or 5xx */
+    uint32_t retry_delay_ms;            /*!< Base of the backoff, attempt n waits a random time of up to retry_delay_ms * 2^n */
+    bool hedge;                         /*!< Send a second request when the first is slower than usual, the first response wins.
+                                             Only transcriptions, translations and speech of audio in memory, with ENABLE_REQUEST_HEDGING */
+} OpenAI_Request_Profile_t;
+
+/**
+ * @brief Where the time of one request went, in microseconds. The phases are those of its last attempt,
+ *        phases it skipped are 0, e.g. DNS, connect and TLS on a kept-alive connection.
+ */
+typedef struct {
+    uint32_t dns_us;                    /*!< Resolving the host name, when the transport can tell it apart */
+    uint32_t connect_us;                /*!< TCP connect, the esp_http_client transport includes resolving and the TLS handshake */
+    uint32_t tls_us;                    /*!< TLS handshake, when the transport can tell it apart */
+    uint32_t upload_us;                 /*!< Sending the request head and body */
+    uint32_t ttfb_us;                   /*!< From the end of the request to the response headers */
+    uint32_t download_us;               /*!< Receiving the response body */
+    uint32_t total_us;                  /*!< The whole request, retries and their backoff included */
+    uint32_t sent;                      /*!< Bytes of request body sent */
+    uint32_t received;                  /*!< Bytes of response body received */
+    int status;                         /*!< HTTP status of the response, 0 without one */
+    uint8_t attempts;                   /*!< Attempts sent, more than one after retries */
+    bool reused;                        /*!< Sent over a kept-alive connection */
+} OpenAI_Request_Timing_t;
+
+/**
+ * @brief Callback run by the task that sent a request once the request ended.
+ *
+ * @param ctx[in] the user context given to OpenAISetTimingCallback
+ * @param endpoint[in] the endpoint of the request, e.g. "chat/completions"
+ * @param timing[in] the timing of the request
+ */
+typedef void (*OpenAI_Timing_Cb)(void *ctx, const char *endpoint, const OpenAI_Request_Timing_t *timing);
+
+/**
+ * @brief Aggregates of the recent requests to one endpoint.
+ */
+typedef struct {
+    uint32_t requests;                  /*!< Requests since the OpenAI object was created or the stats were reset */
+    uint32_t failures;                  /*!< Requests of them without a complete 2xx response */
+    uint32_t window;                    /*!< Last successful requests the figures below are taken over */
+    uint32_t reused;                    /*!< Requests of the window sent over a kept-alive connection */
+    OpenAI_Request_Timing_t mean;       /*!< Mean of every figure over the window, status and reused are not set */
+    OpenAI_Request_Timing_t max;        /*!< Maximum of every figure over the window, status and reused are not set */
+} OpenAI_Endpoint_Stats_t;
+
+/**
+ * @brief State of a request queued to the worker tasks.
+ */
+typedef enum {
+    OPENAI_ASYNC_STATE_QUEUED,          /*!< Waiting for a free worker task */
+    OPENAI_ASYNC_STATE_RUNNING,         /*!< Being sent or received by a worker task */
+    OPENAI_ASYNC_STATE_DONE,            /*!< Finished, the result can be taken */
+    OPENAI_ASYNC_STATE_FAILED,          /*!< Finished without a result */
+    OPENAI_ASYNC_STATE_CANCELLED,       /*!< Cancelled before it finished */
+} OpenAI_Async_State;
+
+struct OpenAI_AsyncRequest;
+
+/**
+ * @brief Callback run by the worker task when a request finished, failed or was cancelled.
+ *
+ * @param request[in] the request, its result can be taken here
+ * @param ctx[in] the user context given in OpenAI_Async_Config_t
+ */
+typedef void (*OpenAI_Async_Cb)(struct OpenAI_AsyncRequest *request, void *ctx);
+
+/**
+ * @brief How a queued request reports back, every field is optional.
+ *        Callbacks run on the worker task and should return quickly.
+ */
+typedef struct {
+    OpenAI_Async_Cb done;               /*!< Called when the request ended */
+    void *ctx;                          /*!< User context passed to done and delta */
+    OpenAI_Delta_Cb delta;              /*!< Chat only: receives the generated text piece by piece */
+    EventGroupHandle_t event_group;     /*!< Event group in which bits are set when the request ended */
+    EventBits_t bits;                   /*!< The bits to set in event_group */
+} OpenAI_Async_Config_t;
+
 /**
  * @brief Struct for Embedding data
  *
@@ -263,6 +393,53 @@ typedef struct OpenAI_SpeechResponse {
 
 } OpenAI_SpeechResponse_t;
 
+/**
+ * @brief A request queued to the worker tasks by messageAsync, fileAsync or speechAsync
+ */
+typedef struct OpenAI_AsyncRequest {
+    /**
+     * @brief get the state of the request
+     *
+     * @param request[in] the point of OpenAI_AsyncRequest_t
+     * @return OpenAI_Async_State
+     */
+    OpenAI_Async_State (*getState)(struct OpenAI_AsyncRequest *request);
+
+    /**
+     * @brief wait until the request finished, failed or was cancelled
+     *
+     * @param request[in] the point of OpenAI_AsyncRequest_t
+     * @param timeout[in] the maximum time to wait in ticks, portMAX_DELAY to wait forever
+     * @return bool true if the request ended
+     */
+    bool (*wait)(struct OpenAI_AsyncRequest *request, TickType_t timeout);
+
+    /**
+     * @brief cancel the request. A queued request is dropped, a running one is aborted at the next
+     *        chunk it sends or receives. Its result is discarded.
+     *
+     * @param request[in] the point of OpenAI_AsyncRequest_t
+     */
+    void (*cancel)(struct OpenAI_AsyncRequest *request);
+
+    /**
+     * @brief take the result of a finished request, the caller owns it afterwards:
+     *        OpenAI_StringResponse_t* for messageAsync, char* for fileAsync, OpenAI_SpeechResponse_t* for speechAsync
+     *
+     * @param request[in] the point of OpenAI_AsyncRequest_t
+     * @return void* the result, NULL unless the state is OPENAI_ASYNC_STATE_DONE or when it was already taken
+     */
+    void *(*getResult)(struct OpenAI_AsyncRequest *request);
+
+    /**
+     * @brief delete the request, cancelling it if it did not end yet. Requests must be deleted
+     *        before the OpenAI object they were queued to.
+     *
+     * @param request[in] the point of OpenAI_AsyncRequest_t
+     */
+    void (*delete)(struct OpenAI_AsyncRequest *request);
+} OpenAI_AsyncRequest_t;
+
 /**
  * @brief Given a prompt, the model will return one or more predicted completions,
  * and can also return the probabilities of alternative tokens at each position.
@@ -445,6 +622,15 @@ typedef struct OpenAI_ChatCompletion {
      */
     void (*setUser)(struct OpenAI_ChatCompletion *chatCompletion, const char *u);
 
+    /**
+     * @brief Set the token budget of the conversation saved by message(). Once it is exceeded the
+     *        oldest messages are dropped, so requests stay the same size however long the dialog runs.
+     *
+     * @param chatCompletion[in] the point of OpenAI_ChatCompletion
+     * @param mt[in] estimated number of tokens to keep, 0 keeps the whole conversation
+     */
+    void (*setMaxHistoryTokens)(struct OpenAI_ChatCompletion *chatCompletion, uint32_t mt);
+
     /**
      * @brief Clears the accumulated conversation.
      *
@@ -458,9 +644,40 @@ typedef struct OpenAI_ChatCompletion {
      * @param chatCompletion[in] the point of OpenAI_ChatCompletion
      * @param p[in] the message for completion
      * @param save[in] save it with the first response if selected
-     * @return OpenAI_StringResponse_t*
+     * @return OpenAI_StringResponse_t* the response, an error of the API comes as one without data whose getError
+     *         is set, NULL on other errors
      */
     OpenAI_StringResponse_t *(*message)(struct OpenAI_ChatCompletion *chatCompletion, const char *p, bool save);
+
+    /**
+     * @brief Send the message for completion and stream the response. Every piece of generated text is
+     *        passed to delta as soon as it arrives, so it can be spoken or displayed before the response is complete.
+     *
+     * @param chatCompletion[in] the point of OpenAI_ChatCompletion
+     * @param p[in] the message for completion
+     * @param save[in] save it with the response if selected
+     * @param delta[in] the callback that receives the generated text piece by piece, NULL to only collect it
+     * @param ctx[in] the user context passed to delta
+     * @return OpenAI_StringResponse_t* the complete response, an error of the API or a stream that ended without its
+     *         [DONE] comes as one without data whose getError is set and is not saved, NULL on other errors or when
+     *         delta aborted
+     */
+    OpenAI_StringResponse_t *(*messageStream)(struct OpenAI_ChatCompletion *chatCompletion, const char *p, bool save, OpenAI_Delta_Cb delta, void *ctx);
+
+    /**
+     * @brief Queue the message for completion to a worker task and return right away. The response is
+     *        streamed, so config->delta receives the generated text while it arrives.
+     *        chatCompletion may be used meanwhile, every request sees the conversation as it was when its worker
+     *        took it up, and a saved answer is appended when it arrives. Do not delete chatCompletion until the
+     *        request ended.
+     *
+     * @param chatCompletion[in] the point of OpenAI_ChatCompletion
+     * @param p[in] the message for completion, copied
+     * @param save[in] save it with the response if selected
+     * @param config[in] how the request reports back, NULL to only poll or wait
+     * @return OpenAI_AsyncRequest_t* the queued request, NULL if too many requests are queued
+     */
+    OpenAI_AsyncRequest_t *(*messageAsync)(struct OpenAI_ChatCompletion *chatCompletion, const char *p, bool save, const OpenAI_Async_Config_t *config);
 } OpenAI_ChatCompletion_t;
 
 /**
@@ -705,6 +922,61 @@ typedef struct OpenAI_AudioTranscription {
      * @return char* the transcribed text, you should free it after use.
      */
     char *(*file)(struct OpenAI_AudioTranscription *audioTranscription, uint8_t *data, size_t len, OpenAI_Audio_Input_Format f);
+
+    /**
+     * @brief Transcribe an audio file that is read piece by piece while it is uploaded,
+     *        so it never has to be held in memory as a whole.
+     *
+     * @param audioTranscription[in] the point of OpenAI_AudioTranscription_t
+     * @param read[in] the callback that delivers the input audio data
+     * @param ctx[in] the user context passed to read
+     * @param len[in] the length of the input audio data, read must deliver exactly this many bytes
+     * @param f[in] the format of the input audio data
+     * @return char* the transcribed text, you should free it after use.
+     */
+    char *(*fileStream)(struct OpenAI_AudioTranscription *audioTranscription, OpenAI_Read_Cb read, void *ctx, size_t len, OpenAI_Audio_Input_Format f);
+
+    /**
+     * @brief Transcribe raw PCM audio, such as recorded from I2S. It is uploaded as a WAV file,
+     *        the WAV header is generated in front of the samples without copying them.
+     *
+     * @param audioTranscription[in] the point of OpenAI_AudioTranscription_t
+     * @param data[in] the interleaved little-endian PCM samples, 8 bit samples are unsigned
+     * @param len[in] the length of the PCM data, a whole number of frames
+     * @param sampleRate[in] the sample rate in Hz
+     * @param bits[in] the bits per sample, 8, 16, 24 or 32
+     * @param channels[in] the number of channels
+     * @return char* the transcribed text, you should free it after use.
+     */
+    char *(*filePcm)(struct OpenAI_AudioTranscription *audioTranscription, const uint8_t *data, size_t len, uint32_t sampleRate, uint8_t bits, uint8_t channels);
+
+    /**
+     * @brief Transcribe raw PCM audio that is read piece by piece while it is uploaded,
+     *        so a recording can go from I2S to the request without a buffer for all of it.
+     *
+     * @param audioTranscription[in] the point of OpenAI_AudioTranscription_t
+     * @param read[in] the callback that delivers the PCM samples
+     * @param ctx[in] the user context passed to read
+     * @param len[in] the length of the PCM data, read must deliver exactly this many bytes
+     * @param sampleRate[in] the sample rate in Hz
+     * @param bits[in] the bits per sample, 8, 16, 24 or 32
+     * @param channels[in] the number of channels
+     * @return char* the transcribed text, you should free it after use.
+     */
+    char *(*filePcmStream)(struct OpenAI_AudioTranscription *audioTranscription, OpenAI_Read_Cb read, void *ctx, size_t len, uint32_t sampleRate, uint8_t bits, uint8_t channels);
+
+    /**
+     * @brief Queue the transcription of an audio file to a worker task and return right away.
+     *        Do not use or delete audioTranscription until the request ended.
+     *
+     * @param audioTranscription[in] the point of OpenAI_AudioTranscription_t
+     * @param data[in] the input audio data, not copied, it must stay valid until the request ended
+     * @param len[in] the length of the input audio data
+     * @param f[in] the format of the input audio data
+     * @param config[in] how the request reports back, NULL to only poll or wait
+     * @return OpenAI_AsyncRequest_t* the queued request, NULL if too many requests are queued
+     */
+    OpenAI_AsyncRequest_t *(*fileAsync)(struct OpenAI_AudioTranscription *audioTranscription, const uint8_t *data, size_t len, OpenAI_Audio_Input_Format f, const OpenAI_Async_Config_t *config);
 } OpenAI_AudioTranscription_t;
 
 /**
@@ -753,6 +1025,30 @@ typedef struct OpenAI_AudioSpeech {
      */
     OpenAI_SpeechResponse_t *(*speech)(struct OpenAI_AudioSpeech *createSpeech, char *p);
 
+    /**
+     * @brief Send the message for audio generation and hand the audio to a callback while it is received,
+     *        e.g. to write it into the ring buffer of an mp3_decoder pipeline so playback starts right away.
+     *        Only one chunk of the audio is held in memory at a time.
+     *
+     * @param createSpeech[in] the point of OpenAI_AudioSpeech_t
+     * @param p[in] the message for audio generation
+     * @param write[in] the callback that receives every chunk of the audio
+     * @param ctx[in] the user context passed to write
+     * @return esp_err_t ESP_OK when the whole audio was received, ESP_FAIL on errors or when write aborted
+     */
+    esp_err_t (*speechStream)(struct OpenAI_AudioSpeech *createSpeech, char *p, OpenAI_Write_Cb write, void *ctx);
+
+    /**
+     * @brief Queue the message for audio generation to a worker task and return right away.
+     *        Do not use or delete createSpeech until the request ended.
+     *
+     * @param createSpeech[in] the point of OpenAI_AudioSpeech_t
+     * @param p[in] the message for audio generation, copied
+     * @param config[in] how the request reports back, NULL to only poll or wait
+     * @return OpenAI_AsyncRequest_t* the queued request, NULL if too many requests are queued
+     */
+    OpenAI_AsyncRequest_t *(*speechAsync)(struct OpenAI_AudioSpeech *createSpeech, const char *p, const OpenAI_Async_Config_t *config);
+
 } OpenAI_AudioSpeech_t;
 
 /**
@@ -795,8 +1091,126 @@ typedef struct OpenAI_AudioTranslation {
      * @return char* the translated text in English, you should free it after use.
      */
     char *(*file)(struct OpenAI_AudioTranslation *audioTranslation, uint8_t *data, size_t len, OpenAI_Audio_Input_Format f);
+
+    /**
+     * @brief Transcribe and translate an audio file into English, the audio is read piece by piece
+     *        while it is uploaded.
+     *
+     * @param audioTranslation[in] the point of OpenAI_AudioTranslation_t
+     * @param read[in] the callback that delivers the input audio data
+     * @param ctx[in] the user context passed to read
+     * @param len[in] the length of the input audio data, read must deliver exactly this many bytes
+     * @param f[in] the format of the input audio data
+     * @return char* the translated text in English, you should free it after use.
+     */
+    char *(*fileStream)(struct OpenAI_AudioTranslation *audioTranslation, OpenAI_Read_Cb read, void *ctx, size_t len, OpenAI_Audio_Input_Format f);
+
+    /**
+     * @brief Transcribe and translate raw PCM audio into English, such as recorded from I2S. It is uploaded as a WAV file,
+     *        the WAV header is generated in front of the samples without copying them.
+     *
+     * @param audioTranslation[in] the point of OpenAI_AudioTranslation_t
+     * @param data[in] the interleaved little-endian PCM samples, 8 bit samples are unsigned
+     * @param len[in] the length of the PCM data, a whole number of frames
+     * @param sampleRate[in] the sample rate in Hz
+     * @param bits[in] the bits per sample, 8, 16, 24 or 32
+     * @param channels[in] the number of channels
+     * @return char* the translated text in English, you should free it after use.
+     */
+    char *(*filePcm)(struct OpenAI_AudioTranslation *audioTranslation, const uint8_t *data, size_t len, uint32_t sampleRate, uint8_t bits, uint8_t channels);
+
+    /**
+     * @brief Transcribe and translate raw PCM audio into English that is read piece by piece while it is uploaded,
+     *        so a recording can go from I2S to the request without a buffer for all of it.
+     *
+     * @param audioTranslation[in] the point of OpenAI_AudioTranslation_t
+     * @param read[in] the callback that delivers the PCM samples
+     * @param ctx[in] the user context passed to read
+     * @param len[in] the length of the PCM data, read must deliver exactly this many bytes
+     * @param sampleRate[in] the sample rate in Hz
+     * @param bits[in] the bits per sample, 8, 16, 24 or 32
+     * @param channels[in] the number of channels
+     * @return char* the translated text in English, you should free it after use.
+     */
+    char *(*filePcmStream)(struct OpenAI_AudioTranslation *audioTranslation, OpenAI_Read_Cb read, void *ctx, size_t len, uint32_t sampleRate, uint8_t bits, uint8_t channels);
 } OpenAI_AudioTranslation_t;
 
+/**
+ * @brief An answer found in the answer cache, it points into the memory-mapped cache partition and stays
+ *        valid until it is released. A store that has to clear the full cache and clear wait for the release.
+ *
+ */
+typedef struct {
+    float similarity;       /*!< Cosine similarity of the cached question to the one looked up */
+    const char *text;       /*!< Text of the answer */
+    const uint8_t *audio;   /*!< Audio of the answer, NULL if none was stored */
+    size_t audioLen;        /*!< Length of audio */
+} OpenAI_AnswerCacheHit_t;
+
+/**
+ * @brief Answers to earlier questions kept in a flash partition, found again for questions with the same meaning.
+ *        Questions are compared by the cosine similarity of their embeddings.
+ *
+ */
+typedef struct OpenAI_AnswerCache {
+    /**
+     * @brief Set the similarity a cached question needs to count as the same question
+     *
+     * @param answerCache[in] the point of OpenAI_AnswerCache_t
+     * @param threshold[in] cosine similarity between 0 and 1, CONFIG_ANSWER_CACHE_THRESHOLD percent by default
+     */
+    void (*setThreshold)(struct OpenAI_AnswerCache *answerCache, float threshold);
+
+    /**
+     * @brief Embed the question and look for the most similar cached question above the threshold.
+     *        The embedding is kept for a store of the same question.
+     *
+     * @param answerCache[in] the point of OpenAI_AnswerCache_t
+     * @param question[in] the question, e.g. a transcript
+     * @param hit[out] the cached answer, release it after use
+     * @return esp_err_t ESP_OK on a hit, ESP_ERR_NOT_FOUND on a miss, ESP_FAIL if the question could not be embedded
+     */
+    esp_err_t (*lookup)(struct OpenAI_AnswerCache *answerCache, const char *question, OpenAI_AnswerCacheHit_t *hit);
+
+    /**
+     * @brief Release a hit of lookup, its text and audio must not be used afterwards. Release it before a store
+     *        or clear of the same task, they may wait for it.
+     *
+     * @param answerCache[in] the point of OpenAI_AnswerCache_t
+     * @param hit[in] the hit, its pointers are cleared
+     */
+    void (*release)(struct OpenAI_AnswerCache *answerCache, OpenAI_AnswerCacheHit_t *hit);
+
+    /**
+     * @brief Store the answer to a question. When the partition is full it is cleared first, once all hits
+     *        are released.
+     *
+     * @param answerCache[in] the point of OpenAI_AnswerCache_t
+     * @param question[in] the question, embedded again unless it is the one of the last lookup
+     * @param text[in] the text of the answer
+     * @param audio[in] the audio of the answer, e.g. the speech of text, NULL for none
+     * @param audioLen[in] the length of audio
+     * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the answer does not fit into the partition
+     */
+    esp_err_t (*store)(struct OpenAI_AnswerCache *answerCache, const char *question, const char *text, const uint8_t *audio, size_t audioLen);
+
+    /**
+     * @brief Get the number of cached answers
+     *
+     * @param answerCache[in] the point of OpenAI_AnswerCache_t
+     * @return uint32_t the number of cached answers
+     */
+    uint32_t (*getCount)(struct OpenAI_AnswerCache *answerCache);
+
+    /**
+     * @brief Erase all cached answers, once all hits are released
+     *
+     * @param answerCache[in] the point of OpenAI_AnswerCache_t
+     * @return esp_err_t ESP_OK on success
+     */
+    esp_err_t (*clear)(struct OpenAI_AnswerCache *answerCache);
+} OpenAI_AnswerCache_t;
+
 /**
  * @brief The entry point for calling the Openai api
  *
@@ -980,6 +1394,25 @@ typedef struct OpenAI {
      */
     void (*audioSpeechDelete)(OpenAI_AudioSpeech_t *audioSpeech);
 #endif
+
+#if CONFIG_ENABLE_ANSWER_CACHE || defined __DOXYGEN__
+    /**
+     * @brief Create an answer cache in a data partition, see OpenAI_AnswerCache_t. A partition holding answers
+     *        of another embedding model or dimension is cleared.
+     *
+     * @param openai[in] The OpenAI object, used to embed the questions
+     * @param label[in] The label of the data partition
+     * @return OpenAI_AnswerCache_t* The answer cache object, NULL if the partition is missing or too small
+     */
+    OpenAI_AnswerCache_t *(*answerCacheCreate)(struct OpenAI *openai, const char *label);
+
+    /**
+     * @brief Delete an answer cache object, the cached answers stay in the partition. Its hits must be released before.
+     *
+     * @param answerCache[in] The answer cache object
+     */
+    void (*answerCacheDelete)(OpenAI_AnswerCache_t *answerCache);
+#endif
 } OpenAI_t;
 
 /**
@@ -990,8 +1423,21 @@ typedef struct OpenAI {
  */
 OpenAI_t *OpenAICreate(const char *api_key);
 
+struct OpenAI_Transport;
+
+/**
+ * @brief Create an OpenAI object that sends its requests with the given transport, see OpenAI_Transport.h.
+ *        OpenAICreate uses the default transport of the target.
+ *
+ * @param api_key The key of openai
+ * @param transport The transport, owned and deleted by the OpenAI object, also when the creation fails
+ * @return OpenAI_t* The OpenAI object
+ */
+OpenAI_t *OpenAICreateWithTransport(const char *api_key, struct OpenAI_Transport *transport);
+
 /**
- * @brief Clear the OpenAI object and release resources
+ * @brief Clear the OpenAI object and release resources. Async requests that did not end yet
+ *        are cancelled and waited for, so are the losing attempts of hedged requests.
  *
  * @param oai The OpenAI object
  */
@@ -1003,6 +1449,54 @@ void OpenAIDelete(OpenAI_t *oai);
  */
 void OpenAIChangeBaseURL(OpenAI_t *oai, const char *baseURL);
 
+/**
+ * @brief Change the timeouts, retries and hedging of a class of requests, before requests of the class are sent.
+ *        The defaults come from menuconfig, the response timeouts are set per class.
+ *
+ * @param oai The OpenAI object
+ * @param requestClass The class of requests
+ * @param profile The new profile, copied
+ */
+void OpenAISetRequestProfile(OpenAI_t *oai, OpenAI_Request_Class requestClass, const OpenAI_Request_Profile_t *profile);
+
+/**
+ * @brief Get the timeouts, retries and hedging of a class of requests
+ *
+ * @param oai The OpenAI object
+ * @param requestClass The class of requests
+ * @param profile Where to store the profile
+ */
+void OpenAIGetRequestProfile(OpenAI_t *oai, OpenAI_Request_Class requestClass, OpenAI_Request_Profile_t *profile);
+
+#if CONFIG_ENABLE_REQUEST_TIMING || defined __DOXYGEN__
+/**
+ * @brief Have the timing of every request reported to a callback. The attempts of hedged requests are
+ *        reported one by one.
+ *
+ * @param oai The OpenAI object
+ * @param cb The callback, NULL to stop reporting
+ * @param ctx The user context passed to cb
+ */
+void OpenAISetTimingCallback(OpenAI_t *oai, OpenAI_Timing_Cb cb, void *ctx);
+
+/**
+ * @brief Get the aggregates of the recent requests to an endpoint
+ *
+ * @param oai The OpenAI object
+ * @param endpoint The endpoint, e.g. "audio/transcriptions"
+ * @param stats Where to store the aggregates
+ * @return esp_err_t ESP_OK, ESP_ERR_NOT_FOUND if no request to the endpoint was recorded
+ */
+esp_err_t OpenAIGetEndpointStats(OpenAI_t *oai, const char *endpoint, OpenAI_Endpoint_Stats_t *stats);
+
+/**
+ * @brief Forget the aggregates of all endpoints, e.g. before measuring another configuration
+ *
+ * @param oai The OpenAI object
+ */
+void OpenAIResetEndpointStats(OpenAI_t *oai);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,140 @@
+/* SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "OpenAI.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    OPENAI_HTTP_METHOD_GET = 0,
+    OPENAI_HTTP_METHOD_POST,
+    OPENAI_HTTP_METHOD_DELETE
+} OpenAI_Http_Method;
+
+/**
+ * @brief A piece of a request body, either in memory or delivered by a read callback.
+ *        The parts are written to the connection one after the other, nothing is copied.
+ *
+ */
+typedef struct {
+    const uint8_t *data;    /*!< Data of the part, NULL to take it from read */
+    size_t len;             /*!< Length of the part */
+    OpenAI_Read_Cb read;    /*!< Callback that delivers the data when data is NULL */
+    void *ctx;              /*!< User context of read */
+} OpenAI_Body_Part_t;
+
+/**
+ * @brief An HTTP request of the OpenAI component.
+ *
+ */
+typedef struct {
+    OpenAI_Http_Method method;          /*!< Method of the request */
+    const char *url;                    /*!< Full URL, base URL and endpoint */
+    const char *content_type;           /*!< Value of the Content-Type header */
+    const char *authorization;          /*!< Value of the Authorization header */
+    const OpenAI_Body_Part_t *parts;    /*!< Body, written part by part */
+    size_t count;                       /*!< Number of parts */
+    size_t len;                         /*!< Length of the body, the sum of the part lengths */
+    uint32_t connect_timeout_ms;        /*!< Time to open the connection, TLS handshake included */
+    uint32_t ttfb_timeout_ms;           /*!< Time from the end of the body to the response headers, also the longest pause while reading the response */
+    uint32_t timeout_ms;                /*!< Time from send until the end of the response body, 0 for no limit */
+    OpenAI_Request_Timing_t *timing;    /*!< Where send stores the time of the phases it measured and whether the connection
+                                             was reused, the other fields zeroed, also on failure. NULL if not wanted */
+} OpenAI_Http_Request_t;
+
+/**
+ * @brief Transport the OpenAI object sends its requests with. The requests of one OpenAI object can be
+ *        sent from several tasks at once, a transport has to handle concurrent exchanges.
+ *
+ */
+typedef struct OpenAI_Transport {
+    /**
+     * @brief Send a request and receive the headers of its response
+     *
+     * @param transport[in] the transport
+     * @param request[in] the request
+     * @param status[out] the HTTP status code of the response
+     * @param content_length[out] the length of the response body, -1 if it is not known up front
+     * @return void* handle of the exchange to read the response body from, NULL on failure
+     */
+    void *(*send)(struct OpenAI_Transport *transport, const OpenAI_Http_Request_t *request, int *status, int64_t *content_length);
+
+    /**
+     * @brief Read the next piece of the response body, fails once the timeout of the request is over
+     *
+     * @param transport[in] the transport
+     * @param exchange[in] the handle returned by send
+     * @param buf[out] where to store the data
+     * @param len[in] the maximum number of bytes to store
+     * @return int the number of bytes stored, 0 at the end of the body, negative on failure
+     */
+    int (*read)(struct OpenAI_Transport *transport, void *exchange, char *buf, size_t len);
+
+    /**
+     * @brief End an exchange, whether or not its response was read completely
+     *
+     * @param transport[in] the transport
+     * @param exchange[in] the handle returned by send
+     */
+    void (*finish)(struct OpenAI_Transport *transport, void *exchange);
+
+    /**
+     * @brief Release the transport, called by OpenAIDelete
+     *
+     * @param transport[in] the transport
+     */
+    void (*delete)(struct OpenAI_Transport *transport);
+} OpenAI_Transport_t;
+
+/**
+ * @brief Callback of OpenAI_TransportWriteBody that writes a piece of the body to the connection.
+ *
+ * @return int 0 once all of data was written, negative on failure
+ */
+typedef int (*OpenAI_Body_Write_Cb)(void *ctx, const char *data, size_t len);
+
+/**
+ * @brief Write the parts of a request body one after the other, for transport implementations.
+ *        Parts with a read callback go through one small chunk buffer.
+ *
+ * @param parts[in] the body parts
+ * @param count[in] the number of parts
+ * @param write[in] callback writing to the connection
+ * @param ctx[in] the context of write
+ * @return esp_err_t ESP_OK if the whole body was written
+ */
+esp_err_t OpenAI_TransportWriteBody(const OpenAI_Body_Part_t *parts, size_t count, OpenAI_Body_Write_Cb write, void *ctx);
+
+#if !CONFIG_IDF_TARGET_LINUX
+/**
+ * @brief Create the esp_http_client transport, the default on the chips. It keeps one connection
+ *        alive between requests with ENABLE_PERSISTENT_CONNECTION.
+ *
+ * @return OpenAI_Transport_t* the transport, NULL on failure
+ */
+OpenAI_Transport_t *OpenAI_TransportEspHttpCreate(void);
+#else
+/**
+ * @brief Create the POSIX sockets transport, the default on the linux target. It speaks plain
+ *        HTTP/1.1, e.g. to a local stand-in server, and keeps one connection alive between
+ *        requests with ENABLE_PERSISTENT_CONNECTION. https URLs are refused.
+ *
+ * @return OpenAI_Transport_t* the transport, NULL on failure
+ */
+OpenAI_Transport_t *OpenAI_TransportPosixCreate(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
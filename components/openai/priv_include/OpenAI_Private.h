@@ -0,0 +1,83 @@
+/* SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Shared by the sources of the component, each of them defines its own TAG
+
+#if CONFIG_ENABLE_PERSISTENT_CONNECTION
+#define OPENAI_CONNECTION_IDLE_TIMEOUT_MS (CONFIG_PERSISTENT_CONNECTION_IDLE_TIMEOUT * 1000)
+#else
+#define OPENAI_CONNECTION_IDLE_TIMEOUT_MS 0
+#endif
+
+#define OPENAI_ERROR_CHECK(a, str, ret) if(!(a)) { \
+        ESP_LOGE(TAG,"%s:%d (%s):%s", __FILE__, __LINE__, __FUNCTION__, str); \
+        return (ret); \
+    }
+
+#define OPENAI_ERROR_CHECK_ABORT(a, str) if(!(a)) { \
+        ESP_LOGE(TAG,"%s:%d (%s):%s", __FILE__, __LINE__, __FUNCTION__, str); \
+        abort(); \
+    }
+
+#define OPENAI_ERROR_CHECK_RETURN_VOID(a, str) if(!(a)) { \
+        ESP_LOGE(TAG,"%s:%d (%s):%s", __FILE__, __LINE__, __FUNCTION__, str); \
+        return; \
+    }
+
+#define OPENAI_ERROR_CHECK_CONTINUE(a, str) if(!(a)) { \
+        ESP_LOGE(TAG,"%s:%d (%s):%s", __FILE__, __LINE__, __FUNCTION__, str); \
+    }
+
+#define OPENAI_ERROR_CHECK_GOTO(a, str, label) if(!(a)) { \
+        ESP_LOGE(TAG,"%s:%d (%s):%s", __FILE__, __LINE__, __FUNCTION__, str); \
+        goto label; \
+    }
+
+/**
+ * @brief Milliseconds left until a deadline in ticks, 0 once it passed
+ *
+ */
+static inline uint32_t OpenAI_TimeLeftMs(TickType_t deadline)
+{
+    int32_t left = (int32_t)(deadline - xTaskGetTickCount());
+    return left > 0 ? pdTICKS_TO_MS(left) : 0;
+}
+
+/**
+ * @brief Microseconds from a monotonic clock, for the timing of requests
+ *
+ */
+#if CONFIG_IDF_TARGET_LINUX
+#include <time.h>
+
+static inline int64_t OpenAI_TimeUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+#else
+#include "esp_timer.h"
+
+static inline int64_t OpenAI_TimeUs(void)
+{
+    return esp_timer_get_time();
+}
+#endif
+
+#if CONFIG_ENABLE_ANSWER_CACHE
+#include "OpenAI.h"
+
+OpenAI_AnswerCache_t *OpenAI_AnswerCacheCreate(OpenAI_t *openai, const char *label);
+void OpenAI_AnswerCacheDelete(OpenAI_AnswerCache_t *answerCache);
+#endif
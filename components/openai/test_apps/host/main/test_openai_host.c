@@ -0,0 +1,705 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "OpenAI.h"
+#include "OpenAI_Transport.h"
+#include "cJSON.h"
+#include "unity.h"
+
+static const char *TAG = "openai_host_test";
+
+// Requests go to the local stand-in set as CONFIG_DEFAULT_OPENAI_BASE_URL, the key is not checked
+static char *openai_key = "mock";
+
+typedef struct {
+    char text[256];
+    int calls;
+} delta_ctx_t;
+
+static int on_delta(void *ctx, const char *delta)
+{
+    delta_ctx_t *d = (delta_ctx_t *)ctx;
+    strncat(d->text, delta, sizeof(d->text) - strlen(d->text) - 1);
+    d->calls++;
+    return 0;
+}
+
+// Keeps every delta as a cJSON string, created while the next chunks are still parsed
+static int on_delta_json(void *ctx, const char *delta)
+{
+    cJSON *deltas = (cJSON *)ctx;
+    cJSON *item = cJSON_CreateString(delta);
+    if (item == NULL || !cJSON_AddItemToArray(deltas, item)) {
+        cJSON_Delete(item);
+        return -1;
+    }
+    return 0;
+}
+
+typedef struct {
+    size_t len;
+    uint8_t first;
+} speech_ctx_t;
+
+static int on_audio(void *ctx, const uint8_t *data, size_t len)
+{
+    speech_ctx_t *s = (speech_ctx_t *)ctx;
+    if (s->len == 0 && len > 0) {
+        s->first = data[0];
+    }
+    s->len += len;
+    return 0;
+}
+
+static int compare_ms(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Sets the faults and latency of the stand-in with its /faults endpoint, straight through a transport
+static void mock_configure(const char *config)
+{
+    OpenAI_Transport_t *transport = OpenAI_TransportPosixCreate();
+    TEST_ASSERT_NOT_NULL(transport);
+    OpenAI_Body_Part_t part = {
+        .data = (const uint8_t *)config,
+        .len = strlen(config),
+    };
+    OpenAI_Http_Request_t request = {
+        .method = OPENAI_HTTP_METHOD_POST,
+        .url = CONFIG_DEFAULT_OPENAI_BASE_URL "faults",
+        .content_type = "application/json",
+        .authorization = "Bearer mock",
+        .parts = &part,
+        .count = 1,
+        .len = part.len,
+        .connect_timeout_ms = 1000,
+        .ttfb_timeout_ms = 1000,
+    };
+    int status = 0;
+    int64_t content_length = 0;
+    void *exchange = transport->send(transport, &request, &status, &content_length);
+    TEST_ASSERT_NOT_NULL(exchange);
+    TEST_ASSERT_EQUAL(200, status);
+    char buf[64];
+    while (transport->read(transport, exchange, buf, sizeof(buf)) > 0) {
+    }
+    transport->finish(transport, exchange);
+    transport->delete(transport);
+}
+
+#define BENCH_REQUESTS 100
+
+// Latency of transcriptions against a stand-in that stalls some of them, p50 and p99 in ms
+static void bench_transcriptions(OpenAI_AudioTranscription_t *audioTranscription, uint8_t *audio, size_t length, uint32_t *p50, uint32_t *p99)
+{
+    static uint32_t ms[BENCH_REQUESTS];
+    for (int i = 0; i < BENCH_REQUESTS; i++) {
+        TickType_t start = xTaskGetTickCount();
+        char *text = audioTranscription->file(audioTranscription, audio, length, OPENAI_AUDIO_INPUT_FORMAT_WAV);
+        ms[i] = pdTICKS_TO_MS(xTaskGetTickCount() - start);
+        TEST_ASSERT_NOT_NULL(text);
+        free(text);
+    }
+    qsort(ms, BENCH_REQUESTS, sizeof(uint32_t), &compare_ms);
+    *p50 = ms[BENCH_REQUESTS / 2 - 1];
+    *p99 = ms[BENCH_REQUESTS * 99 / 100 - 1];
+}
+
+TEST_CASE("test ChatCompletion", "[ChatCompletion]")
+{
+    OpenAI_t *openai = OpenAICreate(openai_key);
+    TEST_ASSERT_NOT_NULL(openai);
+    OpenAI_ChatCompletion_t *chatCompletion = openai->chatCreate(openai);
+    TEST_ASSERT_NOT_NULL(chatCompletion);
+    chatCompletion->setModel(chatCompletion, "gpt-3.5-turbo");
+    chatCompletion->setSystem(chatCompletion, "You are a helpful assistant.");
+
+    OpenAI_StringResponse_t *result = chatCompletion->message(chatCompletion, "How far away is the moon?", false);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_NULL(result->getError(result));
+    TEST_ASSERT_EQUAL(1, result->getLen(result));
+    ESP_LOGI(TAG, "%s", result->getData(result, 0));
+    TEST_ASSERT_NOT_NULL(strstr(result->getData(result, 0), "How far away is the moon?"));
+    char *expected = strdup(result->getData(result, 0));
+    result->delete (result);
+
+    // The same answer arrives as server-sent events in HTTP chunks
+    delta_ctx_t delta = {0};
+    result = chatCompletion->messageStream(chatCompletion, "How far away is the moon?", false, &on_delta, &delta);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_STRING(expected, result->getData(result, 0));
+    TEST_ASSERT_EQUAL_STRING(expected, delta.text);
+    TEST_ASSERT_GREATER_THAN(1, delta.calls);
+    result->delete (result);
+
+    free(expected);
+    openai->chatDelete(chatCompletion);
+    OpenAIDelete(openai);
+}
+
+TEST_CASE("test ChatCompletion stream with cJSON in the delta callback", "[ChatCompletion]")
+{
+    OpenAI_t *openai = OpenAICreate(openai_key);
+    TEST_ASSERT_NOT_NULL(openai);
+    OpenAI_ChatCompletion_t *chatCompletion = openai->chatCreate(openai);
+    TEST_ASSERT_NOT_NULL(chatCompletion);
+
+    cJSON *deltas = cJSON_CreateArray();
+    TEST_ASSERT_NOT_NULL(deltas);
+    OpenAI_StringResponse_t *result = chatCompletion->messageStream(chatCompletion, "How far away is the moon?", false, &on_delta_json, deltas);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_GREATER_THAN(1, cJSON_GetArraySize(deltas));
+
+    // The strings the callback created are intact after the chunks were parsed and deleted
+    char joined[256] = {0};
+    cJSON *item = NULL;
+    cJSON_ArrayForEach(item, deltas) {
+        TEST_ASSERT_TRUE(cJSON_IsString(item));
+        strncat(joined, cJSON_GetStringValue(item), sizeof(joined) - strlen(joined) - 1);
+    }
+    TEST_ASSERT_EQUAL_STRING(result->getData(result, 0), joined);
+    result->delete (result);
+    cJSON_Delete(deltas);
+
+    openai->chatDelete(chatCompletion);
+    OpenAIDelete(openai);
+}
+
+TEST_CASE("test ChatCompletion stream errors", "[ChatCompletion]")
+{
+    OpenAI_t *openai = OpenAICreate(openai_key);
+    TEST_ASSERT_NOT_NULL(openai);
+    OpenAI_ChatCompletion_t *chatCompletion = openai->chatCreate(openai);
+    TEST_ASSERT_NOT_NULL(chatCompletion);
+
+    // A stream cut short before its [DONE] is an error and is not saved
+    mock_configure("{\"faults\": {\"chat\": \"truncate:1\"}}");
+    delta_ctx_t delta = {0};
+    OpenAI_StringResponse_t *result = chatCompletion->messageStream(chatCompletion, "How far away is the moon?", true, &on_delta, &delta);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL(0, result->getLen(result));
+    TEST_ASSERT_NOT_NULL(strstr(result->getError(result), "[DONE]"));
+    TEST_ASSERT_GREATER_THAN(0, delta.calls);
+    result->delete (result);
+
+    // The error of the API is returned the same way message() returns it
+    mock_configure("{\"faults\": {\"chat\": \"error:1\"}}");
+    result = chatCompletion->message(chatCompletion, "How far away is the moon?", false);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL(0, result->getLen(result));
+    TEST_ASSERT_NOT_NULL(strstr(result->getError(result), "server_overloaded"));
+    result->delete (result);
+    result = chatCompletion->messageStream(chatCompletion, "How far away is the moon?", false, NULL, NULL);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL(0, result->getLen(result));
+    TEST_ASSERT_NOT_NULL(strstr(result->getError(result), "server_overloaded"));
+    result->delete (result);
+    mock_configure("{\"faults\": {\"chat\": \"\"}}");
+
+    // The chat goes on after the failed requests
+    result = chatCompletion->message(chatCompletion, "How far away is the moon?", false);
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL(1, result->getLen(result));
+    TEST_ASSERT_NOT_NULL(strstr(result->getData(result, 0), "How far away is the moon?"));
+    result->delete (result);
+
+    openai->chatDelete(chatCompletion);
+    OpenAIDelete(openai);
+}
+
+#if CONFIG_ENABLE_ASYNC
+#define CONCURRENT_CHAT_ROUNDS 20
+
+TEST_CASE("test ChatCompletion async and sync requests on one chat", "[ChatCompletion][async]")
+{
+    OpenAI_t *openai = OpenAICreate(openai_key);
+    TEST_ASSERT_NOT_NULL(openai);
+    OpenAI_ChatCompletion_t *chatCompletion = openai->chatCreate(openai);
+    TEST_ASSERT_NOT_NULL(chatCompletion);
+    chatCompletion->setMaxHistoryTokens(chatCompletion, 200);
+    mock_configure("{\"latency\": {\"chat\": \"uniform:0:0.01\"}}");
+
+    // Both save into the conversation while the other one builds its body from it, and the trimming drops turns meanwhile
+    for (int i = 0; i < CONCURRENT_CHAT_ROUNDS; i++) {
+        OpenAI_AsyncRequest_t *request = chatCompletion->messageAsync(chatCompletion, "How far away is the moon?", true, NULL);
+        TEST_ASSERT_NOT_NULL(request);
+        chatCompletion->setSystem(chatCompletion, (i % 2) ? "You are a helpful assistant." : "Answer briefly.");
+        OpenAI_StringResponse_t *result = chatCompletion->message(chatCompletion, "How far away is the sun?", true);
+        TEST_ASSERT_NOT_NULL(result);
+        TEST_ASSERT_EQUAL(1, result->getLen(result));
+        result->delete (result);
+        TEST_ASSERT_TRUE(request->wait(request, pdMS_TO_TICKS(10000)));
+        TEST_ASSERT_EQUAL(OPENAI_ASYNC_STATE_DONE, request->getState(request));
+        result = request->getResult(request);
+        TEST_ASSERT_NOT_NULL(result);
+        TEST_ASSERT_NOT_NULL(strstr(result->getData(result, 0), "How far away is the moon?"));
+        result->delete (result);
+        request->delete (request);
+    }
+    mock_configure("{\"latency\": {\"chat\": \"fixed:0\"}}");
+
+    openai->chatDelete(chatCompletion);
+    OpenAIDelete(openai);
+}
+#endif
+
+TEST_CASE("test AudioTranscription and AudioSpeech", "[AudioTranscription][AudioSpeech]")
+{
+    OpenAI_t *openai = OpenAICreate(openai_key);
+    TEST_ASSERT_NOT_NULL(openai);
+    OpenAI_AudioTranscription_t *audioTranscription = openai->audioTranscriptionCreate(openai);
+    TEST_ASSERT_NOT_NULL(audioTranscription);
+    audioTranscription->setResponseFormat(audioTranscription, OPENAI_AUDIO_RESPONSE_FORMAT_JSON);
+    audioTranscription->setLanguage(audioTranscription, "en");
+
+    // The stand-in answers any upload, what is checked is the multipart body and the response parsing
+    size_t length = 32000;
+    uint8_t *audio = calloc(1, length);
+    TEST_ASSERT_NOT_NULL(audio);
+    char *text = audioTranscription->file(audioTranscription, audio, length, OPENAI_AUDIO_INPUT_FORMAT_WAV);
+    TEST_ASSERT_NOT_NULL(text);
+    TEST_ASSERT_GREATER_THAN(0, strlen(text));
+    ESP_LOGI(TAG, "Text: %s", text);
+    free(audio);
+
+    OpenAI_AudioSpeech_t *audioSpeech = openai->audioSpeechCreate(openai);
+    TEST_ASSERT_NOT_NULL(audioSpeech);
+    audioSpeech->setModel(audioSpeech, "tts-1");
+    audioSpeech->setVoice(audioSpeech, "nova");
+    audioSpeech->setResponseFormat(audioSpeech, OPENAI_AUDIO_OUTPUT_FORMAT_MP3);
+    OpenAI_SpeechResponse_t *speechresult = audioSpeech->speech(audioSpeech, text);
+    TEST_ASSERT_NOT_NULL(speechresult);
+    TEST_ASSERT_GREATER_THAN(0, speechresult->getLen(speechresult));
+    // MP3 frame sync
+    TEST_ASSERT_EQUAL_HEX8(0xff, (uint8_t)speechresult->getData(speechresult)[0]);
+
+    speech_ctx_t streamed = {0};
+    TEST_ASSERT_EQUAL(ESP_OK, audioSpeech->speechStream(audioSpeech, text, &on_audio, &streamed));
+    TEST_ASSERT_EQUAL(speechresult->getLen(speechresult), streamed.len);
+    TEST_ASSERT_EQUAL_HEX8(0xff, streamed.first);
+
+    free(text);
+    speechresult->delete (speechresult);
+    openai->audioSpeechDelete(audioSpeech);
+    openai->audioTranscriptionDelete(audioTranscription);
+    OpenAIDelete(openai);
+}
+
+// Keeps a copy of the last request body, then sends it on with the POSIX transport
+typedef struct {
+    OpenAI_Transport_t parent;
+    OpenAI_Transport_t *inner;
+    uint8_t body[40000];
+    size_t len;
+} capture_transport_t;
+
+static int capture_write(void *ctx, const char *data, size_t len)
+{
+    capture_transport_t *capture = (capture_transport_t *)ctx;
+    if (capture->len + len > sizeof(capture->body)) {
+        return -1;
+    }
+    memcpy(capture->body + capture->len, data, len);
+    capture->len += len;
+    return 0;
+}
+
+static void *capture_send(OpenAI_Transport_t *transport, const OpenAI_Http_Request_t *request, int *status, int64_t *content_length)
+{
+    capture_transport_t *capture = (capture_transport_t *)transport;
+    capture->len = 0;
+    if (OpenAI_TransportWriteBody(request->parts, request->count, &capture_write, capture) != ESP_OK) {
+        return NULL;
+    }
+    OpenAI_Body_Part_t part = { .data = capture->body, .len = capture->len };
+    OpenAI_Http_Request_t copy = *request;
+    copy.parts = &part;
+    copy.count = 1;
+    return capture->inner->send(capture->inner, &copy, status, content_length);
+}
+
+static int capture_read(OpenAI_Transport_t *transport, void *exchange, char *buf, size_t len)
+{
+    capture_transport_t *capture = (capture_transport_t *)transport;
+    return capture->inner->read(capture->inner, exchange, buf, len);
+}
+
+static void capture_finish(OpenAI_Transport_t *transport, void *exchange)
+{
+    capture_transport_t *capture = (capture_transport_t *)transport;
+    capture->inner->finish(capture->inner, exchange);
+}
+
+static void capture_delete(OpenAI_Transport_t *transport)
+{
+    capture_transport_t *capture = (capture_transport_t *)transport;
+    capture->inner->delete(capture->inner);
+    free(capture);
+}
+
+typedef struct {
+    const uint8_t *data;
+    size_t pos;
+} pcm_reader_t;
+
+static int read_pcm(void *ctx, uint8_t *buf, size_t len)
+{
+    pcm_reader_t *reader = (pcm_reader_t *)ctx;
+    memcpy(buf, reader->data + reader->pos, len);
+    reader->pos += len;
+    return len;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// The uploaded file is a WAV header followed by exactly the samples
+static void check_wav_upload(const capture_transport_t *capture, const uint8_t *pcm, size_t len)
+{
+    const uint8_t *wav = NULL;
+    for (size_t i = 0; i + 4 <= capture->len; i++) {
+        if (memcmp(capture->body + i, "RIFF", 4) == 0) {
+            wav = capture->body + i;
+            break;
+        }
+    }
+    TEST_ASSERT_NOT_NULL(wav);
+    TEST_ASSERT_TRUE(wav + 44 + len <= capture->body + capture->len);
+    TEST_ASSERT_EQUAL(36 + len, get_le32(wav + 4));
+    TEST_ASSERT_EQUAL(0, memcmp(wav + 8, "WAVEfmt ", 8));
+    TEST_ASSERT_EQUAL(16, get_le32(wav + 16));
+    TEST_ASSERT_EQUAL(1, wav[20] | wav[21] << 8);
+    TEST_ASSERT_EQUAL(1, wav[22] | wav[23] << 8);
+    TEST_ASSERT_EQUAL(16000, get_le32(wav + 24));
+    TEST_ASSERT_EQUAL(32000, get_le32(wav + 28));
+    TEST_ASSERT_EQUAL(2, wav[32] | wav[33] << 8);
+    TEST_ASSERT_EQUAL(16, wav[34] | wav[35] << 8);
+    TEST_ASSERT_EQUAL(0, memcmp(wav + 36, "data", 4));
+    TEST_ASSERT_EQUAL(len, get_le32(wav + 40));
+    TEST_ASSERT_EQUAL(0, memcmp(wav + 44, pcm, len));
+    TEST_ASSERT_EQUAL(0, memcmp(wav + 44 + len, "\r\n--", 4));
+}
+
+TEST_CASE("test AudioTranscription of PCM", "[AudioTranscription]")
+{
+    capture_transport_t *capture = calloc(1, sizeof(capture_transport_t));
+    TEST_ASSERT_NOT_NULL(capture);
+    capture->inner = OpenAI_TransportPosixCreate();
+    TEST_ASSERT_NOT_NULL(capture->inner);
+    capture->parent.send = &capture_send;
+    capture->parent.read = &capture_read;
+    capture->parent.finish = &capture_finish;
+    capture->parent.delete = &capture_delete;
+    OpenAI_t *openai = OpenAICreateWithTransport(openai_key, &capture->parent);
+    TEST_ASSERT_NOT_NULL(openai);
+    OpenAI_AudioTranscription_t *audioTranscription = openai->audioTranscriptionCreate(openai);
+    TEST_ASSERT_NOT_NULL(audioTranscription);
+
+    // One second of 16 kHz 16 bit mono, as recorded from I2S
+    size_t length = 32000;
+    uint8_t *pcm = malloc(length);
+    TEST_ASSERT_NOT_NULL(pcm);
+    for (size_t i = 0; i < length; i++) {
+        pcm[i] = i * 7;
+    }
+    char *text = audioTranscription->filePcm(audioTranscription, pcm, length, 16000, 16, 1);
+    TEST_ASSERT_NOT_NULL(text);
+    TEST_ASSERT_GREATER_THAN(0, strlen(text));
+    free(text);
+    check_wav_upload(capture, pcm, length);
+
+    pcm_reader_t reader = { .data = pcm };
+    text = audioTranscription->filePcmStream(audioTranscription, &read_pcm, &reader, length, 16000, 16, 1);
+    TEST_ASSERT_NOT_NULL(text);
+    free(text);
+    TEST_ASSERT_EQUAL(length, reader.pos);
+    check_wav_upload(capture, pcm, length);
+
+    // Half a frame, or an unknown sample size, is refused before anything is sent
+    capture->len = 0;
+    TEST_ASSERT_NULL(audioTranscription->filePcm(audioTranscription, pcm, length - 1, 16000, 16, 1));
+    TEST_ASSERT_NULL(audioTranscription->filePcm(audioTranscription, pcm, length, 16000, 12, 1));
+    TEST_ASSERT_EQUAL(0, capture->len);
+
+    free(pcm);
+    openai->audioTranscriptionDelete(audioTranscription);
+    OpenAIDelete(openai);
+}
+
+TEST_CASE("test ChatCompletion history trimmed by whole turns", "[ChatCompletion]")
+{
+    capture_transport_t *capture = calloc(1, sizeof(capture_transport_t));
+    TEST_ASSERT_NOT_NULL(capture);
+    capture->inner = OpenAI_TransportPosixCreate();
+    TEST_ASSERT_NOT_NULL(capture->inner);
+    capture->parent.send = &capture_send;
+    capture->parent.read = &capture_read;
+    capture->parent.finish = &capture_finish;
+    capture->parent.delete = &capture_delete;
+    OpenAI_t *openai = OpenAICreateWithTransport(openai_key, &capture->parent);
+    TEST_ASSERT_NOT_NULL(openai);
+    OpenAI_ChatCompletion_t *chatCompletion = openai->chatCreate(openai);
+    TEST_ASSERT_NOT_NULL(chatCompletion);
+    chatCompletion->setSystem(chatCompletion, "You are a helpful assistant.");
+    // A turn of the mock is some 32 tokens, its answer alone some 21: dropping only the oldest question of
+    // two turns would fit the budget and leave its answer first
+    chatCompletion->setMaxHistoryTokens(chatCompletion, 55);
+
+    for (int i = 0; i < 4; i++) {
+        OpenAI_StringResponse_t *result = chatCompletion->message(chatCompletion, "How far away is the moon?", true);
+        TEST_ASSERT_NOT_NULL(result);
+        result->delete (result);
+
+        // The request carries the system message, whole saved turns and the new question
+        cJSON *body = cJSON_ParseWithLength((const char *)capture->body, capture->len);
+        TEST_ASSERT_NOT_NULL(body);
+        cJSON *messages = cJSON_GetObjectItem(body, "messages");
+        int count = cJSON_GetArraySize(messages);
+        TEST_ASSERT_EQUAL(0, count % 2);
+        TEST_ASSERT_LESS_OR_EQUAL(4, count);
+        TEST_ASSERT_EQUAL_STRING("system", cJSON_GetStringValue(cJSON_GetObjectItem(cJSON_GetArrayItem(messages, 0), "role")));
+        TEST_ASSERT_EQUAL_STRING("user", cJSON_GetStringValue(cJSON_GetObjectItem(cJSON_GetArrayItem(messages, 1), "role")));
+        cJSON_Delete(body);
+    }
+
+    openai->chatDelete(chatCompletion);
+    OpenAIDelete(openai);
+}
+
+#if CONFIG_ENABLE_REQUEST_TIMING
+typedef struct {
+    int calls;
+    char endpoint[32];
+    OpenAI_Request_Timing_t first;
+    OpenAI_Request_Timing_t last;
+} timing_ctx_t;
+
+static void on_timing(void *ctx, const char *endpoint, const OpenAI_Request_Timing_t *timing)
+{
+    timing_ctx_t *t = (timing_ctx_t *)ctx;
+    if (t->calls++ == 0) {
+        t->first = *timing;
+    }
+    t->last = *timing;
+    snprintf(t->endpoint, sizeof(t->endpoint), "%s", endpoint);
+}
+
+TEST_CASE("test request timing", "[timing]")
+{
+    OpenAI_t *openai = OpenAICreate(openai_key);
+    TEST_ASSERT_NOT_NULL(openai);
+    timing_ctx_t timing = {0};
+    OpenAISetTimingCallback(openai, &on_timing, &timing);
+    OpenAI_ChatCompletion_t *chatCompletion = openai->chatCreate(openai);
+    TEST_ASSERT_NOT_NULL(chatCompletion);
+
+    // The stand-in takes 50 ms to answer, which shows as time to first byte
+    mock_configure("{\"latency\": {\"chat\": \"fixed:0.05\"}}");
+    for (int i = 0; i < 3; i++) {
+        OpenAI_StringResponse_t *result = chatCompletion->message(chatCompletion, "How far away is the moon?", false);
+        TEST_ASSERT_NOT_NULL(result);
+        result->delete (result);
+    }
+    mock_configure("{\"latency\": {\"chat\": \"fixed:0\"}}");
+    TEST_ASSERT_EQUAL(3, timing.calls);
+    TEST_ASSERT_EQUAL_STRING("chat/completions", timing.endpoint);
+    TEST_ASSERT_FALSE(timing.first.reused);
+    TEST_ASSERT_TRUE(timing.last.reused);
+    TEST_ASSERT_EQUAL(0, timing.last.dns_us + timing.last.connect_us);
+    TEST_ASSERT_EQUAL(200, timing.last.status);
+    TEST_ASSERT_EQUAL(1, timing.last.attempts);
+    TEST_ASSERT_GREATER_THAN(0, timing.last.sent);
+    TEST_ASSERT_GREATER_THAN(0, timing.last.received);
+    TEST_ASSERT_GREATER_THAN(50000 - 1, timing.last.ttfb_us);
+    TEST_ASSERT_GREATER_THAN(timing.last.upload_us + timing.last.ttfb_us + timing.last.download_us - 1, timing.last.total_us);
+
+    OpenAI_Endpoint_Stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, OpenAIGetEndpointStats(openai, "chat/completions", &stats));
+    TEST_ASSERT_EQUAL(3, stats.requests);
+    TEST_ASSERT_EQUAL(0, stats.failures);
+    TEST_ASSERT_EQUAL(3, stats.window);
+    TEST_ASSERT_EQUAL(2, stats.reused);
+    TEST_ASSERT_GREATER_THAN(50000 - 1, stats.mean.ttfb_us);
+    TEST_ASSERT_GREATER_THAN(stats.mean.total_us - 1, stats.max.total_us);
+    TEST_ASSERT_EQUAL(timing.last.received, stats.mean.received);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, OpenAIGetEndpointStats(openai, "embeddings", &stats));
+
+    // A request without a response counts as a failure and stays out of the averages
+    OpenAIChangeBaseURL(openai, "http://127.0.0.1:1/v1/");
+    OpenAI_StringResponse_t *result = chatCompletion->message(chatCompletion, "How far away is the moon?", false);
+    if (result) {
+        result->delete (result);
+    }
+    TEST_ASSERT_EQUAL(4, timing.calls);
+    TEST_ASSERT_EQUAL(0, timing.last.status);
+    TEST_ASSERT_EQUAL(CONFIG_REQUEST_RETRIES + 1, timing.last.attempts);
+    TEST_ASSERT_EQUAL(ESP_OK, OpenAIGetEndpointStats(openai, "chat/completions", &stats));
+    TEST_ASSERT_EQUAL(4, stats.requests);
+    TEST_ASSERT_EQUAL(1, stats.failures);
+    TEST_ASSERT_EQUAL(3, stats.window);
+
+    OpenAIResetEndpointStats(openai);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, OpenAIGetEndpointStats(openai, "chat/completions", &stats));
+    openai->chatDelete(chatCompletion);
+    OpenAIDelete(openai);
+}
+#endif
+
+TEST_CASE("test transport", "[transport]")
+{
+    OpenAI_Transport_t *transport = OpenAI_TransportPosixCreate();
+    TEST_ASSERT_NOT_NULL(transport);
+    const char *body = "{}";
+    OpenAI_Body_Part_t part = {
+        .data = (const uint8_t *)body,
+        .len = strlen(body),
+    };
+    OpenAI_Http_Request_t request = {
+        .method = OPENAI_HTTP_METHOD_POST,
+        .url = CONFIG_DEFAULT_OPENAI_BASE_URL "unknown",
+        .content_type = "application/json",
+        .authorization = "Bearer mock",
+        .parts = &part,
+        .count = 1,
+        .len = part.len,
+    };
+    // Error responses are read like any other, back to back on the kept-alive connection
+    for (int i = 0; i < 3; i++) {
+        int status = 0;
+        int64_t content_length = 0;
+        void *exchange = transport->send(transport, &request, &status, &content_length);
+        TEST_ASSERT_NOT_NULL(exchange);
+        TEST_ASSERT_EQUAL(404, status);
+        char buf[128] = {0};
+        int len = 0;
+        int rlen = 0;
+        while ((rlen = transport->read(transport, exchange, buf + len, sizeof(buf) - 1 - len)) > 0) {
+            len += rlen;
+        }
+        TEST_ASSERT_EQUAL(0, rlen);
+        TEST_ASSERT_EQUAL(content_length, len);
+        TEST_ASSERT_NOT_NULL(strstr(buf, "not_found"));
+        transport->finish(transport, exchange);
+    }
+
+    // No TLS on the host
+    int status = 0;
+    int64_t content_length = 0;
+    request.url = "https://api.openai.com/v1/models";
+    TEST_ASSERT_NULL(transport->send(transport, &request, &status, &content_length));
+    transport->delete(transport);
+
+    // A failed connection surfaces as an error result, not a crash
+    OpenAI_t *openai = OpenAICreateWithTransport(openai_key, OpenAI_TransportPosixCreate());
+    TEST_ASSERT_NOT_NULL(openai);
+    OpenAIChangeBaseURL(openai, "http://127.0.0.1:1/v1/");
+    OpenAI_ChatCompletion_t *chatCompletion = openai->chatCreate(openai);
+    OpenAI_StringResponse_t *result = chatCompletion->message(chatCompletion, "hello", false);
+    TEST_ASSERT_TRUE(result == NULL || result->getLen(result) == 0);
+    if (result) {
+        result->delete (result);
+    }
+    openai->chatDelete(chatCompletion);
+    OpenAIDelete(openai);
+}
+
+#if CONFIG_ENABLE_REQUEST_HEDGING
+TEST_CASE("test hedged transcription retried after a 503", "[hedging]")
+{
+    OpenAI_t *openai = OpenAICreate(openai_key);
+    TEST_ASSERT_NOT_NULL(openai);
+    OpenAI_AudioTranscription_t *audioTranscription = openai->audioTranscriptionCreate(openai);
+    TEST_ASSERT_NOT_NULL(audioTranscription);
+    size_t length = 16000;
+    uint8_t *audio = calloc(1, length);
+    TEST_ASSERT_NOT_NULL(audio);
+    OpenAI_Request_Profile_t profile;
+    OpenAIGetRequestProfile(openai, OPENAI_REQUEST_CLASS_AUDIO_TEXT, &profile);
+    TEST_ASSERT_TRUE(profile.hedge);
+    TEST_ASSERT_GREATER_THAN(0, profile.retries);
+
+    // Transcriptions of 200 ms put the hedging delay well above the 503 that follows
+    mock_configure("{\"latency\": {\"transcription\": \"fixed:0.2\"}}");
+    for (int i = 0; i < 10; i++) {
+        char *text = audioTranscription->file(audioTranscription, audio, length, OPENAI_AUDIO_INPUT_FORMAT_WAV);
+        TEST_ASSERT_NOT_NULL(text);
+        free(text);
+    }
+
+    // The only attempt gets a 503 before the hedge is sent, the retry gets the transcript
+    mock_configure("{\"faults\": {\"transcription\": \"error:1:1\"}, \"latency\": {\"transcription\": \"fixed:0\"}}");
+    char *text = audioTranscription->file(audioTranscription, audio, length, OPENAI_AUDIO_INPUT_FORMAT_WAV);
+    mock_configure("{\"faults\": {\"transcription\": \"\"}}");
+    TEST_ASSERT_NOT_NULL(text);
+    TEST_ASSERT_GREATER_THAN(0, strlen(text));
+    free(text);
+
+    free(audio);
+    openai->audioTranscriptionDelete(audioTranscription);
+    OpenAIDelete(openai);
+}
+
+TEST_CASE("benchmark hedged transcriptions", "[hedging][benchmark]")
+{
+    OpenAI_t *openai = OpenAICreate(openai_key);
+    TEST_ASSERT_NOT_NULL(openai);
+    OpenAI_AudioTranscription_t *audioTranscription = openai->audioTranscriptionCreate(openai);
+    TEST_ASSERT_NOT_NULL(audioTranscription);
+    size_t length = 16000;
+    uint8_t *audio = calloc(1, length);
+    TEST_ASSERT_NOT_NULL(audio);
+
+    // 3% of the transcriptions stall for 2 s before their response, the others take 50 ms
+    mock_configure("{\"faults\": {\"transcription\": \"stall:0.03:2\"}, \"latency\": {\"transcription\": \"fixed:0.05\"}}");
+
+    OpenAI_Request_Profile_t profile;
+    OpenAIGetRequestProfile(openai, OPENAI_REQUEST_CLASS_AUDIO_TEXT, &profile);
+    uint32_t p50[2];
+    uint32_t p99[2];
+    for (int hedge = 0; hedge < 2; hedge++) {
+        profile.hedge = hedge;
+        OpenAISetRequestProfile(openai, OPENAI_REQUEST_CLASS_AUDIO_TEXT, &profile);
+        bench_transcriptions(audioTranscription, audio, length, &p50[hedge], &p99[hedge]);
+        ESP_LOGI(TAG, "hedging %s: p50 %" PRIu32 " ms, p99 %" PRIu32 " ms", hedge ? "on" : "off", p50[hedge], p99[hedge]);
+    }
+    mock_configure("{\"faults\": {\"transcription\": \"\"}, \"latency\": {\"transcription\": \"fixed:0\"}}");
+
+    // Hedging costs nothing in the median and takes the stalls out of the tail
+    TEST_ASSERT_LESS_THAN(2000, p99[1]);
+    TEST_ASSERT_LESS_THAN(p99[0], p99[1]);
+    TEST_ASSERT_LESS_THAN(p50[0] + 20, p50[1]);
+
+    free(audio);
+    openai->audioTranscriptionDelete(audioTranscription);
+    OpenAIDelete(openai);
+}
+#endif
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void app_main(void)
+{
+    printf("OpenAI HOST TEST \n");
+    unity_run_menu();
+}
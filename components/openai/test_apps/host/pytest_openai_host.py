@@ -0,0 +1,56 @@
+# SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+'''
+Steps to run these cases, with ESP-IDF 5.1 or later:
+- Build
+  - . ${IDF_PATH}/export.sh
+  - idf.py --preview set-target linux
+  - idf.py build
+- Test
+  - pip install -r tools/requirements/requirement.pytest.txt
+  - pytest components/openai/test_apps/host --target linux
+
+The tests talk to a local stand-in for the OpenAI API, bench/mock_openai.py at
+the root of the project by default, set MOCK_OPENAI to use another copy of it.
+'''
+
+import os
+import sys
+import time
+import socket
+import subprocess
+
+import pytest
+from pytest_embedded import Dut
+
+MOCK_PORT = 8100
+MOCK_OPENAI = os.environ.get('MOCK_OPENAI', os.path.join(os.path.dirname(__file__), '../../../../bench/mock_openai.py'))
+
+@pytest.fixture(autouse=True)
+def mock_openai():
+    latency = [f'{endpoint}=fixed:0' for endpoint in ('transcription', 'chat', 'speech')]
+    args = [sys.executable, MOCK_OPENAI, '--port', str(MOCK_PORT)]
+    for spec in latency:
+        args += ['--latency', spec]
+    mock = subprocess.Popen(args)
+    deadline = time.time() + 10
+    while True:
+        try:
+            socket.create_connection(('127.0.0.1', MOCK_PORT), 1).close()
+            break
+        except OSError:
+            if time.time() > deadline:
+                mock.kill()
+                raise
+            time.sleep(0.1)
+    yield
+    mock.terminate()
+    mock.wait()
+
+@pytest.mark.linux
+@pytest.mark.host_test
+def test_openai_host(dut: Dut)-> None:
+    dut.expect_exact('Press ENTER to see the list of tests.')
+    dut.write('*')
+    dut.expect_unity_test_output(timeout = 120)
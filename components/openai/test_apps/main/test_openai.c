@@ -10,8 +10,11 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
+#include "freertos/event_groups.h"
 #include "esp_system.h"
 #include "esp_heap_caps.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
 #include "esp_log.h"
 #include "OpenAI.h"
 #include "unity.h"
@@ -194,6 +197,49 @@ TEST_CASE("test AudioSpeech", "[AudioSpeech]")
     vTaskDelay(1000 / portTICK_PERIOD_MS);
 }
 
+#if CONFIG_ENABLE_ANSWER_CACHE
+TEST_CASE("test AnswerCache", "[AnswerCache]")
+{
+    ESP_ERROR_CHECK(example_connect());
+    ESP_LOGI(TAG, "Connected to AP, begin http example");
+    OpenAI_t *openai = OpenAICreate(openai_key);
+    TEST_ASSERT_NOT_NULL(openai);
+    OpenAI_AnswerCache_t *answerCache = openai->answerCacheCreate(openai, "answers");
+    TEST_ASSERT_NOT_NULL(answerCache);
+    TEST_ASSERT_EQUAL(ESP_OK, answerCache->clear(answerCache));
+
+    OpenAI_AnswerCacheHit_t hit;
+    const char *question = "How far away is the moon?";
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, answerCache->lookup(answerCache, question, &hit));
+    size_t length = introduce_espressif_mp3_end - introduce_espressif_mp3_start;
+    TEST_ASSERT_EQUAL(ESP_OK, answerCache->store(answerCache, question, "About 384,400 km.", introduce_espressif_mp3_start, length));
+    TEST_ASSERT_EQUAL(1, answerCache->getCount(answerCache));
+
+    // The same question in other words finds the answer, another question doesn't
+    TEST_ASSERT_EQUAL(ESP_OK, answerCache->lookup(answerCache, "What is the distance from the earth to the moon?", &hit));
+    ESP_LOGI(TAG, "similarity %.3f", hit.similarity);
+    TEST_ASSERT_EQUAL_STRING("About 384,400 km.", hit.text);
+    TEST_ASSERT_EQUAL(length, hit.audioLen);
+    TEST_ASSERT_EQUAL_MEMORY(introduce_espressif_mp3_start, hit.audio, length);
+    answerCache->release(answerCache, &hit);
+    TEST_ASSERT_NULL(hit.text);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, answerCache->lookup(answerCache, "Turn on the TV", &hit));
+
+    // Answers stay in flash
+    openai->answerCacheDelete(answerCache);
+    answerCache = openai->answerCacheCreate(openai, "answers");
+    TEST_ASSERT_NOT_NULL(answerCache);
+    TEST_ASSERT_EQUAL(1, answerCache->getCount(answerCache));
+    TEST_ASSERT_EQUAL(ESP_OK, answerCache->lookup(answerCache, question, &hit));
+    TEST_ASSERT_EQUAL_STRING("About 384,400 km.", hit.text);
+    answerCache->release(answerCache, &hit);
+    openai->answerCacheDelete(answerCache);
+    OpenAIDelete(openai);
+    example_disconnect();
+    vTaskDelay(1000 / portTICK_PERIOD_MS);
+}
+#endif
+
 TEST_CASE("test memory leak", "[memory]")
 {
     OpenAI_t *openai = OpenAICreate(openai_key);
@@ -206,6 +252,242 @@ TEST_CASE("test memory leak", "[memory]")
     OpenAIDelete(openai);
 }
 
+#define ASYNC_CHAT_BIT BIT0
+#define ASYNC_TRANSCRIPTION_BIT BIT1
+
+static void async_done(OpenAI_AsyncRequest_t *request, void *ctx)
+{
+    ESP_LOGI(TAG, "%s request ended in state %d", (const char *)ctx, request->getState(request));
+}
+
+TEST_CASE("test async requests", "[async]")
+{
+    ESP_ERROR_CHECK(example_connect());
+    OpenAI_t *openai = OpenAICreate(openai_key);
+    TEST_ASSERT_NOT_NULL(openai);
+    OpenAI_ChatCompletion_t *chatCompletion = openai->chatCreate(openai);
+    TEST_ASSERT_NOT_NULL(chatCompletion);
+    chatCompletion->setModel(chatCompletion, "gpt-3.5-turbo");
+    OpenAI_AudioTranscription_t *audioTranscription = openai->audioTranscriptionCreate(openai);
+    TEST_ASSERT_NOT_NULL(audioTranscription);
+    audioTranscription->setLanguage(audioTranscription, "en");
+    EventGroupHandle_t events = xEventGroupCreate();
+    TEST_ASSERT_NOT_NULL(events);
+
+    OpenAI_Async_Config_t chat_config = { .done = async_done, .ctx = "chat", .event_group = events, .bits = ASYNC_CHAT_BIT };
+    OpenAI_AsyncRequest_t *chat = chatCompletion->messageAsync(chatCompletion, "tell me a joke", false, &chat_config);
+    TEST_ASSERT_NOT_NULL(chat);
+    OpenAI_Async_Config_t transcription_config = { .done = async_done, .ctx = "transcription", .event_group = events, .bits = ASYNC_TRANSCRIPTION_BIT };
+    size_t length = turn_on_tv_en_mp3_end - turn_on_tv_en_mp3_start;
+    OpenAI_AsyncRequest_t *transcription = audioTranscription->fileAsync(audioTranscription, turn_on_tv_en_mp3_start, length, OPENAI_AUDIO_INPUT_FORMAT_MP3, &transcription_config);
+    TEST_ASSERT_NOT_NULL(transcription);
+
+    // The test task keeps running while the requests are on the network
+    int64_t start = esp_timer_get_time();
+    uint32_t polls = 0;
+    while ((xEventGroupWaitBits(events, ASYNC_CHAT_BIT | ASYNC_TRANSCRIPTION_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(10)) & (ASYNC_CHAT_BIT | ASYNC_TRANSCRIPTION_BIT)) != (ASYNC_CHAT_BIT | ASYNC_TRANSCRIPTION_BIT)) {
+        polls++;
+    }
+    ESP_LOGI(TAG, "Both requests ended after %"PRId64" ms, %"PRIu32" polls in between", (esp_timer_get_time() - start) / 1000, polls);
+    TEST_ASSERT_GREATER_THAN(0, polls);
+
+    OpenAI_StringResponse_t *result = chat->getResult(chat);
+    TEST_ASSERT_NOT_NULL(result);
+    ESP_LOGI(TAG, "Chat: %s", result->getData(result, 0));
+    result->delete (result);
+    char *text = transcription->getResult(transcription);
+    TEST_ASSERT_NOT_NULL(text);
+    ESP_LOGI(TAG, "Text: %s", text);
+    free(text);
+    chat->delete (chat);
+    transcription->delete (transcription);
+
+    // A cancelled request ends without a result
+    chat = chatCompletion->messageAsync(chatCompletion, "count from one to one hundred", false, NULL);
+    TEST_ASSERT_NOT_NULL(chat);
+    chat->cancel(chat);
+    TEST_ASSERT_TRUE(chat->wait(chat, pdMS_TO_TICKS(60000)));
+    TEST_ASSERT_EQUAL(OPENAI_ASYNC_STATE_CANCELLED, chat->getState(chat));
+    TEST_ASSERT_NULL(chat->getResult(chat));
+    chat->delete (chat);
+
+    vEventGroupDelete(events);
+    openai->audioTranscriptionDelete(audioTranscription);
+    openai->chatDelete(chatCompletion);
+    OpenAIDelete(openai);
+    example_disconnect();
+    vTaskDelay(1000 / portTICK_PERIOD_MS);
+}
+
+#define BENCHMARK_ROUNDS 5
+
+static TaskHandle_t benchmark_task;
+static volatile uint32_t benchmark_allocs;
+
+/* Counts the heap allocations of the benchmarking task, CONFIG_HEAP_USE_HOOKS calls it for every allocation */
+void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+    if (benchmark_task != NULL && xTaskGetCurrentTaskHandle() == benchmark_task) {
+        benchmark_allocs++;
+    }
+}
+
+void IRAM_ATTR esp_heap_trace_free_hook(void *ptr)
+{
+}
+
+static void benchmark_report(const char *name, const int64_t *us, const uint32_t *allocs)
+{
+    int64_t total_us = 0;
+    uint32_t total_allocs = 0;
+    for (int i = 0; i < BENCHMARK_ROUNDS; i++) {
+        ESP_LOGI(TAG, "%s round %d: %"PRId64" ms, %"PRIu32" allocations", name, i, us[i] / 1000, allocs[i]);
+        // The first round also opens the connection
+        if (i > 0) {
+            total_us += us[i];
+            total_allocs += allocs[i];
+        }
+    }
+    printf("BENCHMARK %s: %"PRId64" ms, %"PRIu32" allocations per call\n", name,
+           total_us / (BENCHMARK_ROUNDS - 1) / 1000, total_allocs / (BENCHMARK_ROUNDS - 1));
+}
+
+TEST_CASE("benchmark ChatCompletion, AudioTranscription and Embedding", "[benchmark]")
+{
+    int64_t us[BENCHMARK_ROUNDS];
+    uint32_t allocs[BENCHMARK_ROUNDS];
+    ESP_ERROR_CHECK(example_connect());
+    OpenAI_t *openai = OpenAICreate(openai_key);
+    TEST_ASSERT_NOT_NULL(openai);
+    benchmark_task = xTaskGetCurrentTaskHandle();
+
+    OpenAI_ChatCompletion_t *chatCompletion = openai->chatCreate(openai);
+    TEST_ASSERT_NOT_NULL(chatCompletion);
+    chatCompletion->setModel(chatCompletion, "gpt-3.5-turbo");
+    chatCompletion->setSystem(chatCompletion, "You are a helpful assistant.");
+    chatCompletion->setMaxTokens(chatCompletion, 16);
+    for (int i = 0; i < BENCHMARK_ROUNDS; i++) {
+        benchmark_allocs = 0;
+        int64_t start = esp_timer_get_time();
+        OpenAI_StringResponse_t *result = chatCompletion->message(chatCompletion, "Reply with one word.", false);
+        us[i] = esp_timer_get_time() - start;
+        allocs[i] = benchmark_allocs;
+        TEST_ASSERT_NOT_NULL(result);
+        result->delete (result);
+    }
+    benchmark_report("ChatCompletion", us, allocs);
+    openai->chatDelete(chatCompletion);
+
+    OpenAI_AudioTranscription_t *audioTranscription = openai->audioTranscriptionCreate(openai);
+    TEST_ASSERT_NOT_NULL(audioTranscription);
+    audioTranscription->setResponseFormat(audioTranscription, OPENAI_AUDIO_RESPONSE_FORMAT_JSON);
+    audioTranscription->setLanguage(audioTranscription, "en");
+    size_t length = turn_on_tv_en_mp3_end - turn_on_tv_en_mp3_start;
+    for (int i = 0; i < BENCHMARK_ROUNDS; i++) {
+        benchmark_allocs = 0;
+        int64_t start = esp_timer_get_time();
+        char *text = audioTranscription->file(audioTranscription, (uint8_t *)turn_on_tv_en_mp3_start, length, OPENAI_AUDIO_INPUT_FORMAT_MP3);
+        us[i] = esp_timer_get_time() - start;
+        allocs[i] = benchmark_allocs;
+        TEST_ASSERT_NOT_NULL(text);
+        free(text);
+    }
+    benchmark_report("AudioTranscription", us, allocs);
+    openai->audioTranscriptionDelete(audioTranscription);
+
+    // The response of about 30 KB is where scanning instead of parsing shows
+    for (int i = 0; i < BENCHMARK_ROUNDS; i++) {
+        benchmark_allocs = 0;
+        int64_t start = esp_timer_get_time();
+        OpenAI_EmbeddingResponse_t *embedding = openai->embeddingCreate(openai, "The food was delicious and the waiter was friendly.", "text-embedding-ada-002", NULL);
+        us[i] = esp_timer_get_time() - start;
+        allocs[i] = benchmark_allocs;
+        TEST_ASSERT_NOT_NULL(embedding);
+        TEST_ASSERT_EQUAL_UINT32(1, embedding->getLen(embedding));
+        embedding->delete (embedding);
+    }
+    benchmark_report("Embedding", us, allocs);
+
+    benchmark_task = NULL;
+    OpenAIDelete(openai);
+    example_disconnect();
+    vTaskDelay(1000 / portTICK_PERIOD_MS);
+}
+
+#if CONFIG_ENABLE_REQUEST_TIMING
+typedef struct {
+    int calls;
+    OpenAI_Request_Timing_t timing[BENCHMARK_ROUNDS];
+} benchmark_timing_t;
+
+static void benchmark_on_timing(void *ctx, const char *endpoint, const OpenAI_Request_Timing_t *timing)
+{
+    benchmark_timing_t *t = (benchmark_timing_t *)ctx;
+    if (t->calls < BENCHMARK_ROUNDS) {
+        t->timing[t->calls] = *timing;
+    }
+    t->calls++;
+}
+
+TEST_CASE("benchmark connection reuse against the HTTPS mock", "[benchmark]")
+{
+    if (strlen(CONFIG_OPENAI_MOCK_URL) == 0) {
+        TEST_IGNORE_MESSAGE("CONFIG_OPENAI_MOCK_URL is not set");
+    }
+    ESP_ERROR_CHECK(example_connect());
+
+    // A client per request connects and does the whole TLS handshake every time, one client keeps its connection
+    for (int reuse = 0; reuse < 2; reuse++) {
+        benchmark_timing_t timing = {0};
+        OpenAI_t *openai = NULL;
+        for (int i = 0; i < BENCHMARK_ROUNDS; i++) {
+            if (openai == NULL) {
+                openai = OpenAICreate(openai_key);
+                TEST_ASSERT_NOT_NULL(openai);
+                OpenAIChangeBaseURL(openai, CONFIG_OPENAI_MOCK_URL);
+                OpenAISetTimingCallback(openai, &benchmark_on_timing, &timing);
+            }
+            OpenAI_ChatCompletion_t *chatCompletion = openai->chatCreate(openai);
+            TEST_ASSERT_NOT_NULL(chatCompletion);
+            OpenAI_StringResponse_t *result = chatCompletion->message(chatCompletion, "How far away is the moon?", false);
+            TEST_ASSERT_NOT_NULL(result);
+            result->delete (result);
+            openai->chatDelete(chatCompletion);
+            if (!reuse) {
+                OpenAIDelete(openai);
+                openai = NULL;
+            }
+        }
+        if (openai != NULL) {
+            OpenAIDelete(openai);
+        }
+        TEST_ASSERT_EQUAL(BENCHMARK_ROUNDS, timing.calls);
+
+        const char *name = reuse ? "keep-alive" : "new connection";
+        uint32_t connect_us = 0;
+        uint32_t total_us = 0;
+        for (int i = 0; i < BENCHMARK_ROUNDS; i++) {
+            ESP_LOGI(TAG, "%s round %d: connect %"PRIu32" us, total %"PRIu32" us%s", name, i,
+                     timing.timing[i].connect_us, timing.timing[i].total_us, timing.timing[i].reused ? ", reused" : "");
+            // The first round opens a connection either way
+            if (i > 0) {
+                connect_us += timing.timing[i].connect_us;
+                total_us += timing.timing[i].total_us;
+                TEST_ASSERT_EQUAL(reuse, timing.timing[i].reused);
+            }
+        }
+        printf("BENCHMARK %s: connect %"PRIu32" us, total %"PRIu32" us per request\n", name,
+               connect_us / (BENCHMARK_ROUNDS - 1), total_us / (BENCHMARK_ROUNDS - 1));
+        if (reuse) {
+            TEST_ASSERT_EQUAL(0, connect_us);
+        }
+    }
+
+    example_disconnect();
+    vTaskDelay(1000 / portTICK_PERIOD_MS);
+}
+#endif
+
 static size_t before_free_8bit;
 static size_t before_free_32bit;
 
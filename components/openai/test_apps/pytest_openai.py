@@ -22,6 +22,8 @@ from pytest_embedded import Dut
     'config',
     [
         'defaults',
+        'no_json_arena',
+        'no_json_scan',
     ],
 )
 def test_openai(dut: Dut)-> None:
@@ -0,0 +1,122 @@
+import time
+import threading
+
+from collections import deque
+from concurrent.futures import ThreadPoolExecutor
+
+# note: bounded multi-turn memory per device. Each conversation keeps as many
+# of its most recent (user, assistant) turns as fit in a token budget, the
+# oldest turns are evicted first and, when a summarizer is given, folded into
+# a running summary instead of being forgotten. The message prefix sent ahead
+# of every new prompt is cached until the conversation changes.
+
+# note: summarizing is an upstream call, it runs on a background thread so it
+# never holds up a reply. One summary at a time per conversation: turns evicted
+# meanwhile wait in pending, still sent along, and are folded in by the next
+# round, so no round starts from a summary another round is replacing.
+
+# note: ~4 characters per token for English plus the per-message overhead of
+# the chat format, close enough for budgeting without a tokenizer
+MESSAGE_OVERHEAD_TOKENS = 4
+
+def estimate_tokens(text):
+    return (len(text) + 3) // 4 + MESSAGE_OVERHEAD_TOKENS
+
+class Conversation:
+    def __init__(self):
+        self.turns = deque() # (user, assistant, tokens)
+        self.tokens = 0
+        self.summary = None
+        self.pending = [] # (user, assistant) evicted, not yet summarized
+        self.summarizing = False
+        self.updated = time.monotonic()
+        self._prefix = None
+
+    def prefix(self):
+        if self._prefix is None:
+            messages = []
+            if self.summary:
+                messages.append({"role": "system", "content": f"Summary of the earlier conversation: {self.summary}"})
+            for user, assistant in self.pending:
+                messages.append({"role": "user", "content": user})
+                messages.append({"role": "assistant", "content": assistant})
+            for user, assistant, _ in self.turns:
+                messages.append({"role": "user", "content": user})
+                messages.append({"role": "assistant", "content": assistant})
+            self._prefix = tuple(messages)
+        return self._prefix
+
+class ConversationStore:
+    def __init__(self, token_budget, max_idle_seconds, summarize=None, summarize_timeout=None):
+        # note: summarize(summary, turns, timeout) returns the new summary
+        self.token_budget = token_budget
+        self.max_idle_seconds = max_idle_seconds
+        self.summarize = summarize
+        self.summarize_timeout = summarize_timeout
+
+        self._lock = threading.Lock()
+        self._conversations = {}
+        self._summarizer = ThreadPoolExecutor(max_workers=2, thread_name_prefix='summarize') if summarize else None
+
+    def _get(self, device):
+        now = time.monotonic()
+        conversation = self._conversations.get(device)
+        if conversation is None or now - conversation.updated > self.max_idle_seconds:
+            conversation = self._conversations[device] = Conversation()
+        return conversation
+
+    def _expire(self):
+        now = time.monotonic()
+        for device in [d for d, c in self._conversations.items() if now - c.updated > self.max_idle_seconds]:
+            del self._conversations[device]
+
+    def history(self, device):
+        # note: messages to send between the system prompt and the new prompt
+        with self._lock:
+            return self._get(device).prefix()
+
+    def append(self, device, user, assistant):
+        with self._lock:
+            self._expire()
+            conversation = self._get(device)
+            tokens = estimate_tokens(user) + estimate_tokens(assistant)
+            conversation.turns.append((user, assistant, tokens))
+            conversation.tokens += tokens
+            while conversation.tokens > self.token_budget and conversation.turns:
+                user, assistant, tokens = conversation.turns.popleft()
+                conversation.tokens -= tokens
+                if self.summarize:
+                    conversation.pending.append((user, assistant))
+            conversation.updated = time.monotonic()
+            conversation._prefix = None
+            if conversation.pending and not conversation.summarizing:
+                conversation.summarizing = True
+                self._summarizer.submit(self._summarize, conversation)
+
+    def _summarize(self, conversation):
+        while True:
+            with self._lock:
+                summary, turns = conversation.summary, conversation.pending[:]
+                if not turns:
+                    conversation.summarizing = False
+                    return
+            try:
+                summary = self.summarize(summary, turns, self.summarize_timeout)
+            except Exception as e:
+                # note: the turns are forgotten as if there was no summarizer
+                print(f"Summarizing {len(turns)} turns failed: {e!r}")
+            with self._lock:
+                conversation.summary = summary
+                del conversation.pending[:len(turns)]
+                conversation._prefix = None
+
+    def clear(self, device):
+        with self._lock:
+            self._conversations.pop(device, None)
+
+    def stats(self):
+        with self._lock:
+            return {
+                'conversations': len(self._conversations),
+                'tokens': sum(c.tokens for c in self._conversations.values()),
+            }
@@ -0,0 +1,82 @@
+import re
+import json
+
+# note: intent routing for a transcribed prompt. A local classifier catches the
+# plain "what's the weather in <City>" questions so their weather fetch can
+# start right away without any model call. Everything else is resolved by one chat call
+# that may either answer directly or request tools (TOOLS), whose calls then
+# run concurrently before a single final completion.
+
+# note: Whisper capitalizes place names, so a city is a run of capitalized
+# words. Only a whole utterance of this shape is taken for a weather question,
+# anything more or less, e.g. a time of year or a city and its state, is left
+# to the model.
+CITY = r"[A-Z][\w'-]*(?:\s+[A-Z][\w'-]*){0,3}"
+CITY_SEPARATOR = re.compile(r"\s+and\s+(?:in\s+)?")
+WEATHER_QUESTION = re.compile(
+    r"(?i:(?:(?:what|how)(?:'s|\u2019s|\s+is)\s+|(?:tell|give|show)\s+me\s+)?"
+    r"(?:the\s+)?(?:current\s+)?(?:weather|forecast|temperature)(?:\s+like)?\s+(?:in|for)\s+)"
+    rf"(?P<cities>{CITY}(?:(?i:\s+and\s+(?:in\s+)?){CITY})*)"
+    r"(?i:\s+(?:right\s+now|now|today))?\s*[.?!]*"
+)
+
+# note: capitalized words after "in" or "for" that are times, not places
+NOT_PLACES = {
+    'january', 'february', 'march', 'april', 'may', 'june', 'july', 'august', 'september', 'october',
+    'november', 'december', 'monday', 'tuesday', 'wednesday', 'thursday', 'friday', 'saturday', 'sunday',
+    'christmas', 'easter', 'halloween', 'thanksgiving', 'year', "year's", 'tomorrow', 'tonight',
+}
+
+ROUTER_SYSTEM = (
+    "You are a helpful voice assistant. Answer briefly in plain spoken English. "
+    "Call get_weather for every city the user asks about the weather of."
+)
+
+TOOLS = [
+    {
+        "type": "function",
+        "function": {
+            "name": "get_weather",
+            "description": "Current weather of a city.",
+            "parameters": {
+                "type": "object",
+                "properties": {
+                    "city": {"type": "string", "description": "City name, e.g. Detroit"},
+                    "country_code": {"type": "string", "description": "ISO 3166 country code, e.g. us"},
+                },
+                "required": ["city"],
+            },
+        },
+    },
+]
+
+class ToolCall:
+    def __init__(self, name, arguments):
+        self.name = name
+        self.arguments = arguments
+
+    def key(self):
+        return (self.name, json.dumps(self.arguments, sort_keys=True))
+
+def classify(text):
+    # note: returns the tool calls for a prompt the classifier is sure about,
+    # None when the model has to decide
+    match = WEATHER_QUESTION.fullmatch(text.strip())
+    if match is None:
+        return None
+    cities = CITY_SEPARATOR.split(match.group('cities'))
+    if any(word.casefold() in NOT_PLACES for city in cities for word in city.split()):
+        return None
+    return [ToolCall('get_weather', {'city': city}) for city in dict.fromkeys(cities)]
+
+def parse_tool_calls(tool_calls):
+    # note: (name, JSON arguments) pairs from the model, malformed ones dropped
+    calls = []
+    for name, arguments in tool_calls:
+        try:
+            arguments = json.loads(arguments or '{}')
+        except json.JSONDecodeError:
+            continue
+        if isinstance(arguments, dict):
+            calls.append(ToolCall(name, arguments))
+    return calls
@@ -21,7 +21,7 @@ cleanup () {
   echo "cleaning up..."
 
   # cleanup sent/received files
-  rm speech_response.mp3
+  rm -r responses
   rm text_response.txt
   rm *.wav
 
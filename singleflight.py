@@ -0,0 +1,53 @@
+import threading
+
+from admission import DeadlineExceeded
+
+# note: in-flight request coalescing, the first caller for a key runs the
+# upstream call and every caller that arrives with the same key while it is
+# still running waits for and shares that one result (or exception). Nothing
+# is kept once the call finishes, caching is left to the caller. A follower
+# waits at most its own timeout, the leader's call keeps running for the
+# others when a follower gives up.
+
+class _Call:
+    def __init__(self):
+        self.done = threading.Event()
+        self.result = None
+        self.error = None
+
+class SingleFlight:
+    def __init__(self):
+        self._lock = threading.Lock()
+        self._calls = {}
+
+    def do(self, key, fn, timeout=None):
+        # note: returns (result, shared), shared is True for followers. The
+        # leader's fn enforces its own timeout, followers raise
+        # DeadlineExceeded once theirs runs out
+        with self._lock:
+            call = self._calls.get(key)
+            leader = call is None
+            if leader:
+                call = self._calls[key] = _Call()
+
+        if not leader:
+            if not call.done.wait(timeout):
+                raise DeadlineExceeded(key)
+            if call.error is not None:
+                raise call.error
+            return call.result, True
+
+        try:
+            call.result = fn()
+        except BaseException as e:
+            call.error = e
+            raise
+        finally:
+            with self._lock:
+                del self._calls[key]
+            call.done.set()
+        return call.result, False
+
+    def in_flight(self):
+        with self._lock:
+            return len(self._calls)
@@ -1,31 +1,316 @@
-import os, datetime, sys
+import os, datetime, sys, re
+import hashlib
 import wave
+import mimetypes
 import argparse
 import socket
+import threading
 
 import requests # use for OpenWeather API
 import json # use to parse through city.list.json
 
 from urllib import parse
-from http.server import HTTPServer
+from concurrent.futures import ThreadPoolExecutor
+from http.server import ThreadingHTTPServer
 from http.server import BaseHTTPRequestHandler
 
-from openai import OpenAI
+from openai import APITimeoutError
+
+import metrics
+from tts_cache import TTSCache
+from singleflight import SingleFlight
+from conversation import ConversationStore
+from admission import AdmissionController, Deadline, DeadlineExceeded, Rejected
+import backends
+import audio_prep
+import router
 
 # todo: include city.json for searching, less API calls
 
 PORT = 8000
 MAX_PROMPT_TOKENS = 100
 
+CHAT_MODEL = 'gpt-3.5-turbo'
+TRANSCRIPTION_MODEL = 'whisper-1'
+
 CHIME_FILE = 'chime.mp3'
 SPEECH_RESPONSE_FILE = 'speech_response.mp3'
 TEXT_RESPONSE_FILE   = 'text_response.txt'
 
-selected_file = SPEECH_RESPONSE_FILE
+# note: every device gets its own answer file, GET /speech_response.mp3 serves
+# the one belonging to the requesting device
+RESPONSE_DIR = 'responses'
 
-OPENWEATHER_API_KEY = os.environ.get('OPENWEATHER_API_KEY')
+# note: files that may be fetched by name besides the speech response
+STATIC_FILES = {
+    CHIME_FILE: CHIME_FILE,
+}
 
-client = OpenAI()
+OPENWEATHER_API_KEY = os.environ.get('OPENWEATHER_API_KEY')
+OPENWEATHER_BASE_URL = os.environ.get('OPENWEATHER_BASE_URL', 'https://api.openweathermap.org')
+
+# note: the parts of an OpenWeather reply the summary needs, the rest only
+# costs prompt tokens
+WEATHER_FIELDS = ('name', 'weather', 'main', 'wind', 'clouds', 'rain', 'snow', 'cod', 'message')
+
+TTS_MODEL  = 'tts-1'
+TTS_VOICE  = 'echo'
+TTS_FORMAT = 'mp3'
+
+# note: every stage runs against OpenAI ('openai', or an OpenAI-compatible
+# server when its base URL is set) or a resident local engine on the CPU:
+# whisper.cpp for speech-to-text, llama.cpp for chat and Piper for speech
+ASR_BACKEND  = os.environ.get('ASR_BACKEND', 'openai')
+CHAT_BACKEND = os.environ.get('CHAT_BACKEND', 'openai')
+TTS_BACKEND  = os.environ.get('TTS_BACKEND', 'openai')
+
+BACKEND_SETTINGS = backends.Settings(
+    transcription_model=TRANSCRIPTION_MODEL,
+    chat_model=CHAT_MODEL,
+    tts_model=TTS_MODEL,
+    tts_voice=TTS_VOICE,
+    base_urls={
+        'asr':  os.environ.get('ASR_BASE_URL'),
+        'chat': os.environ.get('CHAT_BASE_URL'),
+        'tts':  os.environ.get('TTS_BASE_URL'),
+    },
+    whisper_model=os.environ.get('WHISPER_MODEL', 'models/ggml-base.en.bin'),
+    llama_model=os.environ.get('LLAMA_MODEL', 'models/qwen2.5-1.5b-instruct-q4_k_m.gguf'),
+    llama_context_tokens=2048,
+    piper_voice=os.environ.get('PIPER_VOICE', 'models/en_US-lessac-medium.onnx'),
+    threads=int(os.environ.get('LOCAL_THREADS', os.cpu_count() or 4)),
+)
+
+# note: recordings are trimmed and resampled to 16 kHz mono in memory before
+# transcription, and sent as 'wav', 'flac' or 'opus' (the latter two need the
+# soundfile package). SAVE_RECORDINGS additionally keeps the original upload
+# as a WAV file.
+AUDIO_UPLOAD_FORMAT = os.environ.get('AUDIO_UPLOAD_FORMAT', 'wav')
+TRIM_SILENCE = True
+SAVE_RECORDINGS = False
+
+TTS_CACHE_DIR = 'tts_cache'
+TTS_CACHE_MEMORY_BYTES = 8 * 1024 * 1024
+TTS_CACHE_DISK_BYTES   = 256 * 1024 * 1024
+
+# note: earlier turns of a device's conversation are sent along with each new
+# prompt, bounded by a token budget so requests keep a flat size
+CONVERSATION_TOKEN_BUDGET = 600
+CONVERSATION_IDLE_SECONDS = 300
+CONVERSATION_SUMMARIZE = False
+CONVERSATION_SUMMARIZE_TIMEOUT_SECONDS = 10.0
+
+# note: at most MAX_ACTIVE_REQUESTS uploads run their upstream calls at once,
+# up to MAX_QUEUED_REQUESTS more wait QUEUE_TIMEOUT_SECONDS for a slot and
+# each device may start DEVICE_RATE_PER_SECOND requests (bursts of
+# DEVICE_BURST). Anything beyond that is answered with the busy clip.
+MAX_ACTIVE_REQUESTS = 8
+MAX_QUEUED_REQUESTS = 16
+QUEUE_TIMEOUT_SECONDS = 2.0
+DEVICE_RATE_PER_SECOND = 1.0
+DEVICE_BURST = 4
+
+# note: time budget of an admitted request and the upstream timeout of each
+# stage within it, in seconds
+REQUEST_DEADLINE_SECONDS = 20.0
+STAGE_TIMEOUTS = {
+    'transcription': 8.0,
+    'chat': 6.0,
+    'weather': 3.0,
+    'tts': 8.0,
+}
+
+NOT_UNDERSTOOD_PHRASE = "Sorry, I didn't catch that. Please try again."
+BUSY_PHRASE = "I'm a little busy right now, please try again in a moment."
+LOG_PHRASE = "this device has been prompted {} times."
+
+# note: counters a device reports on /log early on, their phrases are pre-warmed
+PREWARM_LOG_COUNTERS = 20
+
+# note: the busy clip is kept outside the TTS cache so eviction never removes it
+BUSY_RESPONSE_FILE = 'busy_response.mp3'
+
+# note: phrases synthesized once at startup so their first use is a cache hit,
+# the fixed replies the handlers send. The busy clip is synthesized on its own
+# and the chime is a static file
+PREWARM_PHRASES = [
+    NOT_UNDERSTOOD_PHRASE,
+    *(LOG_PHRASE.format(counter) for counter in range(PREWARM_LOG_COUNTERS + 1)),
+]
+
+# note: created in main(), local models are loaded once at startup
+asr_backend = chat_backend = tts_backend = None
+
+metrics_registry = metrics.Registry()
+STAGE_SECONDS = metrics_registry.register(metrics.Histogram(
+    'voice_assistant_stage_seconds',
+    'Time spent in each stage of a voice assistant request.',
+    ('stage', 'device', 'intent')
+))
+UPSTREAM_COALESCED = metrics_registry.register(metrics.Counter(
+    'voice_assistant_upstream_coalesced_total',
+    'Upstream calls answered by an identical call that was already in flight.',
+    ('call',)
+))
+REQUESTS_REJECTED = metrics_registry.register(metrics.Counter(
+    'voice_assistant_requests_rejected_total',
+    'Requests answered with the busy clip instead of being processed.',
+    ('reason',)
+))
+
+admission = AdmissionController(
+    MAX_ACTIVE_REQUESTS,
+    MAX_QUEUED_REQUESTS,
+    QUEUE_TIMEOUT_SECONDS,
+    DEVICE_RATE_PER_SECOND,
+    DEVICE_BURST
+)
+
+tts_cache = TTSCache(TTS_CACHE_DIR, TTS_CACHE_MEMORY_BYTES, TTS_CACHE_DISK_BYTES)
+
+# note: concurrent identical upstream calls (devices in one room asking the
+# same thing, or a device retrying) share a single request
+upstream_flights = SingleFlight()
+
+def coalesce(call, key, fn, timeout=None):
+    result, shared = upstream_flights.do((call, key), fn, timeout)
+    if shared:
+        UPSTREAM_COALESCED.inc(call=call)
+    return result
+
+def normalize_prompt(text):
+    return ' '.join(text.casefold().split()).strip(' .,!?')
+
+def transcribe(audio, audio_key, timeout=None):
+    return coalesce('transcription', audio_key, lambda: asr_backend.transcribe(audio, timeout), timeout)
+
+def chat_completion(system, prompt, history=(), timeout=None):
+    history_key = tuple((m['role'], m['content']) for m in history)
+    key = (chat_backend.model, MAX_PROMPT_TOKENS, system, history_key, normalize_prompt(prompt))
+    messages = [
+        {"role": "system", "content": system},
+        *history,
+        {"role": "user", "content": prompt}
+    ]
+    return coalesce('chat', key, lambda: chat_backend.complete(messages, MAX_PROMPT_TOKENS, timeout), timeout)
+
+def chat_route(prompt, history=(), timeout=None):
+    # note: one call that either answers or asks for tools, see router.py
+    history_key = tuple((m['role'], m['content']) for m in history)
+    key = (chat_backend.model, MAX_PROMPT_TOKENS, 'route', history_key, normalize_prompt(prompt))
+    messages = [
+        {"role": "system", "content": router.ROUTER_SYSTEM},
+        *history,
+        {"role": "user", "content": prompt}
+    ]
+    content, calls = coalesce('chat', key, lambda: chat_backend.route(messages, router.TOOLS, MAX_PROMPT_TOKENS, timeout), timeout)
+    return content, router.parse_tool_calls(calls)
+
+def summarize_turns(summary, turns, timeout=None):
+    transcript = '\n'.join(f'User: {user}\nAssistant: {assistant}' for user, assistant in turns)
+    if summary:
+        transcript = f'Earlier summary: {summary}\n{transcript}'
+    return chat_completion(
+        f"Summarize this conversation in a few sentences, keep names, places and facts. Keep it within {MAX_PROMPT_TOKENS} tokens.",
+        transcript,
+        timeout=timeout
+    )
+
+conversations = ConversationStore(
+    CONVERSATION_TOKEN_BUDGET,
+    CONVERSATION_IDLE_SECONDS,
+    summarize_turns if CONVERSATION_SUMMARIZE else None,
+    CONVERSATION_SUMMARIZE_TIMEOUT_SECONDS
+)
+
+def fetch_weather(city_name, country_code, timeout=None):
+    url = f'{OPENWEATHER_BASE_URL}/data/2.5/weather?q={city_name},{country_code}&appid={OPENWEATHER_API_KEY}&units=imperial'
+    key = normalize_prompt(f'{city_name},{country_code}')
+    return coalesce('weather', key, lambda: requests.get(url, timeout=timeout).json(), timeout)
+
+def run_tool(call, timeout=None):
+    if call.name == 'get_weather':
+        city = call.arguments.get('city', '')
+        country_code = call.arguments.get('country_code') or 'us'
+        weather = fetch_weather(city, country_code, timeout)
+        return {field: weather[field] for field in WEATHER_FIELDS if field in weather}
+    return {'error': f'unknown tool {call.name}'}
+
+# note: tool calls of one request run concurrently
+tool_pool = ThreadPoolExecutor(max_workers=8, thread_name_prefix='tool')
+
+def run_tools(calls, timeout=None):
+    calls = list({call.key(): call for call in calls}.values())
+    futures = [tool_pool.submit(run_tool, call, timeout) for call in calls]
+    return [{'tool': call.name, 'arguments': call.arguments, 'result': future.result()}
+            for call, future in zip(calls, futures)]
+
+def synthesize_speech(text, timeout=None):
+    # note: text-to-speech through the content-addressed cache, only a miss
+    # pays for the backend
+    voice, model = tts_backend.voice, tts_backend.model
+    key = TTSCache.key(text, voice, model, TTS_FORMAT)
+    speech = lambda text, voice, model, fmt: tts_backend.synthesize(text, fmt, timeout)
+    return coalesce('tts', key, lambda: tts_cache.get_or_create(text, voice, model, TTS_FORMAT, speech)[1], timeout)
+
+def write_file_atomic(path, data):
+    # note: replace atomically, a GET that already opened the previous file
+    # keeps streaming it from the old inode
+    tmp_path = f'{path}.tmp'
+    with open(tmp_path, 'wb') as file:
+        file.write(data)
+    os.replace(tmp_path, path)
+
+def prewarm_tts_cache(phrases):
+    for phrase in phrases:
+        try:
+            synthesize_speech(phrase)
+        except Exception as e:
+            print(f"Could not pre-warm TTS phrase '{phrase}': {e}")
+    try:
+        write_file_atomic(BUSY_RESPONSE_FILE, synthesize_speech(BUSY_PHRASE))
+    except Exception as e:
+        print(f"Could not synthesize the busy clip: {e}")
+    print("TTS cache ready: {}".format(tts_cache.stats()))
+
+device_responses = {} # device id -> (path of the audio its next GET receives, intent)
+device_responses_lock = threading.Lock()
+latest_response = (None, '')
+
+def set_device_response(device, path, intent):
+    global latest_response
+    with device_responses_lock:
+        device_responses[device] = (path, intent)
+        latest_response = (path, intent)
+
+def get_device_response(device):
+    with device_responses_lock:
+        return device_responses.get(device, latest_response)
+
+def save_speech_response(device, audio, intent):
+    os.makedirs(RESPONSE_DIR, exist_ok=True)
+    path = os.path.join(RESPONSE_DIR, f'{device}.{TTS_FORMAT}')
+    write_file_atomic(path, audio)
+    set_device_response(device, path, intent)
+
+def parse_byte_range(header, size):
+    # note: returns (first, last) for a single satisfiable range, None when the
+    # range cannot be satisfied and False when the header should be ignored
+    match = re.fullmatch(r'\s*bytes\s*=\s*(\d*)\s*-\s*(\d*)\s*', header)
+    if not match or (not match.group(1) and not match.group(2)):
+        return False
+
+    if not match.group(1):
+        suffix = int(match.group(2))
+        if suffix == 0 or size == 0:
+            return None
+        return max(size - suffix, 0), size - 1
+
+    first = int(match.group(1))
+    last = int(match.group(2)) if match.group(2) else size - 1
+    if first >= size or last < first:
+        return None
+    return first, min(last, size - 1)
 
 class Handler(BaseHTTPRequestHandler):
     def _set_headers(self, length):
@@ -34,6 +319,10 @@ class Handler(BaseHTTPRequestHandler):
             self.send_header('Content-length', str(length))
         self.end_headers()
 
+    def _device_id(self):
+        device = self.headers.get('x-device-id') or self.client_address[0]
+        return re.sub(r'[^A-Za-z0-9_.-]', '_', device)
+
     def _get_chunk_size(self):
         data = self.rfile.read(2)
         while data[-2:] != b"\r\n":
@@ -48,32 +337,124 @@ class Handler(BaseHTTPRequestHandler):
     def _write_wav(self, data, rates, bits, ch):
         t = datetime.datetime.utcnow()
         time = t.strftime('%Y%m%dT%H%M%SZ')
-        filename = str.format('{}_{}_{}_{}.wav', time, rates, bits, ch)
+        # note: the device id keeps uploads from different devices within the
+        # same second apart now that requests are handled concurrently
+        filename = str.format('{}_{}_{}_{}_{}.wav', time, rates, bits, ch, self._device_id())
 
         wavfile = wave.open(filename, 'wb')
         wavfile.setparams((ch, int(bits/8), rates, 0, 'NONE', 'NONE'))
-        wavfile.writeframesraw(bytearray(data))
+        wavfile.writeframesraw(data)
         wavfile.close()
         return filename
 
-    def _copy_mp3(self, source_file, destination_file):
-        try:
-            # Open the source MP3 file for reading in binary mode
-            with open(source_file, 'rb') as file:
-                # Read the contents of the source file
-                mp3_data = file.read()
-
-            # Open the destination MP3 file for writing in binary mode
-            with open(destination_file, 'wb') as file:
-                # Write the contents of the source file to the destination file
-                file.write(mp3_data)
-
-            print(f"Successfully copied {source_file} to {destination_file}")
+    def _send_busy(self, timer, reason, retry_after):
+        # note: fast path under overload, the device's next GET plays the
+        # pre-synthesized busy clip (or the chime if it is not ready yet)
+        REQUESTS_REJECTED.inc(reason=reason)
+        timer.labels['intent'] = 'busy'
+        path = BUSY_RESPONSE_FILE if os.path.exists(BUSY_RESPONSE_FILE) else CHIME_FILE
+        set_device_response(self._device_id(), path, 'busy')
+
+        body = 'Busy ({}), retry after {} s'.format(reason, retry_after).encode('utf-8')
+        self.send_response(503)
+        self.send_header("Content-type", "text/html;charset=utf-8")
+        self.send_header("Content-Length", str(len(body)))
+        self.send_header("Retry-After", str(retry_after))
+        self.end_headers()
+        self.wfile.write(body)
 
-        except Exception as e:
-            print(f"An error occurred: {e}")
+    def _process_upload(self, timer, data, total_bytes, sample_rates, bits, channel):
+        try:
+            rates, width, channels = int(sample_rates), int(bits), int(channel)
+        except ValueError:
+            raise audio_prep.UnsupportedAudio(f'audio headers: {sample_rates} Hz, {bits} bits, {channel} channel(s)') from None
+
+        # note: store our byte data to .wav file
+        speech_prompt = None
+        if SAVE_RECORDINGS:
+            with timer.stage('wav_write'):
+                speech_prompt = self._write_wav(data, rates, width, channels)
+
+        with timer.stage('audio_prep'):
+            audio = audio_prep.prepare(data, rates, width, channels, AUDIO_UPLOAD_FORMAT, TRIM_SILENCE)
+        print("Prepared {:.2f} s of speech, {} bytes to transcribe instead of {}".format(audio.seconds(), len(audio.data), total_bytes))
+
+        deadline = Deadline(REQUEST_DEADLINE_SECONDS, STAGE_TIMEOUTS)
+
+        # note: speech-to-text prompt transcription, keyed by the audio content.
+        # A recording that is silence throughout needs no transcription at all
+        audio_key = hashlib.sha256(f'{sample_rates}/{bits}/{channel}/'.encode() + data).hexdigest()
+        text_prompt = ''
+        if len(audio.samples):
+            with timer.stage('transcription'):
+                text_prompt = transcribe(audio, audio_key, deadline.timeout('transcription'))
+
+        # note: the local classifier resolves common weather commands without a
+        # model call, anything else is routed by one chat call that answers
+        # directly or asks for tools. Tools run concurrently and a single final
+        # completion turns their results into the answer.
+        calls = None
+        if not text_prompt.strip():
+            timer.labels['intent'] = 'empty'
+            text_response = NOT_UNDERSTOOD_PHRASE
+        else:
+            calls = router.classify(text_prompt)
+            if calls is None:
+                with timer.stage('intent_route'):
+                    text_response, calls = chat_route(text_prompt, conversations.history(self._device_id()),
+                                                      deadline.timeout('chat'))
+
+        if calls:
+            timer.labels['intent'] = 'weather'
+            print("requesting weather information...")
+
+            with timer.stage('weather_fetch'):
+                results = run_tools(calls, deadline.timeout('weather'))
+
+            content = f'''
+            Your job is to answer the user's question from the following weather data in natural English.
+            Make sure imperial units are spelled out in english. Keep it within {MAX_PROMPT_TOKENS} tokens.
+            '''
+
+            # note: assistant chat text response
+            with timer.stage('chat_summarize_weather'):
+                text_response = chat_completion(content, f"{text_prompt}\n{json.dumps(results)}",
+                                                timeout=deadline.timeout('chat'))
+        elif timer.labels['intent'] != 'empty':
+            timer.labels['intent'] = 'chat'
+            if not text_response.strip():
+                text_response = NOT_UNDERSTOOD_PHRASE
+
+        # note: store our latest response in text form
+        with open(TEXT_RESPONSE_FILE, "w") as file:
+            file.write(text_response)
+
+        # note: text-to-speech response generation, cached by content
+        with timer.stage('tts'):
+            speech_response = synthesize_speech(text_response, deadline.timeout('tts'))
+        save_speech_response(self._device_id(), speech_response, timer.labels['intent'])
+
+        if timer.labels['intent'] != 'empty':
+            conversations.append(self._device_id(), text_prompt, text_response)
+
+        if speech_prompt:
+            body = 'File {} was written, size {}'.format(speech_prompt, total_bytes).encode('utf-8')
+        else:
+            body = 'Upload received, size {}'.format(total_bytes).encode('utf-8')
+        self.send_response(200)
+        self.send_header("Content-type", "text/html;charset=utf-8")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
 
     def do_POST(self):
+        timer = metrics.StageTimer(STAGE_SECONDS, device=self._device_id(), intent='unknown')
+        try:
+            self._handle_post(timer)
+        finally:
+            timer.commit()
+
+    def _handle_post(self, timer):
         urlparts = parse.urlparse(self.path)
         request_file_path = urlparts.path.strip('/')
         total_bytes = 0
@@ -84,7 +465,7 @@ class Handler(BaseHTTPRequestHandler):
 
         if (request_file_path == 'upload'
             and self.headers.get('Transfer-Encoding', '').lower() == 'chunked'):
-            data = []
+            data = bytearray()
             sample_rates = self.headers.get('x-audio-sample-rates', '').lower()
             bits = self.headers.get('x-audio-bits', '').lower()
             channel = self.headers.get('x-audio-channel', '').lower()
@@ -92,93 +473,38 @@ class Handler(BaseHTTPRequestHandler):
 
             print("Audio information, sample rates: {}, bits: {}, channel(s): {}".format(sample_rates, bits, channel))
             # https://stackoverflow.com/questions/24500752/how-can-i-read-exactly-one-response-chunk-with-pythons-http-client
-            while True:
-                chunk_size = self._get_chunk_size()
-                total_bytes += chunk_size
-                print("Total bytes received: {}".format(total_bytes))
-                sys.stdout.write("\033[F")
-                if (chunk_size == 0):
-                    break
-                else:
-                    chunk_data = self._get_chunk_data(chunk_size)
-                    data += chunk_data
-
-            # note: store our byte data to .wav file
-            speech_prompt = self._write_wav(data, int(sample_rates), int(bits), int(channel))
-
-            # note: speech-to-text prompt transcription
-            text_prompt = client.audio.transcriptions.create(
-                model="whisper-1",
-                file=open(speech_prompt, "rb"),
-                response_format="text"
-            )
-
-            # note: parse through the user's prompt for key words like 'weather' or 'music'
-            if 'weather' in text_prompt:
-                print("requesting weather information...")
-
-                # note: parse out city name from text prompt
-                city_name = client.chat.completions.create(
-                    model="gpt-3.5-turbo",
-                    messages=[
-                        {"role": "system", "content": "Only return the city name embedded within text responses"},
-                        {"role": "user", "content": text_prompt}
-                    ],
-                    max_tokens=MAX_PROMPT_TOKENS
-                ).choices[0].message.content
-
-                country_code = 'us'
-
-                url = f'https://api.openweathermap.org/data/2.5/weather?q={city_name},{country_code}&appid={OPENWEATHER_API_KEY}&units=imperial'
-
-                weather_data = f"{requests.get(url).json()}"
-
-                content = f'''
-                Your job is to summarize the following 'weather' section of the json file into natural English.
-                Make sure imperial units are spelled out in english. Keep it within {MAX_PROMPT_TOKENS} tokens.
-                '''
-
-                # note: assistant chat text response
-                text_response = client.chat.completions.create(
-                    model="gpt-3.5-turbo",
-                    messages=[
-                        {"role": "system", "content": content},
-                        {"role": "user", "content": weather_data}
-                    ],
-                    max_tokens=MAX_PROMPT_TOKENS
-                ).choices[0].message.content
-            else:
-                # note: assistant chat text response
-                text_response = client.chat.completions.create(
-                    model="gpt-3.5-turbo",
-                    messages=[
-                        {"role": "system", "content": "You are a helpful assistant."},
-                        {"role": "user", "content": text_prompt}
-                    ],
-                    max_tokens=MAX_PROMPT_TOKENS
-                ).choices[0].message.content
-
-            # note: store our latest response in text form
-            with open(TEXT_RESPONSE_FILE, "w") as file:
-                file.write(text_response)
-
-            # note: text-to-speech response generation
-            speech_response = client.audio.speech.create(
-                model="tts-1",
-                voice="echo",
-                input=text_response
-            )
-
-            # note: stream and read our response back
-            speech_response.stream_to_file(SPEECH_RESPONSE_FILE)
-
-            self.send_response(200)
-            self.send_header("Content-type", "text/html;charset=utf-8")
-            self.send_header("Content-Length", str(total_bytes))
-            self.end_headers()
-            body = 'File {} was written, size {}'.format(speech_prompt, total_bytes)
-            self.wfile.write(body.encode('utf-8'))
-            selected_file = SPEECH_RESPONSE_FILE
+            with timer.stage('upload_receive'):
+                while True:
+                    chunk_size = self._get_chunk_size()
+                    total_bytes += chunk_size
+                    print("Total bytes received: {}".format(total_bytes))
+                    sys.stdout.write("\033[F")
+                    if (chunk_size == 0):
+                        break
+                    else:
+                        chunk_data = self._get_chunk_data(chunk_size)
+                        data += chunk_data
+
+            # note: admission is decided once the upload is drained, so a
+            # rejected device still gets a clean reply and fetches the busy clip
+            try:
+                with timer.stage('admission_wait'):
+                    admission.acquire(self._device_id())
+            except Rejected as e:
+                self._send_busy(timer, e.reason, e.retry_after)
+                return
+            try:
+                self._process_upload(timer, data, total_bytes, sample_rates, bits, channel)
+            except (DeadlineExceeded, APITimeoutError, requests.exceptions.Timeout):
+                self._send_busy(timer, 'deadline', 1)
+            except audio_prep.UnsupportedAudio as e:
+                # note: a recording no retry can fix, the device gets an error
+                # reply instead of a dropped connection
+                print(f"Unsupported upload: {e}")
+                timer.labels['intent'] = 'unsupported'
+                self.send_error(415, f'Unsupported audio: {e}')
+            finally:
+                admission.release()
 
         elif (request_file_path == 'log'):
             content_length = int(self.headers['Content-Length'])
@@ -187,17 +513,23 @@ class Handler(BaseHTTPRequestHandler):
             counter = data.get('counter')
 
             print("Received counter:", counter)
-
-            # note: text-to-speech response generation
-            speech_response = client.audio.speech.create(
-                model="tts-1",
-                voice="echo",
-                input=f"this device has been prompted {counter} times."
-            )
-
-            # note: stream and read our response back
-            speech_response.stream_to_file(SPEECH_RESPONSE_FILE)
-            selected_file = SPEECH_RESPONSE_FILE
+            timer.labels['intent'] = 'log'
+
+            try:
+                with timer.stage('admission_wait'):
+                    admission.acquire(self._device_id())
+            except Rejected as e:
+                self._send_busy(timer, e.reason, e.retry_after)
+                return
+            try:
+                # note: text-to-speech response generation, cached by content
+                with timer.stage('tts'):
+                    speech_response = synthesize_speech(LOG_PHRASE.format(counter), STAGE_TIMEOUTS['tts'])
+                save_speech_response(self._device_id(), speech_response, 'log')
+            except (APITimeoutError, requests.exceptions.Timeout):
+                self._send_busy(timer, 'deadline', 1)
+            finally:
+                admission.release()
 
         elif (request_file_path == 'chime'):
             content_length = int(self.headers['Content-Length'])
@@ -207,23 +539,103 @@ class Handler(BaseHTTPRequestHandler):
 
             print("Received chime:", chime)
             
-            # note: copy chime.mp3 into speech_response.mp3
-            self._copy_mp3("./chime.mp3", "./speech_response.mp3")
+            # note: point the device's next GET at chime.mp3, no copy needed
+            timer.labels['intent'] = 'chime'
+            set_device_response(self._device_id(), CHIME_FILE, 'chime')
+
+    def _serve_metrics(self):
+        body = metrics_registry.expose().encode('utf-8')
+        self.send_response(200)
+        self.send_header("Content-type", metrics.CONTENT_TYPE)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def _serve_file(self, timer, send_body):
+        request_file_path = parse.urlparse(self.path).path.strip('/')
+
+        if request_file_path == SPEECH_RESPONSE_FILE:
+            path, timer.labels['intent'] = get_device_response(self._device_id())
+        else:
+            path = STATIC_FILES.get(request_file_path)
+            timer.labels['intent'] = 'static'
+
+        try:
+            file = open(path, 'rb') if path else None
+        except FileNotFoundError:
+            file = None
+        if file is None:
+            self.send_error(404)
+            return
+
+        with file:
+            st = os.fstat(file.fileno())
+            size = st.st_size
+            etag = f'"{st.st_size:x}-{st.st_mtime_ns:x}"'
+
+            if_none_match = self.headers.get('If-None-Match', '')
+            if etag in [tag.strip() for tag in if_none_match.split(',')] or if_none_match.strip() == '*':
+                self.send_response(304)
+                self.send_header("ETag", etag)
+                self.end_headers()
+                return
+
+            # note: honor a single byte range so an interrupted http_stream can
+            # resume instead of downloading the whole answer again
+            status = 200
+            first, last = 0, size - 1
+            byte_range = self.headers.get('Range')
+            if byte_range and self.headers.get('If-Range', etag) == etag:
+                byte_range = parse_byte_range(byte_range, size)
+                if byte_range is None:
+                    self.send_response(416)
+                    self.send_header("Content-Range", f"bytes */{size}")
+                    self.send_header("Content-Length", "0")
+                    self.end_headers()
+                    return
+                if byte_range:
+                    status = 206
+                    first, last = byte_range
+
+            self.send_response(status)
+            self.send_header("Content-type", mimetypes.guess_type(path)[0] or "application/octet-stream")
+            self.send_header("Content-Disposition", f"attachment; filename={request_file_path}")
+            self.send_header("Content-Length", str(last - first + 1))
+            self.send_header("Accept-Ranges", "bytes")
+            self.send_header("ETag", etag)
+            self.send_header("Cache-Control", "no-cache")
+            if status == 206:
+                self.send_header("Content-Range", f"bytes {first}-{last}/{size}")
+            self.end_headers()
+
+            if send_body and last >= first:
+                # note: zero-copy from the page cache to the socket
+                self.wfile.flush()
+                self.connection.sendfile(file, first, last - first + 1)
 
     def do_GET(self):
         print("Do GET")
+        if parse.urlparse(self.path).path.strip('/') == 'metrics':
+            self._serve_metrics()
+            return
 
-        with open(SPEECH_RESPONSE_FILE, "rb") as file:
-            speech_response_data = file.read()
+        timer = metrics.StageTimer(STAGE_SECONDS, device=self._device_id(), intent='unknown')
+        try:
+            with timer.stage('response_serve'):
+                self._serve_file(timer, send_body=True)
+        finally:
+            timer.commit()
 
-        self.send_response(200)
-        self.send_header("Content-type", "audio/mpeg")
-        self.send_header("Content-Disposition", f"attachment; filename={SPEECH_RESPONSE_FILE}")
-        self.send_header("Content-Length", str(len(speech_response_data)))
-        self.end_headers()
-        self.wfile.write(speech_response_data)
+    def do_HEAD(self):
+        self._serve_file(metrics.StageTimer(STAGE_SECONDS), send_body=False)
 
 
+class Server(ThreadingHTTPServer):
+    # note: the default listen backlog of 5 resets connections during a burst,
+    # admission control is what decides which requests are served
+    request_queue_size = 128
+    daemon_threads = True
+
 def get_host_ip():
     # https://www.cnblogs.com/z-x-y/p/9529930.html
     try:
@@ -238,13 +650,33 @@ def main():
     parser = argparse.ArgumentParser(description='HTTP Server save EGR536-VoiceAssistantProject example speech data to wav file')
     parser.add_argument('--ip', '-i', nargs='?', type = str)
     parser.add_argument('--port', '-p', nargs='?', type = int)
+    parser.add_argument('--max-active', default=MAX_ACTIVE_REQUESTS, type = int, help='requests processed at once')
+    parser.add_argument('--max-queued', default=MAX_QUEUED_REQUESTS, type = int, help='requests waiting for a slot')
+    parser.add_argument('--device-rate', default=DEVICE_RATE_PER_SECOND, type = float, help='requests per second per device')
+    parser.add_argument('--asr', default=ASR_BACKEND, choices=['openai', 'whispercpp'], help='speech-to-text backend')
+    parser.add_argument('--chat', default=CHAT_BACKEND, choices=['openai', 'llamacpp'], help='chat backend')
+    parser.add_argument('--tts', default=TTS_BACKEND, choices=['openai', 'piper'], help='text-to-speech backend')
     args = parser.parse_args()
     if not args.ip:
         args.ip = get_host_ip()
     if not args.port:
         args.port = PORT
 
-    httpd = HTTPServer((args.ip, args.port), Handler)
+    global asr_backend, chat_backend, tts_backend
+    asr_backend, chat_backend, tts_backend = backends.create_backends(args.asr, args.chat, args.tts, BACKEND_SETTINGS)
+    print("Backends: speech-to-text {} ({}), chat {} ({}), text-to-speech {} ({})".format(
+        args.asr, asr_backend.model, args.chat, chat_backend.model, args.tts, tts_backend.model))
+
+    admission.max_active = args.max_active
+    admission.max_queued = args.max_queued
+    admission.device_rate = args.device_rate
+
+    # note: fill the TTS cache in the background so startup is not delayed
+    threading.Thread(target=prewarm_tts_cache, args=(PREWARM_PHRASES,), daemon=True).start()
+
+    # note: one thread per connection, so concurrent devices overlap their
+    # upstream calls instead of queueing behind each other
+    httpd = Server((args.ip, args.port), Handler)
 
     print("Serving HTTP on {} port {}".format(args.ip, args.port))
     httpd.serve_forever()
@@ -0,0 +1,40 @@
+'''
+Steps to run these cases:
+  - pip install pytest
+  - pytest test_router.py
+'''
+
+import pytest
+
+import router
+
+def cities(calls):
+    return [call.arguments['city'] for call in calls]
+
+@pytest.mark.parametrize('text, expected', [
+    ("What's the weather in Detroit?", ['Detroit']),
+    ('What is the weather like in New York City?', ['New York City']),
+    ("What's the temperature in Detroit right now?", ['Detroit']),
+    ('Tell me the forecast for San Francisco.', ['San Francisco']),
+    ("How's the weather in Detroit and Chicago today?", ['Detroit', 'Chicago']),
+    ('weather in Detroit', ['Detroit']),
+])
+def test_weather_question(text, expected):
+    calls = router.classify(text)
+    assert calls is not None
+    assert [call.name for call in calls] == ['get_weather'] * len(expected)
+    assert cities(calls) == expected
+
+@pytest.mark.parametrize('text', [
+    'is it usually cloudy in April',
+    "what's the temperature at Christmas",
+    'tell me about the wind in The Wind in the Willows',
+    "What's the weather in December?",
+    "What's the weather in Detroit, Michigan?",
+    "What's the weather going to be in Detroit tomorrow?",
+    'How is the weather today?',
+    'Is it raining in Seattle?',
+    'Tell me a joke about microcontrollers.',
+])
+def test_left_to_the_model(text):
+    assert router.classify(text) is None
@@ -0,0 +1,125 @@
+import os
+import hashlib
+import threading
+
+from collections import OrderedDict
+
+# note: content-addressed text-to-speech cache, entries are keyed by a hash of
+# everything that changes the synthesized audio (text, voice, model, format)
+# and live in a small memory tier backed by a larger on-disk tier. Both tiers
+# are bounded in bytes and evict the least recently used entry first.
+
+class TTSCache:
+    def __init__(self, directory, max_memory_bytes, max_disk_bytes):
+        self.directory = directory
+        self.max_memory_bytes = max_memory_bytes
+        self.max_disk_bytes = max_disk_bytes
+
+        self._lock = threading.Lock()
+        self._memory = OrderedDict() # key -> audio bytes
+        self._memory_bytes = 0
+        self._disk = OrderedDict()   # key -> file size
+        self._disk_bytes = 0
+
+        os.makedirs(directory, exist_ok=True)
+        self._load_disk_index()
+
+    @staticmethod
+    def key(text, voice, model, fmt):
+        h = hashlib.sha256()
+        for field in (model, voice, fmt, text):
+            h.update(field.encode('utf-8'))
+            h.update(b'\0')
+        return h.hexdigest()
+
+    def path(self, key, fmt):
+        return os.path.join(self.directory, f'{key}.{fmt}')
+
+    def _load_disk_index(self):
+        # note: rebuild the disk LRU order from file modification times, so
+        # entries survive a server restart
+        entries = []
+        for name in os.listdir(self.directory):
+            key, _, ext = name.partition('.')
+            if len(key) != 64 or not ext or '.' in ext:
+                continue
+            st = os.stat(os.path.join(self.directory, name))
+            entries.append((st.st_mtime, key, ext, st.st_size))
+
+        for _, key, ext, size in sorted(entries):
+            self._disk[(key, ext)] = size
+            self._disk_bytes += size
+        self._evict_disk()
+
+    def _remember(self, key, data):
+        if key in self._memory:
+            self._memory.move_to_end(key)
+            return
+        if len(data) > self.max_memory_bytes:
+            return
+        self._memory[key] = data
+        self._memory_bytes += len(data)
+        while self._memory_bytes > self.max_memory_bytes:
+            _, old = self._memory.popitem(last=False)
+            self._memory_bytes -= len(old)
+
+    def _evict_disk(self):
+        while self._disk_bytes > self.max_disk_bytes and self._disk:
+            (key, ext), size = self._disk.popitem(last=False)
+            self._disk_bytes -= size
+            try:
+                os.remove(self.path(key, ext))
+            except FileNotFoundError:
+                pass
+
+    def get(self, key, fmt):
+        with self._lock:
+            data = self._memory.get((key, fmt))
+            if data is not None:
+                self._memory.move_to_end((key, fmt))
+                return data
+
+            if (key, fmt) not in self._disk:
+                return None
+            try:
+                with open(self.path(key, fmt), 'rb') as file:
+                    data = file.read()
+            except FileNotFoundError:
+                self._disk_bytes -= self._disk.pop((key, fmt))
+                return None
+
+            self._disk.move_to_end((key, fmt))
+            os.utime(self.path(key, fmt))
+            self._remember((key, fmt), data)
+            return data
+
+    def put(self, key, fmt, data):
+        path = self.path(key, fmt)
+        tmp_path = f'{path}.{threading.get_ident()}.tmp'
+        with open(tmp_path, 'wb') as file:
+            file.write(data)
+        os.replace(tmp_path, path)
+
+        with self._lock:
+            old_size = self._disk.pop((key, fmt), 0)
+            self._disk[(key, fmt)] = len(data)
+            self._disk_bytes += len(data) - old_size
+            self._remember((key, fmt), data)
+            self._evict_disk()
+
+    def get_or_create(self, text, voice, model, fmt, synthesize):
+        key = self.key(text, voice, model, fmt)
+        data = self.get(key, fmt)
+        if data is None:
+            data = synthesize(text, voice, model, fmt)
+            self.put(key, fmt, data)
+        return key, data
+
+    def stats(self):
+        with self._lock:
+            return {
+                'memory_entries': len(self._memory),
+                'memory_bytes': self._memory_bytes,
+                'disk_entries': len(self._disk),
+                'disk_bytes': self._disk_bytes,
+            }